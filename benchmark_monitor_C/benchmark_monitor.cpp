@@ -15,6 +15,9 @@ using namespace system_monitor;
 // Variables globales para monitoreo
 // ============================================================
 static SystemMonitor* g_monitor = nullptr;
+// Un único contador para el inicio (en cada benchmark) y el final (en el reporter):
+// cada RaplCounter mide desde su propia construcción
+static RaplCounter* g_rapl = nullptr;
 static CSVWriter* g_csv_writer = nullptr;
 static uint64_t g_energy_start = 0;
 static double g_temp_start = 0.0;
@@ -42,7 +45,7 @@ static void BM_VectorAdd(benchmark::State& state) {
     std::vector<double> c(N, 0.0);
     
     // Medición inicial
-    g_energy_start = g_monitor->readRAPLEnergy();
+    g_energy_start = g_rapl->readEnergyUJ();
     g_temp_start = g_monitor->getTemperature();
     
     for (auto _ : state) {
@@ -69,7 +72,7 @@ static void BM_DotProduct(benchmark::State& state) {
     std::vector<double> a(N, 1.5);
     std::vector<double> b(N, 2.5);
     
-    g_energy_start = g_monitor->readRAPLEnergy();
+    g_energy_start = g_rapl->readEnergyUJ();
     g_temp_start = g_monitor->getTemperature();
     
     for (auto _ : state) {
@@ -95,7 +98,7 @@ static void BM_MemCpy(benchmark::State& state) {
     std::vector<char> src(N, 'A');
     std::vector<char> dst(N, 'B');
     
-    g_energy_start = g_monitor->readRAPLEnergy();
+    g_energy_start = g_rapl->readEnergyUJ();
     g_temp_start = g_monitor->getTemperature();
     
     for (auto _ : state) {
@@ -117,7 +120,7 @@ static void BM_LoopCopy(benchmark::State& state) {
     std::vector<char> src(N, 'A');
     std::vector<char> dst(N, 'B');
     
-    g_energy_start = g_monitor->readRAPLEnergy();
+    g_energy_start = g_rapl->readEnergyUJ();
     g_temp_start = g_monitor->getTemperature();
     
     for (auto _ : state) {
@@ -144,7 +147,7 @@ static void BM_MatrixMultiply(benchmark::State& state) {
     std::vector<float> B(K * N, 2.0f);
     std::vector<float> C(M * N, 0.0f);
     
-    g_energy_start = g_monitor->readRAPLEnergy();
+    g_energy_start = g_rapl->readEnergyUJ();
     g_temp_start = g_monitor->getTemperature();
     
     for (auto _ : state) {
@@ -199,7 +202,7 @@ public:
         std::cout << "   CPU Freq: " << cpu_info.freq_mhz << " MHz" << std::endl;
         std::cout << "   Governor: " << cpu_info.governor << std::endl;
         
-        if (monitor_->isRAPLAvailable()) {
+        if (g_rapl->isAvailable()) {
             std::cout << "   ✅ RAPL disponible" << std::endl;
         } else {
             std::cout << "   ⚠️  RAPL no disponible" << std::endl;
@@ -237,7 +240,7 @@ public:
             result.time_s = run.GetAdjustedRealTime() / 1e9;  // ns a s
             
             // Energía
-            uint64_t energy_end = monitor_->readRAPLEnergy();
+            uint64_t energy_end = g_rapl->readEnergyUJ();
             result.energy.energy_uj = energy_end - g_energy_start;
             result.energy.energy_j = result.energy.energy_uj / 1e6;
             result.energy.power_avg_w = SystemMonitor::calculatePowerAvg(
@@ -288,6 +291,7 @@ private:
 int main(int argc, char** argv) {
     // Inicializar monitor global
     g_monitor = new SystemMonitor();
+    g_rapl = new RaplCounter(powercapRoot());
     
     // Verificar permisos
     if (geteuid() != 0) {
@@ -302,6 +306,7 @@ int main(int argc, char** argv) {
     benchmark::RunSpecifiedBenchmarks(&reporter);
     
     // Cleanup
+    delete g_rapl;
     delete g_monitor;
     
     return 0;
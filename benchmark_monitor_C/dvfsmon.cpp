@@ -0,0 +1,205 @@
+// dvfsmon.cpp - API C (dvfsmon.h) sobre SystemMonitor, RaplCounter, PerfCounters, los marcadores de
+// región y el anillo en memoria compartida
+#include "dvfsmon.h"
+#include "region_markers.h"
+#include "shm_ring.h"
+#include "system_monitor.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <new>
+#include <sched.h>
+
+using namespace system_monitor;
+
+namespace {
+
+#define DVFSMON_STR2(x) #x
+#define DVFSMON_STR(x) DVFSMON_STR2(x)
+const char kVersion[] = DVFSMON_STR(DVFSMON_VERSION_MAJOR) "." DVFSMON_STR(DVFSMON_VERSION_MINOR) "."
+                        DVFSMON_STR(DVFSMON_VERSION_PATCH);
+
+// Estado al abrir una región
+struct Region {
+    const char* name;
+    uint64_t t_ns;
+    uint64_t energy_uj;
+    PerfMetrics perf;
+};
+
+} // namespace
+
+struct dvfsmon_session {
+    dvfsmon_session() : rapl(powercapRoot()), capabilities(0), depth(0) {}
+
+    SystemMonitor monitor;
+    RaplCounter rapl;
+    PerfCounters perf;
+    unsigned capabilities;
+    int depth;
+    Region stack[DVFSMON_MAX_DEPTH];
+
+    void snapshot(Region* r) {
+        r->t_ns = nowNs();
+        r->energy_uj = rapl.readEnergyUJ();
+        if (!perf.read(&r->perf)) r->perf = PerfMetrics{0, 0, 0, 0, 0.0};
+    }
+};
+
+extern "C" {
+
+const char* dvfsmon_version(void) { return kVersion; }
+
+const char* dvfsmon_strerror(int status) {
+    switch (status) {
+    case DVFSMON_OK: return "ok";
+    case DVFSMON_EINVAL: return "invalid argument";
+    case DVFSMON_ENOMEM: return "out of memory";
+    case DVFSMON_EUNAVAIL: return "measurement not available on this machine";
+    case DVFSMON_ESTATE: return "no open region, or region stack full";
+    case DVFSMON_EIO: return "cannot write the region summary";
+    case DVFSMON_EAGAIN: return "sample not published yet";
+    case DVFSMON_ELOST: return "sample already overwritten in the ring";
+    default: return "unknown status";
+    }
+}
+
+int dvfsmon_open(dvfsmon_session** out) {
+    if (!out) return DVFSMON_EINVAL;
+    *out = nullptr;
+    dvfsmon_session* s = nullptr;
+    try {
+        s = new dvfsmon_session();
+    } catch (const std::bad_alloc&) {
+        return DVFSMON_ENOMEM;
+    }
+    if (s->rapl.isAvailable()) s->capabilities |= DVFSMON_CAP_ENERGY;
+    if (s->perf.isAvailable()) s->capabilities |= DVFSMON_CAP_COUNTERS;
+    if (s->monitor.getCPUFreqMHz(0) > 0.0) s->capabilities |= DVFSMON_CAP_FREQUENCY;
+    if (s->monitor.getTemperature() > 0.0) s->capabilities |= DVFSMON_CAP_TEMPERATURE;
+    *out = s;
+    return DVFSMON_OK;
+}
+
+void dvfsmon_close(dvfsmon_session* session) { delete session; }
+
+unsigned dvfsmon_capabilities(const dvfsmon_session* session) { return session ? session->capabilities : 0; }
+
+int dvfsmon_region_start(dvfsmon_session* session, const char* name) {
+    if (!session || !name) return DVFSMON_EINVAL;
+    if (session->depth == DVFSMON_MAX_DEPTH) return DVFSMON_ESTATE;
+    Region* r = &session->stack[session->depth++];
+    r->name = name;
+    session->snapshot(r);
+    return DVFSMON_OK;
+}
+
+int dvfsmon_region_stop(dvfsmon_session* session, dvfsmon_region_metrics* out) {
+    if (!session) return DVFSMON_EINVAL;
+    if (session->depth == 0) return DVFSMON_ESTATE;
+    Region end;
+    session->snapshot(&end);
+    const Region& begin = session->stack[--session->depth];
+    if (!out) return DVFSMON_OK;
+
+    out->name = begin.name;
+    out->depth = session->depth;
+    out->time_s = (end.t_ns - begin.t_ns) / 1e9;
+    out->energy_j = (end.energy_uj - begin.energy_uj) / 1e6;
+    out->power_avg_w = SystemMonitor::calculatePowerAvg(out->energy_j, out->time_s);
+    out->counters.instructions = end.perf.instructions - begin.perf.instructions;
+    out->counters.cycles = end.perf.cycles - begin.perf.cycles;
+    out->counters.cache_misses = end.perf.cache_misses - begin.perf.cache_misses;
+    out->counters.branch_misses = end.perf.branch_misses - begin.perf.branch_misses;
+    out->ipc = SystemMonitor::calculateIPC(out->counters.instructions, out->counters.cycles);
+    return DVFSMON_OK;
+}
+
+int dvfsmon_read_energy(dvfsmon_session* session, double* joules) {
+    if (!session || !joules) return DVFSMON_EINVAL;
+    *joules = 0.0;
+    if (!(session->capabilities & DVFSMON_CAP_ENERGY)) return DVFSMON_EUNAVAIL;
+    *joules = session->rapl.readEnergyUJ() / 1e6;
+    return DVFSMON_OK;
+}
+
+int dvfsmon_read_counters(dvfsmon_session* session, dvfsmon_counters* out) {
+    if (!session || !out) return DVFSMON_EINVAL;
+    PerfMetrics perf = {0, 0, 0, 0, 0.0};
+    bool ok = session->perf.read(&perf);
+    out->instructions = perf.instructions;
+    out->cycles = perf.cycles;
+    out->cache_misses = perf.cache_misses;
+    out->branch_misses = perf.branch_misses;
+    return ok ? DVFSMON_OK : DVFSMON_EUNAVAIL;
+}
+
+int dvfsmon_read_frequency(dvfsmon_session* session, int cpu, double* mhz) {
+    if (!session || !mhz) return DVFSMON_EINVAL;
+    if (cpu < 0) cpu = sched_getcpu();
+    *mhz = cpu >= 0 ? session->monitor.getCPUFreqMHz(cpu) : 0.0;
+    return *mhz > 0.0 ? DVFSMON_OK : DVFSMON_EUNAVAIL;
+}
+
+int dvfsmon_read_temperature(dvfsmon_session* session, double* celsius) {
+    if (!session || !celsius) return DVFSMON_EINVAL;
+    *celsius = session->monitor.getTemperature();
+    return *celsius > 0.0 ? DVFSMON_OK : DVFSMON_EUNAVAIL;
+}
+
+void dvfsmon_region_begin(const char* name) {
+    if (name) regionBegin(name);
+}
+
+void dvfsmon_region_end(void) { regionEnd(); }
+
+int dvfsmon_regions_write(const char* path) {
+    if (!path) return writeRegionSummary(stderr) ? DVFSMON_OK : DVFSMON_EIO;
+    FILE* f = fopen(path, "w");
+    if (!f) return DVFSMON_EIO;
+    bool ok = writeRegionSummary(f);
+    return fclose(f) == 0 && ok ? DVFSMON_OK : DVFSMON_EIO;
+}
+
+struct dvfsmon_shm {
+    ShmRingReader reader;
+};
+
+int dvfsmon_shm_attach(const char* name, dvfsmon_shm** out) {
+    if (!out) return DVFSMON_EINVAL;
+    *out = nullptr;
+    dvfsmon_shm* shm = nullptr;
+    try {
+        shm = new dvfsmon_shm();
+    } catch (const std::bad_alloc&) {
+        return DVFSMON_ENOMEM;
+    }
+    int status = shm->reader.attach(name ? name : DVFSMON_SHM_NAME);
+    if (status != DVFSMON_OK) {
+        delete shm;
+        return status;
+    }
+    *out = shm;
+    return DVFSMON_OK;
+}
+
+void dvfsmon_shm_detach(dvfsmon_shm* shm) { delete shm; }
+
+int dvfsmon_shm_info_get(const dvfsmon_shm* shm, dvfsmon_shm_info* out) {
+    if (!shm || !out) return DVFSMON_EINVAL;
+    shm->reader.info(out);
+    return DVFSMON_OK;
+}
+
+int dvfsmon_shm_latest(const dvfsmon_shm* shm, dvfsmon_sample* out) {
+    if (!shm || !out) return DVFSMON_EINVAL;
+    return shm->reader.latest(out);
+}
+
+int dvfsmon_shm_read(const dvfsmon_shm* shm, uint64_t seq_no, dvfsmon_sample* out) {
+    if (!shm || !out) return DVFSMON_EINVAL;
+    return shm->reader.read(seq_no, out);
+}
+
+} // extern "C"
@@ -0,0 +1,178 @@
+/* dvfsmon.h - API C de la biblioteca de monitoreo (libdvfsmon)
+ *
+ * Expone el mismo motor de medición que usan los benchmarks (system_monitor.h) para
+ * que una aplicación se instrumente a sí misma: abrir una sesión, delimitar regiones
+ * y leer energía (RAPL), frecuencia, temperatura y contadores hardware (perf_event).
+ *
+ * Una sesión pertenece a un hilo: sus contadores hardware cuentan el hilo que la
+ * abrió y sus regiones forman una pila que no se protege con locks. La energía es
+ * la de todo el nodo (paquetes y DRAM). Cada fuente que la máquina no ofrezca
+ * (sin RAPL, perf_event_paranoid > 2, sin cpufreq) se indica en
+ * dvfsmon_capabilities() y se lee como 0, sin que la sesión falle.
+ *
+ * Además de las sesiones, dvfsmon_region_begin/dvfsmon_region_end marcan regiones sin
+ * sesión en cualquier hilo, con un coste muy por debajo de un microsegundo, y al
+ * salir del proceso escriben un resumen por nombre de región.
+ *
+ * Si en el nodo corre el demonio dvfsmond, dvfsmon_shm_* leen sus últimas muestras de
+ * memoria compartida, sin tocar sysfs.
+ *
+ * Variables de entorno:
+ *   DVFSMON_POWERCAP_ROOT  directorio powercap (por defecto /sys/class/powercap)
+ *   DVFSMON_SAMPLE_MS      periodo de muestreo de RAPL para los marcadores (10 por defecto)
+ *   DVFSMON_REGIONS_OUT    archivo del resumen de marcadores al salir (por defecto
+ *                          stderr; "none" no lo escribe)
+ *
+ * Con CMake:
+ *   find_package(dvfsmon REQUIRED)
+ *   target_link_libraries(app PRIVATE dvfsmon::dvfsmon)         # o dvfsmon::dvfsmon_static
+ */
+#ifndef DVFSMON_H
+#define DVFSMON_H
+
+#include <stdint.h>
+
+#if defined(DVFSMON_BUILDING) && defined(__GNUC__)
+#define DVFSMON_API __attribute__((visibility("default")))
+#else
+#define DVFSMON_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DVFSMON_VERSION_MAJOR 1
+#define DVFSMON_VERSION_MINOR 0
+#define DVFSMON_VERSION_PATCH 0
+
+/* Profundidad máxima de regiones anidadas en una sesión o en un hilo (marcadores) */
+#define DVFSMON_MAX_DEPTH 64
+
+/* Códigos de retorno: 0 o negativos */
+enum dvfsmon_status {
+    DVFSMON_OK = 0,
+    DVFSMON_EINVAL = -1,   /* argumento nulo o fuera de rango */
+    DVFSMON_ENOMEM = -2,
+    DVFSMON_EUNAVAIL = -3, /* la máquina no ofrece esa medida */
+    DVFSMON_ESTATE = -4,   /* dvfsmon_region_stop sin región abierta, o pila llena */
+    DVFSMON_EIO = -5,      /* no se pudo escribir el resumen */
+    DVFSMON_EAGAIN = -6,   /* muestra aún no publicada */
+    DVFSMON_ELOST = -7     /* muestra ya sobrescrita en el anillo */
+};
+
+/* Bits de dvfsmon_capabilities() */
+#define DVFSMON_CAP_ENERGY      0x1u /* RAPL legible */
+#define DVFSMON_CAP_COUNTERS    0x2u /* grupo perf_event abierto */
+#define DVFSMON_CAP_FREQUENCY   0x4u /* cpufreq legible */
+#define DVFSMON_CAP_TEMPERATURE 0x8u /* thermal_zone o hwmon legible */
+
+typedef struct dvfsmon_session dvfsmon_session;
+
+typedef struct dvfsmon_counters {
+    uint64_t instructions;
+    uint64_t cycles;
+    uint64_t cache_misses;
+    uint64_t branch_misses;
+} dvfsmon_counters;
+
+/* Lo medido entre dvfsmon_region_start y dvfsmon_region_stop */
+typedef struct dvfsmon_region_metrics {
+    const char* name;      /* el puntero pasado a dvfsmon_region_start */
+    int depth;             /* 0 para la región más externa */
+    double time_s;
+    double energy_j;
+    double power_avg_w;
+    double ipc;
+    dvfsmon_counters counters;
+} dvfsmon_region_metrics;
+
+/* "MAJOR.MINOR.PATCH" de la biblioteca enlazada */
+DVFSMON_API const char* dvfsmon_version(void);
+/* Texto de un dvfsmon_status */
+DVFSMON_API const char* dvfsmon_strerror(int status);
+
+/* Abre una sesión para el hilo que llama; *out queda en NULL si falla */
+DVFSMON_API int dvfsmon_open(dvfsmon_session** out);
+/* Cierra la sesión (acepta NULL); las regiones abiertas se descartan */
+DVFSMON_API void dvfsmon_close(dvfsmon_session* session);
+/* Bits DVFSMON_CAP_* disponibles en esta sesión */
+DVFSMON_API unsigned dvfsmon_capabilities(const dvfsmon_session* session);
+
+/* Abre una región anidada en la actual. name no se copia: debe seguir siendo válido
+ * hasta el dvfsmon_region_stop correspondiente. */
+DVFSMON_API int dvfsmon_region_start(dvfsmon_session* session, const char* name);
+/* Cierra la región más interna y, si out no es NULL, escribe lo medido en ella */
+DVFSMON_API int dvfsmon_region_stop(dvfsmon_session* session, dvfsmon_region_metrics* out);
+
+/* Energía del nodo desde dvfsmon_open (J) */
+DVFSMON_API int dvfsmon_read_energy(dvfsmon_session* session, double* joules);
+/* Contadores del hilo desde dvfsmon_open */
+DVFSMON_API int dvfsmon_read_counters(dvfsmon_session* session, dvfsmon_counters* out);
+/* Frecuencia actual de una CPU (MHz); cpu < 0 lee la CPU en la que corre el hilo */
+DVFSMON_API int dvfsmon_read_frequency(dvfsmon_session* session, int cpu, double* mhz);
+/* Temperatura de la CPU (°C) */
+DVFSMON_API int dvfsmon_read_temperature(dvfsmon_session* session, double* celsius);
+
+/* ---- Marcadores de región ----
+ * Cada hilo tiene su propia pila de regiones (hasta DVFSMON_MAX_DEPTH; las más
+ * profundas no se miden) y su tabla de totales por nombre, que sólo escribe él. Un
+ * marcador lee el reloj monotónico, la energía de la última muestra de un hilo de
+ * muestreo RAPL (extrapolada al instante actual) y los contadores del hilo con rdpmc;
+ * no toma locks ni hace syscalls salvo el primero de cada hilo, que abre sus
+ * contadores. La energía es la del nodo durante la región: regiones simultáneas en
+ * varios hilos la cuentan cada una. Los tiempos y contadores son inclusivos.
+ *
+ * name no se copia y se agrega por puntero: debe vivir hasta el final del proceso
+ * (un literal). Nombres iguales en punteros distintos se suman en el resumen.
+ * Un dvfsmon_region_end sin región abierta no hace nada. */
+DVFSMON_API void dvfsmon_region_begin(const char* name);
+DVFSMON_API void dvfsmon_region_end(void);
+/* Resumen de las regiones cerradas hasta ahora (una línea key=value por nombre, de
+ * mayor a menor tiempo) en path, o en stderr si path es NULL */
+DVFSMON_API int dvfsmon_regions_write(const char* path);
+
+/* ---- Muestras del demonio en memoria compartida ----
+ * dvfsmond publica cada periodo una muestra del nodo en un anillo dentro de un
+ * segmento POSIX (shm_open). Los lectores lo mapean de sólo lectura: leer una muestra
+ * es copiarla bajo el seqlock de su slot, sin syscalls ni locks, y cualquier número
+ * de procesos puede hacerlo a la vez sin frenar al demonio. Un lector que se quede
+ * atrás más de capacity muestras las pierde (DVFSMON_ELOST). */
+#define DVFSMON_SHM_NAME "/dvfsmon"
+#define DVFSMON_SHM_MAX_CPUS 1024
+
+typedef struct dvfsmon_sample {
+    uint64_t seq_no;         /* 1, 2, ... en orden de publicación */
+    uint64_t t_ns;           /* CLOCK_MONOTONIC al tomarla */
+    double energy_j;         /* RAPL de paquetes y DRAM desde que arrancó el demonio */
+    double power_w;          /* potencia media desde la muestra anterior */
+    double temperature_c;
+    uint32_t capabilities;   /* DVFSMON_CAP_ENERGY, _FREQUENCY, _TEMPERATURE */
+    uint32_t ncpus;          /* entradas válidas de freq_mhz */
+    float freq_mhz[DVFSMON_SHM_MAX_CPUS];  /* por CPU lógica; 0 sin cpufreq */
+} dvfsmon_sample;
+
+typedef struct dvfsmon_shm_info {
+    uint32_t period_ms;
+    uint32_t capacity;       /* muestras que guarda el anillo */
+    int32_t writer_pid;      /* 0 si el demonio terminó */
+    uint64_t head;           /* seq_no de la última muestra (0: todavía ninguna) */
+} dvfsmon_shm_info;
+
+typedef struct dvfsmon_shm dvfsmon_shm;
+
+/* Mapea el segmento name (NULL: DVFSMON_SHM_NAME); DVFSMON_EUNAVAIL si no hay
+ * demonio o el segmento es de otra versión */
+DVFSMON_API int dvfsmon_shm_attach(const char* name, dvfsmon_shm** out);
+DVFSMON_API void dvfsmon_shm_detach(dvfsmon_shm* shm);
+DVFSMON_API int dvfsmon_shm_info_get(const dvfsmon_shm* shm, dvfsmon_shm_info* out);
+/* La última muestra publicada */
+DVFSMON_API int dvfsmon_shm_latest(const dvfsmon_shm* shm, dvfsmon_sample* out);
+/* La muestra seq_no, para leerlas todas en orden */
+DVFSMON_API int dvfsmon_shm_read(const dvfsmon_shm* shm, uint64_t seq_no, dvfsmon_sample* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DVFSMON_H */
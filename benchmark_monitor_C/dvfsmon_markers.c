@@ -0,0 +1,93 @@
+/* dvfsmon_markers.c - Ejemplo de los marcadores de región de dvfsmon (y prueba de ellos)
+ *
+ * Uso: dvfsmon_markers THREADS ITERATIONS [--work-us=N] [--deep=N] [--overhead=N]
+ * Cada uno de THREADS hilos repite ITERATIONS veces una región "outer" con una "inner"
+ * anidada (N microsegundos de trabajo en total, 20 por defecto). Después el hilo
+ * principal abre --deep regiones "deep" anidadas y mide el coste medio de un par
+ * begin/end vacío sobre --overhead pares (100000 por defecto), que escribe en stdout.
+ * El resumen por región lo escribe la biblioteca al salir (DVFSMON_REGIONS_OUT).
+ */
+#include "dvfsmon.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static long g_iterations;
+static double g_work_s = 20e-6;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void spin(double seconds) {
+    volatile double x = 1.0;
+    double end = now_s() + seconds;
+    while (now_s() < end) x = x * 1.0000001 + 1e-9;
+}
+
+static void* worker(void* arg) {
+    long i;
+    (void)arg;
+    for (i = 0; i < g_iterations; ++i) {
+        dvfsmon_region_begin("outer");
+        spin(g_work_s / 2);
+        dvfsmon_region_begin("inner");
+        spin(g_work_s / 2);
+        dvfsmon_region_end();
+        dvfsmon_region_end();
+    }
+    return NULL;
+}
+
+static int usage(const char* prog) {
+    fprintf(stderr, "Usage: %s THREADS ITERATIONS [--work-us=N] [--deep=N] [--overhead=N]\n", prog);
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    long threads = -1, deep = 0, overhead = 100000, i;
+    int positional = 0, a;
+    pthread_t* tids;
+    double t0, marker_ns;
+
+    for (a = 1; a < argc; ++a) {
+        if (strncmp(argv[a], "--work-us=", 10) == 0) {
+            g_work_s = atof(argv[a] + 10) * 1e-6;
+        } else if (strncmp(argv[a], "--deep=", 7) == 0) {
+            deep = atol(argv[a] + 7);
+        } else if (strncmp(argv[a], "--overhead=", 11) == 0) {
+            overhead = atol(argv[a] + 11);
+        } else if (argv[a][0] == '-' || positional == 2) {
+            return usage(argv[0]);
+        } else if (positional++ == 0) {
+            threads = atol(argv[a]);
+        } else {
+            g_iterations = atol(argv[a]);
+        }
+    }
+    if (positional != 2 || threads < 0 || g_iterations < 0 || deep < 0 || overhead < 1 || g_work_s < 0.0)
+        return usage(argv[0]);
+
+    tids = malloc(sizeof(pthread_t) * (threads > 0 ? threads : 1));
+    for (i = 0; i < threads; ++i) pthread_create(&tids[i], NULL, worker, NULL);
+    for (i = 0; i < threads; ++i) pthread_join(tids[i], NULL);
+    free(tids);
+
+    for (i = 0; i < deep; ++i) dvfsmon_region_begin("deep");
+    for (i = 0; i < deep; ++i) dvfsmon_region_end();
+    dvfsmon_region_end(); /* sin región abierta: se ignora */
+
+    t0 = now_s();
+    for (i = 0; i < overhead; ++i) {
+        dvfsmon_region_begin("empty");
+        dvfsmon_region_end();
+    }
+    marker_ns = (now_s() - t0) / overhead * 1e9;
+    printf("threads=%ld,iterations=%ld,marker_ns=%.1f\n", threads, g_iterations, marker_ns);
+    return 0;
+}
@@ -0,0 +1,342 @@
+// dvfsmon_preload.cpp - Perfilador por LD_PRELOAD sobre la biblioteca dvfsmon
+//
+//   LD_PRELOAD=libdvfsmon_preload.so ./app
+//
+// mide un binario sin recompilarlo. Un constructor arranca el muestreo de RAPL de los
+// marcadores y abre los contadores del proceso (PerfCounters con inherit, antes de que
+// la aplicación cree hilos); al salir se escribe una línea con el total del proceso
+// seguida del resumen de regiones. Las regiones salen de los marcadores que la
+// aplicación ya tenga (dvfsmon_region_begin/end) y, opcionalmente, de puntos de
+// entrada conocidos (DVFSMON_PRELOAD_REGIONS):
+//   - MPI: las funciones MPI_* de la tabla se interponen y llaman a su PMPI_* (la
+//     interfaz de perfilado del estándar), resuelta con dlsym en la primera llamada;
+//   - OpenMP: ompt_start_tool registra una herramienta OMPT con los callbacks de región
+//     paralela y de tarea implícita (runtimes con OMPT, como libomp de LLVM o el de
+//     Intel; libgomp no lo tiene y las regiones omp no aparecen). libomp avisa del fin
+//     de la tarea implícita de cada hilo del equipo al empezar la región siguiente, así
+//     que la última de cada hilo no se cuenta.
+// Sin hooks activos el coste es el del hilo de muestreo (un pread por dominio RAPL cada
+// DVFSMON_SAMPLE_MS); cada llamada marcada cuesta un par de marcadores.
+//
+// Variables de entorno (además de las de dvfsmon.h):
+//   DVFSMON_PRELOAD_OUT      archivo del informe; %p es el pid y %r el rango MPI que
+//                            da el lanzador (0 si no hay). Por defecto stderr; "none"
+//                            no lo escribe
+//   DVFSMON_PRELOAD_REGIONS  hooks separados por comas: nombres de la tabla kHooks, o
+//                            "mpi" / "omp" para todos los de un grupo. Ninguno por defecto
+
+#include "region_markers.h"
+#include "system_monitor.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <mutex>
+#include <string>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#define DVFSMON_HOOK extern "C" __attribute__((visibility("default")))
+
+using namespace system_monitor;
+
+namespace {
+
+// ============================================================
+// Hooks configurables
+// ============================================================
+
+enum Hook {
+    kMpiInit, kMpiInitThread, kMpiFinalize, kMpiBarrier, kMpiBcast, kMpiReduce, kMpiAllreduce,
+    kMpiAllgather, kMpiAlltoall, kMpiSend, kMpiRecv, kMpiWait, kMpiWaitall,
+    kOmpParallel, kOmpImplicitTask,
+    kHooks
+};
+
+struct HookInfo {
+    const char* name;   // también el nombre de la región
+    const char* group;
+};
+
+const HookInfo kHookInfo[kHooks] = {
+    {"MPI_Init", "mpi"}, {"MPI_Init_thread", "mpi"}, {"MPI_Finalize", "mpi"}, {"MPI_Barrier", "mpi"},
+    {"MPI_Bcast", "mpi"}, {"MPI_Reduce", "mpi"}, {"MPI_Allreduce", "mpi"}, {"MPI_Allgather", "mpi"},
+    {"MPI_Alltoall", "mpi"}, {"MPI_Send", "mpi"}, {"MPI_Recv", "mpi"}, {"MPI_Wait", "mpi"},
+    {"MPI_Waitall", "mpi"},
+    {"omp_parallel", "omp"}, {"omp_implicit_task", "omp"},
+};
+
+// Se fijan una vez en configure(), antes de que la aplicación cree hilos
+bool g_enabled[kHooks];
+std::once_flag g_configured;
+
+void enableHooks(const std::string& item) {
+    bool found = false;
+    for (int h = 0; h < kHooks; ++h) {
+        if (item == kHookInfo[h].name || item == kHookInfo[h].group) {
+            g_enabled[h] = true;
+            found = true;
+        }
+    }
+    if (!found) fprintf(stderr, "dvfsmon_preload: unknown hook '%s' in DVFSMON_PRELOAD_REGIONS\n", item.c_str());
+}
+
+void parseHooks() {
+    const char* list = getenv("DVFSMON_PRELOAD_REGIONS");
+    if (!list) return;
+    std::string s(list);
+    size_t start = 0;
+    while (start <= s.size()) {
+        size_t end = s.find(',', start);
+        if (end == std::string::npos) end = s.size();
+        if (end > start) enableHooks(s.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
+// El runtime de OpenMP puede llamar a ompt_start_tool antes que nuestro constructor
+void configure() { std::call_once(g_configured, parseHooks); }
+
+// ============================================================
+// Informe del proceso
+// ============================================================
+
+struct Process {
+    pid_t pid;
+    int stderr_fd;  // copia de stderr: hay programas que lo cierran en su propio atexit
+    uint64_t t0_ns;
+    uint64_t energy0_nj;
+    PerfCounters* perf;
+};
+
+Process g_process;
+
+// Rango que exportan los lanzadores (Open MPI, MPICH/Hydra, PMIx, Slurm)
+const char* launcherRank() {
+    static const char* const vars[] = {"OMPI_COMM_WORLD_RANK", "PMI_RANK", "PMIX_RANK", "SLURM_PROCID"};
+    for (const char* v : vars) {
+        const char* rank = getenv(v);
+        if (rank && *rank) return rank;
+    }
+    return "0";
+}
+
+// DVFSMON_PRELOAD_OUT con %p y %r sustituidos
+std::string reportPath(const char* pattern) {
+    std::string path;
+    for (const char* c = pattern; *c; ++c) {
+        if (c[0] == '%' && c[1] == 'p') {
+            path += std::to_string(static_cast<long>(g_process.pid));
+            ++c;
+        } else if (c[0] == '%' && c[1] == 'r') {
+            path += launcherRank();
+            ++c;
+        } else {
+            path += *c;
+        }
+    }
+    return path;
+}
+
+void writeProcessLine(FILE* out) {
+    double time_s = (nowNs() - g_process.t0_ns) / 1e9;
+    double energy_j = (sampledEnergyNJ() - g_process.energy0_nj) / 1e9;
+    PerfMetrics perf = {0, 0, 0, 0, 0.0};
+    g_process.perf->read(&perf);
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    double cpu_s = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+
+    // El nombre del programa no puede llevar separadores
+    std::string command(program_invocation_short_name);
+    for (char& c : command) {
+        if (c == ',' || c == '=' || c == '\n') c = '_';
+    }
+    fprintf(out, "pid=%ld,rank=%s,command=%s,time_s=%.6f,energy_j=%.6f,power_avg_w=%.3f,cpu_time_s=%.6f,"
+            "instructions=%llu,cycles=%llu,ipc=%.3f,cache_misses=%llu,branch_misses=%llu,max_rss_kb=%ld\n",
+            static_cast<long>(g_process.pid), launcherRank(), command.c_str(), time_s, energy_j,
+            SystemMonitor::calculatePowerAvg(energy_j, time_s), cpu_s,
+            static_cast<unsigned long long>(perf.instructions), static_cast<unsigned long long>(perf.cycles),
+            perf.ipc, static_cast<unsigned long long>(perf.cache_misses),
+            static_cast<unsigned long long>(perf.branch_misses), ru.ru_maxrss);
+}
+
+// Registrado después del de los marcadores, así que corre antes: el muestreo sigue vivo
+void reportAtExit() {
+    if (getpid() != g_process.pid) return;  // hijo de fork() sin exec
+    const char* pattern = getenv("DVFSMON_PRELOAD_OUT");
+    if (pattern && strcmp(pattern, "none") == 0) return;
+    if (pattern && *pattern) {
+        std::string path = reportPath(pattern);
+        FILE* f = fopen(path.c_str(), "w");
+        if (!f) {
+            fprintf(stderr, "dvfsmon_preload: cannot write %s\n", path.c_str());
+            return;
+        }
+        writeProcessLine(f);
+        writeRegionSummary(f);
+        fclose(f);
+    } else if (g_process.stderr_fd >= 0) {
+        FILE* err = fdopen(g_process.stderr_fd, "w");
+        if (!err) return;
+        writeProcessLine(err);
+        writeRegionSummary(err);
+        fclose(err);
+    }
+}
+
+__attribute__((constructor)) void startProfiler() {
+    configure();
+    g_process.pid = getpid();
+    g_process.stderr_fd = fcntl(STDERR_FILENO, F_DUPFD_CLOEXEC, 3);
+    startRegionMarkers();
+    setRegionSummaryAtExit(false);
+    g_process.perf = new PerfCounters(true);
+    g_process.t0_ns = nowNs();
+    g_process.energy0_nj = sampledEnergyNJ();
+    atexit(reportAtExit);
+}
+
+// ============================================================
+// MPI: interposición de MPI_* sobre PMPI_*
+// ============================================================
+
+// Sin mpi.h, para servir a cualquier implementación: los argumentos de estas funciones
+// son enteros, handles (int en MPICH, punteros en Open MPI) o punteros, y todos viajan
+// en registros o huecos de pila de 8 bytes en las ABI de 64 bits (x86-64, AArch64), así
+// que se reenvían tal cual como uintptr_t.
+typedef uintptr_t Arg;
+
+std::atomic<void*> g_pmpi[kHooks];
+
+void* pmpi(Hook hook, const char* name) {
+    void* fn = g_pmpi[hook].load(std::memory_order_relaxed);
+    if (fn) return fn;
+    fn = dlsym(RTLD_NEXT, name);
+    if (!fn) fn = dlsym(RTLD_DEFAULT, name);
+    if (!fn) {
+        fprintf(stderr, "dvfsmon_preload: %s not found\n", name);
+        abort();
+    }
+    g_pmpi[hook].store(fn, std::memory_order_relaxed);
+    return fn;
+}
+
+} // namespace
+
+#if defined(__x86_64__) || defined(__aarch64__)
+
+#define DVFSMON_MPI_HOOK(hook, name, params, args)                              \
+    DVFSMON_HOOK int name params {                                              \
+        typedef int (*Real) params;                                             \
+        Real real = reinterpret_cast<Real>(pmpi(hook, "P" #name));              \
+        if (!g_enabled[hook]) return real args;                                 \
+        regionBegin(#name);                                                     \
+        int rc = real args;                                                     \
+        regionEnd();                                                            \
+        return rc;                                                              \
+    }
+
+DVFSMON_MPI_HOOK(kMpiInit, MPI_Init, (Arg argc, Arg argv), (argc, argv))
+DVFSMON_MPI_HOOK(kMpiInitThread, MPI_Init_thread, (Arg argc, Arg argv, Arg required, Arg provided),
+                 (argc, argv, required, provided))
+DVFSMON_MPI_HOOK(kMpiFinalize, MPI_Finalize, (), ())
+DVFSMON_MPI_HOOK(kMpiBarrier, MPI_Barrier, (Arg comm), (comm))
+DVFSMON_MPI_HOOK(kMpiBcast, MPI_Bcast, (Arg buf, Arg count, Arg type, Arg root, Arg comm),
+                 (buf, count, type, root, comm))
+DVFSMON_MPI_HOOK(kMpiReduce, MPI_Reduce, (Arg sbuf, Arg rbuf, Arg count, Arg type, Arg op, Arg root, Arg comm),
+                 (sbuf, rbuf, count, type, op, root, comm))
+DVFSMON_MPI_HOOK(kMpiAllreduce, MPI_Allreduce, (Arg sbuf, Arg rbuf, Arg count, Arg type, Arg op, Arg comm),
+                 (sbuf, rbuf, count, type, op, comm))
+DVFSMON_MPI_HOOK(kMpiAllgather, MPI_Allgather,
+                 (Arg sbuf, Arg scount, Arg stype, Arg rbuf, Arg rcount, Arg rtype, Arg comm),
+                 (sbuf, scount, stype, rbuf, rcount, rtype, comm))
+DVFSMON_MPI_HOOK(kMpiAlltoall, MPI_Alltoall,
+                 (Arg sbuf, Arg scount, Arg stype, Arg rbuf, Arg rcount, Arg rtype, Arg comm),
+                 (sbuf, scount, stype, rbuf, rcount, rtype, comm))
+DVFSMON_MPI_HOOK(kMpiSend, MPI_Send, (Arg buf, Arg count, Arg type, Arg dest, Arg tag, Arg comm),
+                 (buf, count, type, dest, tag, comm))
+DVFSMON_MPI_HOOK(kMpiRecv, MPI_Recv, (Arg buf, Arg count, Arg type, Arg src, Arg tag, Arg comm, Arg status),
+                 (buf, count, type, src, tag, comm, status))
+DVFSMON_MPI_HOOK(kMpiWait, MPI_Wait, (Arg request, Arg status), (request, status))
+DVFSMON_MPI_HOOK(kMpiWaitall, MPI_Waitall, (Arg count, Arg requests, Arg statuses), (count, requests, statuses))
+
+#endif
+
+// ============================================================
+// OpenMP: herramienta OMPT
+// ============================================================
+
+// Lo que se usa de omp-tools.h (OpenMP 5.0), declarado aquí porque no todos los
+// compiladores traen la cabecera
+namespace {
+
+typedef void (*ompt_callback_t)(void);
+typedef ompt_callback_t (*ompt_function_lookup_t)(const char* name);
+typedef int (*ompt_set_callback_t)(int event, ompt_callback_t callback);
+
+union ompt_data_t {
+    uint64_t value;
+    void* ptr;
+};
+
+struct ompt_start_tool_result_t {
+    int (*initialize)(ompt_function_lookup_t lookup, int initial_device_num, ompt_data_t* tool_data);
+    void (*finalize)(ompt_data_t* tool_data);
+    ompt_data_t tool_data;
+};
+
+const int kOmptCallbackParallelBegin = 3;
+const int kOmptCallbackParallelEnd = 4;
+const int kOmptCallbackImplicitTask = 7;
+const int kOmptScopeBegin = 1;
+const int kOmptScopeEnd = 2;
+const int kOmptTaskInitial = 0x1;
+
+// Los dos en el hilo que abre la región
+void onParallelBegin(ompt_data_t*, const void*, ompt_data_t*, unsigned int, int, const void*) {
+    regionBegin(kHookInfo[kOmpParallel].name);
+}
+
+void onParallelEnd(ompt_data_t*, ompt_data_t*, int, const void*) { regionEnd(); }
+
+// En cada hilo del equipo; la tarea implícita inicial dura todo el programa y no se mide
+void onImplicitTask(int endpoint, ompt_data_t*, ompt_data_t*, unsigned int, unsigned int, int flags) {
+    if (flags & kOmptTaskInitial) return;
+    if (endpoint == kOmptScopeBegin) {
+        regionBegin(kHookInfo[kOmpImplicitTask].name);
+    } else if (endpoint == kOmptScopeEnd) {
+        regionEnd();
+    }
+}
+
+int omptInitialize(ompt_function_lookup_t lookup, int, ompt_data_t*) {
+    ompt_set_callback_t set_callback = reinterpret_cast<ompt_set_callback_t>(lookup("ompt_set_callback"));
+    if (!set_callback) return 0;
+    if (g_enabled[kOmpParallel]) {
+        set_callback(kOmptCallbackParallelBegin, reinterpret_cast<ompt_callback_t>(onParallelBegin));
+        set_callback(kOmptCallbackParallelEnd, reinterpret_cast<ompt_callback_t>(onParallelEnd));
+    }
+    if (g_enabled[kOmpImplicitTask]) {
+        set_callback(kOmptCallbackImplicitTask, reinterpret_cast<ompt_callback_t>(onImplicitTask));
+    }
+    return 1;  // distinto de 0: la herramienta queda activa
+}
+
+void omptFinalize(ompt_data_t*) {}
+
+ompt_start_tool_result_t g_ompt_tool = {omptInitialize, omptFinalize, {0}};
+
+} // namespace
+
+// El runtime de OpenMP la busca al iniciarse; NULL desactiva OMPT (sin coste)
+DVFSMON_HOOK ompt_start_tool_result_t* ompt_start_tool(unsigned int, const char*) {
+    configure();
+    return g_enabled[kOmpParallel] || g_enabled[kOmpImplicitTask] ? &g_ompt_tool : nullptr;
+}
@@ -0,0 +1,84 @@
+/* dvfsmon_probe.c - Ejemplo mínimo de la API C de dvfsmon (y prueba de la biblioteca)
+ *
+ * Uso: dvfsmon_probe [MS]
+ * Abre una sesión, ocupa la CPU durante MS milisegundos (100 por defecto) en la región
+ * "outer" con una región "inner" anidada en la segunda mitad, y escribe una línea
+ * key=value con las capacidades y otra por región, en el orden en que se cierran.
+ */
+#include "dvfsmon.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Trabajo con dependencias para que los contadores avancen */
+static void spin(double seconds) {
+    volatile double x = 1.0;
+    double end = now_s() + seconds;
+    while (now_s() < end) {
+        int i;
+        for (i = 0; i < 1000; ++i) x = x * 1.0000001 + 1e-9;
+    }
+}
+
+static int stop_and_print(dvfsmon_session* session) {
+    dvfsmon_region_metrics m;
+    int status = dvfsmon_region_stop(session, &m);
+    if (status != DVFSMON_OK) return status;
+    printf("region=%s,depth=%d,time_s=%.6f,energy_j=%.6f,power_avg_w=%.3f,instructions=%llu,cycles=%llu,"
+           "ipc=%.3f,cache_misses=%llu,branch_misses=%llu\n",
+           m.name, m.depth, m.time_s, m.energy_j, m.power_avg_w, (unsigned long long)m.counters.instructions,
+           (unsigned long long)m.counters.cycles, m.ipc, (unsigned long long)m.counters.cache_misses,
+           (unsigned long long)m.counters.branch_misses);
+    return DVFSMON_OK;
+}
+
+int main(int argc, char** argv) {
+    dvfsmon_session* session = NULL;
+    double ms = argc > 1 ? atof(argv[1]) : 100.0;
+    unsigned caps;
+    double mhz = 0.0, celsius = 0.0;
+    int status;
+
+    if (argc > 2 || ms < 0.0) {
+        fprintf(stderr, "Usage: %s [MS]\n", argv[0]);
+        return 1;
+    }
+    status = dvfsmon_open(&session);
+    if (status != DVFSMON_OK) {
+        fprintf(stderr, "%s: dvfsmon_open: %s\n", argv[0], dvfsmon_strerror(status));
+        return 3;
+    }
+    caps = dvfsmon_capabilities(session);
+    dvfsmon_read_frequency(session, -1, &mhz);
+    dvfsmon_read_temperature(session, &celsius);
+    printf("version=%s,energy=%d,counters=%d,frequency=%d,temperature=%d,freq_mhz=%.1f,temperature_c=%.1f\n",
+           dvfsmon_version(), !!(caps & DVFSMON_CAP_ENERGY), !!(caps & DVFSMON_CAP_COUNTERS),
+           !!(caps & DVFSMON_CAP_FREQUENCY), !!(caps & DVFSMON_CAP_TEMPERATURE), mhz, celsius);
+
+    if ((status = dvfsmon_region_start(session, "outer")) != DVFSMON_OK) goto fail;
+    spin(ms / 2000.0);
+    if ((status = dvfsmon_region_start(session, "inner")) != DVFSMON_OK) goto fail;
+    spin(ms / 2000.0);
+    if ((status = stop_and_print(session)) != DVFSMON_OK) goto fail;
+    if ((status = stop_and_print(session)) != DVFSMON_OK) goto fail;
+    /* la pila ya está vacía */
+    if (dvfsmon_region_stop(session, NULL) != DVFSMON_ESTATE) {
+        fprintf(stderr, "%s: region stack not empty\n", argv[0]);
+        dvfsmon_close(session);
+        return 3;
+    }
+    dvfsmon_close(session);
+    return 0;
+
+fail:
+    fprintf(stderr, "%s: %s\n", argv[0], dvfsmon_strerror(status));
+    dvfsmon_close(session);
+    return 3;
+}
@@ -0,0 +1,113 @@
+/* dvfsmon_shm_probe.c - Ejemplo de lector de las muestras de dvfsmond (y prueba de ellas)
+ *
+ * Uso: dvfsmon_shm_probe [NAME] [--follow=N] [--seq=S] [--check=N]
+ * Sin opciones escribe la cabecera del segmento NAME (DVFSMON_SHM_NAME por defecto) y
+ * su última muestra. --follow lee en orden las N muestras siguientes a la última,
+ * --seq la muestra S y --check lee N veces la última seguidas comprobando que las
+ * muestras nunca retroceden. Todo en líneas key=value en stdout.
+ */
+#include "dvfsmon.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static void print_sample(const dvfsmon_sample* s) {
+    uint32_t cpu;
+    printf("seq_no=%llu,t_ns=%llu,energy_j=%.6f,power_w=%.3f,temperature_c=%.1f,capabilities=%u,ncpus=%u,freq_mhz=",
+           (unsigned long long)s->seq_no, (unsigned long long)s->t_ns, s->energy_j, s->power_w, s->temperature_c,
+           s->capabilities, s->ncpus);
+    for (cpu = 0; cpu < s->ncpus; ++cpu) printf("%s%.0f", cpu ? ";" : "", s->freq_mhz[cpu]);
+    printf("\n");
+}
+
+static int fail(dvfsmon_shm* shm, int status) {
+    fprintf(stderr, "dvfsmon_shm_probe: %s\n", dvfsmon_strerror(status));
+    dvfsmon_shm_detach(shm);
+    return 2;
+}
+
+static void sleep_ms(long ms) {
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (ms % 1000) * 1000000L;
+    nanosleep(&ts, NULL);
+}
+
+static int usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [NAME] [--follow=N] [--seq=S] [--check=N]\n", prog);
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    const char* name = NULL;
+    long follow = 0, check = 0, seq = 0, i;
+    int a, status;
+    dvfsmon_shm* shm;
+    dvfsmon_shm_info info;
+    static dvfsmon_sample sample, prev;
+
+    for (a = 1; a < argc; ++a) {
+        if (strncmp(argv[a], "--follow=", 9) == 0) {
+            follow = atol(argv[a] + 9);
+            if (follow < 1) return usage(argv[0]);
+        } else if (strncmp(argv[a], "--seq=", 6) == 0) {
+            seq = atol(argv[a] + 6);
+            if (seq < 1) return usage(argv[0]);
+        } else if (strncmp(argv[a], "--check=", 8) == 0) {
+            check = atol(argv[a] + 8);
+            if (check < 1) return usage(argv[0]);
+        } else if (argv[a][0] == '-' || name) {
+            return usage(argv[0]);
+        } else {
+            name = argv[a];
+        }
+    }
+
+    status = dvfsmon_shm_attach(name, &shm);
+    if (status != DVFSMON_OK) return fail(NULL, status);
+    dvfsmon_shm_info_get(shm, &info);
+    printf("period_ms=%u,capacity=%u,writer_pid=%d,head=%llu\n", info.period_ms, info.capacity, info.writer_pid,
+           (unsigned long long)info.head);
+
+    if (seq > 0) {
+        status = dvfsmon_shm_read(shm, (uint64_t)seq, &sample);
+        if (status != DVFSMON_OK) return fail(shm, status);
+        print_sample(&sample);
+    } else if (follow > 0) {
+        /* Las N siguientes a la última, esperando a que se publiquen */
+        uint64_t next = info.head + 1;
+        for (i = 0; i < follow;) {
+            status = dvfsmon_shm_read(shm, next, &sample);
+            if (status == DVFSMON_EAGAIN) {
+                sleep_ms(info.period_ms / 4 + 1);
+                continue;
+            }
+            if (status != DVFSMON_OK) return fail(shm, status);
+            print_sample(&sample);
+            ++next;
+            ++i;
+        }
+    } else if (check > 0) {
+        long distinct = 0, backwards = 0;
+        memset(&prev, 0, sizeof(prev));
+        for (i = 0; i < check; ++i) {
+            status = dvfsmon_shm_latest(shm, &sample);
+            if (status != DVFSMON_OK) return fail(shm, status);
+            if (sample.seq_no < prev.seq_no || sample.t_ns < prev.t_ns || sample.energy_j < prev.energy_j ||
+                (sample.seq_no == prev.seq_no && memcmp(&sample, &prev, sizeof(sample)) != 0)) {
+                ++backwards;
+            }
+            if (sample.seq_no != prev.seq_no) ++distinct;
+            prev = sample;
+        }
+        printf("reads=%ld,distinct=%ld,inconsistent=%ld\n", check, distinct, backwards);
+    } else {
+        status = dvfsmon_shm_latest(shm, &sample);
+        if (status != DVFSMON_OK) return fail(shm, status);
+        print_sample(&sample);
+    }
+    dvfsmon_shm_detach(shm);
+    return 0;
+}
@@ -0,0 +1,387 @@
+// dvfsmond.cpp - Demonio de monitoreo: publica las muestras del nodo en memoria compartida
+//
+// Uso: dvfsmond [--name=NAME] [--period-ms=MS] [--slots=N] [--listen=ADDR]...
+//
+// Cada MS milisegundos (100 por defecto) toma una muestra (energía RAPL acumulada,
+// potencia, frecuencia de cada CPU y temperatura) y la publica en el anillo de N slots
+// (64) del segmento NAME (DVFSMON_SHM_NAME). Así las herramientas del nodo leen las
+// mismas muestras con dvfsmon_shm_* en lugar de releer sysfs cada una. Termina con
+// SIGINT/SIGTERM y borra el segmento.
+// Con --listen (unix:PATH, tcp:PORT en 127.0.0.1 o tcp:HOST:PORT; repetible) sirve
+// además GET /metrics en formato de texto de Prometheus: contadores de energía,
+// potencia, frecuencias por CPU, temperaturas y estado de throttling. El cuerpo se
+// renderiza una vez por periodo; los scrapes sólo copian ese búfer (metrics_server.h).
+// Un único hilo atiende el temporizador, las señales y los sockets con epoll.
+// Tras publicar la primera muestra escribe en stdout una línea key=value.
+// DVFSMON_SYSFS_ROOT cambia la raíz de sysfs (/sys) para cpufreq, throttling, zonas y
+// la temperatura del nodo.
+#include "dvfsmon.h"
+#include "metrics_server.h"
+#include "shm_ring.h"
+#include "system_monitor.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace system_monitor;
+
+namespace {
+
+std::string sysfsRoot() {
+    const char* root = getenv("DVFSMON_SYSFS_ROOT");
+    return root && *root ? root : "/sys";
+}
+
+// Fichero de sysfs abierto una vez y releído con pread
+class SysfsFile {
+public:
+    explicit SysfsFile(const std::string& path) : fd_(open(path.c_str(), O_RDONLY | O_CLOEXEC)) {}
+    ~SysfsFile() {
+        if (fd_ >= 0) close(fd_);
+    }
+    SysfsFile(SysfsFile&& other) noexcept : fd_(other.fd_) { other.fd_ = -1; }
+    SysfsFile& operator=(SysfsFile&& other) noexcept {
+        std::swap(fd_, other.fd_);
+        return *this;
+    }
+    SysfsFile(const SysfsFile&) = delete;
+    SysfsFile& operator=(const SysfsFile&) = delete;
+
+    bool isOpen() const { return fd_ >= 0; }
+
+    // Valor entero del fichero; false si no se pudo leer
+    bool read(long long* value) const {
+        char buf[32];
+        if (fd_ < 0) return false;
+        ssize_t n = pread(fd_, buf, sizeof(buf) - 1, 0);
+        if (n <= 0) return false;
+        buf[n] = '\0';
+        char* end;
+        *value = strtoll(buf, &end, 10);
+        return end != buf;
+    }
+
+private:
+    int fd_;
+};
+
+// Contadores de throttling térmico de una CPU (drivers x86 thermal_throttle)
+struct ThrottleFiles {
+    uint32_t cpu;
+    SysfsFile core, package;
+    long long core_count, package_count;
+    bool throttled;  // alguno subió en el último periodo
+};
+
+// Zona térmica de class/thermal
+struct ThermalZone {
+    std::string zone, type;
+    SysfsFile temp;
+};
+
+std::vector<ThermalZone> findThermalZones(const std::string& sysfs) {
+    std::vector<ThermalZone> zones;
+    std::string dir = sysfs + "/class/thermal";
+    DIR* d = opendir(dir.c_str());
+    if (!d) return zones;
+    while (struct dirent* e = readdir(d)) {
+        if (strncmp(e->d_name, "thermal_zone", 12) != 0) continue;
+        std::string base = dir + "/" + e->d_name;
+        ThermalZone z{e->d_name + 12, "", SysfsFile(base + "/temp")};
+        if (!z.temp.isOpen()) continue;
+        FILE* f = fopen((base + "/type").c_str(), "re");
+        char type[64] = "";
+        if (f) {
+            if (!fgets(type, sizeof(type), f)) type[0] = '\0';
+            fclose(f);
+        }
+        for (char* c = type; *c; ++c) {
+            if (*c == '\n') *c = '\0';
+            else if (*c == '"' || *c == '\\') *c = '_';  // seguro como valor de etiqueta
+        }
+        z.type = type;
+        zones.push_back(std::move(z));
+    }
+    closedir(d);
+    std::sort(zones.begin(), zones.end(), [](const ThermalZone& a, const ThermalZone& b) {
+        return a.zone.size() != b.zone.size() ? a.zone.size() < b.zone.size() : a.zone < b.zone;
+    });
+    return zones;
+}
+
+// Temperatura del nodo: la primera fuente con lectura válida, en el orden de
+// SystemMonitor::getTemperature pero bajo la raíz de sysfs configurada
+SysfsFile openNodeTemperature(const std::string& sysfs) {
+    static const char* const paths[] = {"/class/thermal/thermal_zone0/temp", "/class/thermal/thermal_zone1/temp",
+                                        "/class/hwmon/hwmon0/temp1_input", "/class/hwmon/hwmon1/temp1_input"};
+    for (const char* path : paths) {
+        SysfsFile f(sysfs + path);
+        long long millideg;
+        if (f.read(&millideg) && millideg > 0) return f;
+    }
+    return SysfsFile("");
+}
+
+// printf al final de out; con out reservado de antemano no reserva memoria
+void appendf(std::string* out, const char* fmt, ...) {
+    char buf[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n > 0) out->append(buf, std::min<size_t>(n, sizeof(buf) - 1));
+}
+
+void appendFamily(std::string* out, const char* name, const char* type, const char* help) {
+    appendf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// Cuerpo de /metrics para la muestra actual; las fuentes no disponibles se omiten
+void renderMetrics(std::string* out, const dvfsmon_sample& s, long period_ms, const std::vector<ThermalZone>& zones,
+                   const std::vector<ThrottleFiles>& throttle) {
+    out->clear();
+    if (s.capabilities & DVFSMON_CAP_ENERGY) {
+        appendFamily(out, "dvfsmon_energy_joules_total", "counter", "RAPL energy consumed since the daemon started.");
+        appendf(out, "dvfsmon_energy_joules_total %.6f\n", s.energy_j);
+        appendFamily(out, "dvfsmon_power_watts", "gauge", "Average RAPL power over the last sample period.");
+        appendf(out, "dvfsmon_power_watts %.3f\n", s.power_w);
+    }
+    if (s.capabilities & DVFSMON_CAP_FREQUENCY) {
+        appendFamily(out, "dvfsmon_cpu_frequency_hertz", "gauge", "Current frequency of each CPU (scaling_cur_freq).");
+        for (uint32_t cpu = 0; cpu < s.ncpus; ++cpu) {
+            if (s.freq_mhz[cpu] > 0.0f) {
+                appendf(out, "dvfsmon_cpu_frequency_hertz{cpu=\"%u\"} %.0f\n", cpu, s.freq_mhz[cpu] * 1e6);
+            }
+        }
+    }
+    if (s.capabilities & DVFSMON_CAP_TEMPERATURE) {
+        appendFamily(out, "dvfsmon_temperature_celsius", "gauge", "Node temperature reported in the samples.");
+        appendf(out, "dvfsmon_temperature_celsius %.1f\n", s.temperature_c);
+    }
+    if (!zones.empty()) {
+        appendFamily(out, "dvfsmon_thermal_zone_celsius", "gauge", "Temperature of each thermal zone.");
+        for (const ThermalZone& z : zones) {
+            long long mc;
+            if (z.temp.read(&mc)) {
+                appendf(out, "dvfsmon_thermal_zone_celsius{zone=\"%s\",type=\"%s\"} %.3f\n", z.zone.c_str(),
+                        z.type.c_str(), mc / 1000.0);
+            }
+        }
+    }
+    if (!throttle.empty()) {
+        appendFamily(out, "dvfsmon_cpu_throttle_events_total", "counter", "Thermal throttling events of each CPU.");
+        for (const ThrottleFiles& t : throttle) {
+            if (t.core.isOpen()) {
+                appendf(out, "dvfsmon_cpu_throttle_events_total{cpu=\"%u\",scope=\"core\"} %lld\n", t.cpu,
+                        t.core_count);
+            }
+            if (t.package.isOpen()) {
+                appendf(out, "dvfsmon_cpu_throttle_events_total{cpu=\"%u\",scope=\"package\"} %lld\n", t.cpu,
+                        t.package_count);
+            }
+        }
+        appendFamily(out, "dvfsmon_cpu_throttled", "gauge", "1 if the CPU was thermally throttled in the last period.");
+        for (const ThrottleFiles& t : throttle) {
+            appendf(out, "dvfsmon_cpu_throttled{cpu=\"%u\"} %d\n", t.cpu, t.throttled ? 1 : 0);
+        }
+    }
+    appendFamily(out, "dvfsmon_samples_total", "counter", "Samples taken by the daemon.");
+    appendf(out, "dvfsmon_samples_total %llu\n", static_cast<unsigned long long>(s.seq_no));
+    appendFamily(out, "dvfsmon_sample_period_seconds", "gauge", "Sampling period of the daemon.");
+    appendf(out, "dvfsmon_sample_period_seconds %.3f\n", period_ms / 1000.0);
+}
+
+int usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [--name=NAME] [--period-ms=MS] [--slots=N] [--listen=unix:PATH|tcp:[HOST:]PORT]...\n",
+            prog);
+    return 1;
+}
+
+// Valor entero positivo de --opcion=valor
+bool parseCount(const char* arg, const char* option, long* out) {
+    size_t len = strlen(option);
+    if (strncmp(arg, option, len) != 0) return false;
+    char* end;
+    long v = strtol(arg + len, &end, 10);
+    *out = (*end == '\0' && end != arg + len && v > 0) ? v : -1;
+    return true;
+}
+
+// Llamada al sistema fallida al preparar el bucle de eventos
+int systemError(const char* what) {
+    fprintf(stderr, "dvfsmond: %s: %s\n", what, strerror(errno));
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string name = DVFSMON_SHM_NAME;
+    long period_ms = 100, slots = 64;
+    std::vector<std::string> listen;
+    for (int a = 1; a < argc; ++a) {
+        long* target = nullptr;
+        long value = 0;
+        if (strncmp(argv[a], "--name=", 7) == 0 && argv[a][7]) {
+            name = argv[a][7] == '/' ? argv[a] + 7 : std::string("/") + (argv[a] + 7);
+            continue;
+        }
+        if (strncmp(argv[a], "--listen=", 9) == 0 && argv[a][9]) {
+            listen.push_back(argv[a] + 9);
+            continue;
+        }
+        if (parseCount(argv[a], "--period-ms=", &value)) target = &period_ms;
+        else if (parseCount(argv[a], "--slots=", &value)) target = &slots;
+        if (!target || value < 0) return usage(argv[0]);
+        *target = value;
+    }
+
+    // SIGINT/SIGTERM llegan por signalfd al bucle de eventos
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, nullptr);
+
+    ShmRingWriter ring;
+    std::string err;
+    if (!ring.create(name, static_cast<uint32_t>(slots), static_cast<uint32_t>(period_ms), &err)) {
+        fprintf(stderr, "dvfsmond: %s\n", err.c_str());
+        return 1;
+    }
+    MetricsServer server;
+    for (const std::string& spec : listen) {
+        if (!server.listen(spec, &err)) {
+            fprintf(stderr, "dvfsmond: %s\n", err.c_str());
+            return 1;
+        }
+    }
+
+    RaplCounter rapl(powercapRoot());
+    long conf = sysconf(_SC_NPROCESSORS_CONF);
+    uint32_t ncpus = static_cast<uint32_t>(std::min<long>(std::max<long>(conf, 1), DVFSMON_SHM_MAX_CPUS));
+    std::string sysfs = sysfsRoot();
+    std::vector<SysfsFile> freq;
+    std::vector<ThrottleFiles> throttle;
+    std::vector<ThermalZone> zones;
+    for (uint32_t cpu = 0; cpu < ncpus; ++cpu) {
+        std::string dir = sysfs + "/devices/system/cpu/cpu" + std::to_string(cpu);
+        freq.emplace_back(dir + "/cpufreq/scaling_cur_freq");
+        if (listen.empty()) continue;  // throttling y zonas sólo se exportan por /metrics
+        ThrottleFiles t{cpu, SysfsFile(dir + "/thermal_throttle/core_throttle_count"),
+                        SysfsFile(dir + "/thermal_throttle/package_throttle_count"), 0, 0, false};
+        if (!t.core.isOpen() && !t.package.isOpen()) continue;
+        t.core.read(&t.core_count);
+        t.package.read(&t.package_count);
+        throttle.push_back(std::move(t));
+    }
+    if (!listen.empty()) zones = findThermalZones(sysfs);
+    SysfsFile temperature = openNodeTemperature(sysfs);
+
+    uint32_t capabilities = 0;
+    if (rapl.isAvailable()) capabilities |= DVFSMON_CAP_ENERGY;
+    if (std::any_of(freq.begin(), freq.end(), [](const SysfsFile& f) { return f.isOpen(); })) {
+        capabilities |= DVFSMON_CAP_FREQUENCY;
+    }
+    if (temperature.isOpen()) capabilities |= DVFSMON_CAP_TEMPERATURE;
+
+    static dvfsmon_sample sample;  // 4 KB de frecuencias: fuera de la pila
+    sample.capabilities = capabilities;
+    sample.ncpus = ncpus;
+    std::string body;
+    body.reserve(4096 + ncpus * 256 + zones.size() * 128);
+    uint64_t prev_t = nowNs();
+    uint64_t prev_uj = rapl.readEnergyUJ();
+    auto takeSample = [&]() {
+        uint64_t t = nowNs();
+        uint64_t uj = rapl.readEnergyUJ();
+        sample.t_ns = t;
+        sample.energy_j = uj / 1e6;
+        sample.power_w = t > prev_t ? (uj - prev_uj) * 1e3 / (t - prev_t) : 0.0;  // uJ/ns a W
+        long long millideg;
+        sample.temperature_c = temperature.read(&millideg) ? millideg / 1000.0 : 0.0;
+        for (uint32_t cpu = 0; cpu < ncpus; ++cpu) {
+            long long khz;
+            sample.freq_mhz[cpu] = freq[cpu].read(&khz) ? khz / 1000.0f : 0.0f;
+        }
+        ring.publish(&sample);
+        prev_t = t;
+        prev_uj = uj;
+
+        if (listen.empty()) return;
+        for (ThrottleFiles& th : throttle) {
+            long long core = th.core_count, package = th.package_count;
+            th.core.read(&core);
+            th.package.read(&package);
+            th.throttled = core > th.core_count || package > th.package_count;
+            th.core_count = core;
+            th.package_count = package;
+        }
+        renderMetrics(&body, sample, period_ms, zones, throttle);
+        server.setMetrics(body);
+    };
+
+    // Periodo fijo respecto al arranque; las expiraciones perdidas se agrupan
+    int sig_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (sig_fd < 0) return systemError("signalfd");
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0) return systemError("timerfd_create");
+    struct itimerspec period;
+    period.it_interval.tv_sec = period_ms / 1000;
+    period.it_interval.tv_nsec = (period_ms % 1000) * 1000000L;
+    period.it_value = period.it_interval;
+    if (timerfd_settime(timer_fd, 0, &period, nullptr) != 0) return systemError("timerfd_settime");
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if (ep < 0) return systemError("epoll_create1");
+    const int watched[] = {sig_fd, timer_fd, server.fd()};
+    for (int fd : watched) {
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev) != 0) return systemError("epoll_ctl");
+    }
+
+    takeSample();
+    printf("name=%s,period_ms=%ld,slots=%ld,ncpus=%u,pid=%d,listen=%s\n", name.c_str(), period_ms, slots, ncpus,
+           static_cast<int>(getpid()), server.endpoints().c_str());
+    fflush(stdout);
+
+    bool stop = false;
+    int rc = 0;
+    while (!stop) {
+        struct epoll_event events[3];
+        int n = epoll_wait(ep, events, 3, -1);
+        if (n < 0 && errno != EINTR) {
+            rc = systemError("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.fd == sig_fd) {
+                stop = true;
+            } else if (events[i].data.fd == timer_fd) {
+                uint64_t expirations;
+                if (read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations)) takeSample();
+            } else {
+                server.poll();
+            }
+        }
+    }
+    close(ep);
+    close(timer_fd);
+    close(sig_fd);
+    return rc;
+}
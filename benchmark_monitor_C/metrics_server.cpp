@@ -0,0 +1,400 @@
+// metrics_server.cpp - Bucle de eventos del servidor de /metrics: sockets, conexiones y respuestas
+#include "metrics_server.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace system_monitor {
+
+namespace {
+
+// data.u64 de epoll: índice de listeners_, o de clients_ con este bit
+const uint64_t kClientTag = 1ull << 32;
+
+const char kMetricsType[] = "text/plain; version=0.0.4; charset=utf-8";
+
+// Cabecera Connection de la petición (el bloque de cabeceras acaba en \r\n\r\n)
+bool connectionIs(const char* headers, const char* end, const char* value) {
+    static const char kName[] = "\r\nConnection:";
+    const size_t name_len = sizeof(kName) - 1;
+    for (const char* p = headers; p + name_len <= end; ++p) {
+        if (strncasecmp(p, kName, name_len) != 0) continue;
+        p += name_len;
+        while (p < end && (*p == ' ' || *p == '\t')) ++p;
+        return static_cast<size_t>(end - p) >= strlen(value) && strncasecmp(p, value, strlen(value)) == 0;
+    }
+    return false;
+}
+
+} // namespace
+
+MetricsServer::MetricsServer(size_t max_clients)
+    : epfd_(epoll_create1(EPOLL_CLOEXEC)), clients_(max_clients), current_(nullptr) {
+    for (size_t i = max_clients; i-- > 0;) {
+        clients_[i].fd = -1;
+        free_.push_back(i);
+    }
+    for (Response& r : responses_) {
+        r.size = 0;
+        r.refs = 0;
+    }
+
+    // Errores: respuestas fijas que cierran la conexión
+    struct Fixed {
+        Response* r;
+        const char* status;
+        const char* extra;
+    };
+    const Fixed fixed[] = {
+        {&not_found_, "404 Not Found", ""},
+        {&bad_method_, "405 Method Not Allowed", "Allow: GET\r\n"},
+        {&too_large_, "431 Request Header Fields Too Large", ""},
+        {&bad_request_, "400 Bad Request", ""},
+    };
+    for (const Fixed& f : fixed) {
+        char buf[256];
+        size_t body_len = strlen(f.status) + 1;
+        int n = snprintf(buf, sizeof(buf),
+                         "HTTP/1.1 %s\r\nContent-Type: text/plain\r\nContent-Length: %zu\r\n%sConnection: close\r\n"
+                         "\r\n%s\n", f.status, body_len, f.extra, f.status);
+        f.r->data.assign(buf, buf + n);
+        f.r->size = n;
+        f.r->refs = 0;
+    }
+}
+
+MetricsServer::~MetricsServer() {
+    for (Client& c : clients_) {
+        if (c.fd >= 0) ::close(c.fd);
+    }
+    for (const Listener& l : listeners_) {
+        ::close(l.fd);
+        if (!l.unix_path.empty()) unlink(l.unix_path.c_str());
+    }
+    if (epfd_ >= 0) ::close(epfd_);
+}
+
+// ============================================================
+// Sockets de escucha
+// ============================================================
+
+bool MetricsServer::listen(const std::string& spec, std::string* err) {
+    Listener l;
+    l.fd = -1;
+    if (spec.compare(0, 5, "unix:") == 0) {
+        std::string path = spec.substr(5);
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+            *err = "bad unix socket path in " + spec;
+            return false;
+        }
+        memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        l.fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        // Un socket que quedó de un demonio anterior se reemplaza; uno en uso no
+        struct stat st;
+        if (l.fd >= 0 && stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+            int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            bool live = probe >= 0 && connect(probe, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0;
+            if (probe >= 0) ::close(probe);
+            if (live) {
+                ::close(l.fd);
+                *err = path + " is in use by another server";
+                return false;
+            }
+            unlink(path.c_str());
+        }
+        if (l.fd < 0 || bind(l.fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+            *err = "cannot bind " + path + ": " + strerror(errno);
+            if (l.fd >= 0) ::close(l.fd);
+            return false;
+        }
+        l.unix_path = path;
+        l.endpoint = "unix:" + path;
+    } else if (spec.compare(0, 4, "tcp:") == 0) {
+        // tcp:PORT, tcp:HOST:PORT o tcp:[IPV6]:PORT
+        std::string rest = spec.substr(4);
+        size_t colon = rest.rfind(':');
+        std::string host = colon == std::string::npos ? "127.0.0.1" : rest.substr(0, colon);
+        std::string port = colon == std::string::npos ? rest : rest.substr(colon + 1);
+        char* port_end;
+        long port_num = strtol(port.c_str(), &port_end, 10);
+        if (host.size() >= 2 && host.front() == '[' && host.back() == ']') host = host.substr(1, host.size() - 2);
+        struct addrinfo hints, *ai = nullptr;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_NUMERICSERV;
+        if (port.empty() || *port_end || port_num < 0 || port_num > 65535 || host.empty() ||
+            getaddrinfo(host.c_str(), port.c_str(), &hints, &ai) != 0) {
+            *err = "bad tcp address in " + spec;
+            return false;
+        }
+        l.fd = socket(ai->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        if (l.fd >= 0) setsockopt(l.fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (l.fd < 0 || bind(l.fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            *err = "cannot bind " + spec.substr(4) + ": " + strerror(errno);
+            if (l.fd >= 0) ::close(l.fd);
+            freeaddrinfo(ai);
+            return false;
+        }
+        freeaddrinfo(ai);
+
+        // Con el puerto real si se pidió el 0
+        struct sockaddr_storage bound;
+        socklen_t len = sizeof(bound);
+        getsockname(l.fd, reinterpret_cast<struct sockaddr*>(&bound), &len);
+        char addr[INET6_ADDRSTRLEN];
+        if (bound.ss_family == AF_INET6) {
+            const struct sockaddr_in6* a = reinterpret_cast<const struct sockaddr_in6*>(&bound);
+            inet_ntop(AF_INET6, &a->sin6_addr, addr, sizeof(addr));
+            l.endpoint = std::string("tcp:[") + addr + "]:" + std::to_string(ntohs(a->sin6_port));
+        } else {
+            const struct sockaddr_in* a = reinterpret_cast<const struct sockaddr_in*>(&bound);
+            inet_ntop(AF_INET, &a->sin_addr, addr, sizeof(addr));
+            l.endpoint = std::string("tcp:") + addr + ":" + std::to_string(ntohs(a->sin_port));
+        }
+    } else {
+        *err = "listen address must be unix:PATH or tcp:[HOST:]PORT, not " + spec;
+        return false;
+    }
+
+    if (::listen(l.fd, 128) != 0) {
+        *err = "cannot listen on " + l.endpoint + ": " + strerror(errno);
+        ::close(l.fd);
+        if (!l.unix_path.empty()) unlink(l.unix_path.c_str());
+        return false;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u64 = listeners_.size();
+    if (epoll_ctl(epfd_, EPOLL_CTL_ADD, l.fd, &ev) != 0) {
+        *err = "cannot watch " + l.endpoint + ": " + strerror(errno);
+        ::close(l.fd);
+        if (!l.unix_path.empty()) unlink(l.unix_path.c_str());
+        return false;
+    }
+    listeners_.push_back(l);
+    return true;
+}
+
+std::string MetricsServer::endpoints() const {
+    std::string s;
+    for (const Listener& l : listeners_) s += (s.empty() ? "" : ";") + l.endpoint;
+    return s;
+}
+
+// ============================================================
+// Respuestas
+// ============================================================
+
+void MetricsServer::setMetrics(const std::string& body) {
+    // Un búfer que no se esté enviando; si todos lo están (clientes muy lentos), los
+    // scrapes siguen recibiendo el actual hasta el próximo periodo
+    Response* r = nullptr;
+    for (Response& candidate : responses_) {
+        if (&candidate != current_ && candidate.refs == 0) {
+            r = &candidate;
+            break;
+        }
+    }
+    if (!r) return;
+
+    char header[160];
+    int n = snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %zu\r\n\r\n",
+                     kMetricsType, body.size());
+    r->size = n + body.size();
+    if (r->data.size() < r->size) r->data.resize(r->size);  // sólo crece
+    memcpy(r->data.data(), header, n);
+    memcpy(r->data.data() + n, body.data(), body.size());
+    current_ = r;
+}
+
+// ============================================================
+// Conexiones
+// ============================================================
+
+void MetricsServer::poll() {
+    struct epoll_event events[64];
+    int n = epoll_wait(epfd_, events, 64, 0);
+    for (int i = 0; i < n; ++i) {
+        uint64_t tag = events[i].data.u64;
+        if (!(tag & kClientTag)) {
+            accept(static_cast<size_t>(tag));
+            continue;
+        }
+        Client& c = clients_[tag & (kClientTag - 1)];
+        if (c.fd < 0) continue;  // cerrada antes en este mismo lote
+        if (c.out) {
+            onWritable(c);
+        } else {
+            onReadable(c);
+        }
+    }
+}
+
+void MetricsServer::accept(size_t listener) {
+    for (;;) {
+        int fd = accept4(listeners_[listener].fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+        if (free_.empty()) {
+            ::close(fd);
+            continue;
+        }
+        size_t idx = free_.back();
+        free_.pop_back();
+        Client& c = clients_[idx];
+        c.fd = fd;
+        c.in_len = 0;
+        c.out = nullptr;
+        c.sent = 0;
+        c.close_after = false;
+        c.peer_closed = false;
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u64 = kClientTag | idx;
+        // sin registrar nunca se atendería ni se liberaría el hueco
+        if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) != 0) close(c);
+    }
+}
+
+void MetricsServer::onReadable(Client& c) {
+    while (c.in_len < sizeof(c.in)) {
+        ssize_t n = recv(c.fd, c.in + c.in_len, sizeof(c.in) - c.in_len, 0);
+        if (n > 0) {
+            c.in_len += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else if (n == 0) {
+            // Medio cierre: las peticiones ya recibidas se responden igualmente
+            c.peer_closed = true;
+            break;
+        } else {
+            close(c);
+            return;
+        }
+    }
+    if (nextRequest(c)) {
+        onWritable(c);
+    } else if (c.peer_closed) {
+        close(c);  // no queda ninguna petición completa que responder
+    }
+}
+
+// Si hay una petición completa en c.in, la consume y prepara su respuesta
+bool MetricsServer::nextRequest(Client& c) {
+    const char* end = static_cast<const char*>(memmem(c.in, c.in_len, "\r\n\r\n", 4));
+    if (!end) {
+        if (c.in_len == sizeof(c.in)) {
+            startResponse(c, &too_large_, true);
+            return true;
+        }
+        return false;
+    }
+    size_t request_len = end + 4 - c.in;
+
+    // Línea de petición: MÉTODO RUTA VERSIÓN
+    const char* line_end = static_cast<const char*>(memmem(c.in, request_len, "\r\n", 2));
+    const char* sp1 = static_cast<const char*>(memchr(c.in, ' ', line_end - c.in));
+    const char* sp2 = sp1 ? static_cast<const char*>(memchr(sp1 + 1, ' ', line_end - sp1 - 1)) : nullptr;
+    Response* r;
+    bool close_after = true;
+    if (!sp2 || line_end - sp2 - 1 != 8 || strncmp(sp2 + 1, "HTTP/1.", 7) != 0) {
+        r = &bad_request_;
+    } else if (sp1 - c.in != 3 || strncmp(c.in, "GET", 3) != 0) {
+        r = &bad_method_;
+    } else {
+        const char* query = static_cast<const char*>(memchr(sp1 + 1, '?', sp2 - sp1 - 1));
+        const char* path_end = query ? query : sp2;
+        bool metrics = path_end - sp1 - 1 == 8 && strncmp(sp1 + 1, "/metrics", 8) == 0;
+        r = metrics && current_ ? current_ : &not_found_;
+        if (metrics && current_) {
+            // HTTP/1.1 mantiene la conexión salvo "close"; 1.0 sólo con "keep-alive"
+            bool http11 = sp2[8] == '1';
+            close_after = http11 ? connectionIs(line_end, end + 2, "close")
+                                 : !connectionIs(line_end, end + 2, "keep-alive");
+        }
+    }
+    memmove(c.in, c.in + request_len, c.in_len - request_len);
+    c.in_len -= request_len;
+    startResponse(c, r, close_after);
+    return true;
+}
+
+void MetricsServer::startResponse(Client& c, const Response* r, bool close_after) {
+    c.out = r;
+    c.sent = 0;
+    c.close_after = close_after;
+    ++const_cast<Response*>(r)->refs;
+}
+
+void MetricsServer::onWritable(Client& c) {
+    // Envía respuestas mientras el socket acepte datos y haya peticiones encadenadas
+    while (c.out) {
+        while (c.sent < c.out->size) {
+            ssize_t n = send(c.fd, c.out->data.data() + c.sent, c.out->size - c.sent, MSG_NOSIGNAL);
+            if (n >= 0) {
+                c.sent += n;
+            } else if (errno == EINTR) {
+                continue;
+            } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                watch(c, EPOLLOUT);
+                return;
+            } else {
+                close(c);
+                return;
+            }
+        }
+        --const_cast<Response*>(c.out)->refs;
+        c.out = nullptr;
+        if (c.close_after) {
+            // Descarta lo que quede por leer: cerrar con datos pendientes envía un RST
+            // que puede hacer perder la respuesta al cliente
+            shutdown(c.fd, SHUT_WR);
+            while (recv(c.fd, c.in, sizeof(c.in), 0) > 0) {
+            }
+            close(c);
+            return;
+        }
+        nextRequest(c);
+    }
+    // Tras el EOF no hay más que leer (EPOLLIN quedaría siempre activo): con todo
+    // respondido se cierra
+    if (c.peer_closed) {
+        close(c);
+        return;
+    }
+    watch(c, EPOLLIN);
+}
+
+void MetricsServer::watch(Client& c, uint32_t events) {
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.u64 = kClientTag | static_cast<uint64_t>(&c - clients_.data());
+    epoll_ctl(epfd_, EPOLL_CTL_MOD, c.fd, &ev);
+}
+
+void MetricsServer::close(Client& c) {
+    if (c.out) --const_cast<Response*>(c.out)->refs;
+    c.out = nullptr;
+    ::close(c.fd);  // también lo quita de epoll
+    c.fd = -1;
+    free_.push_back(static_cast<size_t>(&c - clients_.data()));
+}
+
+} // namespace system_monitor
@@ -0,0 +1,86 @@
+// metrics_server.h - Servidor HTTP mínimo de /metrics (formato de texto de Prometheus) para dvfsmond
+//
+// Escucha en sockets Unix o TCP locales y atiende a los clientes desde un bucle de
+// eventos (epoll, sin hilos). La respuesta completa (cabeceras y cuerpo) se renderiza
+// una vez por periodo en un búfer que se reutiliza: atender un scrape es sólo copiar
+// bytes de ese búfer al socket, sin reservar memoria. Hay varios búferes de respuesta
+// con un contador de conexiones que los están enviando, de modo que refrescar las
+// métricas no altera una respuesta a medio enviar. Las conexiones salen de un conjunto
+// fijo creado al arrancar; con todas ocupadas, las nuevas se cierran al aceptarlas.
+// Soporta keep-alive y peticiones encadenadas (pipelining). Un cliente que cierra su
+// lado tras enviar (nc -N, shutdown(SHUT_WR)) recibe las respuestas de todas las
+// peticiones completas que mandó antes de que se cierre la conexión.
+
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace system_monitor {
+
+class MetricsServer {
+public:
+    explicit MetricsServer(size_t max_clients = 256);
+    ~MetricsServer();  // cierra los sockets y borra los de tipo Unix
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // Descriptor de epoll propio: el bucle del llamador lo vigila y llama a poll()
+    // cuando esté legible
+    int fd() const { return epfd_; }
+
+    // "unix:PATH", "tcp:PORT" (en 127.0.0.1) o "tcp:HOST:PORT"; PORT 0 elige uno libre.
+    // false y *err si no se pudo
+    bool listen(const std::string& spec, std::string* err);
+    // Direcciones en las que escucha, con el puerto real, separadas por ';'
+    std::string endpoints() const;
+
+    // Nuevas métricas para los scrapes siguientes (las respuestas en curso no cambian)
+    void setMetrics(const std::string& body);
+    // Atiende los eventos pendientes sin bloquear
+    void poll();
+
+private:
+    struct Response {
+        std::vector<char> data;
+        size_t size;
+        int refs;  // conexiones enviándola
+    };
+    struct Client {
+        int fd;
+        char in[4096];  // petición en curso (y las encadenadas tras ella)
+        size_t in_len;
+        const Response* out;
+        size_t sent;
+        bool close_after;
+        bool peer_closed;  // el cliente cerró su lado (EOF): se atiende lo ya recibido
+    };
+    struct Listener {
+        int fd;
+        std::string endpoint;
+        std::string unix_path;
+    };
+
+    void accept(size_t listener);
+    void onReadable(Client& c);
+    void onWritable(Client& c);
+    bool nextRequest(Client& c);
+    void startResponse(Client& c, const Response* r, bool close_after);
+    void watch(Client& c, uint32_t events);
+    void close(Client& c);
+
+    int epfd_;
+    std::vector<Listener> listeners_;
+    std::vector<Client> clients_;
+    std::vector<size_t> free_;   // índices de clients_ libres
+    Response responses_[3];
+    Response* current_;          // la que reciben los scrapes nuevos
+    Response not_found_, bad_method_, too_large_, bad_request_;
+};
+
+} // namespace system_monitor
+
+#endif // METRICS_SERVER_H
@@ -0,0 +1,141 @@
+// rapl_domains.cpp - Lectura de los dominios RAPL (powercap)
+#include "rapl_domains.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace system_monitor {
+
+namespace {
+
+const char kZonePrefix[] = "intel-rapl:";
+
+// Directorio de zona con su ruta numérica ("intel-rapl:0:2" -> {0, 2})
+struct Zone {
+    std::string dir;
+    std::vector<int> id;
+};
+
+bool parseZoneId(const std::string& entry, std::vector<int>* id) {
+    if (entry.compare(0, sizeof(kZonePrefix) - 1, kZonePrefix) != 0) return false;
+    const char* p = entry.c_str() + sizeof(kZonePrefix) - 1;
+    id->clear();
+    while (true) {
+        char* end = nullptr;
+        long v = std::strtol(p, &end, 10);
+        if (end == p || v < 0) return false;
+        id->push_back(static_cast<int>(v));
+        if (*end == '\0') return id->size() <= 2;
+        if (*end != ':') return false;
+        p = end + 1;
+    }
+}
+
+std::string readLine(const std::string& path) {
+    std::ifstream f(path.c_str());
+    std::string line;
+    std::getline(f, line);
+    return line;
+}
+
+// Contenido de un archivo de sysfs ya abierto, como entero; false si no se pudo leer
+bool preadUInt64(int fd, uint64_t* value) {
+    char buf[32];
+    ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return false;
+    buf[n] = '\0';
+    char* end = nullptr;
+    *value = std::strtoull(buf, &end, 10);
+    return end != buf;
+}
+
+} // namespace
+
+RaplDomains::~RaplDomains() {
+    for (int fd : fds_) ::close(fd);
+}
+
+bool RaplDomains::open(const std::string& root, std::string* err) {
+    DIR* dir = opendir(root.c_str());
+    if (!dir) {
+        *err = root + ": " + std::strerror(errno);
+        return false;
+    }
+    // El directorio de la clase powercap lista paquetes (intel-rapl:N) y subdominios
+    // (intel-rapl:N:M) al mismo nivel
+    std::vector<Zone> zones;
+    while (struct dirent* e = readdir(dir)) {
+        Zone z;
+        z.dir = e->d_name;
+        if (parseZoneId(z.dir, &z.id)) zones.push_back(z);
+    }
+    closedir(dir);
+    std::sort(zones.begin(), zones.end(), [](const Zone& a, const Zone& b) { return a.id < b.id; });
+
+    std::vector<std::string> top_name;  // nombre de cada paquete, para nombrar sus subdominios
+    std::string open_err;
+    for (const Zone& z : zones) {
+        std::string base = root + "/" + z.dir + "/";
+        std::string dname = readLine(base + "name");
+        if (dname.empty()) continue;
+        if (z.id.size() == 1) {
+            if (top_name.size() <= static_cast<size_t>(z.id[0])) top_name.resize(z.id[0] + 1);
+            top_name[z.id[0]] = dname;
+        }
+
+        // energy_uj es sólo de root en kernels con el parche de CVE-2020-8694
+        int fd = ::open((base + "energy_uj").c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            open_err = base + "energy_uj: " + std::strerror(errno);
+            continue;
+        }
+        uint64_t value = 0;
+        if (!preadUInt64(fd, &value)) {
+            open_err = base + "energy_uj: unreadable";
+            ::close(fd);
+            continue;
+        }
+
+        if (z.id.size() == 1) {
+            names_.push_back(dname);
+            in_total_.push_back(dname != "psys");
+        } else {
+            std::string parent = static_cast<size_t>(z.id[0]) < top_name.size() && !top_name[z.id[0]].empty()
+                                     ? top_name[z.id[0]]
+                                     : "package-" + std::to_string(z.id[0]);
+            names_.push_back(parent + "." + dname);
+            in_total_.push_back(dname == "dram");
+        }
+        fds_.push_back(fd);
+        max_range_uj_.push_back(std::strtoull(readLine(base + "max_energy_range_uj").c_str(), nullptr, 10));
+        prev_uj_.push_back(value);
+    }
+
+    if (fds_.empty()) {
+        *err = open_err.empty() ? "no RAPL domains under " + root : open_err;
+        return false;
+    }
+    return true;
+}
+
+bool RaplDomains::readDelta(size_t i, uint64_t* delta_uj) {
+    uint64_t value = 0;
+    if (!preadUInt64(fds_[i], &value)) return false;
+    if (value >= prev_uj_[i]) {
+        *delta_uj = value - prev_uj_[i];
+    } else if (max_range_uj_[i] > prev_uj_[i]) {
+        *delta_uj = max_range_uj_[i] - prev_uj_[i] + value;  // desborde
+    } else {
+        *delta_uj = 0;  // rango desconocido: se pierde el intervalo
+    }
+    prev_uj_[i] = value;
+    return true;
+}
+
+} // namespace system_monitor
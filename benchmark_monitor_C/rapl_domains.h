@@ -0,0 +1,52 @@
+// rapl_domains.h - Dominios RAPL de la interfaz powercap de Linux
+//
+// Única implementación de la lectura de RAPL, compartida por la biblioteca dvfsmon
+// (RaplCounter: sesiones, marcadores, dvfsmond, benchmark_monitor) y por node_monitor
+// de gpu_benchmark (RaplSource), que compila este archivo desde aquí. Enumera los paquetes
+// (intel-rapl:N) y sus subdominios (intel-rapl:N:M), abre cada energy_uj una vez y lo
+// relee con pread; el desborde en max_energy_range_uj se pliega en el incremento, así
+// que basta leer más a menudo que el periodo de desborde (minutos a plena potencia).
+
+#ifndef RAPL_DOMAINS_H
+#define RAPL_DOMAINS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace system_monitor {
+
+class RaplDomains {
+public:
+    RaplDomains() {}
+    ~RaplDomains();
+    RaplDomains(const RaplDomains&) = delete;
+    RaplDomains& operator=(const RaplDomains&) = delete;
+
+    // Abre los dominios bajo root (normalmente /sys/class/powercap) en orden numérico
+    // y toma su primera lectura. false y *err si no hay ninguno legible
+    bool open(const std::string& root, std::string* err);
+
+    size_t size() const { return fds_.size(); }
+    // "package-0", "package-0.dram", "psys"...
+    const std::string& name(size_t i) const { return names_[i]; }
+    // Si el dominio entra en el total del nodo: los paquetes y su DRAM. psys ya
+    // contiene a los paquetes y core/uncore están dentro del contador de su paquete
+    bool inTotal(size_t i) const { return in_total_[i] != 0; }
+
+    // Microjoules del dominio i desde la lectura anterior, desborde incluido. false si
+    // no se pudo leer: el dominio queda como estaba y la lectura siguiente cubre el hueco
+    bool readDelta(size_t i, uint64_t* delta_uj);
+
+private:
+    std::vector<int> fds_;
+    std::vector<std::string> names_;
+    std::vector<char> in_total_;
+    std::vector<uint64_t> max_range_uj_;
+    std::vector<uint64_t> prev_uj_;
+};
+
+} // namespace system_monitor
+
+#endif // RAPL_DOMAINS_H
@@ -0,0 +1,342 @@
+// region_markers.cpp - Pila por hilo, tablas de totales sin locks y muestreo de RAPL
+#include "region_markers.h"
+#include "dvfsmon.h"
+#include "system_monitor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace system_monitor {
+
+namespace {
+
+// ============================================================
+// Energía: hilo de muestreo y seqlock
+// ============================================================
+
+// Lee RAPL cada period_ms en su propio hilo (el único que toca el RaplCounter) y
+// publica la última muestra con un seqlock, de modo que los marcadores la leen sin
+// syscalls ni locks.
+class EnergySampler {
+public:
+    EnergySampler(const std::string& powercap_root, int period_ms)
+        : rapl_(powercap_root), period_ns_(period_ms * 1000000ull), period_ms_(period_ms),
+          seq_(0), t_ns_(0), energy_nj_(0), power_w_(0.0), stop_(false) {
+        if (!rapl_.isAvailable()) return;
+        publish(nowNs(), rapl_.readEnergyUJ() * 1000, 0.0);
+        thread_ = std::thread(&EnergySampler::loop, this);
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    // Energía (nJ) en t_ns: la última muestra más su potencia (W = nJ/ns) por el tiempo
+    // transcurrido, como mucho un periodo
+    uint64_t energyNJ(uint64_t t_ns) const {
+        uint32_t s1, s2;
+        uint64_t t, e;
+        double p;
+        do {
+            s1 = seq_.load(std::memory_order_acquire);
+            t = t_ns_.load(std::memory_order_relaxed);
+            e = energy_nj_.load(std::memory_order_relaxed);
+            p = power_w_.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            s2 = seq_.load(std::memory_order_relaxed);
+        } while (s1 != s2 || (s1 & 1));
+        uint64_t elapsed = t_ns > t ? std::min(t_ns - t, period_ns_) : 0;
+        return e + static_cast<uint64_t>(p * elapsed);
+    }
+
+private:
+    void publish(uint64_t t, uint64_t e, double p) {
+        uint32_t s = seq_.load(std::memory_order_relaxed);
+        seq_.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        t_ns_.store(t, std::memory_order_relaxed);
+        energy_nj_.store(e, std::memory_order_relaxed);
+        power_w_.store(p, std::memory_order_relaxed);
+        seq_.store(s + 2, std::memory_order_release);
+    }
+
+    void loop() {
+        uint64_t prev_t = t_ns_.load(std::memory_order_relaxed);
+        uint64_t prev_e = energy_nj_.load(std::memory_order_relaxed);
+        std::unique_lock<std::mutex> lock(mu_);
+        while (!cv_.wait_for(lock, std::chrono::milliseconds(period_ms_), [this] { return stop_; })) {
+            uint64_t t = nowNs();
+            uint64_t e = rapl_.readEnergyUJ() * 1000;
+            double p = t > prev_t ? static_cast<double>(e - prev_e) / (t - prev_t) : 0.0;
+            publish(t, e, p);
+            prev_t = t;
+            prev_e = e;
+        }
+    }
+
+    RaplCounter rapl_;
+    const uint64_t period_ns_;
+    const int period_ms_;
+    std::atomic<uint32_t> seq_;
+    std::atomic<uint64_t> t_ns_;
+    std::atomic<uint64_t> energy_nj_;
+    std::atomic<double> power_w_;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    bool stop_;
+    std::thread thread_;
+};
+
+// ============================================================
+// Tablas por hilo
+// ============================================================
+
+const int kTableBits = 9;
+const int kTableSize = 1 << kTableBits;  // nombres distintos por tabla
+const char kOverflowName[] = "[overflow]";
+
+// Totales de un nombre. Sólo los escribe el hilo dueño de la tabla; el resumen los lee
+// desde otro hilo, por eso son atómicos (relaxed, sin instrucciones con lock)
+struct Entry {
+    std::atomic<const char*> name;
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> time_ns;
+    std::atomic<uint64_t> energy_nj;
+    std::atomic<uint64_t> instructions;
+    std::atomic<uint64_t> cycles;
+    std::atomic<uint64_t> cache_misses;
+    std::atomic<uint64_t> branch_misses;
+};
+
+struct ThreadTable {
+    Entry entries[kTableSize];  // direccionamiento abierto por puntero del nombre
+    Entry overflow;             // nombres que ya no caben
+    std::atomic<bool> in_use;
+    ThreadTable* next;          // fijo una vez publicada en g_tables
+};
+
+// Lista de todas las tablas creadas; sólo crece (push con CAS)
+std::atomic<ThreadTable*> g_tables(nullptr);
+std::once_flag g_once;
+EnergySampler* g_sampler = nullptr;
+pid_t g_pid = 0;  // proceso que arrancó el muestreo
+std::atomic<bool> g_summary_at_exit(true);
+
+void add(std::atomic<uint64_t>& total, uint64_t value) {
+    total.store(total.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+Entry* findEntry(ThreadTable* table, const char* name) {
+    uint64_t h = (reinterpret_cast<uintptr_t>(name) * 0x9E3779B97F4A7C15ull) >> (64 - kTableBits);
+    for (int i = 0; i < kTableSize; ++i) {
+        Entry& e = table->entries[(h + i) & (kTableSize - 1)];
+        const char* n = e.name.load(std::memory_order_relaxed);
+        if (n == name) return &e;
+        if (!n) {
+            e.name.store(name, std::memory_order_release);
+            return &e;
+        }
+    }
+    return &table->overflow;
+}
+
+// Tabla libre de un hilo que ya terminó, o una nueva
+ThreadTable* acquireTable() {
+    for (ThreadTable* t = g_tables.load(std::memory_order_acquire); t; t = t->next) {
+        bool expected = false;
+        if (t->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) return t;
+    }
+    ThreadTable* t = new ThreadTable();  // value-initialized: contadores a cero
+    t->overflow.name.store(kOverflowName, std::memory_order_relaxed);
+    t->in_use.store(true, std::memory_order_relaxed);
+    t->next = g_tables.load(std::memory_order_relaxed);
+    while (!g_tables.compare_exchange_weak(t->next, t, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    return t;
+}
+
+void atExit() {
+    // Un hijo de fork() no tiene el hilo de muestreo y su resumen repetiría el del padre
+    if (getpid() != g_pid) return;
+    if (g_sampler) g_sampler->stop();
+    if (!g_summary_at_exit.load()) return;
+    const char* out = getenv("DVFSMON_REGIONS_OUT");
+    if (out && strcmp(out, "none") == 0) return;
+    if (out && *out) {
+        FILE* f = fopen(out, "w");
+        if (!f) return;
+        writeRegionSummary(f);
+        fclose(f);
+    } else {
+        writeRegionSummary(stderr);
+    }
+}
+
+void startRuntime() {
+    const char* period = getenv("DVFSMON_SAMPLE_MS");
+    int period_ms = period ? atoi(period) : 0;
+    g_sampler = new EnergySampler(powercapRoot(), period_ms > 0 ? period_ms : 10);
+    g_pid = getpid();
+    atexit(atExit);
+}
+
+// ============================================================
+// Estado por hilo
+// ============================================================
+
+struct Frame {
+    const char* name;
+    uint64_t t_ns;
+    uint64_t energy_nj;
+    bool has_perf;
+    PerfMetrics perf;
+};
+
+struct ThreadState {
+    ThreadState() : table(nullptr), perf(nullptr), depth(0), skipped(0) {}
+    ~ThreadState() {
+        delete perf;
+        if (table) table->in_use.store(false, std::memory_order_release);
+    }
+
+    ThreadTable* table;
+    PerfCounters* perf;
+    int depth;
+    int skipped;  // regiones por encima de DVFSMON_MAX_DEPTH, que no se miden
+    Frame stack[DVFSMON_MAX_DEPTH];
+};
+
+thread_local ThreadState t_state;
+
+void initThread(ThreadState& ts) {
+    startRegionMarkers();
+    ts.table = acquireTable();
+    ts.perf = new PerfCounters();
+}
+
+// Salida parseable: el nombre no puede llevar separadores
+std::string sanitize(const char* name) {
+    std::string s(name);
+    for (char& c : s) {
+        if (c == ',' || c == '=' || c == '\n') c = '_';
+    }
+    return s;
+}
+
+struct Summary {
+    uint64_t calls, time_ns, energy_nj, instructions, cycles, cache_misses, branch_misses;
+};
+
+void accumulate(Summary* s, const Entry& e) {
+    s->calls += e.calls.load(std::memory_order_relaxed);
+    s->time_ns += e.time_ns.load(std::memory_order_relaxed);
+    s->energy_nj += e.energy_nj.load(std::memory_order_relaxed);
+    s->instructions += e.instructions.load(std::memory_order_relaxed);
+    s->cycles += e.cycles.load(std::memory_order_relaxed);
+    s->cache_misses += e.cache_misses.load(std::memory_order_relaxed);
+    s->branch_misses += e.branch_misses.load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+void startRegionMarkers() { std::call_once(g_once, startRuntime); }
+
+uint64_t sampledEnergyNJ() {
+    startRegionMarkers();
+    return g_sampler->energyNJ(nowNs());
+}
+
+void setRegionSummaryAtExit(bool enabled) { g_summary_at_exit.store(enabled); }
+
+void regionBegin(const char* name) {
+    ThreadState& ts = t_state;
+    if (!ts.table) initThread(ts);
+    if (ts.depth == DVFSMON_MAX_DEPTH) {
+        ++ts.skipped;
+        return;
+    }
+    Frame& f = ts.stack[ts.depth++];
+    f.name = name;
+    f.t_ns = nowNs();
+    f.energy_nj = g_sampler->energyNJ(f.t_ns);
+    // Contadores al final, para no contar el propio marcador
+    f.has_perf = ts.perf->readRaw(&f.perf);
+}
+
+void regionEnd() {
+    ThreadState& ts = t_state;
+    if (ts.skipped > 0) {
+        --ts.skipped;
+        return;
+    }
+    if (ts.depth == 0) return;  // sin región abierta
+    PerfMetrics perf;
+    bool has_perf = ts.perf->readRaw(&perf);
+    uint64_t t = nowNs();
+    uint64_t energy = g_sampler->energyNJ(t);
+
+    const Frame& f = ts.stack[--ts.depth];
+    Entry* e = findEntry(ts.table, f.name);
+    add(e->calls, 1);
+    add(e->time_ns, t - f.t_ns);
+    // La extrapolación puede pasarse de la muestra siguiente
+    add(e->energy_nj, energy > f.energy_nj ? energy - f.energy_nj : 0);
+    if (has_perf && f.has_perf) {
+        add(e->instructions, perf.instructions - f.perf.instructions);
+        add(e->cycles, perf.cycles - f.perf.cycles);
+        add(e->cache_misses, perf.cache_misses - f.perf.cache_misses);
+        add(e->branch_misses, perf.branch_misses - f.perf.branch_misses);
+    }
+}
+
+bool writeRegionSummary(FILE* out) {
+    // Un mismo nombre puede llegar con punteros distintos (y en varias tablas)
+    std::map<std::string, Summary> totals;
+    for (ThreadTable* t = g_tables.load(std::memory_order_acquire); t; t = t->next) {
+        for (int i = 0; i <= kTableSize; ++i) {
+            const Entry& e = i < kTableSize ? t->entries[i] : t->overflow;
+            const char* name = e.name.load(std::memory_order_acquire);
+            if (!name || e.calls.load(std::memory_order_relaxed) == 0) continue;
+            Summary& s = totals.insert(std::make_pair(sanitize(name), Summary())).first->second;
+            accumulate(&s, e);
+        }
+    }
+
+    std::vector<std::pair<std::string, Summary>> rows(totals.begin(), totals.end());
+    std::stable_sort(rows.begin(), rows.end(), [](const std::pair<std::string, Summary>& a,
+                                                  const std::pair<std::string, Summary>& b) {
+        return a.second.time_ns > b.second.time_ns;
+    });
+    for (const auto& row : rows) {
+        const Summary& s = row.second;
+        double time_s = s.time_ns / 1e9;
+        double energy_j = s.energy_nj / 1e9;
+        fprintf(out, "region=%s,calls=%llu,time_s=%.9f,energy_j=%.6f,power_avg_w=%.3f,instructions=%llu,"
+                "cycles=%llu,ipc=%.3f,cache_misses=%llu,branch_misses=%llu\n",
+                row.first.c_str(), static_cast<unsigned long long>(s.calls), time_s, energy_j,
+                SystemMonitor::calculatePowerAvg(energy_j, time_s),
+                static_cast<unsigned long long>(s.instructions), static_cast<unsigned long long>(s.cycles),
+                SystemMonitor::calculateIPC(s.instructions, s.cycles),
+                static_cast<unsigned long long>(s.cache_misses), static_cast<unsigned long long>(s.branch_misses));
+    }
+    return fflush(out) == 0 && !ferror(out);
+}
+
+} // namespace system_monitor
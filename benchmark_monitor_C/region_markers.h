@@ -0,0 +1,39 @@
+// region_markers.h - Marcadores de región por hilo (dvfsmon_region_begin/end)
+//
+// Para instrumentar fases de una aplicación sin sesiones: cada hilo lleva su pila de
+// regiones abiertas (thread_local) y una tabla de totales por nombre que sólo escribe
+// él, así que marcar no toma locks ni hace syscalls en el caso normal:
+//   - tiempo: CLOCK_MONOTONIC (vDSO);
+//   - energía: la última muestra RAPL de un hilo de muestreo, publicada con un
+//     seqlock y extrapolada al instante actual con la potencia de esa muestra;
+//   - contadores: PerfCounters::readRaw (rdpmc), abiertos en el primer marcador del hilo.
+// Las tablas se registran en una lista sin locks y se reutilizan cuando su hilo
+// termina; el resumen suma por nombre las de todos los hilos.
+
+#ifndef REGION_MARKERS_H
+#define REGION_MARKERS_H
+
+#include <cstdint>
+#include <cstdio>
+
+namespace system_monitor {
+
+void regionBegin(const char* name);
+void regionEnd();
+
+// Una línea key=value por nombre de región, de mayor a menor tiempo; false si no se
+// pudo escribir
+bool writeRegionSummary(FILE* out);
+
+// Arranca el muestreo de RAPL y registra el resumen al salir, que si no hace el primer
+// marcador. Quien registre después su propio atexit lo ejecuta antes que el resumen,
+// con el muestreo aún en marcha.
+void startRegionMarkers();
+// Energía del nodo (nJ) desde que arrancó el muestreo, como la ven los marcadores
+uint64_t sampledEnergyNJ();
+// Con false no se escribe el resumen al salir (lo escribe quien llama)
+void setRegionSummaryAtExit(bool enabled);
+
+} // namespace system_monitor
+
+#endif // REGION_MARKERS_H
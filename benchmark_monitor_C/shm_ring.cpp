@@ -0,0 +1,246 @@
+// shm_ring.cpp - Segmento POSIX con el anillo de muestras y su seqlock por slot
+#include "shm_ring.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace system_monitor {
+
+namespace {
+
+// Un lector que encuentra su slot a medio escribir más veces que esto supone que el
+// escritor murió dentro de publish()
+const int kMaxSpins = 1 << 20;
+
+// shm_open quiere "/nombre"
+std::string shmName(const std::string& name) {
+    return !name.empty() && name[0] == '/' ? name : "/" + name;
+}
+
+size_t segmentSize(uint32_t capacity) {
+    return sizeof(ShmHeader) + static_cast<size_t>(capacity) * sizeof(ShmSlot);
+}
+
+// Cerrojo que serializa create() y el borrado entre escritores: "<segmento>.lock",
+// flock exclusivo mientras el segmento se crea y hasta que su cabecera está publicada
+std::string lockName(const std::string& shm_name) {
+    return shm_name + ".lock";
+}
+
+// Toma el cerrojo de creación; devuelve su descriptor o -1. Quien lo tenía antes pudo
+// borrarlo al terminar, así que sólo vale si el nombre sigue siendo el mismo objeto
+int lockCreation(const std::string& lock_name) {
+    for (;;) {
+        int fd = shm_open(lock_name.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) return -1;
+        int rc;
+        while ((rc = flock(fd, LOCK_EX)) != 0 && errno == EINTR) {
+        }
+        if (rc != 0) {
+            close(fd);
+            return -1;
+        }
+        int cur = shm_open(lock_name.c_str(), O_RDONLY, 0);
+        struct stat held, current;
+        bool same = cur >= 0 && fstat(fd, &held) == 0 && fstat(cur, &current) == 0 &&
+                    held.st_dev == current.st_dev && held.st_ino == current.st_ino;
+        if (cur >= 0) close(cur);
+        if (same) return fd;
+        close(fd);
+    }
+}
+
+bool writerAlive(int32_t pid) {
+    return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+// Si name existe y su escritor sigue vivo devuelve su pid; si no, 0. Con el cerrojo de
+// creación tomado, una cabecera sin magic es de un escritor que murió antes de publicarla
+int32_t liveWriter(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) return 0;
+    struct stat st;
+    int32_t pid = 0;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(ShmHeader)) {
+        void* p = mmap(nullptr, sizeof(ShmHeader), PROT_READ, MAP_SHARED, fd, 0);
+        if (p != MAP_FAILED) {
+            const ShmHeader* h = static_cast<const ShmHeader*>(p);
+            if (h->magic.load(std::memory_order_acquire) == kShmMagic) {
+                pid = h->writer_pid.load(std::memory_order_relaxed);
+            }
+            munmap(p, sizeof(ShmHeader));
+        }
+    }
+    close(fd);
+    return writerAlive(pid) ? pid : 0;
+}
+
+} // namespace
+
+// ============================================================
+// Escritor
+// ============================================================
+
+ShmRingWriter::ShmRingWriter() : map_(nullptr), size_(0), header_(nullptr), slots_(nullptr) {}
+
+ShmRingWriter::~ShmRingWriter() {
+    if (!map_) return;
+    int lock = lockCreation(lockName(name_));
+    header_->writer_pid.store(0, std::memory_order_release);
+    munmap(map_, size_);
+    shm_unlink(name_.c_str());
+    if (lock >= 0) {
+        shm_unlink(lockName(name_).c_str());
+        close(lock);
+    }
+}
+
+bool ShmRingWriter::create(const std::string& name, uint32_t capacity, uint32_t period_ms, std::string* err) {
+    name_ = shmName(name);
+    if (capacity == 0) {
+        *err = "the ring needs at least one slot";
+        return false;
+    }
+    // Otro dvfsmond puede estar creando el mismo segmento: hasta que publique la
+    // cabecera, su segmento no se distingue del de un escritor muerto
+    int lock = lockCreation(lockName(name_));
+    if (lock < 0) {
+        *err = "cannot lock " + lockName(name_) + ": " + strerror(errno);
+        return false;
+    }
+    int fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0 && errno == EEXIST) {
+        int32_t pid = liveWriter(name_);
+        if (pid) {
+            close(lock);
+            *err = name_ + " is already published by pid " + std::to_string(pid);
+            return false;
+        }
+        // Segmento de un escritor que murió sin borrarlo
+        shm_unlink(name_.c_str());
+        fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    }
+    if (fd < 0) {
+        int saved = errno;
+        close(lock);
+        *err = "shm_open " + name_ + ": " + strerror(saved);
+        return false;
+    }
+    // Legible por los lectores de otros usuarios aunque la umask lo restrinja
+    fchmod(fd, 0644);
+
+    size_ = segmentSize(capacity);
+    void* p = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(size_)) == 0) {
+        p = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    int saved = errno;
+    close(fd);
+    if (p == MAP_FAILED) {
+        shm_unlink(name_.c_str());
+        close(lock);
+        *err = "cannot map " + name_ + ": " + strerror(saved);
+        return false;
+    }
+
+    // ftruncate deja el segmento a cero: slots con seq 0 y head 0
+    map_ = p;
+    header_ = static_cast<ShmHeader*>(p);
+    slots_ = reinterpret_cast<ShmSlot*>(static_cast<char*>(p) + sizeof(ShmHeader));
+    header_->version = kShmVersion;
+    header_->slot_size = sizeof(ShmSlot);
+    header_->capacity = capacity;
+    header_->period_ms = period_ms;
+    header_->writer_pid.store(getpid(), std::memory_order_relaxed);
+    header_->magic.store(kShmMagic, std::memory_order_release);
+    close(lock);  // cabecera publicada
+    return true;
+}
+
+void ShmRingWriter::publish(dvfsmon_sample* sample) {
+    uint64_t n = header_->head.load(std::memory_order_relaxed) + 1;
+    sample->seq_no = n;
+    ShmSlot& slot = slots_[(n - 1) % header_->capacity];
+    uint64_t s = slot.seq.load(std::memory_order_relaxed);
+    slot.seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&slot.sample, sample, sizeof(*sample));
+    slot.seq.store(s + 2, std::memory_order_release);
+    header_->head.store(n, std::memory_order_release);
+}
+
+// ============================================================
+// Lector
+// ============================================================
+
+ShmRingReader::ShmRingReader() : map_(nullptr), size_(0), header_(nullptr), slots_(nullptr) {}
+
+ShmRingReader::~ShmRingReader() {
+    if (map_) munmap(map_, size_);
+}
+
+int ShmRingReader::attach(const std::string& name) {
+    int fd = shm_open(shmName(name).c_str(), O_RDONLY, 0);
+    if (fd < 0) return errno == ENOENT || errno == EACCES ? DVFSMON_EUNAVAIL : DVFSMON_EINVAL;
+    struct stat st;
+    void* p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(ShmHeader)) {
+        p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (p == MAP_FAILED) return DVFSMON_EUNAVAIL;
+
+    const ShmHeader* h = static_cast<const ShmHeader*>(p);
+    if (h->magic.load(std::memory_order_acquire) != kShmMagic || h->version != kShmVersion ||
+        h->slot_size != sizeof(ShmSlot) || segmentSize(h->capacity) > static_cast<size_t>(st.st_size)) {
+        munmap(p, st.st_size);
+        return DVFSMON_EUNAVAIL;
+    }
+    map_ = p;
+    size_ = st.st_size;
+    header_ = h;
+    slots_ = reinterpret_cast<const ShmSlot*>(static_cast<const char*>(p) + sizeof(ShmHeader));
+    return DVFSMON_OK;
+}
+
+void ShmRingReader::info(dvfsmon_shm_info* out) const {
+    out->period_ms = header_->period_ms;
+    out->capacity = header_->capacity;
+    out->writer_pid = header_->writer_pid.load(std::memory_order_relaxed);
+    out->head = header_->head.load(std::memory_order_acquire);
+}
+
+int ShmRingReader::read(uint64_t seq_no, dvfsmon_sample* out) const {
+    uint64_t head = header_->head.load(std::memory_order_acquire);
+    if (seq_no == 0 || seq_no > head) return DVFSMON_EAGAIN;
+    if (head - seq_no >= header_->capacity) return DVFSMON_ELOST;
+
+    const ShmSlot& slot = slots_[(seq_no - 1) % header_->capacity];
+    for (int spin = 0; spin < kMaxSpins; ++spin) {
+        uint64_t s1 = slot.seq.load(std::memory_order_acquire);
+        if (s1 & 1) continue;
+        memcpy(out, &slot.sample, sizeof(*out));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != s1) continue;
+        // El escritor pudo dar la vuelta al anillo desde que se leyó head
+        return out->seq_no == seq_no ? DVFSMON_OK : DVFSMON_ELOST;
+    }
+    return DVFSMON_EAGAIN;
+}
+
+int ShmRingReader::latest(dvfsmon_sample* out) const {
+    for (;;) {
+        uint64_t head = header_->head.load(std::memory_order_acquire);
+        if (head == 0) return DVFSMON_EAGAIN;
+        int status = read(head, out);
+        if (status != DVFSMON_ELOST) return status;
+    }
+}
+
+} // namespace system_monitor
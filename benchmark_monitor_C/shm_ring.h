@@ -0,0 +1,91 @@
+// shm_ring.h - Anillo de muestras del nodo en memoria compartida (dvfsmond y dvfsmon_shm_*)
+//
+// Un único escritor publica muestras (dvfsmon_sample) en un anillo de slots dentro de
+// un segmento POSIX; los lectores lo mapean de sólo lectura. Cada slot lleva su
+// seqlock (impar mientras se escribe): el lector copia la muestra y la repite si el
+// número de secuencia cambió entretanto. head cuenta las muestras publicadas.
+//
+// Disposición del segmento: ShmHeader y capacity ShmSlot, alineados a línea de caché.
+// magic se escribe el último, así que un lector que lo ve tiene la cabecera completa.
+// Los escritores crean y borran el segmento con flock sobre "<nombre>.lock", de modo
+// que ninguno toma por muerto el segmento que otro aún no ha terminado de publicar.
+
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include "dvfsmon.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace system_monitor {
+
+const uint32_t kShmMagic = 0x44564653;  // "DVFS"
+const uint32_t kShmVersion = 1;
+
+struct alignas(64) ShmHeader {
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t slot_size;
+    uint32_t capacity;
+    uint32_t period_ms;
+    std::atomic<int32_t> writer_pid;  // 0 cuando el escritor termina
+    std::atomic<uint64_t> head;       // muestras publicadas; la última es la head
+};
+
+struct alignas(64) ShmSlot {
+    std::atomic<uint64_t> seq;  // seqlock: impar mientras se escribe
+    dvfsmon_sample sample;
+};
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "el anillo necesita atómicos sin locks para compartirse entre procesos");
+
+// Crea y publica el segmento (dvfsmond)
+class ShmRingWriter {
+public:
+    ShmRingWriter();
+    ~ShmRingWriter();  // marca el escritor como terminado y borra el segmento
+    ShmRingWriter(const ShmRingWriter&) = delete;
+    ShmRingWriter& operator=(const ShmRingWriter&) = delete;
+
+    // Crea el segmento name; un segmento anterior sólo se reemplaza si su escritor ya
+    // no vive (si otro escritor lo está creando, espera a que publique la cabecera).
+    // false y *err si no se pudo
+    bool create(const std::string& name, uint32_t capacity, uint32_t period_ms, std::string* err);
+    // Publica sample como la muestra siguiente (le asigna seq_no)
+    void publish(dvfsmon_sample* sample);
+
+private:
+    std::string name_;
+    void* map_;
+    size_t size_;
+    ShmHeader* header_;
+    ShmSlot* slots_;
+};
+
+// Vista de sólo lectura del segmento; los métodos devuelven un dvfsmon_status
+class ShmRingReader {
+public:
+    ShmRingReader();
+    ~ShmRingReader();
+    ShmRingReader(const ShmRingReader&) = delete;
+    ShmRingReader& operator=(const ShmRingReader&) = delete;
+
+    int attach(const std::string& name);
+    void info(dvfsmon_shm_info* out) const;
+    int latest(dvfsmon_sample* out) const;
+    int read(uint64_t seq_no, dvfsmon_sample* out) const;
+
+private:
+    void* map_;
+    size_t size_;
+    const ShmHeader* header_;
+    const ShmSlot* slots_;
+};
+
+} // namespace system_monitor
+
+#endif // SHM_RING_H
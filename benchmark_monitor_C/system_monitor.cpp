@@ -6,10 +6,16 @@
 #include <cmath>
 #include <ctime>
 #include <iomanip>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
-#include <dirent.h>
+#include <fcntl.h>
 #include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
 
 namespace system_monitor {
 
@@ -18,16 +24,11 @@ namespace system_monitor {
 // ============================================================
 
 SystemMonitor::SystemMonitor() 
-    : rapl_path_("/sys/class/powercap/intel-rapl"),
-      rapl_available_(false),
-      perf_available_(false) {
+    : perf_available_(-1) {
     
-    // Verificar disponibilidad de RAPL
-    struct stat st;
-    rapl_available_ = (stat(rapl_path_.c_str(), &st) == 0);
-    
-    // Verificar disponibilidad de perf
-    perf_available_ = (system("which perf > /dev/null 2>&1") == 0);
+    // La energía RAPL se lee con RaplCounter. La disponibilidad de perf se comprueba en
+    // isPerfAvailable(): lanza un proceso, y quien usa la biblioteca puede crear el
+    // monitor en un constructor o bajo LD_PRELOAD
 }
 
 SystemMonitor::~SystemMonitor() {}
@@ -62,16 +63,17 @@ uint64_t SystemMonitor::readSysFileUInt64(const std::string& path) {
     }
 }
 
+double SystemMonitor::getCPUFreqMHz(int cpu) {
+    uint64_t khz = readSysFileUInt64("/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                                     "/cpufreq/scaling_cur_freq");
+    return khz / 1000.0;  // kHz a MHz
+}
+
 CPUInfo SystemMonitor::getCPUInfo() {
     CPUInfo info;
     
-    // Frecuencia de CPU (de /proc/cpuinfo o /sys)
-    std::string freq_str = readSysFile("/sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq");
-    if (!freq_str.empty()) {
-        info.freq_mhz = std::stod(freq_str) / 1000.0;  // kHz a MHz
-    } else {
-        info.freq_mhz = 0.0;
-    }
+    // Frecuencia de CPU (de /sys)
+    info.freq_mhz = getCPUFreqMHz(0);
     
     // Governor
     info.governor = readSysFile("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor");
@@ -85,35 +87,6 @@ CPUInfo SystemMonitor::getCPUInfo() {
     return info;
 }
 
-uint64_t SystemMonitor::readRAPLEnergy() {
-    if (!rapl_available_) {
-        return 0;
-    }
-    
-    // Buscar el dominio package-0 (o el primero disponible)
-    DIR* dir = opendir(rapl_path_.c_str());
-    if (!dir) {
-        return 0;
-    }
-    
-    uint64_t total_energy = 0;
-    struct dirent* entry;
-    
-    while ((entry = readdir(dir)) != nullptr) {
-        std::string dirname = entry->d_name;
-        
-        // Buscar intel-rapl:0 (package-0)
-        if (dirname.find("intel-rapl:0") != std::string::npos) {
-            std::string energy_path = rapl_path_ + "/" + dirname + "/energy_uj";
-            total_energy = readSysFileUInt64(energy_path);
-            break;
-        }
-    }
-    
-    closedir(dir);
-    return total_energy;
-}
-
 double SystemMonitor::getTemperature() {
     // Intentar leer de diferentes fuentes de temperatura
     std::vector<std::string> temp_paths = {
@@ -138,12 +111,11 @@ double SystemMonitor::getTemperature() {
     return 0.0;  // No disponible
 }
 
-bool SystemMonitor::isRAPLAvailable() {
-    return rapl_available_;
-}
-
 bool SystemMonitor::isPerfAvailable() {
-    return perf_available_;
+    if (perf_available_ < 0) {
+        perf_available_ = (system("which perf > /dev/null 2>&1") == 0);
+    }
+    return perf_available_ != 0;
 }
 
 // ============================================================
@@ -214,6 +186,168 @@ PerfMetrics SystemMonitor::parsePerfMetrics(const std::string& perf_output) {
     return metrics;
 }
 
+// ============================================================
+// RaplCounter - Implementación
+// ============================================================
+
+RaplCounter::RaplCounter(const std::string& powercap_root) : available_(false), total_uj_(0) {
+    std::string err;
+    if (!domains_.open(powercap_root, &err)) return;
+    for (size_t i = 0; i < domains_.size(); ++i) available_ = available_ || domains_.inTotal(i);
+}
+
+uint64_t RaplCounter::readEnergyUJ() {
+    for (size_t i = 0; i < domains_.size(); ++i) {
+        uint64_t delta = 0;
+        if (domains_.inTotal(i) && domains_.readDelta(i, &delta)) total_uj_ += delta;
+    }
+    return total_uj_;
+}
+
+// ============================================================
+// PerfCounters - Implementación
+// ============================================================
+
+PerfCounters::PerfCounters(bool inherit) {
+    static const uint64_t configs[kEvents] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+    std::fill(fds_, fds_ + kEvents, -1);
+    std::fill(pages_, pages_ + kEvents, nullptr);
+    
+    for (int i = 0; i < kEvents; ++i) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.inherit = inherit;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.disabled = (i == 0);
+        
+        int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1,
+                                          i == 0 ? -1 : fds_[0], PERF_FLAG_FD_CLOEXEC));
+        if (fd < 0) {
+            for (int j = 0; j < i; ++j) ::close(fds_[j]);
+            std::fill(fds_, fds_ + kEvents, -1);
+            return;
+        }
+        fds_[i] = fd;
+    }
+    
+    // Página de usuario de cada evento para leerlo con rdpmc; sin ella se usa read().
+    // rdpmc sólo ve el hilo actual, así que con inherit no sirve
+    long page_size = sysconf(_SC_PAGESIZE);
+    for (int i = 0; i < kEvents && !inherit; ++i) {
+        void* page = mmap(nullptr, page_size, PROT_READ, MAP_SHARED, fds_[i], 0);
+        pages_[i] = (page == MAP_FAILED) ? nullptr : page;
+    }
+    ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounters::~PerfCounters() {
+    long page_size = sysconf(_SC_PAGESIZE);
+    for (int i = 0; i < kEvents; ++i) {
+        if (pages_[i]) munmap(pages_[i], page_size);
+        if (fds_[i] >= 0) ::close(fds_[i]);
+    }
+}
+
+bool PerfCounters::readGroup(uint64_t* values, double* scale) {
+    // Formato de grupo: nr, time_enabled, time_running, valores[nr]
+    uint64_t buf[3 + kEvents];
+    if (::read(fds_[0], buf, sizeof(buf)) != static_cast<ssize_t>(sizeof(buf))) return false;
+    
+    *scale = (buf[2] > 0 && buf[2] < buf[1]) ? static_cast<double>(buf[1]) / buf[2] : 1.0;
+    std::copy(buf + 3, buf + 3 + kEvents, values);
+    return true;
+}
+
+bool PerfCounters::readPages(uint64_t* values) const {
+#if defined(__x86_64__) || defined(__i386__)
+    for (int i = 0; i < kEvents; ++i) {
+        const volatile struct perf_event_mmap_page* pc =
+            static_cast<const volatile struct perf_event_mmap_page*>(pages_[i]);
+        if (!pc) return false;
+        
+        // Protocolo de la página: reintentar si el kernel la actualizó mientras se leía
+        uint32_t seq;
+        uint64_t count;
+        do {
+            seq = pc->lock;
+            __asm__ __volatile__("" ::: "memory");
+            uint32_t index = pc->index;
+            // index 0: el evento no está en un contador ahora (multiplexado o no permitido)
+            if (!pc->cap_user_rdpmc || index == 0) return false;
+            count = pc->offset;
+            uint32_t lo, hi;
+            __asm__ __volatile__("rdpmc" : "=a"(lo), "=d"(hi) : "c"(index - 1));
+            int64_t pmc = static_cast<int64_t>((static_cast<uint64_t>(hi) << 32) | lo);
+            int shift = 64 - pc->pmc_width;
+            count += static_cast<uint64_t>((pmc << shift) >> shift);
+            __asm__ __volatile__("" ::: "memory");
+        } while (pc->lock != seq);
+        values[i] = count;
+    }
+    return true;
+#else
+    (void)values;
+    return false;
+#endif
+}
+
+bool PerfCounters::read(PerfMetrics* out) {
+    if (!isAvailable()) return false;
+    
+    uint64_t values[kEvents];
+    double scale = 1.0;
+    if (!readGroup(values, &scale)) return false;
+    for (int i = 0; i < kEvents; ++i) {
+        values[i] = static_cast<uint64_t>(values[i] * scale);
+    }
+    out->cycles = values[0];
+    out->instructions = values[1];
+    out->cache_misses = values[2];
+    out->branch_misses = values[3];
+    out->ipc = SystemMonitor::calculateIPC(out->instructions, out->cycles);
+    return true;
+}
+
+bool PerfCounters::readRaw(PerfMetrics* out) {
+    if (!isAvailable()) return false;
+    
+    uint64_t values[kEvents];
+    double scale = 1.0;
+    if (!readPages(values) && !readGroup(values, &scale)) return false;
+    out->cycles = values[0];
+    out->instructions = values[1];
+    out->cache_misses = values[2];
+    out->branch_misses = values[3];
+    out->ipc = 0.0;
+    return true;
+}
+
+// ============================================================
+// Utilidades internas de la biblioteca dvfsmon
+// ============================================================
+
+uint64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+std::string powercapRoot() {
+    const char* root = getenv("DVFSMON_POWERCAP_ROOT");
+    return root && *root ? root : "/sys/class/powercap";
+}
+
 // ============================================================
 // CSVWriter - Implementación
 // ============================================================
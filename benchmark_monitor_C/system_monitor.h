@@ -1,7 +1,11 @@
 // system_monitor.h - Header para monitoreo de sistema (CPU, RAPL, temperatura)
+// La energía RAPL se lee siempre con RaplCounter (rapl_domains.h), tanto en la
+// biblioteca dvfsmon como en benchmark_monitor
 #ifndef SYSTEM_MONITOR_H
 #define SYSTEM_MONITOR_H
 
+#include "rapl_domains.h"
+
 #include <string>
 #include <vector>
 #include <map>
@@ -60,14 +64,13 @@ public:
     // Obtener información de CPU
     CPUInfo getCPUInfo();
     
-    // Leer energía de RAPL (Intel)
-    uint64_t readRAPLEnergy();
+    // Frecuencia actual de una CPU (MHz, de cpufreq); 0 si no está disponible
+    double getCPUFreqMHz(int cpu);
     
     // Obtener temperatura de CPU
     double getTemperature();
     
     // Verificar disponibilidad de características
-    bool isRAPLAvailable();
     bool isPerfAvailable();
     
     // Calcular métricas derivadas
@@ -79,15 +82,75 @@ public:
     static PerfMetrics parsePerfMetrics(const std::string& perf_output);
     
 private:
-    std::string rapl_path_;
-    bool rapl_available_;
-    bool perf_available_;
+    int perf_available_;  // -1 hasta la primera consulta
     
     // Helper para leer archivos del sistema
     std::string readSysFile(const std::string& path);
     uint64_t readSysFileUInt64(const std::string& path);
 };
 
+// ============================================================
+// Contadores de sesión (biblioteca dvfsmon)
+// ============================================================
+
+// Energía RAPL acumulada de los paquetes y su DRAM (los dominios con inTotal de
+// RaplDomains), desde la construcción.
+class RaplCounter {
+public:
+    explicit RaplCounter(const std::string& powercap_root = "/sys/class/powercap");
+    RaplCounter(const RaplCounter&) = delete;
+    RaplCounter& operator=(const RaplCounter&) = delete;
+    
+    bool isAvailable() const { return available_; }
+    // Energía desde la construcción (microjoules)
+    uint64_t readEnergyUJ();
+    
+private:
+    RaplDomains domains_;
+    bool available_;
+    uint64_t total_uj_;
+};
+
+// Grupo perf_event del hilo que lo crea (ciclos como líder, instrucciones, cache-misses,
+// branch-misses), sólo espacio de usuario, de modo que funciona con
+// perf_event_paranoid <= 2 sin root. Sin el grupo completo no hay contadores.
+// Con inherit cuenta además los hilos y procesos hijos creados después (el proceso
+// entero si se crea antes que ningún otro hilo); entonces no hay rdpmc.
+class PerfCounters {
+public:
+    explicit PerfCounters(bool inherit = false);
+    ~PerfCounters();
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+    
+    bool isAvailable() const { return fds_[0] >= 0; }
+    // Valores desde la creación (escalados si el kernel multiplexó el grupo) e IPC
+    bool read(PerfMetrics* out);
+    // Valores sin escalar ni IPC, para los marcadores de región: con rdpmc desde la
+    // página mmap de cada evento cuando el kernel lo permite (x86, sin syscall) y si no
+    // con read()
+    bool readRaw(PerfMetrics* out);
+    
+private:
+    static const int kEvents = 4;
+    bool readPages(uint64_t* values) const;
+    bool readGroup(uint64_t* values, double* scale);
+    
+    int fds_[kEvents];
+    void* pages_[kEvents];  // perf_event_mmap_page de cada evento, o nullptr
+};
+
+// ============================================================
+// Utilidades internas de la biblioteca dvfsmon
+// ============================================================
+
+// CLOCK_MONOTONIC en nanosegundos (vDSO, sin syscall): sesiones, marcadores, el
+// perfilador y dvfsmond comparten esta escala de tiempo
+uint64_t nowNs();
+// Raíz de powercap: DVFSMON_POWERCAP_ROOT (árboles falsos en los tests) o
+// /sys/class/powercap
+std::string powercapRoot();
+
 // ============================================================
 // Utilidades para CSV
 // ============================================================
@@ -1,10 +0,0 @@
-"""
-Placeholder for GPU GEMM benchmark
-Requires CUDA or OpenCL implementation
-
-For CUDA version:
-  nvcc -O2 -o gemm gemm.cu
-  ./gemm <matrix_size>
-"""
-
-# TODO: Implement CUDA/OpenCL GEMM kernel
@@ -1,10 +1,171 @@
-"""
-Placeholder for GPU Stencil benchmark
-Requires CUDA or OpenCL implementation
+// stencil.cu - CUDA 3D Jacobi stencil benchmark (7- and 27-point)
+//
+// Variants (--kernel=NAME[,NAME...]|all, default stencil7_smem):
+//   stencil<P>_smem       each block stages a 32x4x4 tile plus a one-point halo in
+//                         shared memory and updates one point per thread;
+//   stencil<P>_regstream  each block marches a 32x8 column tile through z, staging one
+//                         xy plane (plus halo) at a time; the z neighbours are carried
+//                         as per-plane partial sums in registers, so every input point
+//                         is read from global memory about once per step.
+// The point arithmetic is in stencil_ops.h; argument handling, inputs, --verify and the
+// key=value summary line (same keys as gemm_benchmark) in stencil_harness.cpp, which
+// stencil_host.cpp also builds against a CPU backend for testing without a GPU. Device
+// memory and timing go through the CUDA backend of the GEMM harness (bench_backend.h).
+//
+// Build in place for the frequency sweep (configs/sweep_config_example.json):
+//   nvcc -O3 -std=c++14 -I../../gpu_benchmark -o stencil stencil.cu stencil_harness.cpp \
+//        ../../gpu_benchmark/bench_backend_cuda.cu
+//   ./stencil <points|NXxNYxNZ> [iterations] [--kernel=...] [--verify]
+// or through gpu_benchmark/CMakeLists.txt (target stencil).
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include <cuda_runtime.h>
 
-For CUDA version:
-  nvcc -O2 -o stencil stencil.cu
-  ./stencil <grid_size>
-"""
+#include "bench_backend.h"
+#include "stencil_harness.h"
+#include "stencil_ops.h"
 
-# TODO: Implement CUDA/OpenCL 3D stencil kernel
+using gpu_monitor::BenchBackend;
+using gpu_monitor::cudaCheck;
+
+namespace {
+
+template <int POINTS>
+__global__ void __launch_bounds__(STENCIL_SMEM_BX * STENCIL_SMEM_BY * STENCIL_SMEM_BZ)
+stencil_smem(const float* __restrict__ in, float* __restrict__ out, int nx, int ny, int nz,
+             StencilCoeffs w) {
+    constexpr int TX = STENCIL_SMEM_BX + 2, TY = STENCIL_SMEM_BY + 2, TZ = STENCIL_SMEM_BZ + 2;
+    constexpr int THREADS = STENCIL_SMEM_BX * STENCIL_SMEM_BY * STENCIL_SMEM_BZ;
+    __shared__ float tile[TZ][TY][TX];
+
+    const int x0 = blockIdx.x * STENCIL_SMEM_BX - 1;
+    const int y0 = blockIdx.y * STENCIL_SMEM_BY - 1;
+    const int z0 = blockIdx.z * STENCIL_SMEM_BZ - 1;
+    const int sy = nx, sz = nx * ny;
+    const int tid = threadIdx.x + STENCIL_SMEM_BX * (threadIdx.y + STENCIL_SMEM_BY * threadIdx.z);
+    // consecutive threads load consecutive x, so the halo rows stay coalesced
+    for (int i = tid; i < TX * TY * TZ; i += THREADS) {
+        int lx = i % TX, ly = (i / TX) % TY, lz = i / (TX * TY);
+        int gx = x0 + lx, gy = y0 + ly, gz = z0 + lz;
+        tile[lz][ly][lx] = (gx >= 0 && gx < nx && gy >= 0 && gy < ny && gz >= 0 && gz < nz)
+                               ? in[gz * sz + gy * sy + gx]
+                               : 0.0f;
+    }
+    __syncthreads();
+
+    const int x = x0 + 1 + threadIdx.x, y = y0 + 1 + threadIdx.y, z = z0 + 1 + threadIdx.z;
+    // the boundary layer is fixed
+    if (x < 1 || x >= nx - 1 || y < 1 || y >= ny - 1 || z < 1 || z >= nz - 1) return;
+    out[z * sz + y * sy + x] =
+        stencilPoint<POINTS>(&tile[threadIdx.z + 1][threadIdx.y + 1][threadIdx.x + 1], TX, TX * TY, w);
+}
+
+template <int POINTS>
+__global__ void __launch_bounds__(STENCIL_RS_BX * STENCIL_RS_BY)
+stencil_regstream(const float* __restrict__ in, float* __restrict__ out, int nx, int ny, int nz,
+                  StencilCoeffs w) {
+    constexpr int PX = STENCIL_RS_BX + 2, PY = STENCIL_RS_BY + 2;
+    constexpr int THREADS = STENCIL_RS_BX * STENCIL_RS_BY;
+    __shared__ float plane[PY][PX];
+
+    const int x0 = blockIdx.x * STENCIL_RS_BX - 1;
+    const int y0 = blockIdx.y * STENCIL_RS_BY - 1;
+    const int x = x0 + 1 + threadIdx.x, y = y0 + 1 + threadIdx.y;
+    const int sy = nx, sz = nx * ny;
+    const int tid = threadIdx.x + STENCIL_RS_BX * threadIdx.y;
+    const bool interior = x >= 1 && x < nx - 1 && y >= 1 && y < ny - 1;
+
+    // s1(z-2), s1(z-1), s0(z-1); out(z-1) = s1(z-2) + s0(z-1) + s1(z)
+    float s1_back2 = 0.0f, s1_back = 0.0f, s0_back = 0.0f;
+    for (int z = 0; z < nz; ++z) {
+        for (int i = tid; i < PX * PY; i += THREADS) {
+            int lx = i % PX, ly = i / PX;
+            int gx = x0 + lx, gy = y0 + ly;
+            plane[ly][lx] = (gx >= 0 && gx < nx && gy >= 0 && gy < ny) ? in[z * sz + gy * sy + gx] : 0.0f;
+        }
+        __syncthreads();
+        float s0, s1;
+        stencilPlaneSums<POINTS>(&plane[threadIdx.y + 1][threadIdx.x + 1], PX, w, &s0, &s1);
+        if (interior && z >= 2) out[(z - 1) * sz + y * sy + x] = s1_back2 + s0_back + s1;
+        s1_back2 = s1_back;
+        s1_back = s1;
+        s0_back = s0;
+        // the next plane overwrites the one just read
+        __syncthreads();
+    }
+}
+
+const void* stencilKernel(const StencilVariant& v) {
+    if (v.kind == STENCIL_SMEM)
+        return v.points == 7 ? (const void*)stencil_smem<7> : (const void*)stencil_smem<27>;
+    return v.points == 7 ? (const void*)stencil_regstream<7> : (const void*)stencil_regstream<27>;
+}
+
+cudaError_t launchStencil(const StencilVariant& v, const StencilArgs& args, const float* in, float* out) {
+    const StencilCoeffs w = stencilCoeffs(v.points);
+    dim3 block(v.bx, v.by, v.bz);
+    dim3 grid((args.nx + v.bx - 1) / v.bx, (args.ny + v.by - 1) / v.by,
+              v.kind == STENCIL_SMEM ? (args.nz + v.bz - 1) / v.bz : 1);
+    if (v.kind == STENCIL_SMEM) {
+        if (v.points == 7) stencil_smem<7><<<grid, block>>>(in, out, args.nx, args.ny, args.nz, w);
+        else stencil_smem<27><<<grid, block>>>(in, out, args.nx, args.ny, args.nz, w);
+    } else {
+        if (v.points == 7) stencil_regstream<7><<<grid, block>>>(in, out, args.nx, args.ny, args.nz, w);
+        else stencil_regstream<27><<<grid, block>>>(in, out, args.nx, args.ny, args.nz, w);
+    }
+    return cudaGetLastError();
+}
+
+// Device grids, released on every exit path.
+struct DeviceGrids {
+    explicit DeviceGrids(BenchBackend& backend) : backend_(backend) {}
+    ~DeviceGrids() {
+        if (a) backend_.release(a);
+        if (b) backend_.release(b);
+    }
+    void *a = nullptr, *b = nullptr;
+
+private:
+    BenchBackend& backend_;
+};
+
+// Memory, batched timing and device properties come from the harness' CUDA backend.
+// The kernels go to the legacy default stream, which the backend's blocking stream
+// (and so its timing events) stays ordered with.
+bool runCuda(const StencilVariant& v, const StencilArgs& args, const std::vector<float>& in,
+             std::vector<float>* out, StencilTiming* timing, std::string* err) {
+    std::unique_ptr<BenchBackend> backend = gpu_monitor::makeCudaBackend(err);
+    if (!backend) return false;
+    const size_t bytes = in.size() * sizeof(float);
+    DeviceGrids d(*backend);
+    // both grids carry the fixed boundary layer; kernels only write the interior
+    if (!backend->allocate(bytes, &d.a, err) || !backend->allocate(bytes, &d.b, err) ||
+        !backend->upload(d.a, in.data(), bytes, err) || !backend->upload(d.b, in.data(), bytes, err))
+        return false;
+    float* a = static_cast<float*>(d.a);
+    float* b = static_cast<float*>(d.b);
+
+    // Warmup (every step rewrites the whole interior, so this does not change the result)
+    if (!cudaCheck(launchStencil(v, args, a, b), "launch", err) || !backend->synchronize(err)) return false;
+
+    int it = 0;
+    auto step = [&]() {
+        cudaError_t rc = (it++ % 2 == 0) ? launchStencil(v, args, a, b) : launchStencil(v, args, b, a);
+        return cudaCheck(rc, "launch", err);
+    };
+    if (!backend->timeBatch(step, args.iterations, &timing->time_s, err)) return false;
+
+    const gpu_monitor::DeviceInfo& dev = backend->device();
+    timing->num_sm = dev.num_sm;
+    timing->occupancy = gpu_monitor::kernelOccupancy(stencilKernel(v), v.bx * v.by * v.bz, dev.max_threads_per_sm);
+
+    const float* result = args.iterations % 2 ? b : a;
+    return backend->download(out->data(), result, bytes, err);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return stencilMain(argc, argv, runCuda);
+}
@@ -0,0 +1,231 @@
+// stencil_harness.cpp - Argument parsing, inputs, CPU reference and summary line for the stencil benchmark
+#include "stencil_harness.h"
+#include "stencil_ops.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <random>
+
+using gpu_monitor::parseInteger;
+using gpu_monitor::trackMaxError;
+
+namespace {
+
+const StencilVariant kVariants[] = {
+    {"stencil7_smem", 7, STENCIL_SMEM, STENCIL_SMEM_BX, STENCIL_SMEM_BY, STENCIL_SMEM_BZ},
+    {"stencil7_regstream", 7, STENCIL_REGSTREAM, STENCIL_RS_BX, STENCIL_RS_BY, 1},
+    {"stencil27_smem", 27, STENCIL_SMEM, STENCIL_SMEM_BX, STENCIL_SMEM_BY, STENCIL_SMEM_BZ},
+    {"stencil27_regstream", 27, STENCIL_REGSTREAM, STENCIL_RS_BX, STENCIL_RS_BY, 1},
+};
+
+bool parseSize(const char* s, StencilArgs* args) {
+    int nx, ny, nz;
+    char extra;
+    if (strchr(s, 'x')) {
+        if (sscanf(s, "%dx%dx%d%c", &nx, &ny, &nz, &extra) != 3) return false;
+    } else {
+        long long points = 0;
+        if (!parseInteger(s, 1LL, static_cast<long long>(INT_MAX), &points)) return false;
+        nx = ny = nz = static_cast<int>(std::llround(std::cbrt(static_cast<double>(points))));
+    }
+    if (nx < 3 || ny < 3 || nz < 3) return false;
+    // kernels index with 32-bit plane offsets
+    if (static_cast<long long>(nx) * ny * nz > INT_MAX) return false;
+    args->nx = nx;
+    args->ny = ny;
+    args->nz = nz;
+    return true;
+}
+
+bool parseVariants(const std::string& list, StencilArgs* args, std::string* err) {
+    args->variants.clear();
+    if (list == "all") {
+        for (const StencilVariant& v : kVariants) args->variants.push_back(&v);
+        return true;
+    }
+    size_t pos = 0;
+    while (pos <= list.size()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos) comma = list.size();
+        std::string name = list.substr(pos, comma - pos);
+        const StencilVariant* v = findStencilVariant(name.c_str());
+        if (!v) {
+            *err = "unknown kernel '" + name + "' (see --list-kernels)";
+            return false;
+        }
+        args->variants.push_back(v);
+        pos = comma + 1;
+    }
+    return true;
+}
+
+// Distance class (0 centre, 1 face, 2 edge, 3 corner) -> weight; 0 outside the stencil.
+double referenceWeight(int points, int dist) {
+    StencilCoeffs w = stencilCoeffs(points);
+    switch (dist) {
+    case 0: return w.center;
+    case 1: return w.face;
+    case 2: return points == 27 ? w.edge : 0.0;
+    default: return points == 27 ? w.corner : 0.0;
+    }
+}
+
+} // namespace
+
+const StencilVariant* stencilVariants(int* count) {
+    *count = static_cast<int>(sizeof(kVariants) / sizeof(kVariants[0]));
+    return kVariants;
+}
+
+const StencilVariant* findStencilVariant(const char* name) {
+    for (const StencilVariant& v : kVariants)
+        if (strcmp(v.name, name) == 0) return &v;
+    return nullptr;
+}
+
+bool parseStencilArgs(int argc, char** argv, StencilArgs* args, std::string* err) {
+    std::vector<const char*> positional;
+    std::string variants = "stencil7_smem";
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (strncmp(arg, "--kernel=", 9) == 0) {
+            variants = arg + 9;
+        } else if (strcmp(arg, "--verify") == 0) {
+            args->verify = true;
+        } else if (strncmp(arg, "--seed=", 7) == 0) {
+            int seed = 0;
+            if (!parseInteger(arg + 7, 1, INT_MAX, &seed)) {
+                *err = std::string("invalid seed: ") + (arg + 7);
+                return false;
+            }
+            args->seed = static_cast<unsigned>(seed);
+        } else if (strcmp(arg, "--list-kernels") == 0) {
+            args->list = true;
+        } else if (strncmp(arg, "--", 2) == 0) {
+            *err = std::string("unknown option: ") + arg;
+            return false;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (args->list) return true;
+    if (positional.empty() || positional.size() > 2) {
+        *err = "expected SIZE [iterations]";
+        return false;
+    }
+    if (!parseSize(positional[0], args)) {
+        *err = std::string("invalid size: ") + positional[0] +
+               " (NXxNYxNZ or a point count, every dimension >= 3)";
+        return false;
+    }
+    if (positional.size() == 2) {
+        if (!parseInteger(positional[1], 1, 1000000, &args->iterations)) {
+            *err = std::string("invalid iterations: ") + positional[1];
+            return false;
+        }
+    }
+    return parseVariants(variants, args, err);
+}
+
+void fillGrid(std::vector<float>& grid, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    for (size_t i = 0; i < grid.size(); ++i) grid[i] = dist(gen);
+}
+
+StencilCheck checkStencil(int points, const StencilArgs& args, const std::vector<float>& in,
+                          const std::vector<float>& out) {
+    const int nx = args.nx, ny = args.ny, nz = args.nz;
+    const long long sy = nx, sz = static_cast<long long>(nx) * ny;
+    double weight[4];
+    for (int d = 0; d < 4; ++d) weight[d] = referenceWeight(points, d);
+
+    std::vector<double> cur(in.begin(), in.end()), next(cur);
+    for (int it = 0; it < args.iterations; ++it) {
+        for (int z = 1; z < nz - 1; ++z)
+            for (int y = 1; y < ny - 1; ++y)
+                for (int x = 1; x < nx - 1; ++x) {
+                    const long long c = z * sz + y * sy + x;
+                    double v = 0.0;
+                    for (int dz = -1; dz <= 1; ++dz)
+                        for (int dy = -1; dy <= 1; ++dy)
+                            for (int dx = -1; dx <= 1; ++dx) {
+                                double wgt = weight[std::abs(dx) + std::abs(dy) + std::abs(dz)];
+                                if (wgt != 0.0) v += wgt * cur[c + dz * sz + dy * sy + dx];
+                            }
+                    next[c] = v;
+                }
+        cur.swap(next);
+    }
+
+    StencilCheck check;
+    check.tolerance = args.iterations * 32.0 * FLT_EPSILON;
+    for (size_t i = 0; i < cur.size(); ++i) {
+        double err = std::fabs(out[i] - cur[i]);
+        trackMaxError(err, &check.max_err);
+    }
+    check.ok = check.max_err <= check.tolerance;
+    return check;
+}
+
+std::string stencilSummaryLine(const StencilVariant& v, const StencilArgs& args,
+                               const StencilTiming& t, const StencilCheck* check) {
+    double interior = static_cast<double>(args.nx - 2) * (args.ny - 2) * (args.nz - 2);
+    double flops = interior * stencilFlopsPerPoint(v.points) * args.iterations;
+    double gflops = t.time_s > 0.0 ? (flops / 1e9) / t.time_s : 0.0;
+    char buf[512];
+    int len = snprintf(buf, sizeof(buf),
+                       "kernel_name=%s,problem_size=%dx%dx%d,iterations=%d,time_s=%.9f,"
+                       "gflops=%.3f,occupancy=%.3f,block=%dx%dx%d,numSM=%d",
+                       v.name, args.nx, args.ny, args.nz, args.iterations, t.time_s, gflops,
+                       t.occupancy, v.bx, v.by, v.bz, t.num_sm);
+    if (check && len > 0 && static_cast<size_t>(len) < sizeof(buf))
+        snprintf(buf + len, sizeof(buf) - len, ",verify=%s,max_err=%.3e",
+                 check->ok ? "pass" : "fail", check->max_err);
+    return buf;
+}
+
+int stencilMain(int argc, char** argv, StencilRunFn run) {
+    StencilArgs args;
+    std::string err;
+    if (!parseStencilArgs(argc, argv, &args, &err)) {
+        fprintf(stderr, "%s: %s\n", argv[0], err.c_str());
+        fprintf(stderr, "Usage: %s SIZE [iterations] [--kernel=NAME[,NAME...]|all] [--verify] [--seed=N]\n"
+                        "       %s --list-kernels\n"
+                        "SIZE is NXxNYxNZ or a number of grid points (nearest cube)\n",
+                argv[0], argv[0]);
+        return gpu_monitor::BENCH_EXIT_USAGE;
+    }
+    if (args.list) {
+        for (const StencilVariant& v : kVariants) printf("%s\n", v.name);
+        return gpu_monitor::BENCH_EXIT_OK;
+    }
+
+    std::vector<float> in(args.points()), out(args.points());
+    fillGrid(in, args.seed);
+
+    int status = gpu_monitor::BENCH_EXIT_OK;
+    for (const StencilVariant* v : args.variants) {
+        StencilTiming timing;
+        // points a kernel fails to write stay NaN and fail verification
+        std::fill(out.begin(), out.end(), std::numeric_limits<float>::quiet_NaN());
+        if (!run(*v, args, in, &out, &timing, &err)) {
+            fprintf(stderr, "%s: %s: %s\n", argv[0], v->name, err.c_str());
+            return gpu_monitor::BENCH_EXIT_BACKEND;
+        }
+        StencilCheck check;
+        if (args.verify) {
+            check = checkStencil(v->points, args, in, out);
+            if (!check.ok) status = gpu_monitor::BENCH_EXIT_VERIFY;
+        }
+        printf("%s\n", stencilSummaryLine(*v, args, timing, args.verify ? &check : nullptr).c_str());
+        fflush(stdout);
+    }
+    return status;
+}
@@ -0,0 +1,85 @@
+// stencil_harness.h
+// Host side of the stencil benchmark: argument parsing, inputs, the double-precision
+// CPU reference used by --verify and the key=value summary line (same keys as
+// gemm_benchmark). A backend supplies one function that runs a variant and times it,
+// so the driver builds against CUDA (stencil.cu) or the CPU backend (stencil_host.cpp).
+
+#ifndef STENCIL_HARNESS_H
+#define STENCIL_HARNESS_H
+
+#include "bench_util.h"
+
+#include <string>
+#include <vector>
+
+enum StencilKind {
+    STENCIL_SMEM,      // 3D tile plus halo staged in shared memory, one point per thread
+    STENCIL_REGSTREAM  // xy tile marching through z, z neighbours as partial sums in registers
+};
+
+struct StencilVariant {
+    const char* name;  // "stencil<points>_<smem|regstream>"
+    int points;        // 7 or 27
+    StencilKind kind;
+    int bx, by, bz;    // thread block shape
+};
+
+// All variants.
+const StencilVariant* stencilVariants(int* count);
+
+// Variant called name, or nullptr.
+const StencilVariant* findStencilVariant(const char* name);
+
+struct StencilArgs {
+    int nx = 0, ny = 0, nz = 0;
+    int iterations = 10;
+    std::vector<const StencilVariant*> variants;  // --kernel=NAME[,NAME...] or all
+    bool verify = false;
+    unsigned seed = 1;
+    bool list = false;  // --list-kernels
+
+    size_t points() const { return static_cast<size_t>(nx) * ny * nz; }
+};
+
+// Parse "SIZE [iterations] [--kernel=...] [--verify] [--seed=N]" or "--list-kernels".
+// SIZE is NXxNYxNZ, or a point count rounded to the nearest cube (as passed by the
+// frequency sweep). Every dimension must be at least 3. Returns false with a message.
+bool parseStencilArgs(int argc, char** argv, StencilArgs* args, std::string* err);
+
+// Uniform values in [0, 1) from a fixed-seed generator.
+void fillGrid(std::vector<float>& grid, unsigned seed);
+
+struct StencilCheck {
+    double max_err = 0.0;  // max |out - ref| over the grid
+    double tolerance = 0.0;
+    bool ok = true;
+};
+
+// Run the stencil for args.iterations Jacobi steps in double precision from in (the
+// boundary layer stays fixed) and compare out against it. Values stay in [0, 1] and
+// each step adds at most ~27 float roundings, so the tolerance is
+// iterations * 32 * FLT_EPSILON.
+StencilCheck checkStencil(int points, const StencilArgs& args, const std::vector<float>& in,
+                          const std::vector<float>& out);
+
+struct StencilTiming {
+    double time_s = 0.0;  // all iterations, warmup excluded
+    double occupancy = 0.0;
+    int num_sm = 0;
+};
+
+// Run args.iterations Jacobi steps of v from in (after a warmup step) and leave the
+// final grid, boundary included, in *out. Returns false with a message in *err.
+typedef bool (*StencilRunFn)(const StencilVariant& v, const StencilArgs& args,
+                             const std::vector<float>& in, std::vector<float>* out,
+                             StencilTiming* timing, std::string* err);
+
+// kernel_name=...,problem_size=NXxNYxNZ,iterations=..,time_s=..,gflops=..,occupancy=..,
+// block=XxYxZ,numSM=..[,verify=pass|fail,max_err=..]
+std::string stencilSummaryLine(const StencilVariant& v, const StencilArgs& args,
+                               const StencilTiming& t, const StencilCheck* check);
+
+// Whole driver: parse, fill, run each selected variant, print one line per variant.
+int stencilMain(int argc, char** argv, StencilRunFn run);
+
+#endif // STENCIL_HARNESS_H
@@ -0,0 +1,76 @@
+// stencil_host.cpp - CPU backend of the stencil benchmark (stencil_host)
+//
+// Runs each variant on the CPU with the point arithmetic of stencil_ops.h: the
+// shared-memory variants apply stencilPoint to every interior point, the
+// register-streaming variants march each column through z combining the per-plane sums
+// of stencilPlaneSums, exactly as the kernels do. It exists so argument handling, the
+// plane decomposition and the correctness check can be tested without a GPU; its
+// timings say nothing about GPU performance.
+#include "stencil_harness.h"
+#include "stencil_ops.h"
+
+#include <chrono>
+
+namespace {
+
+template <int POINTS>
+void stepPoint(const float* in, float* out, int nx, int ny, int nz, const StencilCoeffs& w) {
+    const int sy = nx, sz = nx * ny;
+    for (int z = 1; z < nz - 1; ++z)
+        for (int y = 1; y < ny - 1; ++y)
+            for (int x = 1; x < nx - 1; ++x) {
+                const int c = z * sz + y * sy + x;
+                out[c] = stencilPoint<POINTS>(in + c, sy, sz, w);
+            }
+}
+
+template <int POINTS>
+void stepStream(const float* in, float* out, int nx, int ny, int nz, const StencilCoeffs& w) {
+    const int sy = nx, sz = nx * ny;
+    for (int y = 1; y < ny - 1; ++y)
+        for (int x = 1; x < nx - 1; ++x) {
+            // s1(z-2), s1(z-1), s0(z-1): the kernel's register queue
+            float s1_back2 = 0.0f, s1_back = 0.0f, s0_back = 0.0f;
+            for (int z = 0; z < nz; ++z) {
+                const int c = z * sz + y * sy + x;
+                float s0, s1;
+                stencilPlaneSums<POINTS>(in + c, sy, w, &s0, &s1);
+                if (z >= 2) out[c - sz] = s1_back2 + s0_back + s1;
+                s1_back2 = s1_back;
+                s1_back = s1;
+                s0_back = s0;
+            }
+        }
+}
+
+void step(const StencilVariant& v, const StencilArgs& args, const float* in, float* out) {
+    const StencilCoeffs w = stencilCoeffs(v.points);
+    if (v.kind == STENCIL_SMEM) {
+        if (v.points == 7) stepPoint<7>(in, out, args.nx, args.ny, args.nz, w);
+        else stepPoint<27>(in, out, args.nx, args.ny, args.nz, w);
+    } else {
+        if (v.points == 7) stepStream<7>(in, out, args.nx, args.ny, args.nz, w);
+        else stepStream<27>(in, out, args.nx, args.ny, args.nz, w);
+    }
+}
+
+bool runHost(const StencilVariant& v, const StencilArgs& args, const std::vector<float>& in,
+             std::vector<float>* out, StencilTiming* timing, std::string*) {
+    // both buffers carry the fixed boundary layer; steps only write the interior
+    std::vector<float> a(in), b(in);
+    step(v, args, a.data(), b.data());  // warmup
+    auto start = std::chrono::steady_clock::now();
+    for (int it = 0; it < args.iterations; ++it) {
+        if (it % 2 == 0) step(v, args, a.data(), b.data());
+        else step(v, args, b.data(), a.data());
+    }
+    timing->time_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    *out = args.iterations % 2 ? b : a;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    return stencilMain(argc, argv, runHost);
+}
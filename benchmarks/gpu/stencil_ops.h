@@ -0,0 +1,74 @@
+// stencil_ops.h
+// Point arithmetic of the 3D Jacobi stencils, shared verbatim by the CUDA kernels
+// (stencil.cu) and the CPU backend (stencil_host.cpp), so the host build exercises the
+// same decomposition the GPU runs. Grids are nx x ny x nz floats, x fastest.
+//
+// Weights depend only on the distance class of a neighbour: centre, face (6), edge (12,
+// 27-point only) and corner (8, 27-point only). They sum to 1, so values stay in the
+// range of the input and errors do not grow geometrically over iterations.
+
+#ifndef STENCIL_OPS_H
+#define STENCIL_OPS_H
+
+#ifdef __CUDACC__
+#define STENCIL_HD __host__ __device__ __forceinline__
+#else
+#define STENCIL_HD inline
+#endif
+
+// Thread block shapes: the shared-memory variant computes a 3D tile per block, the
+// register-streaming variant marches an xy tile through z.
+#define STENCIL_SMEM_BX 32
+#define STENCIL_SMEM_BY 4
+#define STENCIL_SMEM_BZ 4
+#define STENCIL_RS_BX 32
+#define STENCIL_RS_BY 8
+
+struct StencilCoeffs {
+    float center, face, edge, corner;
+};
+
+inline StencilCoeffs stencilCoeffs(int points) {
+    if (points == 7) return StencilCoeffs{0.4f, 0.1f, 0.0f, 0.0f};
+    return StencilCoeffs{0.28f, 0.06f, 0.025f, 0.0075f};
+}
+
+// Nominal floating-point operations per updated point (adds + multiplies of
+// stencilPoint), used for the gflops figure of every variant.
+inline int stencilFlopsPerPoint(int points) {
+    return points == 7 ? 8 : 30;
+}
+
+// Updated value at p (x stride 1, y stride sy, z stride sz); every neighbour must exist.
+template <int POINTS>
+STENCIL_HD float stencilPoint(const float* p, int sy, int sz, const StencilCoeffs& w) {
+    float faces = p[-1] + p[1] + p[-sy] + p[sy] + p[-sz] + p[sz];
+    float v = w.center * p[0] + w.face * faces;
+    if (POINTS == 27) {
+        float edges = p[-sy - 1] + p[-sy + 1] + p[sy - 1] + p[sy + 1] +
+                      p[-sz - 1] + p[-sz + 1] + p[sz - 1] + p[sz + 1] +
+                      p[-sz - sy] + p[-sz + sy] + p[sz - sy] + p[sz + sy];
+        float corners = p[-sz - sy - 1] + p[-sz - sy + 1] + p[-sz + sy - 1] + p[-sz + sy + 1] +
+                        p[sz - sy - 1] + p[sz - sy + 1] + p[sz + sy - 1] + p[sz + sy + 1];
+        v += w.edge * edges + w.corner * corners;
+    }
+    return v;
+}
+
+// The stencil split by plane: a plane at z contributes *s0 to the output at z and *s1
+// to the outputs at z-1 and z+1, so out(z) = s1(z-1) + s0(z) + s1(z+1). p points into
+// the plane (x stride 1, y stride sy); its 8 xy neighbours must exist.
+template <int POINTS>
+STENCIL_HD void stencilPlaneSums(const float* p, int sy, const StencilCoeffs& w, float* s0, float* s1) {
+    float faces = p[-1] + p[1] + p[-sy] + p[sy];
+    if (POINTS == 27) {
+        float diag = p[-sy - 1] + p[-sy + 1] + p[sy - 1] + p[sy + 1];
+        *s0 = w.center * p[0] + w.face * faces + w.edge * diag;
+        *s1 = w.face * p[0] + w.edge * faces + w.corner * diag;
+    } else {
+        *s0 = w.center * p[0] + w.face * faces;
+        *s1 = w.face * p[0];
+    }
+}
+
+#endif // STENCIL_OPS_H
@@ -0,0 +1,100 @@
+// bench_backend.h
+// Backend interface of the GPU benchmark harness: device memory, copies, batched
+// timing and the kernel entry points of the workloads built on it (GEMM, STREAM). The CUDA
+// backend (bench_backend_cuda.cu) is only built where nvcc exists; the host backend
+// runs CPU emulations of the kernels so the front ends (gemm_harness.cpp,
+// gemm_google.cpp, stream_harness.cpp) can be tested on GPU-less machines.
+
+#ifndef BENCH_BACKEND_H
+#define BENCH_BACKEND_H
+
+#include "gemm_tiles.h"
+#include "stream_ops.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace gpu_monitor {
+
+struct DeviceInfo {
+    std::string name;
+    int num_sm = 0;
+    int max_threads_per_sm = 0;
+    int compute_capability = 0;  // major * 10 + minor; 0 on the host backend
+    int max_grid_x = 0;          // largest gridDim.x (65535 before compute capability 3.0)
+};
+
+// A batch of launches recorded once and replayed as a unit: a CUDA graph on the GPU,
+// so replaying costs one host-side launch however many kernels it holds.
+class LaunchGraph {
+public:
+    virtual ~LaunchGraph() {}
+    virtual int count() const = 0;  // launches per replay
+};
+
+class BenchBackend {
+public:
+    virtual ~BenchBackend() {}
+
+    virtual const char* name() const = 0;  // "cuda", "host"
+    virtual const DeviceInfo& device() const = 0;
+
+    // Device memory. Buffers come from DeviceBufferPool rather than from callers.
+    virtual bool allocate(size_t bytes, void** ptr, std::string* err) = 0;
+    virtual void release(void* ptr) = 0;
+    virtual bool upload(void* dst, const void* src, size_t bytes, std::string* err) = 0;
+    virtual bool download(void* dst, const void* src, size_t bytes, std::string* err) = 0;
+    virtual bool fill(void* dst, unsigned char byte, size_t bytes, std::string* err) = 0;
+
+    // Issue launch() count times back to back between one pair of timestamps (one
+    // CUDA event pair on the GPU, so launches are not serialized by a host sync) and
+    // wait for them; *seconds is the total. Stops at the first failed launch.
+    virtual bool timeBatch(const std::function<bool()>& launch, int count, double* seconds,
+                           std::string* err) = 0;
+    // Record launch() count times into a graph without running it. launch() must only
+    // queue device work (no copies to or from the host, no synchronization).
+    virtual bool captureGraph(const std::function<bool()>& launch, int count,
+                              std::unique_ptr<LaunchGraph>* graph, std::string* err) = 0;
+    // Replay graph between one pair of timestamps and wait for it; *seconds is the total.
+    virtual bool timeGraph(LaunchGraph& graph, double* seconds, std::string* err) = 0;
+    // Wait for all queued work.
+    virtual bool synchronize(std::string* err) = 0;
+
+    // GEMM: whether cfg can run here (device capability, toolkit and compiled
+    // architectures); if not, the reason in *why.
+    virtual bool supportsGemm(const TileConfig& cfg, std::string* why) const = 0;
+    // Convert row-major float src (rows x cols) to the input type of precision into dst,
+    // zero-padded to prows x pcols (WMMA operands; see TileConfig::paddedM and friends).
+    virtual bool convertGemmOperand(GemmPrecision precision, const float* src, int rows, int cols,
+                                    void* dst, int prows, int pcols, std::string* err) = 0;
+    // Queue one launch of cfg computing C = A * B (row-major, device pointers). a and b
+    // are float M x K and K x N, or for WMMA kernels the converted, padded operands.
+    virtual bool launchGemm(const TileConfig& cfg, const void* a, const void* b, float* c,
+                            int m, int k, int n, std::string* err) = 0;
+    // Theoretical occupancy of cfg (resident warps / maximum warps per SM); 0 if unknown.
+    virtual double gemmOccupancy(const TileConfig& cfg) const = 0;
+
+    // STREAM: queue one launch of op over n elements of the device arrays a, b and c
+    // (stream_ops.h) as grid blocks of block threads, in a grid-stride loop.
+    virtual bool launchStream(StreamOp op, int block, int grid, double* a, double* b, double* c,
+                              double q, size_t n, std::string* err) = 0;
+    // Blocks of op's kernel with block threads that fit on one SM at once
+    // (cudaOccupancyMaxActiveBlocksPerMultiprocessor); 0 if unknown.
+    virtual int streamActiveBlocks(StreamOp op, int block) const = 0;
+};
+
+// Front ends take a factory so argument errors are reported before any device is touched.
+typedef std::unique_ptr<BenchBackend> (*BackendFactory)(std::string* err);
+
+// CPU backend: heap "device" memory, steady_clock timing, emulated kernels. Never fails.
+std::unique_ptr<BenchBackend> makeHostBackend(std::string* err);
+
+// CUDA backend on the current device; nullptr with a message in *err if there is
+// none. Defined in bench_backend_cuda.cu, so only available to CUDA builds.
+std::unique_ptr<BenchBackend> makeCudaBackend(std::string* err);
+
+} // namespace gpu_monitor
+
+#endif // BENCH_BACKEND_H
@@ -0,0 +1,230 @@
+// bench_backend_cuda.cu - CUDA backend of the benchmark harness
+//
+// All kernels and timing events go to one stream owned by the backend. It is a
+// blocking stream, so the synchronous cudaMemcpy/cudaMemset on the legacy default
+// stream stay ordered with it, and it can be captured into CUDA graphs (the legacy
+// stream cannot). Graphs need CUDA 10; older toolkits (Fermi cards such as the
+// M2075s in guane15 stop at CUDA 8) report graph mode as unavailable.
+#include "bench_backend.h"
+#include "bench_util.h"
+#include "gemm_kernels.cuh"
+#include "stream_kernels.cuh"
+
+#include <cuda_runtime.h>
+
+#include <cstdio>
+#include <utility>
+
+namespace gpu_monitor {
+
+namespace {
+
+#if CUDART_VERSION >= 10000
+class CudaGraph : public LaunchGraph {
+public:
+    CudaGraph(cudaGraph_t graph, cudaGraphExec_t exec, int count)
+        : graph_(graph), exec_(exec), count_(count) {}
+    ~CudaGraph() override {
+        cudaGraphExecDestroy(exec_);
+        cudaGraphDestroy(graph_);
+    }
+    int count() const override { return count_; }
+    cudaGraphExec_t exec() const { return exec_; }
+
+private:
+    cudaGraph_t graph_;
+    cudaGraphExec_t exec_;
+    int count_;
+};
+#endif
+
+class CudaBackend : public BenchBackend {
+public:
+    explicit CudaBackend(const cudaDeviceProp& prop) : prop_(prop), stream_(nullptr), start_(nullptr), stop_(nullptr) {
+        info_.name = prop.name;
+        info_.num_sm = prop.multiProcessorCount;
+        info_.max_threads_per_sm = prop.maxThreadsPerMultiProcessor;
+        info_.compute_capability = prop.major * 10 + prop.minor;
+        info_.max_grid_x = prop.maxGridSize[0];
+    }
+    ~CudaBackend() override {
+        if (start_) cudaEventDestroy(start_);
+        if (stop_) cudaEventDestroy(stop_);
+        if (stream_) cudaStreamDestroy(stream_);
+    }
+
+    // Creates the stream and the timing events; a failure here (no context, out of
+    // resources) is reported now rather than as an invalid handle at the first timing.
+    bool init(std::string* err) {
+        return cudaCheck(cudaStreamCreate(&stream_), "cudaStreamCreate", err) &&
+               cudaCheck(cudaEventCreate(&start_), "cudaEventCreate", err) &&
+               cudaCheck(cudaEventCreate(&stop_), "cudaEventCreate", err);
+    }
+
+    const char* name() const override { return "cuda"; }
+    const DeviceInfo& device() const override { return info_; }
+
+    bool allocate(size_t bytes, void** ptr, std::string* err) override {
+        return cudaCheck(cudaMalloc(ptr, bytes), "cudaMalloc", err);
+    }
+    void release(void* ptr) override { cudaFree(ptr); }
+    bool upload(void* dst, const void* src, size_t bytes, std::string* err) override {
+        return cudaCheck(cudaMemcpy(dst, src, bytes, cudaMemcpyHostToDevice), "cudaMemcpy", err);
+    }
+    bool download(void* dst, const void* src, size_t bytes, std::string* err) override {
+        return cudaCheck(cudaMemcpy(dst, src, bytes, cudaMemcpyDeviceToHost), "cudaMemcpy", err);
+    }
+    bool fill(void* dst, unsigned char byte, size_t bytes, std::string* err) override {
+        return cudaCheck(cudaMemset(dst, byte, bytes), "cudaMemset", err);
+    }
+
+    bool timeBatch(const std::function<bool()>& launch, int count, double* seconds,
+                   std::string* err) override {
+        cudaEventRecord(start_, stream_);
+        for (int i = 0; i < count; ++i) {
+            if (!launch()) {
+                cudaEventRecord(stop_, stream_);
+                cudaEventSynchronize(stop_);
+                if (err->empty()) *err = "launch failed";
+                return false;
+            }
+        }
+        cudaEventRecord(stop_, stream_);
+        return elapsed(seconds, err);
+    }
+
+    bool captureGraph(const std::function<bool()>& launch, int count,
+                      std::unique_ptr<LaunchGraph>* graph, std::string* err) override {
+#if CUDART_VERSION >= 10000
+        cudaGraph_t g = nullptr;
+        cudaGraphExec_t exec = nullptr;
+        // the capture mode argument arrived in CUDA 10.1; 10.0 only has the global mode
+#if CUDART_VERSION >= 10010
+        cudaError_t begin = cudaStreamBeginCapture(stream_, cudaStreamCaptureModeThreadLocal);
+#else
+        cudaError_t begin = cudaStreamBeginCapture(stream_);
+#endif
+        if (!cudaCheck(begin, "cudaStreamBeginCapture", err)) return false;
+        bool queued = true;
+        for (int i = 0; i < count && queued; ++i) queued = launch();
+        // end the capture even after a failed launch, or the stream stays unusable
+        cudaError_t rc = cudaStreamEndCapture(stream_, &g);
+        if (!queued) {
+            if (g) cudaGraphDestroy(g);
+            if (err->empty()) *err = "launch failed";
+            return false;
+        }
+        if (!cudaCheck(rc, "cudaStreamEndCapture", err)) return false;
+        if (!cudaCheck(cudaGraphInstantiate(&exec, g, nullptr, nullptr, 0), "cudaGraphInstantiate", err)) {
+            cudaGraphDestroy(g);
+            return false;
+        }
+        graph->reset(new CudaGraph(g, exec, count));
+        return true;
+#else
+        (void)launch;
+        (void)count;
+        (void)graph;
+        *err = "CUDA graphs need CUDA 10 or later";
+        return false;
+#endif
+    }
+    bool timeGraph(LaunchGraph& graph, double* seconds, std::string* err) override {
+#if CUDART_VERSION >= 10000
+        cudaEventRecord(start_, stream_);
+        cudaError_t rc = cudaGraphLaunch(static_cast<CudaGraph&>(graph).exec(), stream_);
+        cudaEventRecord(stop_, stream_);
+        if (!cudaCheck(rc, "cudaGraphLaunch", err)) {
+            cudaEventSynchronize(stop_);
+            return false;
+        }
+        return elapsed(seconds, err);
+#else
+        (void)graph;
+        (void)seconds;
+        *err = "CUDA graphs need CUDA 10 or later";
+        return false;
+#endif
+    }
+    bool synchronize(std::string* err) override {
+        return cudaCheck(cudaDeviceSynchronize(), "cudaDeviceSynchronize", err);
+    }
+
+    bool supportsGemm(const TileConfig& cfg, std::string* why) const override {
+        if (!cfg.wmma()) return true;
+        char buf[160];
+        if (info_.compute_capability < cfg.min_cc) {
+            snprintf(buf, sizeof(buf), "needs compute capability %d.%d, device has %d.%d", cfg.min_cc / 10,
+                     cfg.min_cc % 10, info_.compute_capability / 10, info_.compute_capability % 10);
+            *why = buf;
+            return false;
+        }
+        if (!gemmWmmaBuilt(cfg.precision)) {
+            *why = cfg.precision == GEMM_FP16 ? "needs CUDA 9 or later" : "needs CUDA 11 or later";
+            return false;
+        }
+        if (!gemmWmmaCompiled(cfg)) {
+            snprintf(buf, sizeof(buf), "not compiled for sm_%d (set CMAKE_CUDA_ARCHITECTURES)", cfg.min_cc);
+            *why = buf;
+            return false;
+        }
+        return true;
+    }
+    bool convertGemmOperand(GemmPrecision precision, const float* src, int rows, int cols, void* dst,
+                            int prows, int pcols, std::string* err) override {
+        return cudaCheck(gpu_monitor::convertGemmOperand(precision, src, rows, cols, dst, prows, pcols, stream_),
+                         "convert", err);
+    }
+    bool launchGemm(const TileConfig& cfg, const void* a, const void* b, float* c, int m, int k,
+                    int n, std::string* err) override {
+        return cudaCheck(gpu_monitor::launchGemm(cfg, a, b, c, m, k, n, stream_), "launch", err);
+    }
+    double gemmOccupancy(const TileConfig& cfg) const override {
+        return gpu_monitor::gemmOccupancy(cfg, prop_);
+    }
+    bool launchStream(StreamOp op, int block, int grid, double* a, double* b, double* c, double q, size_t n,
+                      std::string* err) override {
+        return cudaCheck(gpu_monitor::launchStream(op, block, grid, a, b, c, q, n, stream_), "launch", err);
+    }
+    int streamActiveBlocks(StreamOp op, int block) const override {
+        int blocks = 0;
+        if (cudaOccupancyMaxActiveBlocksPerMultiprocessor(&blocks, streamKernel(op), block, 0) != cudaSuccess)
+            return 0;
+        return blocks;
+    }
+
+private:
+    // Wait for stop_ and store the time since start_.
+    bool elapsed(double* seconds, std::string* err) {
+        if (!cudaCheck(cudaEventSynchronize(stop_), "cudaEventSynchronize", err)) return false;
+        float ms = 0.0f;
+        cudaEventElapsedTime(&ms, start_, stop_);
+        *seconds = ms / 1000.0;
+        return true;
+    }
+
+    cudaDeviceProp prop_;
+    DeviceInfo info_;
+    cudaStream_t stream_;
+    cudaEvent_t start_, stop_;
+};
+
+} // namespace
+
+std::unique_ptr<BenchBackend> makeCudaBackend(std::string* err) {
+    int count = 0, device = 0;
+    cudaDeviceProp prop;
+    if (!cudaCheck(cudaGetDeviceCount(&count), "cudaGetDeviceCount", err)) return nullptr;
+    if (count == 0) {
+        *err = "no CUDA device";
+        return nullptr;
+    }
+    if (!cudaCheck(cudaGetDevice(&device), "cudaGetDevice", err) ||
+        !cudaCheck(cudaGetDeviceProperties(&prop, device), "cudaGetDeviceProperties", err))
+        return nullptr;
+    std::unique_ptr<CudaBackend> backend(new CudaBackend(prop));
+    if (!backend->init(err)) return nullptr;
+    return std::unique_ptr<BenchBackend>(std::move(backend));
+}
+
+} // namespace gpu_monitor
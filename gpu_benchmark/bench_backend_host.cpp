@@ -0,0 +1,198 @@
+// bench_backend_host.cpp - CPU backend of the benchmark harness
+//
+// "Device" memory is heap memory and kernels are CPU emulations with the decomposition
+// of the CUDA ones: for GEMM, BM x BN block tiles, BK-wide zero-padded slabs of A
+// (transposed) and B, TM x TN register tiles per thread, k accumulated in order; for
+// WMMA kernels, operands quantized to the input type and one FP32 partial sum per
+// fragment step (BK products) added to the accumulator, over zero-padded tiles; for
+// STREAM, the grid-stride loop of every thread of the grid in turn. It
+// exists so front ends, edge-tile coverage and the correctness checks can be tested on
+// machines without a GPU; its timings say nothing about GPU performance.
+#include "bench_backend.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace gpu_monitor {
+
+namespace {
+
+void naiveGemm(const float* a, const float* b, float* c, int m, int k, int n) {
+    for (int row = 0; row < m; ++row) {
+        for (int col = 0; col < n; ++col) {
+            float sum = 0.0f;
+            for (int kk = 0; kk < k; ++kk) sum += a[static_cast<size_t>(row) * k + kk] * b[static_cast<size_t>(kk) * n + col];
+            c[static_cast<size_t>(row) * n + col] = sum;
+        }
+    }
+}
+
+void tiledGemm(const TileConfig& cfg, const float* a, const float* b, float* c, int m, int k, int n) {
+    const int bm = cfg.bm, bn = cfg.bn, bk = cfg.bk, tm = cfg.tm, tn = cfg.tn;
+    std::vector<float> as(static_cast<size_t>(bk) * bm), bs(static_cast<size_t>(bk) * bn);
+    std::vector<float> acc(static_cast<size_t>(bm) * bn);
+    for (int by = 0; by < cfg.gridY(m); ++by) {
+        for (int bx = 0; bx < cfg.gridX(n); ++bx) {
+            const int row0 = by * bm, col0 = bx * bn;
+            std::fill(acc.begin(), acc.end(), 0.0f);
+            for (int k0 = 0; k0 < k; k0 += bk) {
+                // stage the slabs as the kernel does: As[kk][r], Bs[kk][c], zero outside
+                for (int r = 0; r < bm; ++r)
+                    for (int kk = 0; kk < bk; ++kk) {
+                        int gr = row0 + r, gk = k0 + kk;
+                        as[static_cast<size_t>(kk) * bm + r] =
+                            gr < m && gk < k ? a[static_cast<size_t>(gr) * k + gk] : 0.0f;
+                    }
+                for (int kk = 0; kk < bk; ++kk)
+                    for (int col = 0; col < bn; ++col) {
+                        int gk = k0 + kk, gc = col0 + col;
+                        bs[static_cast<size_t>(kk) * bn + col] =
+                            gk < k && gc < n ? b[static_cast<size_t>(gk) * n + gc] : 0.0f;
+                    }
+                for (int ty = 0; ty < cfg.blockY(); ++ty)
+                    for (int tx = 0; tx < cfg.blockX(); ++tx)
+                        for (int kk = 0; kk < bk; ++kk)
+                            for (int i = 0; i < tm; ++i)
+                                for (int j = 0; j < tn; ++j) {
+                                    int r = ty * tm + i, col = tx * tn + j;
+                                    acc[static_cast<size_t>(r) * bn + col] +=
+                                        as[static_cast<size_t>(kk) * bm + r] * bs[static_cast<size_t>(kk) * bn + col];
+                                }
+            }
+            for (int r = 0; r < bm && row0 + r < m; ++r)
+                for (int col = 0; col < bn && col0 + col < n; ++col)
+                    c[static_cast<size_t>(row0 + r) * n + col0 + col] = acc[static_cast<size_t>(r) * bn + col];
+        }
+    }
+}
+
+// The "graph" keeps the launch and replays it count times; there is no launch overhead
+// to remove on the CPU, so only the code path is exercised.
+class HostGraph : public LaunchGraph {
+public:
+    HostGraph(const std::function<bool()>& launch, int count) : launch_(launch), count_(count) {}
+    int count() const override { return count_; }
+    const std::function<bool()>& launch() const { return launch_; }
+
+private:
+    std::function<bool()> launch_;
+    int count_;
+};
+
+// a and b are the padded operands (stored as floats holding quantized values)
+void wmmaGemm(const TileConfig& cfg, const float* a, const float* b, float* c, int m, int k, int n) {
+    const int kp = cfg.paddedK(k), np = cfg.paddedN(n);
+    for (int row = 0; row < m; ++row) {
+        for (int col = 0; col < n; ++col) {
+            float acc = 0.0f;
+            for (int k0 = 0; k0 < kp; k0 += cfg.bk) {
+                float step = 0.0f;
+                for (int kk = k0; kk < k0 + cfg.bk; ++kk)
+                    step += a[static_cast<size_t>(row) * kp + kk] * b[static_cast<size_t>(kk) * np + col];
+                acc += step;
+            }
+            c[static_cast<size_t>(row) * n + col] = acc;
+        }
+    }
+}
+
+class HostBackend : public BenchBackend {
+public:
+    HostBackend() {
+        info_.name = "host";
+        info_.max_grid_x = INT_MAX;
+    }
+
+    const char* name() const override { return "host"; }
+    const DeviceInfo& device() const override { return info_; }
+
+    bool allocate(size_t bytes, void** ptr, std::string* err) override {
+        *ptr = malloc(bytes ? bytes : 1);
+        if (!*ptr) *err = "out of memory";
+        return *ptr != nullptr;
+    }
+    void release(void* ptr) override { free(ptr); }
+    bool upload(void* dst, const void* src, size_t bytes, std::string*) override {
+        memcpy(dst, src, bytes);
+        return true;
+    }
+    bool download(void* dst, const void* src, size_t bytes, std::string*) override {
+        memcpy(dst, src, bytes);
+        return true;
+    }
+    bool fill(void* dst, unsigned char byte, size_t bytes, std::string*) override {
+        memset(dst, byte, bytes);
+        return true;
+    }
+
+    bool timeBatch(const std::function<bool()>& launch, int count, double* seconds,
+                   std::string* err) override {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; ++i) {
+            if (!launch()) {
+                if (err->empty()) *err = "launch failed";
+                return false;
+            }
+        }
+        *seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+    bool captureGraph(const std::function<bool()>& launch, int count,
+                      std::unique_ptr<LaunchGraph>* graph, std::string*) override {
+        graph->reset(new HostGraph(launch, count));
+        return true;
+    }
+    bool timeGraph(LaunchGraph& graph, double* seconds, std::string* err) override {
+        HostGraph& g = static_cast<HostGraph&>(graph);
+        return timeBatch(g.launch(), g.count(), seconds, err);
+    }
+    bool synchronize(std::string*) override { return true; }
+
+    // every kernel is emulated, whatever its minimum compute capability
+    bool supportsGemm(const TileConfig&, std::string*) const override { return true; }
+    bool convertGemmOperand(GemmPrecision precision, const float* src, int rows, int cols, void* dst,
+                            int prows, int pcols, std::string*) override {
+        float* out = static_cast<float*>(dst);
+        for (int r = 0; r < prows; ++r)
+            for (int col = 0; col < pcols; ++col)
+                out[static_cast<size_t>(r) * pcols + col] =
+                    r < rows && col < cols ? quantizeGemm(precision, src[static_cast<size_t>(r) * cols + col]) : 0.0f;
+        return true;
+    }
+    bool launchGemm(const TileConfig& cfg, const void* a, const void* b, float* c, int m, int k,
+                    int n, std::string*) override {
+        const float* fa = static_cast<const float*>(a);
+        const float* fb = static_cast<const float*>(b);
+        if (cfg.wmma())
+            wmmaGemm(cfg, fa, fb, c, m, k, n);
+        else if (cfg.tiled())
+            tiledGemm(cfg, fa, fb, c, m, k, n);
+        else
+            naiveGemm(fa, fb, c, m, k, n);
+        return true;
+    }
+    double gemmOccupancy(const TileConfig&) const override { return 0.0; }
+    bool launchStream(StreamOp op, int block, int grid, double* a, double* b, double* c, double q, size_t n,
+                      std::string*) override {
+        const size_t threads = static_cast<size_t>(block) * grid;
+        for (size_t t = 0; t < threads; ++t)
+            for (size_t i = t; i < n; i += threads) streamElement(op, a, b, c, q, i);
+        return true;
+    }
+    int streamActiveBlocks(StreamOp, int) const override { return 0; }
+
+private:
+    DeviceInfo info_;
+};
+
+} // namespace
+
+std::unique_ptr<BenchBackend> makeHostBackend(std::string*) {
+    return std::unique_ptr<BenchBackend>(new HostBackend());
+}
+
+} // namespace gpu_monitor
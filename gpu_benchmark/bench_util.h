@@ -0,0 +1,94 @@
+// bench_util.h
+// Small pieces every benchmark front end shares (gemm, stencil, pipeline, stream,
+// hetero_gemm): exit codes, strict integer parsing of arguments, the running maximum
+// error of --verify and, in CUDA translation units, the CUDA error check and kernel
+// occupancy. Header-only so the host-only stencil_host build can use it without
+// linking gpu_harness.
+
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#ifdef __CUDACC__
+#include <cuda_runtime.h>
+#endif
+
+namespace gpu_monitor {
+
+// Exit codes of every benchmark binary (and of its host build).
+enum BenchExit {
+    BENCH_EXIT_OK = 0,
+    BENCH_EXIT_USAGE = 1,
+    BENCH_EXIT_VERIFY = 2,  // --verify found a mismatch
+    BENCH_EXIT_BACKEND = 3  // allocation, copy, launch or device error
+};
+
+// Base-10 integer in min..max with nothing after it.
+inline bool parseInteger(const char* s, long long min, long long max, long long* out) {
+    char* end = nullptr;
+    errno = 0;
+    long long v = std::strtoll(s, &end, 10);
+    if (end == s || *end != '\0' || errno == ERANGE || v < min || v > max) return false;
+    *out = v;
+    return true;
+}
+
+inline bool parseInteger(const char* s, int min, int max, int* out) {
+    long long v = 0;
+    if (!parseInteger(s, static_cast<long long>(min), static_cast<long long>(max), &v)) return false;
+    *out = static_cast<int>(v);
+    return true;
+}
+
+// Option "--name=value" with an integer value in min..max; *matched tells whether arg
+// was it. A bad value fills *err and returns false.
+inline bool takeIntegerOption(const char* arg, const char* name, int min, int max, int* out, bool* matched,
+                              std::string* err) {
+    size_t len = std::strlen(name);
+    *matched = std::strncmp(arg, name, len) == 0 && arg[len] == '=';
+    if (!*matched) return true;
+    if (!parseInteger(arg + len + 1, min, max, out)) {
+        *err = std::string("invalid ") + name + " (" + std::to_string(min) + ".." + std::to_string(max) +
+               "): " + (arg + len + 1);
+        return false;
+    }
+    return true;
+}
+
+// Folds one element's error into the running maximum of a --verify pass. NaN (an
+// element never written, or a broken result) compares false against everything, so
+// it is tested as "not within" rather than "above", and once seen it sticks.
+inline void trackMaxError(double err, double* max_err) {
+    if (std::isnan(*max_err)) return;
+    if (!(err <= *max_err)) *max_err = err;
+}
+
+#ifdef __CUDACC__
+// True on cudaSuccess; otherwise "<what>: <CUDA error>" in *err.
+inline bool cudaCheck(cudaError_t rc, const char* what, std::string* err) {
+    if (rc == cudaSuccess) return true;
+    *err = std::string(what) + ": " + cudaGetErrorString(rc);
+    return false;
+}
+
+// Theoretical occupancy of kernel in blocks of threads: resident warps
+// (cudaOccupancyMaxActiveBlocksPerMultiprocessor) over the warps an SM holds, at most
+// 1; 0 if the query fails.
+inline double kernelOccupancy(const void* kernel, int threads, int max_threads_per_sm) {
+    int active_blocks = 0;
+    if (cudaOccupancyMaxActiveBlocksPerMultiprocessor(&active_blocks, kernel, threads, 0) != cudaSuccess)
+        return 0.0;
+    int max_warps = max_threads_per_sm / 32;
+    double occupancy = max_warps > 0 ? (double)(active_blocks * ((threads + 31) / 32)) / max_warps : 0.0;
+    return occupancy > 1.0 ? 1.0 : occupancy;
+}
+#endif
+
+} // namespace gpu_monitor
+
+#endif // BENCH_UTIL_H
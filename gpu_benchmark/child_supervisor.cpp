@@ -0,0 +1,131 @@
+// child_supervisor.cpp - pidfd/signalfd child supervision with signal forwarding
+#include "child_supervisor.h"
+
+#include <poll.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace gpu_monitor {
+
+static const int kForwardedSignals[] = {SIGINT, SIGTERM, SIGHUP};
+
+static int pidfdOpen(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+ChildSupervisor::ChildSupervisor() : signal_fd_(-1), pid_fd_(-1), pid_(0), status_(0), signal_(0) {
+    std::memset(&usage_, 0, sizeof(usage_));
+    sigset_t mask;
+    sigemptyset(&mask);
+    for (int sig : kForwardedSignals) sigaddset(&mask, sig);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, &old_mask_);
+    signal_fd_ = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+}
+
+ChildSupervisor::~ChildSupervisor() {
+    if (pid_fd_ >= 0) close(pid_fd_);
+    if (signal_fd_ >= 0) close(signal_fd_);
+    sigprocmask(SIG_SETMASK, &old_mask_, nullptr);
+}
+
+pid_t ChildSupervisor::start(char** cmd) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        // child: the command gets the signal mask the monitor was started with
+        sigprocmask(SIG_SETMASK, &old_mask_, nullptr);
+        execvp(cmd[0], cmd);
+        // if execvp returns, error
+        perror("execvp");
+        _exit(127);
+    }
+    if (pid == -1) {
+        perror("fork");
+        return -1;
+    }
+    pid_ = pid;
+    status_ = 0;
+    std::memset(&usage_, 0, sizeof(usage_));
+    // ENOSYS on pre-5.3 kernels: fall back to SIGCHLD
+    pid_fd_ = pidfdOpen(pid);
+    // A signal that arrived while no child was running is forwarded now
+    if (signal_) kill(pid_, signal_);
+    return pid;
+}
+
+bool ChildSupervisor::reap(int flags) {
+    int status = 0;
+    struct rusage ru;
+    pid_t r;
+    while ((r = wait4(pid_, &status, flags, &ru)) < 0 && errno == EINTR) {
+    }
+    if (r != pid_) return false;
+    status_ = status;
+    usage_ = ru;
+    pid_ = 0;
+    if (pid_fd_ >= 0) {
+        close(pid_fd_);
+        pid_fd_ = -1;
+    }
+    return true;
+}
+
+void ChildSupervisor::handleSignals() {
+    struct signalfd_siginfo si;
+    while (read(signal_fd_, &si, sizeof(si)) == (ssize_t)sizeof(si)) {
+        int sig = (int)si.ssi_signo;
+        if (sig == SIGCHLD) continue;  // exit is picked up by reap()
+        if (!signal_) signal_ = sig;
+        if (pid_ > 0) kill(pid_, sig);
+    }
+}
+
+void ChildSupervisor::pollSignals() {
+    handleSignals();
+}
+
+ChildSupervisor::Event ChildSupervisor::wait(DeadlineTimer* timer) {
+    if (pid_ <= 0) return EXITED;
+    while (true) {
+        struct pollfd fds[3];
+        nfds_t n = 0;
+        fds[n++] = {signal_fd_, POLLIN, 0};
+        if (pid_fd_ >= 0) fds[n++] = {pid_fd_, POLLIN, 0};
+        if (timer) fds[n++] = {timer->fd(), POLLIN, 0};
+        if (poll(fds, n, -1) < 0) {
+            if (errno == EINTR) continue;
+            // Cannot wait for events: block on the child instead
+            reap(0);
+            return EXITED;
+        }
+
+        if (fds[0].revents & POLLIN) handleSignals();
+        // Without a pidfd every wakeup (SIGCHLD included) checks for the exit
+        if ((pid_fd_ < 0 || (fds[1].revents & POLLIN)) && reap(WNOHANG)) return EXITED;
+        if (timer && (fds[n - 1].revents & POLLIN)) {
+            timer->acknowledge();
+            return TICK;
+        }
+    }
+}
+
+void writeChildUsage(std::ostream& os, const struct rusage& ru) {
+    os << "child_user_cpu_s=" << ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 << "\n";
+    os << "child_sys_cpu_s=" << ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6 << "\n";
+    os << "child_max_rss_kb=" << ru.ru_maxrss << "\n";
+    os << "child_minor_faults=" << ru.ru_minflt << "\n";
+    os << "child_major_faults=" << ru.ru_majflt << "\n";
+}
+
+} // namespace gpu_monitor
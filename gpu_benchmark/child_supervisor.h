@@ -0,0 +1,73 @@
+// child_supervisor.h
+// Runs the monitored command and waits on it together with the sampling timer in one
+// poll() loop: the child's pidfd (pidfd_open, Linux 5.3+) reports its exit the moment
+// it happens rather than at the next sample, and SIGINT/SIGTERM/SIGHUP sent to the
+// monitor arrive through a signalfd and are forwarded to the child, so a batch system
+// cancelling the job does not leave the command running. The child is reaped with
+// wait4(), which also yields its resource usage. On kernels without pidfd_open, exit
+// is detected through SIGCHLD on the same signalfd.
+
+#ifndef CHILD_SUPERVISOR_H
+#define CHILD_SUPERVISOR_H
+
+#include "monitor_timing.h"
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <ostream>
+
+namespace gpu_monitor {
+
+class ChildSupervisor {
+public:
+    enum Event { TICK, EXITED };
+
+    // Blocks the forwarded signals (and SIGCHLD) in the calling thread and opens the
+    // signalfd; the previous mask is restored on destruction and in the child.
+    ChildSupervisor();
+    ~ChildSupervisor();
+    ChildSupervisor(const ChildSupervisor&) = delete;
+    ChildSupervisor& operator=(const ChildSupervisor&) = delete;
+
+    // Forks and execs cmd; returns the child's pid, or -1 if fork fails. Only one
+    // child is supervised at a time.
+    pid_t start(char** cmd);
+
+    // Blocks until the child exits or, when timer is given, the next deadline passes
+    // (acknowledged before returning TICK). Signals received meanwhile are forwarded.
+    Event wait(DeadlineTimer* timer);
+
+    // Drains pending signals without blocking, forwarding them to a running child.
+    void pollSignals();
+
+    // Wait status and resource usage of the last child, valid after EXITED.
+    int status() const { return status_; }
+    const struct rusage& usage() const { return usage_; }
+    bool running() const { return pid_ > 0; }
+    pid_t pid() const { return pid_; }  // running child, 0 once reaped
+
+    // First forwarded signal received (0 if none).
+    int signalReceived() const { return signal_; }
+
+private:
+    void handleSignals();
+    bool reap(int flags);
+
+    sigset_t old_mask_;
+    int signal_fd_;
+    int pid_fd_;  // -1 when no child runs or pidfd_open is unsupported
+    pid_t pid_;
+    int status_;
+    struct rusage usage_;
+    int signal_;
+};
+
+// Writes the child's CPU time, peak RSS and page faults as report lines
+// (child_user_cpu_s, child_sys_cpu_s, child_max_rss_kb, child_minor_faults,
+// child_major_faults).
+void writeChildUsage(std::ostream& os, const struct rusage& ru);
+
+} // namespace gpu_monitor
+
+#endif // CHILD_SUPERVISOR_H
@@ -0,0 +1,35 @@
+// device_buffer_pool.cpp - Grow-only per-slot device buffers shared across problem sizes
+#include "device_buffer_pool.h"
+
+namespace gpu_monitor {
+
+DeviceBufferPool::DeviceBufferPool(BenchBackend& backend) : backend_(backend), allocations_(0) {}
+
+DeviceBufferPool::~DeviceBufferPool() {
+    for (Slot& s : slots_)
+        if (s.ptr) backend_.release(s.ptr);
+}
+
+void* DeviceBufferPool::get(int slot, size_t bytes, std::string* err) {
+    if (slot < 0) {
+        *err = "invalid buffer slot";
+        return nullptr;
+    }
+    if (static_cast<size_t>(slot) >= slots_.size()) slots_.resize(slot + 1);
+    Slot& s = slots_[slot];
+    if (s.ptr && s.bytes >= bytes) return s.ptr;
+    // free first so the device never holds both the old and the new buffer
+    if (s.ptr) backend_.release(s.ptr);
+    s.ptr = nullptr;
+    s.bytes = 0;
+    if (!backend_.allocate(bytes, &s.ptr, err)) return nullptr;
+    s.bytes = bytes;
+    ++allocations_;
+    return s.ptr;
+}
+
+size_t DeviceBufferPool::capacity(int slot) const {
+    return slot >= 0 && static_cast<size_t>(slot) < slots_.size() ? slots_[slot].bytes : 0;
+}
+
+} // namespace gpu_monitor
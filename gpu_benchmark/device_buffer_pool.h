@@ -0,0 +1,45 @@
+// device_buffer_pool.h
+// Device buffers reused across problem sizes: each slot keeps the largest allocation
+// requested so far, so sweeping sizes (or reserving the largest one up front) costs one
+// allocation per slot instead of a cudaMalloc/cudaFree pair per size.
+
+#ifndef DEVICE_BUFFER_POOL_H
+#define DEVICE_BUFFER_POOL_H
+
+#include "bench_backend.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace gpu_monitor {
+
+class DeviceBufferPool {
+public:
+    explicit DeviceBufferPool(BenchBackend& backend);
+    ~DeviceBufferPool();
+    DeviceBufferPool(const DeviceBufferPool&) = delete;
+    DeviceBufferPool& operator=(const DeviceBufferPool&) = delete;
+
+    // Buffer of slot holding at least bytes, growing (and discarding the contents)
+    // only when the slot is too small. nullptr with a message in *err on failure.
+    void* get(int slot, size_t bytes, std::string* err);
+
+    // Allocations made so far (growths included).
+    int allocations() const { return allocations_; }
+    size_t capacity(int slot) const;
+
+private:
+    struct Slot {
+        void* ptr = nullptr;
+        size_t bytes = 0;
+    };
+
+    BenchBackend& backend_;
+    std::vector<Slot> slots_;
+    int allocations_;
+};
+
+} // namespace gpu_monitor
+
+#endif // DEVICE_BUFFER_POOL_H
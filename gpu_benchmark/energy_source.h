@@ -0,0 +1,55 @@
+// energy_source.h
+// Pluggable energy sources for node_monitor. A source owns one kind of hardware
+// (RAPL domains, NVML devices) and exposes it as a list of components, each with an
+// energy counter that starts at zero on the first sample. node_monitor drives every
+// source from one sampling loop, so all components share a single monotonic
+// timeline; a source that is not available on the machine is simply not created.
+
+#ifndef ENERGY_SOURCE_H
+#define ENERGY_SOURCE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace gpu_monitor {
+
+enum class ComponentKind { CPU, GPU };
+
+struct EnergyComponent {
+    std::string name;    // unique within the node: "package-0", "package-0.dram", "gpu0"
+    ComponentKind kind;
+    // false for components whose energy is already contained in another one (RAPL
+    // core/uncore inside their package) or that contain others (psys); they are
+    // reported but not added to the node total.
+    bool in_total;
+};
+
+class EnergySource {
+public:
+    virtual ~EnergySource() {}
+
+    // Short identifier used in the report ("rapl", "nvml").
+    virtual const char* name() const = 0;
+
+    // Reads every component, timestamping the readings in seconds since t_origin
+    // (CLOCK_MONOTONIC, shared by all sources). The first call sets the baseline; last
+    // is true for the final sample of the run.
+    virtual void sample(double t_origin, bool last) = 0;
+
+    // Energy since the first sample, in joules.
+    virtual double energyJ(size_t i) const = 0;
+    // Power over the most recent sampling interval (or the last reading), in watts.
+    virtual double powerW(size_t i) const = 0;
+    // How energyJ(i) was obtained ("counter", "hw_counter", "trapezoid").
+    virtual const char* method(size_t i) const = 0;
+
+    const std::vector<EnergyComponent>& components() const { return components_; }
+
+protected:
+    std::vector<EnergyComponent> components_;
+};
+
+} // namespace gpu_monitor
+
+#endif // ENERGY_SOURCE_H
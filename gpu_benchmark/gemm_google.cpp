@@ -0,0 +1,144 @@
+// gemm_google.cpp - Google Benchmark front end of the GEMM harness
+#include "gemm_google.h"
+#include "gemm_harness.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace gpu_monitor {
+
+namespace {
+
+const int kSizes[] = {128, 256, 512};
+const int kMaxSize = 512;
+const unsigned kSeed = 1;
+const int kMaxBatch = 1 << 16;
+
+// Launches per event pair: a fixed count, or (batch == 0) the smallest count keeping
+// the GPU busy for min_time seconds. batch == 1 is the old one-sync-per-launch mode.
+// launch selects stream launches or graph replay of each batch.
+struct GemmOptions {
+    int batch = 0;
+    double min_time = 0.01;
+    LaunchMode launch = LAUNCH_STREAM;
+};
+
+// Take --gemm_batch=auto|N, --gemm_batch_min_time=SECONDS and --gemm_launch=stream|graph
+// out of argv before Google Benchmark sees it. Returns false with a message in *err.
+bool takeGemmArgs(int* argc, char** argv, GemmOptions* opts, std::string* err) {
+    int out = 1;
+    for (int i = 1; i < *argc; ++i) {
+        const char* arg = argv[i];
+        if (strncmp(arg, "--gemm_batch=", 13) == 0) {
+            const char* v = arg + 13;
+            if (strcmp(v, "auto") == 0) {
+                opts->batch = 0;
+            } else if (!parseInteger(v, 1, kMaxBatch, &opts->batch)) {
+                *err = std::string("invalid --gemm_batch (auto or 1..") + std::to_string(kMaxBatch) + "): " + v;
+                return false;
+            }
+        } else if (strncmp(arg, "--gemm_batch_min_time=", 22) == 0) {
+            const char* v = arg + 22;
+            char* end = nullptr;
+            double t = strtod(v, &end);
+            if (end == v || *end != '\0' || !(t > 0.0) || t > 10.0) {
+                *err = std::string("invalid --gemm_batch_min_time (seconds, 0..10]: ") + v;
+                return false;
+            }
+            opts->min_time = t;
+        } else if (strncmp(arg, "--gemm_launch=", 14) == 0) {
+            if (!parseLaunchMode(arg + 14, &opts->launch)) {
+                *err = std::string("invalid --gemm_launch (stream or graph): ") + (arg + 14);
+                return false;
+            }
+        } else {
+            argv[out++] = argv[i];
+        }
+    }
+    argv[out] = nullptr;
+    *argc = out;
+    return true;
+}
+
+GemmOptions g_opts;
+
+void BM_GEMM(benchmark::State& state, GemmSession* session, const TileConfig* cfg) {
+    const int M = static_cast<int>(state.range(0));
+    const int K = static_cast<int>(state.range(1));
+    const int N = static_cast<int>(state.range(2));
+
+    std::string err;
+    int batch = g_opts.batch;
+    if (!session->prepare(M, K, N, kSeed, &err) || !session->warmup(*cfg, &err) ||
+        (batch == 0 && !session->calibrateBatch(*cfg, g_opts.min_time, kMaxBatch, &batch, &err))) {
+        state.SkipWithError(err.c_str());
+        return;
+    }
+    double occupancy = session->occupancy(*cfg);
+
+    // Manual timing, one event pair per batch of launches: Google Benchmark counts
+    // launches (KeepRunningBatch) and divides the batch times by them, so the reported
+    // time is per launch while the GPU is never drained between launches of a batch.
+    double total_s = 0.0;
+    while (state.KeepRunningBatch(batch)) {
+        double seconds = 0.0;
+        if (!session->time(*cfg, batch, &seconds, &err)) {
+            state.SkipWithError(err.c_str());
+            break;
+        }
+        state.SetIterationTime(seconds);
+        total_s += seconds;
+    }
+
+    GemmCounters c = gemmCounters(M, K, N, state.iterations(), total_s);
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(2.0 * M * N * K));
+    state.counters["gflops"] = c.gflops;
+    state.counters["occupancy"] = occupancy;
+    state.counters["bytes"] = c.bytes;
+    state.counters["gbps"] = c.gbps;
+    state.counters["batch"] = batch;
+    state.SetLabel(std::string("launch=") + launchModeName(g_opts.launch));
+}
+
+} // namespace
+
+int gemmGoogleMain(int argc, char** argv, BackendFactory makeBackend) {
+    std::string err;
+    if (!takeGemmArgs(&argc, argv, &g_opts, &err)) {
+        fprintf(stderr, "%s: %s\n", argv[0], err.c_str());
+        return BENCH_EXIT_USAGE;
+    }
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return BENCH_EXIT_USAGE;
+
+    std::unique_ptr<BenchBackend> backend = makeBackend(&err);
+    if (!backend) {
+        fprintf(stderr, "%s: %s\n", argv[0], err.c_str());
+        return BENCH_EXIT_BACKEND;
+    }
+    GemmSession session(*backend);
+    session.setLaunchMode(g_opts.launch);
+    if (!session.reserve(kMaxSize, kMaxSize, kMaxSize, &err)) {
+        fprintf(stderr, "%s: %s\n", argv[0], err.c_str());
+        return BENCH_EXIT_BACKEND;
+    }
+
+    int count = 0;
+    const TileConfig* cfgs = gemmConfigs(&count);
+    for (int i = 0; i < count; ++i) {
+        // only kernels this device can run (tensor-core variants need sm_70 / sm_80)
+        if (!backend->supportsGemm(cfgs[i], &err)) continue;
+        std::string name = strcmp(cfgs[i].name, "naive") == 0 ? "BM_GEMM" : std::string("BM_GEMM_") + cfgs[i].name;
+        benchmark::internal::Benchmark* b = benchmark::RegisterBenchmark(name.c_str(), BM_GEMM, &session, &cfgs[i]);
+        for (int size : kSizes) b->Args({size, size, size});
+        b->UseManualTime()->Unit(benchmark::kMillisecond);
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    return BENCH_EXIT_OK;
+}
+
+} // namespace gpu_monitor
@@ -0,0 +1,28 @@
+// gemm_google.h
+// Google Benchmark front end of the GEMM harness. Every kernel of the family is
+// registered for the standard sizes: the naive kernel as BM_GEMM/M/K/N (the name
+// run_gpu_benchmark.sh and the sweep configs filter on), the others as
+// BM_GEMM_<kernel>/M/K/N. One GemmSession serves all of them, with its buffers
+// reserved for the largest size up front.
+//
+// Each event pair times a batch of launches queued back to back, and the reported
+// time is per launch: --gemm_batch=N fixes the batch, --gemm_batch=auto (default)
+// grows it until one batch takes --gemm_batch_min_time seconds (default 0.01). The
+// batch used is reported in the "batch" counter. --gemm_launch=graph replays each
+// batch as a captured CUDA graph instead of launching its kernels one by one; the
+// mode is reported in the label ("launch=stream" or "launch=graph").
+
+#ifndef GEMM_GOOGLE_H
+#define GEMM_GOOGLE_H
+
+#include "bench_backend.h"
+
+namespace gpu_monitor {
+
+// Parse the batch and Google Benchmark flags, create the backend, register and run.
+// Returns 0, 1 on invalid or unrecognized arguments or BENCH_EXIT_BACKEND if the backend cannot be created.
+int gemmGoogleMain(int argc, char** argv, BackendFactory makeBackend);
+
+} // namespace gpu_monitor
+
+#endif // GEMM_GOOGLE_H
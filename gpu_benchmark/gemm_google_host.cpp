@@ -0,0 +1,7 @@
+// gemm_google_host.cpp - gemm_benchmark_google_host: the Google Benchmark front end on
+// the CPU backend (bench_backend_host.cpp), for testing the harness without a GPU.
+#include "gemm_google.h"
+
+int main(int argc, char** argv) {
+    return gpu_monitor::gemmGoogleMain(argc, argv, gpu_monitor::makeHostBackend);
+}
@@ -0,0 +1,442 @@
+// gemm_harness.cpp - GEMM session, CPU reference and command-line front end of the benchmark harness
+#include "gemm_harness.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <random>
+
+namespace gpu_monitor {
+
+namespace {
+
+#define GEMM_TILE_ENTRY(BM, BN, BK, TM, TN) \
+    {"tiled_" #BM "x" #BN "x" #BK "_" #TM "x" #TN, BM, BN, BK, TM, TN, GEMM_FP32, 0},
+#define GEMM_WMMA_ENTRY(NAME, PRECISION, BK, MIN_CC) \
+    {"wmma_" #NAME, 64, 64, BK, 32, 32, PRECISION, MIN_CC},
+
+const TileConfig kConfigs[] = {
+    {"naive", 0, 0, 0, 0, 0, GEMM_FP32, 0},
+    GEMM_TILE_CONFIGS(GEMM_TILE_ENTRY)
+    GEMM_WMMA_CONFIGS(GEMM_WMMA_ENTRY)
+};
+
+#undef GEMM_TILE_ENTRY
+#undef GEMM_WMMA_ENTRY
+
+const int kVerifyRows = 64;
+
+// DeviceBufferPool slots of a GemmSession: FP32 operands and result, and the operands
+// converted for the WMMA kernel last used
+enum { kSlotA, kSlotB, kSlotC, kSlotConvA, kSlotConvB };
+
+float fromBits(uint32_t u) {
+    float x;
+    memcpy(&x, &u, sizeof(x));
+    return x;
+}
+
+uint32_t toBits(float x) {
+    uint32_t u;
+    memcpy(&u, &x, sizeof(u));
+    return u;
+}
+
+bool parseKernels(const std::string& list, std::vector<const TileConfig*>* out, std::string* err) {
+    out->clear();
+    if (list == "all") {
+        int count = 0;
+        const TileConfig* cfgs = gemmConfigs(&count);
+        for (int i = 0; i < count; ++i) out->push_back(&cfgs[i]);
+        return true;
+    }
+    size_t pos = 0;
+    while (pos <= list.size()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos) comma = list.size();
+        std::string name = list.substr(pos, comma - pos);
+        const TileConfig* cfg = findGemmConfig(name.c_str());
+        if (!cfg) {
+            *err = "unknown kernel '" + name + "' (see --list-kernels)";
+            return false;
+        }
+        out->push_back(cfg);
+        pos = comma + 1;
+    }
+    return true;
+}
+
+} // namespace
+
+float quantizeGemm(GemmPrecision precision, float x) {
+    if (precision == GEMM_FP32 || !std::isfinite(x)) return x;
+    if (precision == GEMM_BF16) {
+        uint32_t u = toBits(x);
+        u += 0x7fffu + ((u >> 16) & 1u);
+        return fromBits(u & 0xffff0000u);
+    }
+    if (precision == GEMM_TF32) {
+        // 10 mantissa bits kept; adding half of the dropped range rounds ties away
+        return fromBits((toBits(x) + 0x1000u) & 0xffffe000u);
+    }
+    // FP16: 11 significant bits down to 2^-14, fixed 2^-24 steps below (subnormals)
+    double a = std::fabs(static_cast<double>(x));
+    if (a >= 65520.0) return std::copysign(INFINITY, x);
+    int exp = 0;
+    std::frexp(a, &exp);
+    double quantum = std::ldexp(1.0, std::max(exp - 1, -14) - 10);
+    return static_cast<float>(std::copysign(std::nearbyint(a / quantum) * quantum, static_cast<double>(x)));
+}
+
+const TileConfig* gemmConfigs(int* count) {
+    *count = static_cast<int>(sizeof(kConfigs) / sizeof(kConfigs[0]));
+    return kConfigs;
+}
+
+const TileConfig* findGemmConfig(const char* name) {
+    for (const TileConfig& cfg : kConfigs)
+        if (strcmp(cfg.name, name) == 0) return &cfg;
+    return nullptr;
+}
+
+const char* launchModeName(LaunchMode mode) {
+    return mode == LAUNCH_GRAPH ? "graph" : "stream";
+}
+
+bool parseLaunchMode(const char* s, LaunchMode* mode) {
+    if (strcmp(s, "stream") == 0)
+        *mode = LAUNCH_STREAM;
+    else if (strcmp(s, "graph") == 0)
+        *mode = LAUNCH_GRAPH;
+    else
+        return false;
+    return true;
+}
+
+bool parseGemmArgs(int argc, char** argv, GemmArgs* args, std::string* err) {
+    std::vector<const char*> positional;
+    std::string kernels = "naive";
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (strncmp(arg, "--kernel=", 9) == 0) {
+            kernels = arg + 9;
+        } else if (strcmp(arg, "--verify") == 0) {
+            args->verify = true;
+        } else if (strncmp(arg, "--seed=", 7) == 0) {
+            int seed = 0;
+            if (!parseInteger(arg + 7, 1, 1000000, &seed)) {
+                *err = std::string("invalid seed: ") + (arg + 7);
+                return false;
+            }
+            args->seed = static_cast<unsigned>(seed);
+        } else if (strncmp(arg, "--launch=", 9) == 0) {
+            if (!parseLaunchMode(arg + 9, &args->launch)) {
+                *err = std::string("invalid launch mode (stream or graph): ") + (arg + 9);
+                return false;
+            }
+        } else if (strcmp(arg, "--list-kernels") == 0) {
+            args->list = true;
+        } else if (strncmp(arg, "--", 2) == 0) {
+            *err = std::string("unknown option: ") + arg;
+            return false;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (args->list) return true;
+    args->all_kernels = kernels == "all";
+    if (positional.size() != 4) {
+        *err = "expected M K N iterations";
+        return false;
+    }
+    int* dims[4] = {&args->m, &args->k, &args->n, &args->iterations};
+    static const char* names[4] = {"M", "K", "N", "iterations"};
+    for (int i = 0; i < 4; ++i) {
+        if (!parseInteger(positional[i], 1, 1000000, dims[i])) {
+            *err = std::string("invalid ") + names[i] + ": " + positional[i];
+            return false;
+        }
+    }
+    return parseKernels(kernels, &args->kernels, err);
+}
+
+void fillMatrix(std::vector<float>& mat, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    for (size_t i = 0; i < mat.size(); ++i) mat[i] = dist(gen);
+}
+
+std::vector<int> verifyRows(int m) {
+    std::vector<int> rows;
+    if (m <= kVerifyRows) {
+        for (int i = 0; i < m; ++i) rows.push_back(i);
+        return rows;
+    }
+    for (int i = 0; i < kVerifyRows; ++i)
+        rows.push_back(static_cast<int>((static_cast<long long>(m - 1) * i) / (kVerifyRows - 1)));
+    return rows;
+}
+
+GemmCheck checkGemm(GemmPrecision precision, const std::vector<float>& a, const std::vector<float>& b,
+                    const std::vector<float>& c, int m, int k, int n) {
+    GemmCheck check;
+    // tensor cores need not round every partial sum to nearest
+    check.tolerance = static_cast<double>(k) * FLT_EPSILON * (precision == GEMM_FP32 ? 1 : 4);
+    std::vector<double> ref(n), mag(n);
+    std::vector<float> bq;
+    const std::vector<float>* bref = &b;
+    if (precision != GEMM_FP32) {
+        bq.resize(b.size());
+        for (size_t i = 0; i < b.size(); ++i) bq[i] = quantizeGemm(precision, b[i]);
+        bref = &bq;
+    }
+    for (int row : verifyRows(m)) {
+        std::fill(ref.begin(), ref.end(), 0.0);
+        std::fill(mag.begin(), mag.end(), 0.0);
+        for (int kk = 0; kk < k; ++kk) {
+            const double av = quantizeGemm(precision, a[static_cast<size_t>(row) * k + kk]);
+            const float* brow = &(*bref)[static_cast<size_t>(kk) * n];
+            for (int col = 0; col < n; ++col) {
+                ref[col] += av * brow[col];
+                mag[col] += std::fabs(av * brow[col]);
+            }
+        }
+        for (int col = 0; col < n; ++col) {
+            double diff = std::fabs(c[static_cast<size_t>(row) * n + col] - ref[col]);
+            double err = mag[col] > 0.0 ? diff / mag[col] : diff;
+            trackMaxError(err, &check.max_err);
+        }
+    }
+    check.ok = check.max_err <= check.tolerance;
+    return check;
+}
+
+std::string gemmSummaryLine(const TileConfig& cfg, const GemmArgs& args, const GemmTiming& t,
+                            const GemmCheck* check) {
+    double gflops = gemmCounters(args.m, args.k, args.n, args.iterations, t.time_s).gflops;
+    char buf[512];
+    int len = snprintf(buf, sizeof(buf),
+                       "kernel_name=gemm_%s,problem_size=%dx%dx%d,iterations=%d,time_s=%.9f,"
+                       "gflops=%.3f,occupancy=%.3f,block=%dx%d,numSM=%d,launch=%s",
+                       cfg.name, args.m, args.k, args.n, args.iterations, t.time_s, gflops,
+                       t.occupancy, cfg.blockX(), cfg.blockY(), t.num_sm, launchModeName(args.launch));
+    if (check && len > 0 && static_cast<size_t>(len) < sizeof(buf))
+        snprintf(buf + len, sizeof(buf) - len, ",verify=%s,max_err=%.3e",
+                 check->ok ? "pass" : "fail", check->max_err);
+    return buf;
+}
+
+GemmCounters gemmCounters(int m, int k, int n, long long launches, double seconds) {
+    GemmCounters c;
+    if (launches <= 0 || seconds <= 0.0) return c;
+    c.per_launch_s = seconds / launches;
+    // FLOPs for GEMM: 2*M*N*K per multiplication
+    double flops = 2.0 * m * n * static_cast<double>(k);
+    c.gflops = (flops / 1e9) / c.per_launch_s;
+    c.bytes = (static_cast<double>(m) * k + static_cast<double>(k) * n + static_cast<double>(m) * n) * sizeof(float);
+    c.gbps = (c.bytes / 1e9) / c.per_launch_s;
+    return c;
+}
+
+GemmSession::GemmSession(BenchBackend& backend)
+    : backend_(backend), pool_(backend), mode_(LAUNCH_STREAM), graph_cfg_(nullptr), m_(0), k_(0), n_(0), seed_(0), uploaded_(false),
+      d_a_(nullptr), d_b_(nullptr), d_c_(nullptr), conv_cfg_(nullptr), conv_a_(nullptr), conv_b_(nullptr) {}
+
+bool GemmSession::reserve(int m, int k, int n, std::string* err) {
+    // growing may move a buffer; prepare() rebinds and uploads again
+    uploaded_ = false;
+    graph_.reset();
+    conv_cfg_ = nullptr;
+    return pool_.get(kSlotA, static_cast<size_t>(m) * k * sizeof(float), err) &&
+           pool_.get(kSlotB, static_cast<size_t>(k) * n * sizeof(float), err) &&
+           pool_.get(kSlotC, static_cast<size_t>(m) * n * sizeof(float), err);
+}
+
+bool GemmSession::bind(int m, int k, int n, std::string* err) {
+    d_a_ = static_cast<float*>(pool_.get(kSlotA, static_cast<size_t>(m) * k * sizeof(float), err));
+    d_b_ = d_a_ ? static_cast<float*>(pool_.get(kSlotB, static_cast<size_t>(k) * n * sizeof(float), err)) : nullptr;
+    d_c_ = d_b_ ? static_cast<float*>(pool_.get(kSlotC, static_cast<size_t>(m) * n * sizeof(float), err)) : nullptr;
+    return d_c_ != nullptr;
+}
+
+bool GemmSession::prepare(int m, int k, int n, unsigned seed, std::string* err) {
+    if (uploaded_ && m == m_ && k == k_ && n == n_ && seed == seed_) return true;
+    if (m != m_ || k != k_ || n != n_ || seed != seed_ || a_.empty()) {
+        a_.resize(static_cast<size_t>(m) * k);
+        b_.resize(static_cast<size_t>(k) * n);
+        fillMatrix(a_, seed);
+        fillMatrix(b_, seed + 1);
+        m_ = m;
+        k_ = k;
+        n_ = n;
+        seed_ = seed;
+    }
+    uploaded_ = false;
+    graph_.reset();
+    conv_cfg_ = nullptr;
+    if (!bind(m, k, n, err) ||
+        !backend_.upload(d_a_, a_.data(), a_.size() * sizeof(float), err) ||
+        !backend_.upload(d_b_, b_.data(), b_.size() * sizeof(float), err))
+        return false;
+    uploaded_ = true;
+    return true;
+}
+
+bool GemmSession::poisonResult(std::string* err) {
+    // all-ones bytes are a NaN
+    return backend_.fill(d_c_, 0xff, static_cast<size_t>(m_) * n_ * sizeof(float), err);
+}
+
+bool GemmSession::warmup(const TileConfig& cfg, std::string* err) {
+    const void *a = nullptr, *b = nullptr;
+    return operands(cfg, &a, &b, err) && backend_.launchGemm(cfg, a, b, d_c_, m_, k_, n_, err) &&
+           backend_.synchronize(err);
+}
+
+bool GemmSession::operands(const TileConfig& cfg, const void** a, const void** b, std::string* err) {
+    if (!cfg.wmma()) {
+        *a = d_a_;
+        *b = d_b_;
+        return true;
+    }
+    if (conv_cfg_ != &cfg) {
+        // converted once per problem and kernel, outside every timing
+        const int mp = cfg.paddedM(m_), kp = cfg.paddedK(k_), np = cfg.paddedN(n_);
+        conv_cfg_ = nullptr;
+        conv_a_ = pool_.get(kSlotConvA, static_cast<size_t>(mp) * kp * sizeof(float), err);
+        conv_b_ = conv_a_ ? pool_.get(kSlotConvB, static_cast<size_t>(kp) * np * sizeof(float), err) : nullptr;
+        if (!conv_b_ ||
+            !backend_.convertGemmOperand(cfg.precision, d_a_, m_, k_, conv_a_, mp, kp, err) ||
+            !backend_.convertGemmOperand(cfg.precision, d_b_, k_, n_, conv_b_, kp, np, err) ||
+            !backend_.synchronize(err))
+            return false;
+        conv_cfg_ = &cfg;
+    }
+    *a = conv_a_;
+    *b = conv_b_;
+    return true;
+}
+
+bool GemmSession::time(const TileConfig& cfg, int count, double* seconds, std::string* err) {
+    const void *a_op = nullptr, *b_op = nullptr;
+    if (!operands(cfg, &a_op, &b_op, err)) return false;
+    if (mode_ == LAUNCH_STREAM)
+        return backend_.timeBatch([&]() { return backend_.launchGemm(cfg, a_op, b_op, d_c_, m_, k_, n_, err); },
+                                  count, seconds, err);
+    if (!graph_ || graph_cfg_ != &cfg || graph_->count() != count) {
+        graph_.reset();
+        // the graph outlives this call, so the launch captures values, not references
+        // (launch errors go to graph_err_, which lives as long as the session)
+        BenchBackend* backend = &backend_;
+        std::string* launch_err = &graph_err_;
+        const void *a = a_op, *b = b_op;
+        float* c = d_c_;
+        int m = m_, k = k_, n = n_;
+        std::function<bool()> launch = [=]() { return backend->launchGemm(cfg, a, b, c, m, k, n, launch_err); };
+        graph_err_.clear();
+        // first replay uploads the graph to the device; keep it out of the timings
+        double untimed = 0.0;
+        if (!backend_.captureGraph(launch, count, &graph_, &graph_err_) ||
+            !backend_.timeGraph(*graph_, &untimed, &graph_err_)) {
+            *err = graph_err_;
+            graph_.reset();
+            return false;
+        }
+        graph_cfg_ = &cfg;
+    }
+    return backend_.timeGraph(*graph_, seconds, err);
+}
+
+bool GemmSession::calibrateBatch(const TileConfig& cfg, double min_seconds, int max_count,
+                                 int* count, std::string* err) {
+    int batch = 1;
+    for (;;) {
+        double seconds = 0.0;
+        if (!time(cfg, batch, &seconds, err)) return false;
+        if (seconds >= min_seconds || batch >= max_count) break;
+        // extrapolate with 20% headroom so timing noise does not leave the next batch
+        // just short of the target; grow at most 10x per step in case the first
+        // (cold) batch was unrepresentative
+        double scale = seconds > 0.0 ? std::min(10.0, 1.2 * min_seconds / seconds) : 10.0;
+        double next = std::ceil(batch * scale);
+        batch = static_cast<int>(std::min<double>(max_count, std::max<double>(batch + 1, next)));
+    }
+    *count = batch;
+    return true;
+}
+
+bool GemmSession::fetchResult(std::vector<float>* c, std::string* err) {
+    c->resize(static_cast<size_t>(m_) * n_);
+    return backend_.download(c->data(), d_c_, c->size() * sizeof(float), err);
+}
+
+int gemmMain(int argc, char** argv, BackendFactory makeBackend) {
+    GemmArgs args;
+    std::string err;
+    if (!parseGemmArgs(argc, argv, &args, &err)) {
+        fprintf(stderr, "%s: %s\n", argv[0], err.c_str());
+        fprintf(stderr, "Usage: %s M K N iterations [--kernel=NAME[,NAME...]|all] [--verify] [--seed=N] [--launch=stream|graph]\n"
+                        "       %s --list-kernels\n", argv[0], argv[0]);
+        return BENCH_EXIT_USAGE;
+    }
+    if (args.list) {
+        int count = 0;
+        const TileConfig* cfgs = gemmConfigs(&count);
+        for (int i = 0; i < count; ++i) printf("%s\n", cfgs[i].name);
+        return BENCH_EXIT_OK;
+    }
+
+    std::unique_ptr<BenchBackend> backend = makeBackend(&err);
+    if (!backend) {
+        fprintf(stderr, "%s: %s\n", argv[0], err.c_str());
+        return BENCH_EXIT_BACKEND;
+    }
+    GemmSession session(*backend);
+    session.setLaunchMode(args.launch);
+    if (!session.prepare(args.m, args.k, args.n, args.seed, &err)) {
+        fprintf(stderr, "%s: %s\n", argv[0], err.c_str());
+        return BENCH_EXIT_BACKEND;
+    }
+
+    // kernels the device cannot run: skipped from "all", an error when asked for by name
+    std::vector<const TileConfig*> kernels;
+    for (const TileConfig* cfg : args.kernels) {
+        std::string why;
+        if (backend->supportsGemm(*cfg, &why)) {
+            kernels.push_back(cfg);
+        } else if (args.all_kernels) {
+            fprintf(stderr, "%s: skipping %s: %s\n", argv[0], cfg->name, why.c_str());
+        } else {
+            fprintf(stderr, "%s: %s: %s\n", argv[0], cfg->name, why.c_str());
+            return BENCH_EXIT_BACKEND;
+        }
+    }
+
+    int status = BENCH_EXIT_OK;
+    std::vector<float> c;
+    for (const TileConfig* cfg : kernels) {
+        GemmTiming timing;
+        if (!session.poisonResult(&err) || !session.warmup(*cfg, &err) ||
+            !session.time(*cfg, args.iterations, &timing.time_s, &err) ||
+            (args.verify && !session.fetchResult(&c, &err))) {
+            fprintf(stderr, "%s: %s: %s\n", argv[0], cfg->name, err.c_str());
+            return BENCH_EXIT_BACKEND;
+        }
+        timing.occupancy = session.occupancy(*cfg);
+        timing.num_sm = backend->device().num_sm;
+        GemmCheck check;
+        if (args.verify) {
+            check = checkGemm(cfg->precision, session.a(), session.b(), c, args.m, args.k, args.n);
+            if (!check.ok) status = BENCH_EXIT_VERIFY;
+        }
+        printf("%s\n", gemmSummaryLine(*cfg, args, timing, args.verify ? &check : nullptr).c_str());
+        fflush(stdout);
+    }
+    return status;
+}
+
+} // namespace gpu_monitor
@@ -0,0 +1,158 @@
+// gemm_harness.h
+// GEMM on the benchmark harness: argument parsing, deterministic inputs, the CPU
+// reference used for correctness checks, GemmSession (pooled device buffers, batched
+// timing, counters) and the command-line front end. Nothing here depends on CUDA; the
+// session runs on any BenchBackend, so the same front ends build against the GPU
+// (gemm_benchmark.cu) or the CPU emulation (gemm_host.cpp) used by the tests.
+
+#ifndef GEMM_HARNESS_H
+#define GEMM_HARNESS_H
+
+#include "bench_backend.h"
+#include "bench_util.h"
+#include "device_buffer_pool.h"
+#include "gemm_tiles.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gpu_monitor {
+
+// How a timed batch reaches the device: one API launch per kernel on the backend's
+// stream, or one replay of a graph captured with the whole batch, which takes the
+// host-side launch work (and with it the CPU clock) out of the measurement.
+enum LaunchMode { LAUNCH_STREAM, LAUNCH_GRAPH };
+
+const char* launchModeName(LaunchMode mode);
+// "stream" or "graph"; false for anything else.
+bool parseLaunchMode(const char* s, LaunchMode* mode);
+
+struct GemmArgs {
+    int m = 0, k = 0, n = 0;
+    int iterations = 0;
+    std::vector<const TileConfig*> kernels;  // --kernel=NAME[,NAME...] or all; default naive
+    bool all_kernels = false;  // --kernel=all: kernels the device cannot run are skipped
+    bool verify = false;
+    unsigned seed = 1;
+    LaunchMode launch = LAUNCH_STREAM;  // --launch=stream|graph
+    bool list = false;  // --list-kernels
+};
+
+// Parse "M K N iterations [--kernel=...] [--verify] [--seed=N] [--launch=MODE]" (options may appear
+// anywhere) or "--list-kernels". Returns false with a message in *err.
+bool parseGemmArgs(int argc, char** argv, GemmArgs* args, std::string* err);
+
+// Fill with uniform values in [0, 1) from a fixed-seed generator, so runs and
+// backends see identical inputs.
+void fillMatrix(std::vector<float>& mat, unsigned seed);
+
+// Rows of C compared against the reference: all of them for small M, otherwise 64
+// evenly spaced rows including the first and last (which cover the edge tiles).
+std::vector<int> verifyRows(int m);
+
+struct GemmCheck {
+    double max_err = 0.0;  // max |C - ref| / sum_k |A||B| over checked elements
+    double tolerance = 0.0;
+    bool ok = true;
+};
+
+// Compare row-major C (M x N) against a double-precision reference on verifyRows().
+// The error of each element is scaled by sum_k |a_ik * b_kj|, the bound of a
+// K-term float dot product, so the tolerance (K * FLT_EPSILON) holds for any
+// summation order the kernel uses. For reduced-precision kernels the reference uses
+// the inputs rounded as the kernel sees them (quantizeGemm), so only the FP32
+// accumulation is checked, with 4x the tolerance.
+GemmCheck checkGemm(GemmPrecision precision, const std::vector<float>& a, const std::vector<float>& b,
+                    const std::vector<float>& c, int m, int k, int n);
+
+// What a backend reports for one configuration.
+struct GemmTiming {
+    double time_s = 0.0;  // all iterations, warmup excluded
+    double occupancy = 0.0;
+    int num_sm = 0;
+};
+
+// Throughput of launches GEMMs of m x k x n taking seconds in total.
+struct GemmCounters {
+    double per_launch_s = 0.0;
+    double gflops = 0.0;
+    double bytes = 0.0;  // A + B + C once, per launch
+    double gbps = 0.0;   // bytes per launch / per_launch_s
+};
+GemmCounters gemmCounters(int m, int k, int n, long long launches, double seconds);
+
+// One GEMM problem resident on a backend. Inputs are generated on the host only when
+// the size or seed changes and live in pooled device buffers, so running many kernels
+// and sizes in one process neither refills matrices nor reallocates per size.
+class GemmSession {
+public:
+    explicit GemmSession(BenchBackend& backend);
+
+    BenchBackend& backend() { return backend_; }
+    const DeviceBufferPool& pool() const { return pool_; }
+
+    // How time() issues its batches (LAUNCH_STREAM by default).
+    void setLaunchMode(LaunchMode mode) { mode_ = mode; }
+    LaunchMode launchMode() const { return mode_; }
+
+    // Grow the device buffers for problems up to m x k x n now, so that later
+    // prepare() calls never allocate.
+    bool reserve(int m, int k, int n, std::string* err);
+    // Make m x k x n inputs from seed resident on the device.
+    bool prepare(int m, int k, int n, unsigned seed, std::string* err);
+    // Overwrite C with NaN, so elements a kernel fails to write fail verification.
+    bool poisonResult(std::string* err);
+    // One launch of cfg, waited for (warmup; also surfaces launch errors).
+    bool warmup(const TileConfig& cfg, std::string* err);
+    // count launches of cfg between one timestamp pair; total in *seconds. In graph
+    // mode the batch is captured (and replayed once untimed) on first use and reused
+    // while cfg, count and the problem stay the same.
+    bool time(const TileConfig& cfg, int count, double* seconds, std::string* err);
+    // Smallest batch (up to max_count launches) whose time() takes at least
+    // min_seconds, found by timing growing batches; doubles as a warmup.
+    bool calibrateBatch(const TileConfig& cfg, double min_seconds, int max_count, int* count,
+                        std::string* err);
+    bool fetchResult(std::vector<float>* c, std::string* err);
+    double occupancy(const TileConfig& cfg) const { return backend_.gemmOccupancy(cfg); }
+
+    int m() const { return m_; }
+    int k() const { return k_; }
+    int n() const { return n_; }
+    const std::vector<float>& a() const { return a_; }
+    const std::vector<float>& b() const { return b_; }
+
+private:
+    bool bind(int m, int k, int n, std::string* err);
+    // Operands of cfg: the FP32 buffers, or for WMMA kernels converted copies made on
+    // first use (and kept until the problem or the kernel changes).
+    bool operands(const TileConfig& cfg, const void** a, const void** b, std::string* err);
+
+    BenchBackend& backend_;
+    DeviceBufferPool pool_;
+    LaunchMode mode_;
+    std::unique_ptr<LaunchGraph> graph_;  // destroyed before the buffers it refers to
+    const TileConfig* graph_cfg_;
+    std::string graph_err_;
+    std::vector<float> a_, b_;
+    int m_, k_, n_;
+    unsigned seed_;
+    bool uploaded_;
+    float *d_a_, *d_b_, *d_c_;
+    const TileConfig* conv_cfg_;
+    void *conv_a_, *conv_b_;
+};
+
+// Summary line parsed by run_gpu_benchmark.sh:
+// kernel_name=...,problem_size=MxKxN,iterations=..,time_s=..,gflops=..,occupancy=..,
+// block=XxY,numSM=..,launch=stream|graph[,verify=pass|fail,max_err=..]
+std::string gemmSummaryLine(const TileConfig& cfg, const GemmArgs& args, const GemmTiming& t,
+                            const GemmCheck* check);
+
+// Command-line front end: parse, prepare, run each selected kernel (one warmup launch,
+// then all iterations between one timestamp pair), print one line per kernel.
+int gemmMain(int argc, char** argv, BackendFactory makeBackend);
+
+} // namespace gpu_monitor
+
+#endif // GEMM_HARNESS_H
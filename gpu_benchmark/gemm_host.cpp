@@ -0,0 +1,7 @@
+// gemm_host.cpp - gemm_benchmark_host: the command-line front end on the CPU backend
+// (bench_backend_host.cpp), for testing the harness without a GPU.
+#include "gemm_harness.h"
+
+int main(int argc, char** argv) {
+    return gpu_monitor::gemmMain(argc, argv, gpu_monitor::makeHostBackend);
+}
@@ -0,0 +1,215 @@
+// gemm_kernels.cuh
+// GEMM kernel family shared by gemm_benchmark and gemm_benchmark_google: the naive
+// kernel (no reuse; every thread streams a row of A and a column of B from global
+// memory) and gemm_tiled<BM, BN, BK, TM, TN>, instantiated for every entry of
+// GEMM_TILE_CONFIGS (gemm_tiles.h). Row-major C = A * B, A is M x K, B is K x N.
+//
+// gemm_tiled:
+//   - shared-memory tiling: a block stages BM x BK of A and BK x BN of B per step,
+//     so each global element is read once per block instead of once per thread;
+//   - register blocking: each thread keeps a TM x TN tile of C in registers and
+//     performs TM*TN FMAs per TM+TN shared-memory reads;
+//   - vectorized loads: slabs are fetched (and C stored) as float4 when the row
+//     length is a multiple of 4, with a bounds-checked scalar path for ragged edges;
+//   - double buffering: two shared slabs; the next slab is fetched into registers
+//     before computing on the current one and stored into the other buffer after,
+//     so global latency overlaps the FMAs and one __syncthreads() per step suffices.
+//
+// The tensor-core kernels (GEMM_WMMA_CONFIGS) are in gemm_wmma.cuh.
+
+#ifndef GEMM_KERNELS_CUH
+#define GEMM_KERNELS_CUH
+
+#include "bench_util.h"
+#include "gemm_tiles.h"
+#include "gemm_wmma.cuh"
+
+#include <cuda_runtime.h>
+
+namespace gpu_monitor {
+
+// Simple naive GEMM kernel
+__global__ void gemm_naive(const float* A, const float* B, float* C, int M, int K, int N) {
+    int row = blockIdx.y * blockDim.y + threadIdx.y;
+    int col = blockIdx.x * blockDim.x + threadIdx.x;
+    if (row < M && col < N) {
+        float sum = 0.0f;
+        for (int k = 0; k < K; ++k)
+            sum += A[row * K + k] * B[k * N + col];
+        C[row * N + col] = sum;
+    }
+}
+
+// Four consecutive elements (row, col..col+3) of a rows x cols row-major matrix,
+// zero outside it. vec: rows are 16-byte aligned, so an in-range quad is one float4.
+__device__ __forceinline__ float4 gemm_load4(const float* __restrict__ p, int row, int col,
+                                             int rows, int cols, bool vec) {
+    float4 v = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+    if (row >= rows) return v;
+    const float* r = p + (size_t)row * cols;
+    if (vec && col + 3 < cols) return *reinterpret_cast<const float4*>(r + col);
+    if (col < cols) v.x = r[col];
+    if (col + 1 < cols) v.y = r[col + 1];
+    if (col + 2 < cols) v.z = r[col + 2];
+    if (col + 3 < cols) v.w = r[col + 3];
+    return v;
+}
+
+template <int BM, int BN, int BK, int TM, int TN>
+__global__ void __launch_bounds__((BM / TM) * (BN / TN))
+gemm_tiled(const float* __restrict__ A, const float* __restrict__ B, float* __restrict__ C,
+           int M, int K, int N) {
+    static_assert(BM % TM == 0 && BN % TN == 0, "thread tiles must divide the block tile");
+    static_assert(BK % 4 == 0 && BN % 4 == 0 && TN % 4 == 0, "slabs and C rows move as float4");
+    constexpr int THREADS = (BM / TM) * (BN / TN);
+    constexpr int A_QUADS = BM * BK / 4;
+    constexpr int B_QUADS = BK * BN / 4;
+    constexpr int A_LOADS = (A_QUADS + THREADS - 1) / THREADS;
+    constexpr int B_LOADS = (B_QUADS + THREADS - 1) / THREADS;
+
+    // A is stored transposed (k-major) so a thread's TM rows are contiguous
+    __shared__ __align__(16) float As[2][BK][BM];
+    __shared__ __align__(16) float Bs[2][BK][BN];
+
+    const int tid = threadIdx.x;
+    const int tx = tid % (BN / TN);
+    const int ty = tid / (BN / TN);
+    const int row0 = blockIdx.y * BM;
+    const int col0 = blockIdx.x * BN;
+    // cudaMalloc'd bases are aligned; rows are too when their length is a multiple of 4
+    const bool vecA = (K & 3) == 0;
+    const bool vecN = (N & 3) == 0;
+
+    float4 ra[A_LOADS];
+    float4 rb[B_LOADS];
+    float acc[TM][TN];
+#pragma unroll
+    for (int i = 0; i < TM; ++i)
+#pragma unroll
+        for (int j = 0; j < TN; ++j) acc[i][j] = 0.0f;
+
+    // global -> registers for the slab starting at k0
+    auto fetch = [&](int k0) {
+#pragma unroll
+        for (int l = 0; l < A_LOADS; ++l) {
+            int q = tid + l * THREADS;
+            if (q < A_QUADS)
+                ra[l] = gemm_load4(A, row0 + q / (BK / 4), k0 + (q % (BK / 4)) * 4, M, K, vecA);
+        }
+#pragma unroll
+        for (int l = 0; l < B_LOADS; ++l) {
+            int q = tid + l * THREADS;
+            if (q < B_QUADS)
+                rb[l] = gemm_load4(B, k0 + q / (BN / 4), col0 + (q % (BN / 4)) * 4, K, N, vecN);
+        }
+    };
+    // registers -> shared buffer buf
+    auto stage = [&](int buf) {
+#pragma unroll
+        for (int l = 0; l < A_LOADS; ++l) {
+            int q = tid + l * THREADS;
+            if (q < A_QUADS) {
+                int r = q / (BK / 4), c = (q % (BK / 4)) * 4;
+                As[buf][c + 0][r] = ra[l].x;
+                As[buf][c + 1][r] = ra[l].y;
+                As[buf][c + 2][r] = ra[l].z;
+                As[buf][c + 3][r] = ra[l].w;
+            }
+        }
+#pragma unroll
+        for (int l = 0; l < B_LOADS; ++l) {
+            int q = tid + l * THREADS;
+            if (q < B_QUADS)
+                *reinterpret_cast<float4*>(&Bs[buf][q / (BN / 4)][(q % (BN / 4)) * 4]) = rb[l];
+        }
+    };
+
+    const int steps = (K + BK - 1) / BK;
+    fetch(0);
+    stage(0);
+    __syncthreads();
+    for (int s = 0; s < steps; ++s) {
+        const int cur = s & 1;
+        // Buffer cur^1 was last read in step s-1, which ended with a barrier, so it
+        // can be refilled while this step computes on cur.
+        if (s + 1 < steps) fetch((s + 1) * BK);
+#pragma unroll
+        for (int kk = 0; kk < BK; ++kk) {
+            float a[TM], b[TN];
+#pragma unroll
+            for (int i = 0; i < TM; ++i) a[i] = As[cur][kk][ty * TM + i];
+#pragma unroll
+            for (int j = 0; j < TN; ++j) b[j] = Bs[cur][kk][tx * TN + j];
+#pragma unroll
+            for (int i = 0; i < TM; ++i)
+#pragma unroll
+                for (int j = 0; j < TN; ++j) acc[i][j] += a[i] * b[j];
+        }
+        if (s + 1 < steps) stage(cur ^ 1);
+        __syncthreads();
+    }
+
+#pragma unroll
+    for (int i = 0; i < TM; ++i) {
+        const int row = row0 + ty * TM + i;
+        if (row >= M) continue;
+        float* crow = C + (size_t)row * N;
+#pragma unroll
+        for (int j = 0; j < TN; j += 4) {
+            const int col = col0 + tx * TN + j;
+            if (vecN && col + 3 < N) {
+                *reinterpret_cast<float4*>(crow + col) =
+                    make_float4(acc[i][j], acc[i][j + 1], acc[i][j + 2], acc[i][j + 3]);
+            } else {
+#pragma unroll
+                for (int jj = 0; jj < 4; ++jj)
+                    if (col + jj < N) crow[col + jj] = acc[i][j + jj];
+            }
+        }
+    }
+}
+
+// Kernel entry point of cfg, for cudaOccupancyMaxActiveBlocksPerMultiprocessor;
+// nullptr if cfg is not in the family (or is a WMMA kernel this toolkit cannot build).
+inline const void* gemmKernel(const TileConfig& cfg) {
+    if (cfg.wmma()) return gemmWmmaKernel(cfg.precision);
+    if (!cfg.tiled()) return reinterpret_cast<const void*>(gemm_naive);
+#define GEMM_TILE_KERNEL(BM_, BN_, BK_, TM_, TN_)                                                \
+    if (cfg.bm == BM_ && cfg.bn == BN_ && cfg.bk == BK_ && cfg.tm == TM_ && cfg.tn == TN_) \
+        return reinterpret_cast<const void*>(gemm_tiled<BM_, BN_, BK_, TM_, TN_>);
+    GEMM_TILE_CONFIGS(GEMM_TILE_KERNEL)
+#undef GEMM_TILE_KERNEL
+    return nullptr;
+}
+
+// Launch cfg once on stream; returns the launch error, if any. A and B are float, or
+// the converted, padded operands of a WMMA kernel (convertGemmOperand).
+inline cudaError_t launchGemm(const TileConfig& cfg, const void* Av, const void* Bv, float* C,
+                              int M, int K, int N, cudaStream_t stream = 0) {
+    if (cfg.wmma()) return launchGemmWmma(cfg, Av, Bv, C, M, K, N, stream);
+    const float* A = static_cast<const float*>(Av);
+    const float* B = static_cast<const float*>(Bv);
+    dim3 grid(cfg.gridX(N), cfg.gridY(M));
+    if (!cfg.tiled()) {
+        gemm_naive<<<grid, dim3(16, 16), 0, stream>>>(A, B, C, M, K, N);
+        return cudaGetLastError();
+    }
+#define GEMM_TILE_LAUNCH(BM_, BN_, BK_, TM_, TN_)                                                \
+    if (cfg.bm == BM_ && cfg.bn == BN_ && cfg.bk == BK_ && cfg.tm == TM_ && cfg.tn == TN_) { \
+        gemm_tiled<BM_, BN_, BK_, TM_, TN_><<<grid, cfg.threads(), 0, stream>>>(A, B, C, M, K, N); \
+        return cudaGetLastError();                                                              \
+    }
+    GEMM_TILE_CONFIGS(GEMM_TILE_LAUNCH)
+#undef GEMM_TILE_LAUNCH
+    return cudaErrorInvalidValue;
+}
+
+// Theoretical occupancy of cfg: resident warps per SM / maximum warps per SM.
+inline double gemmOccupancy(const TileConfig& cfg, const cudaDeviceProp& prop) {
+    const void* kernel = gemmKernel(cfg);
+    return kernel ? kernelOccupancy(kernel, cfg.threads(), prop.maxThreadsPerMultiProcessor) : 0.0;
+}
+
+} // namespace gpu_monitor
+
+#endif // GEMM_KERNELS_CUH
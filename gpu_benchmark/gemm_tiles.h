@@ -0,0 +1,73 @@
+// gemm_tiles.h
+// Tile configurations of the GEMM kernel family. The list is an X-macro so the CUDA
+// dispatch (gemm_kernels.cuh) instantiates exactly the configurations the host harness
+// advertises on the command line, and the host-only build sees the same names without
+// a CUDA toolkit.
+
+#ifndef GEMM_TILES_H
+#define GEMM_TILES_H
+
+// X(BM, BN, BK, TM, TN): each thread block computes a BM x BN tile of C, stepping
+// through K in BK-wide slabs staged in shared memory; each thread accumulates a
+// TM x TN sub-tile in registers, so a block runs (BM/TM)*(BN/TN) threads. BK and TN
+// must be multiples of 4 (float4 loads/stores). The 8x8 configuration needs more
+// than the 63 registers per thread of Fermi (Tesla M2075) and spills there.
+#define GEMM_TILE_CONFIGS(X)  \
+    X(64, 64, 16, 4, 4)       \
+    X(128, 64, 16, 8, 4)      \
+    X(128, 128, 8, 8, 8)
+
+// X(NAME, PRECISION, BK, MIN_CC): tensor-core (WMMA) kernels with FP32 accumulation.
+// Blocks of 4 warps compute 64x64 tiles of C, each warp a 32x32 quadrant as 2x2
+// 16x16 fragments, stepping through K by the fragment depth BK (16 for FP16/BF16,
+// 8 for TF32). Operands are converted once to the input type and zero-padded to
+// whole tiles. MIN_CC is the compute capability (major * 10 + minor) required.
+#define GEMM_WMMA_CONFIGS(X)      \
+    X(fp16, GEMM_FP16, 16, 70)    \
+    X(bf16, GEMM_BF16, 16, 80)    \
+    X(tf32, GEMM_TF32, 8, 80)
+
+namespace gpu_monitor {
+
+// Operand type of a kernel; accumulation is always FP32.
+enum GemmPrecision { GEMM_FP32, GEMM_FP16, GEMM_BF16, GEMM_TF32 };
+
+// One selectable GEMM kernel. The naive kernel (one thread per element of C, 16x16
+// blocks, no reuse) has all tile sizes zero; WMMA kernels use tm x tn as the warp tile.
+struct TileConfig {
+    const char* name;  // "naive", "tiled_<BM>x<BN>x<BK>_<TM>x<TN>", "wmma_<type>"
+    int bm, bn, bk, tm, tn;
+    GemmPrecision precision;
+    int min_cc;  // minimum compute capability, 0 for any
+
+    bool wmma() const { return precision != GEMM_FP32; }
+    bool tiled() const { return bm > 0 && !wmma(); }
+    // Thread block shape as reported in the summary line: x spans columns of C, or
+    // the lanes of a warp for WMMA kernels (y is then the warp count).
+    int blockX() const { return wmma() ? 32 : tiled() ? bn / tn : 16; }
+    int blockY() const { return wmma() ? (bm / tm) * (bn / tn) : tiled() ? bm / tm : 16; }
+    int threads() const { return blockX() * blockY(); }
+    // Thread blocks needed to cover an M x N result.
+    int gridX(int n) const { return (n + tileN() - 1) / tileN(); }
+    int gridY(int m) const { return (m + tileM() - 1) / tileM(); }
+    int tileM() const { return bm > 0 ? bm : 16; }
+    int tileN() const { return bn > 0 ? bn : 16; }
+    // Operand extents of a WMMA kernel, padded to whole block tiles and K steps.
+    int paddedM(int m) const { return gridY(m) * tileM(); }
+    int paddedN(int n) const { return gridX(n) * tileN(); }
+    int paddedK(int k) const { return bk > 0 ? (k + bk - 1) / bk * bk : k; }
+};
+
+// Round x to the precision's input type and back (round to nearest even; TF32 rounds
+// ties away from zero, as the hardware conversion does).
+float quantizeGemm(GemmPrecision precision, float x);
+
+// All configurations, naive first.
+const TileConfig* gemmConfigs(int* count);
+
+// Configuration called name, or nullptr.
+const TileConfig* findGemmConfig(const char* name);
+
+} // namespace gpu_monitor
+
+#endif // GEMM_TILES_H
@@ -0,0 +1,235 @@
+// gemm_wmma.cuh
+// Tensor-core GEMM kernels of the family (GEMM_WMMA_CONFIGS in gemm_tiles.h): FP16
+// and BF16 inputs with m16n16k16 fragments, TF32 with m16n16k8, all accumulating in
+// FP32. A block of 4 warps computes a 64x64 tile of C; each warp loads its 2x2 A and
+// B fragments straight from global memory (operands are converted once and padded to
+// whole tiles by gemm_convert, so loads never leave the buffers) and writes C through
+// a per-warp shared staging tile, which handles the ragged edges of an unpadded C.
+//
+// The kernel bodies exist only when compiled for the architecture they need (sm_70
+// for FP16, sm_80 for BF16/TF32); gemmWmmaCompiled() tells the backend whether the
+// image that runs on the current device has them. BF16 and TF32 need CUDA 11.
+
+#ifndef GEMM_WMMA_CUH
+#define GEMM_WMMA_CUH
+
+#include "gemm_tiles.h"
+
+#include <cuda_runtime.h>
+
+#if CUDART_VERSION >= 9000
+#include <cuda_fp16.h>
+#include <mma.h>
+#define GEMM_HAVE_WMMA_FP16 1
+#endif
+#if CUDART_VERSION >= 11000
+#include <cuda_bf16.h>
+#define GEMM_HAVE_WMMA_BF16_TF32 1
+#endif
+
+namespace gpu_monitor {
+
+#define GEMM_WMMA_WARPS 4
+
+// Whether this toolkit can build the kernel of precision at all.
+inline bool gemmWmmaBuilt(GemmPrecision precision) {
+#ifdef GEMM_HAVE_WMMA_BF16_TF32
+    if (precision == GEMM_BF16 || precision == GEMM_TF32) return true;
+#endif
+#ifdef GEMM_HAVE_WMMA_FP16
+    if (precision == GEMM_FP16) return true;
+#endif
+    (void)precision;
+    return false;
+}
+
+#ifdef GEMM_HAVE_WMMA_FP16
+
+template <typename T>
+__device__ __forceinline__ T gemm_to(float x);
+template <>
+__device__ __forceinline__ half gemm_to<half>(float x) { return __float2half_rn(x); }
+template <>
+__device__ __forceinline__ float gemm_to<float>(float x) { return x; }  // TF32: rounded at fragment load
+#ifdef GEMM_HAVE_WMMA_BF16_TF32
+template <>
+__device__ __forceinline__ __nv_bfloat16 gemm_to<__nv_bfloat16>(float x) { return __float2bfloat16_rn(x); }
+#endif
+
+// dst (prows x pcols) = src (rows x cols) converted to T, zero outside src.
+template <typename T>
+__global__ void gemm_convert(const float* __restrict__ src, int rows, int cols, T* __restrict__ dst,
+                             int prows, int pcols) {
+    size_t total = static_cast<size_t>(prows) * pcols;
+    size_t stride = static_cast<size_t>(blockDim.x) * gridDim.x;
+    for (size_t i = static_cast<size_t>(blockIdx.x) * blockDim.x + threadIdx.x; i < total; i += stride) {
+        int r = static_cast<int>(i / pcols), c = static_cast<int>(i % pcols);
+        dst[i] = gemm_to<T>(r < rows && c < cols ? src[static_cast<size_t>(r) * cols + c] : 0.0f);
+    }
+}
+
+// FP16/BF16 fragments are loaded as stored; TF32 fragments are rounded after loading.
+template <typename Frag>
+__device__ __forceinline__ void gemm_wmma_round(Frag&) {}
+#ifdef GEMM_HAVE_WMMA_BF16_TF32
+template <typename Use, int M, int N, int K>
+__device__ __forceinline__ void gemm_wmma_round(
+    nvcuda::wmma::fragment<Use, M, N, K, nvcuda::wmma::precision::tf32, nvcuda::wmma::row_major>& f) {
+#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ >= 800
+    for (int t = 0; t < f.num_elements; ++t) f.x[t] = nvcuda::wmma::__float_to_tf32(f.x[t]);
+#endif
+}
+#endif
+
+// A is Mp x Kp and B is Kp x Np (padded, row-major); C is M x N.
+template <typename Storage, typename FragT, int BK>
+__device__ __forceinline__ void gemm_wmma_tile(const Storage* __restrict__ A, const Storage* __restrict__ B,
+                                               float* __restrict__ C, int M, int N, int Kp, int Np) {
+    using namespace nvcuda;
+    __shared__ float stage[GEMM_WMMA_WARPS][16 * 16];
+    const int warp = threadIdx.x / 32, lane = threadIdx.x % 32;
+    const int row0 = blockIdx.y * 64 + (warp / 2) * 32;
+    const int col0 = blockIdx.x * 64 + (warp % 2) * 32;
+
+    wmma::fragment<wmma::matrix_a, 16, 16, BK, FragT, wmma::row_major> a[2];
+    wmma::fragment<wmma::matrix_b, 16, 16, BK, FragT, wmma::row_major> b[2];
+    wmma::fragment<wmma::accumulator, 16, 16, BK, float> acc[2][2];
+#pragma unroll
+    for (int i = 0; i < 2; ++i)
+#pragma unroll
+        for (int j = 0; j < 2; ++j) wmma::fill_fragment(acc[i][j], 0.0f);
+
+    for (int k0 = 0; k0 < Kp; k0 += BK) {
+#pragma unroll
+        for (int i = 0; i < 2; ++i) {
+            wmma::load_matrix_sync(a[i], A + static_cast<size_t>(row0 + 16 * i) * Kp + k0, Kp);
+            gemm_wmma_round(a[i]);
+        }
+#pragma unroll
+        for (int j = 0; j < 2; ++j) {
+            wmma::load_matrix_sync(b[j], B + static_cast<size_t>(k0) * Np + col0 + 16 * j, Np);
+            gemm_wmma_round(b[j]);
+        }
+#pragma unroll
+        for (int i = 0; i < 2; ++i)
+#pragma unroll
+            for (int j = 0; j < 2; ++j) wmma::mma_sync(acc[i][j], a[i], b[j], acc[i][j]);
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            wmma::store_matrix_sync(stage[warp], acc[i][j], 16, wmma::mem_row_major);
+            __syncwarp();
+            for (int e = lane; e < 16 * 16; e += 32) {
+                int r = row0 + 16 * i + e / 16, c = col0 + 16 * j + e % 16;
+                if (r < M && c < N) C[static_cast<size_t>(r) * N + c] = stage[warp][e];
+            }
+            __syncwarp();
+        }
+    }
+}
+
+__global__ void __launch_bounds__(GEMM_WMMA_WARPS * 32)
+gemm_wmma_fp16(const half* __restrict__ A, const half* __restrict__ B, float* __restrict__ C,
+               int M, int N, int Kp, int Np) {
+#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ >= 700
+    gemm_wmma_tile<half, half, 16>(A, B, C, M, N, Kp, Np);
+#endif
+}
+
+#ifdef GEMM_HAVE_WMMA_BF16_TF32
+__global__ void __launch_bounds__(GEMM_WMMA_WARPS * 32)
+gemm_wmma_bf16(const __nv_bfloat16* __restrict__ A, const __nv_bfloat16* __restrict__ B,
+               float* __restrict__ C, int M, int N, int Kp, int Np) {
+#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ >= 800
+    gemm_wmma_tile<__nv_bfloat16, __nv_bfloat16, 16>(A, B, C, M, N, Kp, Np);
+#endif
+}
+
+__global__ void __launch_bounds__(GEMM_WMMA_WARPS * 32)
+gemm_wmma_tf32(const float* __restrict__ A, const float* __restrict__ B, float* __restrict__ C,
+               int M, int N, int Kp, int Np) {
+#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ >= 800
+    gemm_wmma_tile<float, nvcuda::wmma::precision::tf32, 8>(A, B, C, M, N, Kp, Np);
+#endif
+}
+#endif // GEMM_HAVE_WMMA_BF16_TF32
+
+#endif // GEMM_HAVE_WMMA_FP16
+
+// Kernel entry point of a WMMA precision, or nullptr if this toolkit cannot build it.
+inline const void* gemmWmmaKernel(GemmPrecision precision) {
+#ifdef GEMM_HAVE_WMMA_BF16_TF32
+    if (precision == GEMM_BF16) return reinterpret_cast<const void*>(gemm_wmma_bf16);
+    if (precision == GEMM_TF32) return reinterpret_cast<const void*>(gemm_wmma_tf32);
+#endif
+#ifdef GEMM_HAVE_WMMA_FP16
+    if (precision == GEMM_FP16) return reinterpret_cast<const void*>(gemm_wmma_fp16);
+#endif
+    (void)precision;
+    return nullptr;
+}
+
+// Whether the image of cfg's kernel that runs on the current device was compiled for
+// an architecture with the kernel body (the PTX architecture is what the guards see).
+inline bool gemmWmmaCompiled(const TileConfig& cfg) {
+    const void* kernel = gemmWmmaKernel(cfg.precision);
+    cudaFuncAttributes attr;
+    if (!kernel || cudaFuncGetAttributes(&attr, kernel) != cudaSuccess) return false;
+    return attr.ptxVersion >= cfg.min_cc;
+}
+
+// Convert a float operand for precision (see BenchBackend::convertGemmOperand).
+inline cudaError_t convertGemmOperand(GemmPrecision precision, const float* src, int rows, int cols,
+                                      void* dst, int prows, int pcols, cudaStream_t stream = 0) {
+    const int threads = 256, blocks = 1024;
+    switch (precision) {
+#ifdef GEMM_HAVE_WMMA_FP16
+    case GEMM_FP16:
+        gemm_convert<half><<<blocks, threads, 0, stream>>>(src, rows, cols, static_cast<half*>(dst), prows, pcols);
+        return cudaGetLastError();
+#endif
+#ifdef GEMM_HAVE_WMMA_BF16_TF32
+    case GEMM_BF16:
+        gemm_convert<__nv_bfloat16><<<blocks, threads, 0, stream>>>(src, rows, cols,
+                                                                    static_cast<__nv_bfloat16*>(dst), prows, pcols);
+        return cudaGetLastError();
+    case GEMM_TF32:
+        gemm_convert<float><<<blocks, threads, 0, stream>>>(src, rows, cols, static_cast<float*>(dst), prows, pcols);
+        return cudaGetLastError();
+#endif
+    default:
+        return cudaErrorInvalidValue;
+    }
+}
+
+// Launch the WMMA kernel of cfg on padded operands.
+inline cudaError_t launchGemmWmma(const TileConfig& cfg, const void* A, const void* B, float* C,
+                                  int M, int K, int N, cudaStream_t stream = 0) {
+    dim3 grid(cfg.gridX(N), cfg.gridY(M));
+    const int kp = cfg.paddedK(K), np = cfg.paddedN(N);
+    switch (cfg.precision) {
+#ifdef GEMM_HAVE_WMMA_FP16
+    case GEMM_FP16:
+        gemm_wmma_fp16<<<grid, cfg.threads(), 0, stream>>>(static_cast<const half*>(A),
+                                                           static_cast<const half*>(B), C, M, N, kp, np);
+        return cudaGetLastError();
+#endif
+#ifdef GEMM_HAVE_WMMA_BF16_TF32
+    case GEMM_BF16:
+        gemm_wmma_bf16<<<grid, cfg.threads(), 0, stream>>>(static_cast<const __nv_bfloat16*>(A),
+                                                           static_cast<const __nv_bfloat16*>(B), C, M, N, kp, np);
+        return cudaGetLastError();
+    case GEMM_TF32:
+        gemm_wmma_tf32<<<grid, cfg.threads(), 0, stream>>>(static_cast<const float*>(A),
+                                                           static_cast<const float*>(B), C, M, N, kp, np);
+        return cudaGetLastError();
+#endif
+    default:
+        return cudaErrorInvalidValue;
+    }
+}
+
+} // namespace gpu_monitor
+
+#endif // GEMM_WMMA_CUH
@@ -0,0 +1,97 @@
+// gpu_aggregates.cpp - constant-memory aggregation of sampling passes
+#include "gpu_aggregates.h"
+
+namespace gpu_monitor {
+
+namespace {
+
+// Mean over the devices of one pass, skipping failed reads; nothing is added to the
+// node statistics when every device failed.
+struct NodeMean {
+    double sum = 0.0;
+    size_t n = 0;
+
+    void add(double v) {
+        sum += v;
+        ++n;
+    }
+    void addTo(MetricStats* m) const {
+        if (n) m->add(sum / n);
+    }
+};
+
+} // namespace
+
+void GpuAggregates::init(size_t n) {
+    ndev = n;
+    energy.assign(n, TrapezoidIntegrator());
+    power_read_errors.assign(n, 0);
+    power_w.assign(n, MetricStats());
+    core_mhz.assign(n, MetricStats());
+    mem_mhz.assign(n, MetricStats());
+    util_pct.assign(n, MetricStats());
+    temp_c.assign(n, MetricStats());
+    throttle.assign(n, ThrottleTime());
+    node_power_w = MetricStats();
+    node_core_mhz = MetricStats();
+    node_mem_mhz = MetricStats();
+    node_util_pct = MetricStats();
+    node_temp_c = MetricStats();
+    node_throttle = ThrottleTime();
+    passes = 0;
+    first_pass_s = last_pass_s = interval_max_s = 0.0;
+}
+
+void GpuAggregates::add(const PassSample& s) {
+    if (passes == 0) {
+        first_pass_s = s.t_s;
+    } else if (s.t_s - last_pass_s > interval_max_s) {
+        interval_max_s = s.t_s - last_pass_s;
+    }
+    last_pass_s = s.t_s;
+    ++passes;
+
+    double sum_p = 0.0;
+    bool power_ok = true;
+    // Node clocks, utilization and temperature average the devices whose read succeeded
+    NodeMean core, mem, util, temp;
+    unsigned long long node_mask = kThrottleReasonsUnavailable;
+    for (size_t d = 0; d < ndev; ++d) {
+        if (s.power_ok[d]) {
+            energy[d].add(s.dev_t_s[d], s.power_w[d]);
+            power_w[d].add(s.power_w[d]);
+        } else {
+            ++power_read_errors[d];
+            power_ok = false;
+        }
+        if (s.core_ok[d]) {
+            core_mhz[d].add(s.core_mhz[d]);
+            core.add(s.core_mhz[d]);
+        }
+        if (s.mem_ok[d]) {
+            mem_mhz[d].add(s.mem_mhz[d]);
+            mem.add(s.mem_mhz[d]);
+        }
+        if (s.util_ok[d]) {
+            util_pct[d].add(s.util_pct[d]);
+            util.add(s.util_pct[d]);
+        }
+        if (s.temp_ok[d]) {
+            temp_c[d].add(s.temp_c[d]);
+            temp.add(s.temp_c[d]);
+        }
+        throttle[d].add(s.dev_t_s[d], s.throttle[d]);
+        if (s.throttle[d] != kThrottleReasonsUnavailable)
+            node_mask = (node_mask == kThrottleReasonsUnavailable) ? s.throttle[d] : (node_mask | s.throttle[d]);
+        sum_p += s.power_w[d];
+    }
+    if (ndev == 0) return;
+    if (power_ok) node_power_w.add(sum_p);
+    core.addTo(&node_core_mhz);
+    mem.addTo(&node_mem_mhz);
+    util.addTo(&node_util_pct);
+    temp.addTo(&node_temp_c);
+    node_throttle.add(s.t_s, node_mask);
+}
+
+} // namespace gpu_monitor
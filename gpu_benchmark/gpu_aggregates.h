@@ -0,0 +1,68 @@
+// gpu_aggregates.h
+// Streaming aggregation of sampling passes for gpu_monitor_nvml. Each pass is folded
+// into fixed-size accumulators, so memory depends on the number of devices only and
+// not on the length of the run.
+
+#ifndef GPU_AGGREGATES_H
+#define GPU_AGGREGATES_H
+
+#include "gpu_devices.h"
+#include "monitor_timing.h"
+#include "streaming_stats.h"
+#include "throttle_reasons.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace gpu_monitor {
+
+// Per-device accumulators, one vector per metric indexed by device, plus node-level
+// statistics of the per-pass aggregate (total power, device-mean clocks/util/temp).
+struct GpuAggregates {
+    size_t ndev = 0;
+
+    std::vector<TrapezoidIntegrator> energy;  // power over real timestamps
+    std::vector<uint64_t> power_read_errors;  // failed power reads, left out of energy
+                                              // and power stats (the integrator bridges
+                                              // the gap between valid samples)
+    std::vector<MetricStats> power_w;
+    // Clock, utilization and temperature stats skip failed reads (PassSample::*_ok)
+    std::vector<MetricStats> core_mhz;
+    std::vector<MetricStats> mem_mhz;
+    std::vector<MetricStats> util_pct;
+    std::vector<MetricStats> temp_c;
+    std::vector<ThrottleTime> throttle;
+
+    MetricStats node_power_w;  // passes where every device's power read succeeded
+    MetricStats node_core_mhz;  // mean over the devices whose read succeeded
+    MetricStats node_mem_mhz;
+    MetricStats node_util_pct;
+    MetricStats node_temp_c;
+    ThrottleTime node_throttle;  // reasons present on any device
+
+    // Pass timing
+    uint64_t passes = 0;
+    double first_pass_s = 0.0;
+    double last_pass_s = 0.0;
+    double interval_max_s = 0.0;
+
+    void init(size_t n);
+    void add(const PassSample& s);
+
+    uint64_t powerReadErrors() const {
+        uint64_t n = 0;
+        for (uint64_t e : power_read_errors) n += e;
+        return n;
+    }
+    double intervalMeanS() const {
+        return passes > 1 ? (last_pass_s - first_pass_s) / (passes - 1) : 0.0;
+    }
+    // Time-weighted mean power of device d
+    double powerAvgW(size_t d) const {
+        return energy[d].count() > 1 ? energy[d].mean() : power_w[d].stats().mean();
+    }
+};
+
+} // namespace gpu_monitor
+
+#endif // GPU_AGGREGATES_H
@@ -0,0 +1,190 @@
+// gpu_clocks.cpp - supported clock enumeration and application/locked clock control
+#include "gpu_clocks.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+namespace gpu_monitor {
+
+bool parseClockMode(const std::string& s, ClockMode* out) {
+    if (s == "app" || s == "application") {
+        *out = ClockMode::APPLICATION;
+    } else if (s == "locked") {
+        *out = ClockMode::LOCKED;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* clockModeName(ClockMode mode) {
+    return mode == ClockMode::LOCKED ? "locked" : "app";
+}
+
+static bool parseMHz(const std::string& s, unsigned int* out) {
+    if (s.empty() || s.find_first_not_of("0123456789") != std::string::npos) return false;
+    unsigned long v = std::strtoul(s.c_str(), nullptr, 10);
+    if (v == 0 || v > 100000) return false;
+    *out = (unsigned int)v;
+    return true;
+}
+
+bool parseClockPairs(const std::string& spec, std::vector<ClockPair>* out, std::string* err) {
+    out->clear();
+    std::stringstream ss(spec);
+    std::string tok;
+    while (std::getline(ss, tok, ',')) {
+        if (tok.empty()) continue;
+        size_t colon = tok.find(':');
+        ClockPair p;
+        if (colon == std::string::npos || !parseMHz(tok.substr(0, colon), &p.mem_mhz) ||
+            !parseMHz(tok.substr(colon + 1), &p.gr_mhz)) {
+            *err = "bad clock pair '" + tok + "' (expected MEM:GR in MHz)";
+            return false;
+        }
+        out->push_back(p);
+    }
+    if (out->empty()) {
+        *err = "empty clock list";
+        return false;
+    }
+    return true;
+}
+
+#ifdef GPU_MONITOR_HAVE_APP_CLOCKS
+// Calls an NVML list getter twice: once for the size, once for the values.
+template <typename Fn>
+static nvmlReturn_t queryList(Fn fn, std::vector<unsigned int>* out) {
+    unsigned int count = 0;
+    nvmlReturn_t ret = fn(&count, nullptr);
+    if (ret != NVML_SUCCESS && ret != NVML_ERROR_INSUFFICIENT_SIZE) return ret;
+    out->assign(count, 0);
+    if (count == 0) return NVML_SUCCESS;
+    ret = fn(&count, out->data());
+    out->resize(count);
+    return ret;
+}
+#endif
+
+nvmlReturn_t supportedClockPairs(nvmlDevice_t dev, std::vector<ClockPair>* out) {
+    out->clear();
+#ifdef GPU_MONITOR_HAVE_APP_CLOCKS
+    std::vector<unsigned int> mems;
+    nvmlReturn_t ret = queryList(
+        [dev](unsigned int* n, unsigned int* v) { return nvmlDeviceGetSupportedMemoryClocks(dev, n, v); }, &mems);
+    if (ret != NVML_SUCCESS) return ret;
+    for (unsigned int mem : mems) {
+        std::vector<unsigned int> grs;
+        ret = queryList([dev, mem](unsigned int* n, unsigned int* v) {
+            return nvmlDeviceGetSupportedGraphicsClocks(dev, mem, n, v);
+        }, &grs);
+        if (ret != NVML_SUCCESS) return ret;
+        for (unsigned int gr : grs) out->push_back(ClockPair{mem, gr});
+    }
+    return NVML_SUCCESS;
+#else
+    (void)dev;
+    return NVML_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+nvmlReturn_t commonClockPairs(const DeviceSet& devs, std::vector<ClockPair>* out, std::string* err) {
+    out->clear();
+    for (size_t d = 0; d < devs.size(); ++d) {
+        std::vector<ClockPair> pairs;
+        nvmlReturn_t ret = supportedClockPairs(devs.handles[d], &pairs);
+        if (ret != NVML_SUCCESS) {
+            *err = "gpu" + std::to_string(devs.index[d]) + ": supported clocks: " + nvmlErrorString(ret);
+            return ret;
+        }
+        if (d == 0) {
+            *out = pairs;
+            continue;
+        }
+        out->erase(std::remove_if(out->begin(), out->end(),
+                                  [&pairs](const ClockPair& p) {
+                                      return std::find(pairs.begin(), pairs.end(), p) == pairs.end();
+                                  }),
+                   out->end());
+    }
+    return NVML_SUCCESS;
+}
+
+ClockController::ClockController(ClockMode mode) : mode_(mode), mem_locked_(false) {}
+
+ClockController::~ClockController() {
+    restore();
+}
+
+nvmlReturn_t ClockController::apply(const DeviceSet& devs, const ClockPair& pair, std::string* err) {
+    for (size_t d = 0; d < devs.size(); ++d) {
+        nvmlDevice_t dev = devs.handles[d];
+        if (std::find(touched_.begin(), touched_.end(), dev) == touched_.end()) {
+            touched_.push_back(dev);
+            touched_index_.push_back(devs.index[d]);
+        }
+
+        nvmlReturn_t ret = NVML_ERROR_NOT_SUPPORTED;
+        const char* what = "set application clocks";
+        if (mode_ == ClockMode::APPLICATION) {
+#ifdef GPU_MONITOR_HAVE_APP_CLOCKS
+            ret = nvmlDeviceSetApplicationsClocks(dev, pair.mem_mhz, pair.gr_mhz);
+#endif
+        } else {
+            what = "lock graphics clock";
+#ifdef GPU_MONITOR_HAVE_LOCKED_CLOCKS
+            ret = nvmlDeviceSetGpuLockedClocks(dev, pair.gr_mhz, pair.gr_mhz);
+#endif
+#ifdef GPU_MONITOR_HAVE_MEM_LOCKED_CLOCKS
+            if (ret == NVML_SUCCESS) {
+                what = "lock memory clock";
+                ret = nvmlDeviceSetMemoryLockedClocks(dev, pair.mem_mhz, pair.mem_mhz);
+                if (ret == NVML_SUCCESS) mem_locked_ = true;
+            }
+#endif
+        }
+        if (ret != NVML_SUCCESS) {
+            std::ostringstream os;
+            os << "gpu" << devs.index[d] << ": " << what << " " << pair.mem_mhz << ":" << pair.gr_mhz << ": "
+               << nvmlErrorString(ret);
+            *err = os.str();
+            return ret;
+        }
+    }
+    return NVML_SUCCESS;
+}
+
+bool ClockController::restore() {
+    bool ok = true;
+    for (size_t i = 0; i < touched_.size(); ++i) {
+        nvmlReturn_t ret = NVML_ERROR_NOT_SUPPORTED;
+        if (mode_ == ClockMode::APPLICATION) {
+#ifdef GPU_MONITOR_HAVE_APP_CLOCKS
+            ret = nvmlDeviceResetApplicationsClocks(touched_[i]);
+#endif
+        } else {
+#ifdef GPU_MONITOR_HAVE_LOCKED_CLOCKS
+            ret = nvmlDeviceResetGpuLockedClocks(touched_[i]);
+#endif
+#ifdef GPU_MONITOR_HAVE_MEM_LOCKED_CLOCKS
+            if (mem_locked_) {
+                nvmlReturn_t mret = nvmlDeviceResetMemoryLockedClocks(touched_[i]);
+                if (ret == NVML_SUCCESS) ret = mret;
+            }
+#endif
+        }
+        if (ret != NVML_SUCCESS) {
+            std::cerr << "Failed to restore default clocks on gpu" << touched_index_[i] << ": "
+                      << nvmlErrorString(ret) << "\n";
+            ok = false;
+        }
+    }
+    touched_.clear();
+    touched_index_.clear();
+    mem_locked_ = false;
+    return ok;
+}
+
+} // namespace gpu_monitor
@@ -0,0 +1,70 @@
+// gpu_clocks.h
+// Clock control for DVFS sweeps: enumerates the memory/graphics clock pairs a device
+// supports and pins devices to one pair through NVML, either as application clocks
+// (nvmlDeviceSetApplicationsClocks) or as locked clocks (nvmlDeviceSetGpuLockedClocks,
+// plus nvmlDeviceSetMemoryLockedClocks where available). Clocks set this way persist
+// in the driver after the process exits, so ClockController resets every device it
+// touched when restore() is called or when it is destroyed.
+
+#ifndef GPU_CLOCKS_H
+#define GPU_CLOCKS_H
+
+#include "gpu_devices.h"
+
+#include <nvml.h>
+#include <string>
+#include <vector>
+
+namespace gpu_monitor {
+
+struct ClockPair {
+    unsigned int mem_mhz;
+    unsigned int gr_mhz;
+};
+
+inline bool operator==(const ClockPair& a, const ClockPair& b) {
+    return a.mem_mhz == b.mem_mhz && a.gr_mhz == b.gr_mhz;
+}
+
+enum class ClockMode { APPLICATION, LOCKED };
+
+// Parses "app"/"application" or "locked".
+bool parseClockMode(const std::string& s, ClockMode* out);
+const char* clockModeName(ClockMode mode);
+
+// Parses a comma-separated list of MEM:GR pairs in MHz ("5001:1530,5001:1200").
+// Returns false and fills *err on malformed input.
+bool parseClockPairs(const std::string& spec, std::vector<ClockPair>* out, std::string* err);
+
+// Every supported memory/graphics pair of dev, memory clocks and graphics clocks in the
+// order NVML reports them (highest first).
+nvmlReturn_t supportedClockPairs(nvmlDevice_t dev, std::vector<ClockPair>* out);
+
+// Pairs supported by every device in devs, in the order of the first device.
+nvmlReturn_t commonClockPairs(const DeviceSet& devs, std::vector<ClockPair>* out, std::string* err);
+
+class ClockController {
+public:
+    explicit ClockController(ClockMode mode);
+    ~ClockController();
+
+    // Pins every device in devs to pair. On failure fills *err; devices already
+    // changed stay registered for restore().
+    nvmlReturn_t apply(const DeviceSet& devs, const ClockPair& pair, std::string* err);
+
+    // Resets the clocks of every device changed so far to their defaults. Safe to call
+    // more than once; returns false if any reset failed (reported on stderr).
+    bool restore();
+
+    ClockMode mode() const { return mode_; }
+
+private:
+    ClockMode mode_;
+    std::vector<nvmlDevice_t> touched_;
+    std::vector<unsigned int> touched_index_;
+    bool mem_locked_;  // memory clocks were locked as well (LOCKED mode)
+};
+
+} // namespace gpu_monitor
+
+#endif // GPU_CLOCKS_H
@@ -0,0 +1,181 @@
+// gpu_devices.cpp - device selection and SoA sampling for gpu_monitor_nvml
+#include "gpu_devices.h"
+#include "monitor_timing.h"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+namespace gpu_monitor {
+
+static bool isAllDigits(const std::string& s) {
+    if (s.empty()) return false;
+    for (char c : s) {
+        if (!std::isdigit((unsigned char)c)) return false;
+    }
+    return true;
+}
+
+static nvmlReturn_t describe(nvmlDevice_t dev, DeviceSet* out) {
+    unsigned int idx = 0;
+    nvmlReturn_t ret = nvmlDeviceGetIndex(dev, &idx);
+    if (ret != NVML_SUCCESS) return ret;
+
+    // Already selected through another selector
+    if (std::find(out->index.begin(), out->index.end(), idx) != out->index.end()) return NVML_SUCCESS;
+
+    char buf[96];
+    std::string name, uuid, pci;
+    if (nvmlDeviceGetName(dev, buf, sizeof(buf)) == NVML_SUCCESS) name = buf;
+    if (nvmlDeviceGetUUID(dev, buf, sizeof(buf)) == NVML_SUCCESS) uuid = buf;
+    nvmlPciInfo_t pci_info;
+    if (nvmlDeviceGetPciInfo(dev, &pci_info) == NVML_SUCCESS) pci = pci_info.busId;
+
+    out->handles.push_back(dev);
+    out->index.push_back(idx);
+    out->name.push_back(name);
+    out->uuid.push_back(uuid);
+    out->pci_bus_id.push_back(pci);
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t selectDevices(const std::string& spec, DeviceSet* out, std::string* err) {
+    *out = DeviceSet();
+    std::vector<std::string> selectors;
+    std::stringstream ss(spec);
+    std::string tok;
+    while (std::getline(ss, tok, ',')) {
+        if (!tok.empty()) selectors.push_back(tok);
+    }
+    if (selectors.empty()) selectors.push_back("all");
+
+    for (const std::string& sel : selectors) {
+        nvmlReturn_t ret;
+        if (sel == "all") {
+            unsigned int count = 0;
+            ret = nvmlDeviceGetCount(&count);
+            for (unsigned int i = 0; ret == NVML_SUCCESS && i < count; ++i) {
+                nvmlDevice_t dev;
+                ret = nvmlDeviceGetHandleByIndex(i, &dev);
+                if (ret == NVML_SUCCESS) ret = describe(dev, out);
+            }
+        } else {
+            nvmlDevice_t dev;
+            if (isAllDigits(sel)) {
+                ret = nvmlDeviceGetHandleByIndex((unsigned int)std::stoul(sel), &dev);
+            } else if (sel.compare(0, 4, "GPU-") == 0 || sel.compare(0, 4, "MIG-") == 0) {
+                ret = nvmlDeviceGetHandleByUUID(sel.c_str(), &dev);
+            } else if (sel.find(':') != std::string::npos) {
+                ret = nvmlDeviceGetHandleByPciBusId(sel.c_str(), &dev);
+            } else {
+                *err = "unrecognised device selector '" + sel + "' (use an index, UUID or PCI bus id)";
+                return NVML_ERROR_INVALID_ARGUMENT;
+            }
+            if (ret == NVML_SUCCESS) ret = describe(dev, out);
+        }
+        if (ret != NVML_SUCCESS) {
+            *err = "device '" + sel + "': " + nvmlErrorString(ret);
+            return ret;
+        }
+    }
+
+    if (out->size() == 0) {
+        *err = "no NVML devices found";
+        return NVML_ERROR_NOT_FOUND;
+    }
+    return NVML_SUCCESS;
+}
+
+void PassSample::resize(size_t ndev) {
+    dev_t_s.resize(ndev);
+    power_w.resize(ndev);
+    power_ok.resize(ndev);
+    core_mhz.resize(ndev);
+    sm_mhz.resize(ndev);
+    mem_mhz.resize(ndev);
+    util_pct.resize(ndev);
+    temp_c.resize(ndev);
+    core_ok.resize(ndev);
+    mem_ok.resize(ndev);
+    util_ok.resize(ndev);
+    temp_ok.resize(ndev);
+    throttle.resize(ndev);
+}
+
+void samplePass(const DeviceSet& devs, double t_origin, PassSample* s) {
+    const size_t n = devs.size();
+    s->resize(n);
+    s->t_s = monotonicSeconds() - t_origin;
+
+    for (size_t d = 0; d < n; ++d) {
+        nvmlDevice_t dev = devs.handles[d];
+
+        unsigned int power_mw = 0;
+        s->dev_t_s[d] = monotonicSeconds() - t_origin;
+        nvmlReturn_t ret = nvmlDeviceGetPowerUsage(dev, &power_mw);
+        s->power_ok[d] = (ret == NVML_SUCCESS);
+        s->power_w[d] = s->power_ok[d] ? (power_mw / 1000.0) : 0.0;
+
+        unsigned int mhz = 0;
+        ret = nvmlDeviceGetClockInfo(dev, NVML_CLOCK_GRAPHICS, &mhz);
+        s->core_ok[d] = (ret == NVML_SUCCESS);
+        s->core_mhz[d] = s->core_ok[d] ? mhz : 0;
+
+        mhz = 0;
+        ret = nvmlDeviceGetClockInfo(dev, NVML_CLOCK_SM, &mhz);
+        s->sm_mhz[d] = (ret == NVML_SUCCESS) ? mhz : 0;
+
+        mhz = 0;
+        ret = nvmlDeviceGetClockInfo(dev, NVML_CLOCK_MEM, &mhz);
+        s->mem_ok[d] = (ret == NVML_SUCCESS);
+        s->mem_mhz[d] = s->mem_ok[d] ? mhz : 0;
+
+        nvmlUtilization_t util;
+        ret = nvmlDeviceGetUtilizationRates(dev, &util);
+        s->util_ok[d] = (ret == NVML_SUCCESS);
+        s->util_pct[d] = s->util_ok[d] ? util.gpu : 0;
+
+        unsigned int temp = 0;
+        ret = nvmlDeviceGetTemperature(dev, NVML_TEMPERATURE_GPU, &temp);
+        s->temp_ok[d] = (ret == NVML_SUCCESS);
+        s->temp_c[d] = s->temp_ok[d] ? temp : 0;
+
+#ifdef GPU_MONITOR_HAVE_THROTTLE_REASONS
+        unsigned long long reasons = 0;
+        ret = nvmlDeviceGetCurrentClocksThrottleReasons(dev, &reasons);
+        s->throttle[d] = (ret == NVML_SUCCESS) ? reasons : kThrottleReasonsUnavailable;
+#else
+        s->throttle[d] = kThrottleReasonsUnavailable;
+#endif
+    }
+}
+
+void EnergyCounters::init(size_t ndev) {
+#ifdef GPU_MONITOR_HAVE_TOTAL_ENERGY
+    ok.assign(ndev, 1);
+#else
+    ok.assign(ndev, 0);
+#endif
+    start_mj.assign(ndev, 0);
+    end_mj.assign(ndev, 0);
+}
+
+void EnergyCounters::read(const DeviceSet& devs, bool first) {
+#ifdef GPU_MONITOR_HAVE_TOTAL_ENERGY
+    for (size_t d = 0; d < devs.size(); ++d) {
+        if (!ok[d]) continue;
+        unsigned long long e_mj = 0;
+        if (nvmlDeviceGetTotalEnergyConsumption(devs.handles[d], &e_mj) != NVML_SUCCESS) {
+            ok[d] = 0;
+            continue;
+        }
+        if (first) start_mj[d] = e_mj;
+        end_mj[d] = e_mj;
+    }
+#else
+    (void)devs;
+    (void)first;
+#endif
+}
+
+} // namespace gpu_monitor
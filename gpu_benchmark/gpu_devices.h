@@ -0,0 +1,81 @@
+// gpu_devices.h
+// Device selection and per-pass sampling for gpu_monitor_nvml. Selected devices and
+// per-pass readings are kept in structure-of-arrays form so one sampling pass walks
+// flat arrays instead of per-device objects.
+
+#ifndef GPU_DEVICES_H
+#define GPU_DEVICES_H
+
+#include "throttle_reasons.h"
+
+#include <nvml.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace gpu_monitor {
+
+// Devices chosen for monitoring; all vectors have size() entries.
+struct DeviceSet {
+    std::vector<nvmlDevice_t> handles;
+    std::vector<unsigned int> index;  // NVML index
+    std::vector<std::string> name;
+    std::vector<std::string> uuid;
+    std::vector<std::string> pci_bus_id;
+
+    size_t size() const { return handles.size(); }
+};
+
+// Resolves a comma-separated selector list into devices. "all" (or an empty spec)
+// enumerates every device; other entries may be an NVML index, a UUID ("GPU-...")
+// or a PCI bus id ("0000:02:00.0"). Duplicates are dropped, order is preserved.
+// On failure returns the NVML error and fills *err.
+nvmlReturn_t selectDevices(const std::string& spec, DeviceSet* out, std::string* err);
+
+// Readings of one sampling pass, one array per metric indexed by device. The buffers
+// are reused from pass to pass; history is folded into streaming aggregates.
+struct PassSample {
+    double t_s = 0.0;              // pass start, seconds since monitor start
+    std::vector<double> dev_t_s;   // time each device's power was read
+    std::vector<double> power_w;
+    std::vector<char> power_ok;    // 0 when the power read failed (power_w is then
+                                   // meaningless and left out of every aggregate)
+    std::vector<unsigned int> core_mhz;       // graphics clock
+    std::vector<unsigned int> sm_mhz;
+    std::vector<unsigned int> mem_mhz;
+    std::vector<unsigned int> util_pct;
+    std::vector<unsigned int> temp_c;
+    std::vector<char> core_ok;  // 0 when that read failed: the value is stored as 0
+    std::vector<char> mem_ok;   // and left out of the aggregates, like power_ok
+    std::vector<char> util_ok;
+    std::vector<char> temp_ok;
+    std::vector<unsigned long long> throttle;  // nvmlClocksThrottleReason* bitmask, or
+                                               // kThrottleReasonsUnavailable
+
+    void resize(size_t ndev);
+    size_t size() const { return power_w.size(); }
+};
+
+// Queries power, clocks, utilization, temperature and clock throttle reasons of every
+// device once into *s. Failed queries are stored as 0 (throttle reasons as
+// kThrottleReasonsUnavailable) and, except for the SM clock that is only traced,
+// marked in the matching *_ok flag.
+void samplePass(const DeviceSet& devs, double t_origin, PassSample* s);
+
+// Hardware total-energy counters (mJ), read at the first and last pass (and when a
+// snapshot is written) only.
+// A device whose counter fails once is excluded for the rest of the run.
+struct EnergyCounters {
+    std::vector<char> ok;
+    std::vector<unsigned long long> start_mj;
+    std::vector<unsigned long long> end_mj;
+
+    void init(size_t ndev);
+    void read(const DeviceSet& devs, bool first);
+    bool valid(size_t dev) const { return ok[dev] && end_mj[dev] >= start_mj[dev]; }
+    double joules(size_t dev) const { return (end_mj[dev] - start_mj[dev]) / 1000.0; }
+};
+
+} // namespace gpu_monitor
+
+#endif // GPU_DEVICES_H
@@ -1,168 +1,606 @@
 // gpu_monitor_nvml.cpp
 // Simple NVML-based monitor that launches a child process (the benchmark), samples NVML
-// at a given interval, and writes aggregated statistics to an output file.
+// on a fixed-rate absolute-deadline schedule, and writes aggregated statistics to an
+// output file. All selected GPUs are sampled in one pass per period and reported both
+// per device and in aggregate. Energy comes from the hardware total-energy counter when
+// the device supports it (Volta+), otherwise from integrating power over the real
+// sample timestamps. Samples are folded into streaming aggregates as they arrive, so
+// memory stays constant however long the child runs; optional periodic snapshots of
+// the report survive a crash of the monitored job. Every sample can also be streamed
+// to a CSV or binary trace through a background writer thread. Clock throttle reasons
+// are tracked per sample so runs whose clocks were lowered by power or thermal limits
+// (rather than by the DVFS setting under test) are flagged as contaminated. With
+// --clocks the monitor also drives the sweep itself: it pins the devices to each
+// memory/graphics clock pair in turn, runs the command once per pair, and restores
+// the default clocks on exit or when interrupted by a signal. The child is supervised
+// through a pidfd in the same poll loop as the sampling timer, so its exit is seen
+// immediately; SIGINT/SIGTERM/SIGHUP are forwarded to it and its resource usage
+// (CPU time, peak RSS, page faults) is part of the report. On shared GPUs,
+// --per-process also attributes device energy to the command's process tree by its
+// share of the per-process SM utilization.
 
 #include <nvml.h>
-#include <unistd.h>
-#include <sys/wait.h>
-#include <chrono>
-#include <thread>
 #include <vector>
 #include <string>
 #include <iostream>
-#include <fstream>
 #include <iomanip>
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
-#include <ctime>
 
-int main(int argc, char** argv) {
-    if (argc < 4) {
-        std::cerr << "Usage: " << argv[0] << " <sample_ms> <output_file> <command> [args...]\n";
-        return 2;
+#include "child_supervisor.h"
+#include "gpu_aggregates.h"
+#include "gpu_clocks.h"
+#include "gpu_devices.h"
+#include "monitor_cli.h"
+#include "monitor_timing.h"
+#include "process_attribution.h"
+#include "trace_writer.h"
+
+using gpu_monitor::ChildSupervisor;
+using gpu_monitor::ClockController;
+using gpu_monitor::ClockMode;
+using gpu_monitor::ClockPair;
+using gpu_monitor::DeadlineTimer;
+using gpu_monitor::DeviceSet;
+using gpu_monitor::EnergyCounters;
+using gpu_monitor::GpuAggregates;
+using gpu_monitor::MetricStats;
+using gpu_monitor::OptionResult;
+using gpu_monitor::PassSample;
+using gpu_monitor::ProcessAttribution;
+using gpu_monitor::ThrottleTime;
+using gpu_monitor::TraceWriter;
+
+// Command-line options given before <sample_ms>.
+struct MonitorOptions {
+    std::string devices = "all";
+    int snapshot_ms = 0;  // 0 = report only at the end
+    std::string trace_path;  // empty = no per-sample trace
+    TraceWriter::Format trace_format = TraceWriter::CSV;
+    double throttle_tolerance_pct = 0.0;  // contaminated above this share of the run
+    std::string clocks;                   // "all" or MEM:GR list; empty = leave clocks alone
+    ClockMode clock_mode = ClockMode::APPLICATION;
+    bool list_clocks = false;
+    bool per_process = false;  // attribute device energy to the command's process tree
+};
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options] <sample_ms> <output_file> <command> [args...]\n"
+              << "       " << prog << " [--devices=LIST] --list-clocks\n"
+              << "Options:\n"
+              << "  --devices=LIST   comma-separated NVML indices, UUIDs or PCI bus ids (default: all)\n"
+              << "  --snapshot-ms=N  rewrite the output file with the running aggregates every N ms\n"
+              << "  --trace=PATH     write every sample (per device) to PATH\n"
+              << "  --trace-format=F trace format: csv (default) or bin\n"
+              << "  --throttle-tolerance-pct=P  flag the run as contaminated only when power/thermal\n"
+              << "                   throttling covers more than P% of it (default 0: any)\n"
+              << "  --clocks=LIST    run the command once per MEM:GR clock pair (MHz, comma-separated)\n"
+              << "                   or for every supported pair (\"all\"); {mem} and {gr} in the\n"
+              << "                   output/trace paths are replaced by the pair\n"
+              << "  --clock-mode=M   app (application clocks, default) or locked (locked clocks)\n"
+              << "  --list-clocks    print the supported clock pairs of the selected devices\n"
+              << "  --per-process    attribute device energy to the command's processes by their share\n"
+              << "                   of the per-process GPU utilization (for shared GPUs)\n";
+}
+
+// Parses leading --options; returns the index of the first positional argument or -1.
+static int parseOptions(int argc, char** argv, MonitorOptions* opts) {
+    static const std::vector<std::string> flags = {"--list-clocks", "--per-process"};
+    return gpu_monitor::parseOptions(argc, argv, flags, [opts](const std::string& key, const std::string& val) {
+        if (key == "--list-clocks") {
+            opts->list_clocks = true;
+        } else if (key == "--per-process") {
+            opts->per_process = true;
+        } else if (key == "--devices") {
+            opts->devices = val;
+        } else if (key == "--snapshot-ms") {
+            opts->snapshot_ms = std::atoi(val.c_str());
+            if (opts->snapshot_ms < 0) {
+                std::cerr << "--snapshot-ms must be >= 0\n";
+                return OptionResult::INVALID;
+            }
+        } else if (key == "--trace") {
+            opts->trace_path = val;
+        } else if (key == "--trace-format") {
+            if (!gpu_monitor::parseTraceFormat(val, &opts->trace_format)) {
+                std::cerr << "--trace-format must be csv or bin\n";
+                return OptionResult::INVALID;
+            }
+        } else if (key == "--throttle-tolerance-pct") {
+            opts->throttle_tolerance_pct = std::atof(val.c_str());
+            if (opts->throttle_tolerance_pct < 0.0) {
+                std::cerr << "--throttle-tolerance-pct must be >= 0\n";
+                return OptionResult::INVALID;
+            }
+        } else if (key == "--clocks") {
+            std::vector<ClockPair> pairs;
+            std::string err;
+            if (val != "all" && !gpu_monitor::parseClockPairs(val, &pairs, &err)) {
+                std::cerr << "--clocks: " << err << "\n";
+                return OptionResult::INVALID;
+            }
+            opts->clocks = val;
+        } else if (key == "--clock-mode") {
+            if (!gpu_monitor::parseClockMode(val, &opts->clock_mode)) {
+                std::cerr << "--clock-mode must be app or locked\n";
+                return OptionResult::INVALID;
+            }
+        } else {
+            return OptionResult::UNKNOWN;
+        }
+        return OptionResult::OK;
+    });
+}
+
+static double discrepancyPct(double integrated, double counter) {
+    // Relative error of the sampled estimate against the counter
+    return (counter > 0.0) ? (integrated - counter) / counter * 100.0 : 0.0;
+}
+
+// Writes min/max/std and p50/p95/p99 of one metric as <prefix><name>.<stat>=value
+static void writeStats(std::ostream& os, const std::string& prefix, const char* name,
+                       const MetricStats& m) {
+    os << prefix << name << ".min=" << m.stats().min() << "\n";
+    os << prefix << name << ".max=" << m.stats().max() << "\n";
+    os << prefix << name << ".std=" << m.stats().stddev() << "\n";
+    os << prefix << name << ".p50=" << m.p50() << "\n";
+    os << prefix << name << ".p95=" << m.p95() << "\n";
+    os << prefix << name << ".p99=" << m.p99() << "\n";
+}
+
+// Writes time under each throttle reason and the contamination verdict as
+// <prefix>throttle...=value
+static void writeThrottle(std::ostream& os, const std::string& prefix, const ThrottleTime& t,
+                          double tolerance_pct) {
+    os << prefix << "throttle_supported=" << (t.supported ? 1 : 0) << "\n";
+    if (!t.supported) return;
+    bool contaminated = (t.seen_mask & gpu_monitor::contaminatingThrottleMask()) &&
+                        t.contaminatedPct() > tolerance_pct;
+    os << prefix << "throttle_reasons=" << gpu_monitor::throttleReasonNames(t.seen_mask) << "\n";
+    os << prefix << "throttle_contaminated=" << (contaminated ? 1 : 0) << "\n";
+    os << prefix << "throttle_contaminated_s=" << t.contaminated_s << "\n";
+    os << prefix << "throttle_contaminated_pct=" << t.contaminatedPct() << "\n";
+    for (size_t i = 0; i < gpu_monitor::kNumThrottleReasons; ++i)
+        os << prefix << "throttle." << gpu_monitor::kThrottleReasons[i].name << "_s=" << t.reason_s[i] << "\n";
+}
+
+// Everything the key=value report is built from.
+struct ReportInput {
+    int sample_ms;
+    const DeviceSet* devs;
+    const GpuAggregates* agg;
+    const EnergyCounters* counters;
+    const MonitorOptions* opts;
+    const TraceWriter* trace;
+    const ChildSupervisor* child;
+    const ProcessAttribution* procs;  // null without --per-process
+    std::string trace_path;   // empty when no trace is written
+    const ClockPair* clocks;  // pair set for this run, or null
+    size_t sweep_index;
+    size_t sweep_total;
+    uint64_t missed_deadlines;
+    double duration_s;
+    bool complete;  // false for periodic snapshots
+};
+
+// Writes the report as key=value lines.
+static void writeReportLines(std::ostream& ofs, const ReportInput& in) {
+    const DeviceSet& devs = *in.devs;
+    const GpuAggregates& agg = *in.agg;
+    const EnergyCounters& counters = *in.counters;
+    const size_t ndev = devs.size();
+
+    // Node aggregate: power/energy summed; clocks, utilization and temperature
+    // averaged over devices
+    double power_avg_w = 0.0, energy_int_j = 0.0, energy_j = 0.0;
+    size_t n_counter = 0;
+    for (size_t d = 0; d < ndev; ++d) {
+        power_avg_w += agg.powerAvgW(d);
+        // Trapezoidal integration over the actual timestamps (no uniform-spacing assumption)
+        energy_int_j += agg.energy[d].integral();
+        // Prefer the hardware counter: it also sees spikes shorter than sample_ms
+        if (counters.valid(d)) {
+            energy_j += counters.joules(d);
+            ++n_counter;
+        } else {
+            energy_j += agg.energy[d].integral();
+        }
     }
+    const char* energy_method = (n_counter == ndev) ? "hw_counter" : (n_counter == 0 ? "trapezoid" : "mixed");
 
-    int sample_ms = std::atoi(argv[1]);
-    const char* out_file = argv[2];
+    ofs << "timestamp=" << gpu_monitor::isoTimestamp() << "\n";
+    ofs << "status=" << (in.complete ? "complete" : "running") << "\n";
+    ofs << std::fixed << std::setprecision(3);
+    ofs << "power_avg_w=" << power_avg_w << "\n";
+    ofs << "gpu_core_clock_MHz=" << agg.node_core_mhz.stats().mean() << "\n";
+    ofs << "gpu_mem_clock_MHz=" << agg.node_mem_mhz.stats().mean() << "\n";
+    ofs << "gpu_utilization_pct=" << agg.node_util_pct.stats().mean() << "\n";
+    ofs << "gpu_temp_c=" << agg.node_temp_c.stats().mean() << "\n";
+    ofs << "samples=" << agg.passes << "\n";
+    ofs << "sample_period_ms=" << in.sample_ms << "\n";
+    ofs << "sample_interval_mean_ms=" << agg.intervalMeanS() * 1000.0 << "\n";
+    ofs << "sample_interval_max_ms=" << agg.interval_max_s * 1000.0 << "\n";
+    ofs << "missed_deadlines=" << in.missed_deadlines << "\n";
+    ofs << "power_read_errors=" << agg.powerReadErrors() << "\n";
+    ofs << "duration_s=" << in.duration_s << "\n";
+    ofs << "energy_j=" << energy_j << "\n";
+    ofs << "energy_method=" << energy_method << "\n";
+    ofs << "energy_integrated_j=" << energy_int_j << "\n";
+    if (n_counter == ndev) {
+        ofs << "energy_counter_j=" << energy_j << "\n";
+        ofs << "energy_discrepancy_pct=" << discrepancyPct(energy_int_j, energy_j) << "\n";
+    }
+    if (in.procs) {
+        double attributed_j = 0.0;
+        for (size_t d = 0; d < ndev; ++d)
+            attributed_j += in.procs->attributedJ(d, counters.valid(d) ? counters.joules(d) : agg.energy[d].integral());
+        ofs << "energy_attributed_j=" << attributed_j << "\n";
+        ofs << "energy_attributed_pct=" << (energy_j > 0.0 ? attributed_j / energy_j * 100.0 : 0.0) << "\n";
+    }
+    if (in.clocks) {
+        ofs << "clock_mode=" << gpu_monitor::clockModeName(in.opts->clock_mode) << "\n";
+        ofs << "clock_set_mem_MHz=" << in.clocks->mem_mhz << "\n";
+        ofs << "clock_set_gr_MHz=" << in.clocks->gr_mhz << "\n";
+        ofs << "sweep_index=" << in.sweep_index << "\n";
+        ofs << "sweep_total=" << in.sweep_total << "\n";
+    }
+    if (in.complete) {
+        // Resource usage of the command (and of the descendants it waited for)
+        gpu_monitor::writeChildUsage(ofs, in.child->usage());
+    }
+    if (in.child->signalReceived())
+        ofs << "forwarded_signal=" << in.child->signalReceived() << "\n";
+    if (!in.trace_path.empty()) {
+        ofs << "trace_file=" << in.trace_path << "\n";
+        ofs << "trace_format=" << (in.opts->trace_format == TraceWriter::BINARY ? "bin" : "csv") << "\n";
+        ofs << "trace_records=" << in.trace->written() << "\n";
+        ofs << "trace_dropped=" << in.trace->dropped() << "\n";
+    }
+    writeThrottle(ofs, "", agg.node_throttle, in.opts->throttle_tolerance_pct);
+    writeStats(ofs, "", "power_w", agg.node_power_w);
+    writeStats(ofs, "", "core_clock_MHz", agg.node_core_mhz);
+    writeStats(ofs, "", "mem_clock_MHz", agg.node_mem_mhz);
+    writeStats(ofs, "", "utilization_pct", agg.node_util_pct);
+    writeStats(ofs, "", "temp_c", agg.node_temp_c);
 
-    // Build command args for exec
-    char** cmd = &argv[3];
+    // Per-device metrics, keyed by NVML index: gpu<idx>.<metric>=value
+    ofs << "devices=" << ndev << "\n";
+    for (size_t d = 0; d < ndev; ++d) {
+        std::string p = "gpu" + std::to_string(devs.index[d]) + ".";
+        bool has_counter = counters.valid(d);
+        double e_int = agg.energy[d].integral();
+        ofs << p << "name=" << devs.name[d] << "\n";
+        ofs << p << "uuid=" << devs.uuid[d] << "\n";
+        ofs << p << "pci_bus_id=" << devs.pci_bus_id[d] << "\n";
+        ofs << p << "power_avg_w=" << agg.powerAvgW(d) << "\n";
+        ofs << p << "power_read_errors=" << agg.power_read_errors[d] << "\n";
+        ofs << p << "gpu_core_clock_MHz=" << agg.core_mhz[d].stats().mean() << "\n";
+        ofs << p << "gpu_mem_clock_MHz=" << agg.mem_mhz[d].stats().mean() << "\n";
+        ofs << p << "gpu_utilization_pct=" << agg.util_pct[d].stats().mean() << "\n";
+        ofs << p << "gpu_temp_c=" << agg.temp_c[d].stats().mean() << "\n";
+        ofs << p << "energy_j=" << (has_counter ? counters.joules(d) : e_int) << "\n";
+        ofs << p << "energy_method=" << (has_counter ? "hw_counter" : "trapezoid") << "\n";
+        ofs << p << "energy_integrated_j=" << e_int << "\n";
+        if (has_counter) {
+            ofs << p << "energy_counter_j=" << counters.joules(d) << "\n";
+            ofs << p << "energy_discrepancy_pct=" << discrepancyPct(e_int, counters.joules(d)) << "\n";
+        }
+        if (in.procs) {
+            // Device-wide energy (energy_j) split by the command's utilization share
+            const ProcessAttribution& pa = *in.procs;
+            double dev_j = has_counter ? counters.joules(d) : e_int;
+            double attr_j = pa.attributedJ(d, dev_j);
+            ofs << p << "proc_supported=" << (pa.supported(d) ? 1 : 0) << "\n";
+            ofs << p << "proc_count_max=" << pa.treeProcsMax(d) << "\n";
+            ofs << p << "proc_other_count_max=" << pa.otherProcsMax(d) << "\n";
+            ofs << p << "proc_sm_util_pct=" << pa.treeSmUtil(d).mean() << "\n";
+            ofs << p << "proc_mem_used_mib_max=" << pa.treeMemMiBMax(d) << "\n";
+            ofs << p << "energy_attributed_j=" << attr_j << "\n";
+            ofs << p << "energy_attributed_pct=" << (dev_j > 0.0 ? attr_j / dev_j * 100.0 : 0.0) << "\n";
+        }
+        writeThrottle(ofs, p, agg.throttle[d], in.opts->throttle_tolerance_pct);
+        writeStats(ofs, p, "power_w", agg.power_w[d]);
+        writeStats(ofs, p, "core_clock_MHz", agg.core_mhz[d]);
+        writeStats(ofs, p, "mem_clock_MHz", agg.mem_mhz[d]);
+        writeStats(ofs, p, "utilization_pct", agg.util_pct[d]);
+        writeStats(ofs, p, "temp_c", agg.temp_c[d]);
+    }
+}
 
-    // Fork and exec the benchmark command
-    pid_t pid = fork();
-    if (pid == -1) {
-        perror("fork");
-        return 3;
+// Writes the report to path (see writeReportFile). Returns false if it cannot be written.
+static bool writeReport(const std::string& path, const ReportInput& in) {
+    return gpu_monitor::writeReportFile(path, [&in](std::ostream& os) { writeReportLines(os, in); });
+}
+
+// Samples devs until the child started by sup exits, then writes the final report. The
+// caller fills the per-run report fields (trace path, clock pair, sweep position).
+// Returns 0, 6 if the report cannot be written, or 8 (after waiting for the child) if
+// the sampling timer cannot be armed; the child's wait status is left in sup.status().
+static int monitorChild(ChildSupervisor& sup, const DeviceSet& devs, const MonitorOptions& opts, int sample_ms,
+                        const std::string& out_file, TraceWriter& trace, ReportInput report) {
+    const size_t ndev = devs.size();
+    PassSample pass;
+    GpuAggregates agg;
+    agg.init(ndev);
+    EnergyCounters counters;
+    counters.init(ndev);
+    ProcessAttribution procs;
+    if (opts.per_process) procs.init(ndev, sup.pid());
+
+    report.sample_ms = sample_ms;
+    report.devs = &devs;
+    report.agg = &agg;
+    report.counters = &counters;
+    report.opts = &opts;
+    report.trace = &trace;
+    report.child = &sup;
+    report.procs = opts.per_process ? &procs : nullptr;
+
+    double t_start = gpu_monitor::monotonicSeconds();
+    double next_snapshot_s = opts.snapshot_ms / 1000.0;
+    DeadlineTimer timer((int64_t)sample_ms * 1000000LL);
+    std::string timer_err;
+    if (!timer.start(&timer_err)) {
+        std::cerr << "Sampling timer failed: " << timer_err << "\n";
+        sup.wait(nullptr);
+        return 8;
+    }
+
+    // Loop until child exits; each pass samples every selected device. The exit wakes
+    // the loop at once and is followed by one last pass.
+    bool child_done = false;
+    while (true) {
+        gpu_monitor::samplePass(devs, t_start, &pass);
+        agg.add(pass);
+        if (opts.per_process) procs.sample(devs, pass);
+        trace.push(devs, pass);
+
+        // Energy counters are read on the first and last pass (and for snapshots)
+        // only, so they cover the same window as the integrated power.
+        bool first_pass = (agg.passes == 1);
+        bool snapshot = !child_done && opts.snapshot_ms > 0 && pass.t_s >= next_snapshot_s;
+        if (first_pass || child_done || snapshot) counters.read(devs, first_pass);
+
+        if (child_done) break;
+
+        if (snapshot) {
+            report.missed_deadlines = timer.missed();
+            report.duration_s = pass.t_s;
+            report.complete = false;
+            if (!writeReport(out_file, report))
+                std::cerr << "Failed to write snapshot: " << out_file << "\n";
+            while (next_snapshot_s <= pass.t_s) next_snapshot_s += opts.snapshot_ms / 1000.0;
+        }
+
+        child_done = sup.wait(&timer) == ChildSupervisor::EXITED;
     }
 
-    if (pid == 0) {
-        // child
-        execvp(cmd[0], cmd);
-        // if execvp returns, error
-        perror("execvp");
-        _exit(127);
+    report.missed_deadlines = timer.missed();
+    report.duration_s = gpu_monitor::monotonicSeconds() - t_start;
+    report.complete = true;
+
+    // Flush the remaining trace records so the report's record count is final
+    if (!trace.close()) std::cerr << "Failed to write trace file: " << report.trace_path << "\n";
+
+    // Write to output file as key=value lines
+    if (!writeReport(out_file, report)) {
+        std::cerr << "Failed to open output file: " << out_file << "\n";
+        return 6;
     }
+    return 0;
+}
 
-    // parent: monitor child
+// --list-clocks: one gpu<idx>.supported_clocks=MEM:GR,... line per selected device.
+static int listClocks(const MonitorOptions& opts) {
     nvmlReturn_t ret = nvmlInit();
     if (ret != NVML_SUCCESS) {
         std::cerr << "NVML init failed: " << nvmlErrorString(ret) << "\n";
-        // still wait for child to finish
-        int status = 0;
-        waitpid(pid, &status, 0);
         return 4;
     }
-
-    nvmlDevice_t device;
-    ret = nvmlDeviceGetHandleByIndex(0, &device);
+    DeviceSet devs;
+    std::string err;
+    ret = gpu_monitor::selectDevices(opts.devices, &devs, &err);
     if (ret != NVML_SUCCESS) {
-        std::cerr << "NVML get device failed: " << nvmlErrorString(ret) << "\n";
+        std::cerr << "NVML get device failed: " << err << "\n";
         nvmlShutdown();
-        int status = 0;
-        waitpid(pid, &status, 0);
         return 5;
     }
+    int rc = 0;
+    for (size_t d = 0; d < devs.size(); ++d) {
+        std::vector<ClockPair> pairs;
+        ret = gpu_monitor::supportedClockPairs(devs.handles[d], &pairs);
+        if (ret != NVML_SUCCESS) {
+            std::cerr << "gpu" << devs.index[d] << ": supported clocks: " << nvmlErrorString(ret) << "\n";
+            rc = 7;
+            continue;
+        }
+        std::cout << "gpu" << devs.index[d] << ".supported_clocks=";
+        for (size_t i = 0; i < pairs.size(); ++i)
+            std::cout << (i ? "," : "") << pairs[i].mem_mhz << ":" << pairs[i].gr_mhz;
+        std::cout << "\n";
+    }
+    nvmlShutdown();
+    return rc;
+}
 
-    std::vector<double> powers; // watts
-    std::vector<unsigned int> core_clocks;
-    std::vector<unsigned int> mem_clocks;
-    std::vector<unsigned int> utils; // percent
-    std::vector<unsigned int> temps; // C
-
-    auto t_start = std::chrono::steady_clock::now();
+// Output or trace path for one clock pair: {mem} and {gr} are replaced; a multi-pair
+// sweep without placeholders inserts _<mem>_<gr> before the file extension.
+static std::string pairPath(const std::string& path, const ClockPair& p, bool multi) {
+    if (path.empty()) return path;
+    std::string out = path;
+    bool placeholder = false;
+    const std::pair<const char*, unsigned int> subs[] = {{"{mem}", p.mem_mhz}, {"{gr}", p.gr_mhz}};
+    for (const auto& sub : subs) {
+        for (size_t pos; (pos = out.find(sub.first)) != std::string::npos;) {
+            out.replace(pos, std::strlen(sub.first), std::to_string(sub.second));
+            placeholder = true;
+        }
+    }
+    if (placeholder || !multi) return out;
+    std::string suffix = "_" + std::to_string(p.mem_mhz) + "_" + std::to_string(p.gr_mhz);
+    size_t slash = out.rfind('/');
+    size_t dot = out.rfind('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash) || dot == slash + 1)
+        return out + suffix;
+    return out.insert(dot, suffix);
+}
 
-    // Loop until child exits
-    int status = 0;
-    while (true) {
-        // non-blocking check if child is alive
-        pid_t r = waitpid(pid, &status, WNOHANG);
-        bool child_done = (r == pid);
+// --clocks: runs the command once per clock pair with the devices pinned to it, then
+// restores the default clocks. Returns the last non-zero child exit code (or 0),
+// 128+signal when interrupted, or a monitor error code.
+static int runClockSweep(const MonitorOptions& opts, int sample_ms, const std::string& out_file, char** cmd) {
+    nvmlReturn_t ret = nvmlInit();
+    if (ret != NVML_SUCCESS) {
+        std::cerr << "NVML init failed: " << nvmlErrorString(ret) << "\n";
+        return 4;
+    }
+    DeviceSet devs;
+    std::string err;
+    ret = gpu_monitor::selectDevices(opts.devices, &devs, &err);
+    if (ret != NVML_SUCCESS) {
+        std::cerr << "NVML get device failed: " << err << "\n";
+        nvmlShutdown();
+        return 5;
+    }
 
-        // sample
-    unsigned int power_mw = 0;
-        ret = nvmlDeviceGetPowerUsage(device, &power_mw);
-        double power_w = (ret == NVML_SUCCESS) ? (power_mw / 1000.0) : 0.0;
+    // Application clocks must be one of the supported pairs; check them all before
+    // touching any device. Locked clocks accept any value within the device range.
+    std::vector<ClockPair> pairs, supported;
+    if (opts.clocks != "all") gpu_monitor::parseClockPairs(opts.clocks, &pairs, &err);
+    if (opts.clocks == "all" || opts.clock_mode == ClockMode::APPLICATION) {
+        ret = gpu_monitor::commonClockPairs(devs, &supported, &err);
+        if (ret != NVML_SUCCESS) {
+            std::cerr << "NVML clock query failed: " << err << "\n";
+            nvmlShutdown();
+            return 7;
+        }
+    }
+    if (opts.clocks == "all") pairs = supported;
+    for (const ClockPair& p : pairs) {
+        if (opts.clock_mode == ClockMode::APPLICATION &&
+            std::find(supported.begin(), supported.end(), p) == supported.end()) {
+            std::cerr << "Clock pair " << p.mem_mhz << ":" << p.gr_mhz << " is not supported by every selected device\n";
+            nvmlShutdown();
+            return 7;
+        }
+    }
+    if (pairs.empty()) {
+        std::cerr << "No clock pairs to run\n";
+        nvmlShutdown();
+        return 7;
+    }
 
-    unsigned int core_mhz = 0;
-    ret = nvmlDeviceGetClockInfo(device, NVML_CLOCK_GRAPHICS, &core_mhz);
-    unsigned int core_mhz_val = (ret == NVML_SUCCESS) ? core_mhz : 0;
+    // Signals are blocked from here on and read by the supervisor; one received
+    // between runs stops the sweep before the next pair
+    ChildSupervisor sup;
+    ClockController clocks(opts.clock_mode);
+    int rc = 0;
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        sup.pollSignals();
+        if (sup.signalReceived()) break;
+        const ClockPair& pair = pairs[i];
+        ret = clocks.apply(devs, pair, &err);
+        if (ret != NVML_SUCCESS) {
+            std::cerr << "NVML set clocks failed: " << err << "\n";
+            rc = 7;
+            break;
+        }
 
-    unsigned int mem_mhz = 0;
-    ret = nvmlDeviceGetClockInfo(device, NVML_CLOCK_MEM, &mem_mhz);
-    unsigned int mem_mhz_val = (ret == NVML_SUCCESS) ? mem_mhz : 0;
+        bool multi = pairs.size() > 1;
+        ReportInput report;
+        report.trace_path = pairPath(opts.trace_path, pair, multi);
+        report.clocks = &pair;
+        report.sweep_index = i;
+        report.sweep_total = pairs.size();
+        std::string pair_out = pairPath(out_file, pair, multi);
 
-        nvmlUtilization_t util;
-        ret = nvmlDeviceGetUtilizationRates(device, &util);
-        unsigned int gpu_util = (ret == NVML_SUCCESS) ? util.gpu : 0;
+        TraceWriter trace;
+        if (!report.trace_path.empty() && !trace.open(report.trace_path, opts.trace_format)) {
+            std::cerr << "Failed to open trace file: " << report.trace_path << "\n";
+            rc = 6;
+            break;
+        }
+        if (sup.start(cmd) == -1) {
+            rc = 3;
+            break;
+        }
 
-        unsigned int temp = 0;
-        ret = nvmlDeviceGetTemperature(device, NVML_TEMPERATURE_GPU, &temp);
-        unsigned int tval = (ret == NVML_SUCCESS) ? temp : 0;
+        int mrc = monitorChild(sup, devs, opts, sample_ms, pair_out, trace, report);
+        if (mrc != 0) {
+            rc = mrc;
+            break;
+        }
+        if (gpu_monitor::childExitCode(sup.status()) != 0) rc = gpu_monitor::childExitCode(sup.status());
+    }
 
-    powers.push_back(power_w);
-    core_clocks.push_back(core_mhz_val);
-    mem_clocks.push_back(mem_mhz_val);
-        utils.push_back(gpu_util);
-        temps.push_back(tval);
+    if (!clocks.restore() && rc == 0) rc = 7;
+    nvmlShutdown();
+    if (sup.signalReceived()) return 128 + sup.signalReceived();
+    return rc;
+}
 
-        if (child_done) break;
+int main(int argc, char** argv) {
+    MonitorOptions opts;
+    int first = parseOptions(argc, argv, &opts);
+    if (first >= 0 && opts.list_clocks) return listClocks(opts);
+    if (first < 0 || argc - first < 3) {
+        usage(argv[0]);
+        return 2;
+    }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(sample_ms));
+    int sample_ms = std::atoi(argv[first]);
+    const char* out_file = argv[first + 1];
+    if (sample_ms <= 0) {
+        std::cerr << "sample_ms must be a positive integer\n";
+        return 2;
     }
 
-    auto t_end = std::chrono::steady_clock::now();
-    std::chrono::duration<double> dur = t_end - t_start;
-    double duration_s = dur.count();
+    // Build command args for exec
+    char** cmd = &argv[first + 2];
+
+    // Clock sweeps set the clocks before each run, so NVML comes up first
+    if (!opts.clocks.empty()) return runClockSweep(opts, sample_ms, out_file, cmd);
 
-    // compute averages
-    double sum_p = 0.0;
-    long sum_core = 0, sum_mem = 0, sum_util = 0, sum_temp = 0;
-    size_t n = powers.size();
-    for (size_t i = 0; i < n; ++i) {
-        sum_p += powers[i];
-        sum_core += core_clocks[i];
-        sum_mem += mem_clocks[i];
-        sum_util += utils[i];
-        sum_temp += temps[i];
+    // Open the trace before starting the command so a bad path fails fast
+    TraceWriter trace;
+    if (!opts.trace_path.empty() && !trace.open(opts.trace_path, opts.trace_format)) {
+        std::cerr << "Failed to open trace file: " << opts.trace_path << "\n";
+        return 6;
     }
 
-    double avg_p = (n>0) ? (sum_p / n) : 0.0;
-    double avg_core = (n>0) ? (double)sum_core / n : 0.0;
-    double avg_mem = (n>0) ? (double)sum_mem / n : 0.0;
-    double avg_util = (n>0) ? (double)sum_util / n : 0.0;
-    double avg_temp = (n>0) ? (double)sum_temp / n : 0.0;
+    // Fork and exec the benchmark command
+    ChildSupervisor sup;
+    if (sup.start(cmd) == -1) return 3;
 
-    double energy_j = avg_p * duration_s;
+    // parent: monitor child
+    nvmlReturn_t ret = nvmlInit();
+    if (ret != NVML_SUCCESS) {
+        std::cerr << "NVML init failed: " << nvmlErrorString(ret) << "\n";
+        // still wait for child to finish
+        sup.wait(nullptr);
+        return 4;
+    }
 
-    // Write to output file as key=value lines
-    std::ofstream ofs(out_file, std::ios::out | std::ios::trunc);
-    if (!ofs) {
-        std::cerr << "Failed to open output file: " << out_file << "\n";
+    DeviceSet devs;
+    std::string sel_err;
+    ret = gpu_monitor::selectDevices(opts.devices, &devs, &sel_err);
+    if (ret != NVML_SUCCESS) {
+        std::cerr << "NVML get device failed: " << sel_err << "\n";
         nvmlShutdown();
-        return 6;
+        sup.wait(nullptr);
+        return 5;
     }
-    // timestamp ISO
-    auto now = std::chrono::system_clock::now();
-    std::time_t now_t = std::chrono::system_clock::to_time_t(now);
-    char buf[64];
-    std::strftime(buf, sizeof(buf), "%FT%T%z", std::localtime(&now_t));
 
-    ofs << "timestamp=" << buf << "\n";
-    ofs << std::fixed << std::setprecision(3);
-    ofs << "power_avg_w=" << avg_p << "\n";
-    ofs << "gpu_core_clock_MHz=" << avg_core << "\n";
-    ofs << "gpu_mem_clock_MHz=" << avg_mem << "\n";
-    ofs << "gpu_utilization_pct=" << avg_util << "\n";
-    ofs << "gpu_temp_c=" << avg_temp << "\n";
-    ofs << "samples=" << n << "\n";
-    ofs << "duration_s=" << duration_s << "\n";
-    ofs << "energy_j=" << energy_j << "\n";
-    ofs.close();
+    ReportInput report;
+    report.trace_path = opts.trace_path;
+    report.clocks = nullptr;
+    report.sweep_index = report.sweep_total = 0;
 
+    int rc = monitorChild(sup, devs, opts, sample_ms, out_file, trace, report);
     nvmlShutdown();
+    if (rc != 0) return rc;
 
     // Return child's exit status
-    if (WIFEXITED(status)) return WEXITSTATUS(status);
-    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
-    return 0;
+    return gpu_monitor::childExitCode(sup.status());
 }
@@ -0,0 +1,348 @@
+// hetero_gemm.cpp - Work-stealing CPU+GPU split GEMM: queues, workers, adaptive split and front end
+#include "hetero_gemm.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+namespace gpu_monitor {
+
+namespace {
+
+const int kMaxDim = 1000000;
+
+double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// C rows [r0, r1) = A rows [r0, r1) * B, i-k-j order so the inner loop streams rows of B and C.
+void cpuGemmRows(const float* a, const float* b, float* c, int k, int n, int r0, int r1) {
+    for (int i = r0; i < r1; ++i) {
+        float* crow = c + static_cast<size_t>(i) * n;
+        std::fill(crow, crow + n, 0.0f);
+        for (int kk = 0; kk < k; ++kk) {
+            const float aik = a[static_cast<size_t>(i) * k + kk];
+            const float* brow = b + static_cast<size_t>(kk) * n;
+            for (int j = 0; j < n; ++j) crow[j] += aik * brow[j];
+        }
+    }
+}
+
+} // namespace
+
+void RowQueue::reset(int lo, int hi) {
+    std::lock_guard<std::mutex> lock(mu_);
+    lo_ = lo;
+    hi_ = hi;
+}
+
+bool RowQueue::take(int max, int* first, int* count) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (lo_ >= hi_) return false;
+    *first = lo_;
+    *count = std::min(max, hi_ - lo_);
+    lo_ += *count;
+    return true;
+}
+
+bool RowQueue::steal(int max, int* first, int* count) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (lo_ >= hi_) return false;
+    *count = std::min(max, (hi_ - lo_ + 1) / 2);
+    hi_ -= *count;
+    *first = hi_;
+    return true;
+}
+
+bool parseHeteroArgs(int argc, char** argv, HeteroArgs* args, std::string* err) {
+    std::vector<const char*> positional;
+    std::string kernel = "naive";
+    args->cpu_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        bool matched = false;
+        int seed = 0;
+        if (!takeIntegerOption(arg, "--passes", 1, 100000, &args->passes, &matched, err)) return false;
+        if (matched) continue;
+        if (!takeIntegerOption(arg, "--chunk-rows", 1, kMaxDim, &args->chunk_rows, &matched, err)) return false;
+        if (matched) continue;
+        if (!takeIntegerOption(arg, "--cpu-threads", 0, 1024, &args->cpu_threads, &matched, err)) return false;
+        if (matched) continue;
+        if (!takeIntegerOption(arg, "--gpu-batch", 1, kMaxDim, &args->gpu_batch, &matched, err)) return false;
+        if (matched) continue;
+        if (!takeIntegerOption(arg, "--seed", 1, kMaxDim, &seed, &matched, err)) return false;
+        if (matched) {
+            args->seed = static_cast<unsigned>(seed);
+            continue;
+        }
+        if (strncmp(arg, "--split=", 8) == 0) {
+            const char* v = arg + 8;
+            char* end = nullptr;
+            double f = strtod(v, &end);
+            if (strcmp(v, "auto") == 0) {
+                args->split = -1.0;
+            } else if (end != v && *end == '\0' && f >= 0.0 && f <= 1.0) {
+                args->split = f;
+            } else {
+                *err = std::string("invalid --split (0..1 or auto): ") + v;
+                return false;
+            }
+        } else if (strncmp(arg, "--devices=", 10) == 0) {
+            const char* v = arg + 10;
+            if (strcmp(v, "both") == 0) {
+                args->devices = HETERO_BOTH;
+            } else if (strcmp(v, "cpu") == 0) {
+                args->devices = HETERO_CPU_ONLY;
+            } else if (strcmp(v, "gpu") == 0) {
+                args->devices = HETERO_GPU_ONLY;
+            } else {
+                *err = std::string("invalid --devices (both, cpu or gpu): ") + v;
+                return false;
+            }
+        } else if (strncmp(arg, "--kernel=", 9) == 0) {
+            kernel = arg + 9;
+        } else if (strcmp(arg, "--verify") == 0) {
+            args->verify = true;
+        } else if (strcmp(arg, "--show-passes") == 0) {
+            args->show_passes = true;
+        } else if (strncmp(arg, "--", 2) == 0) {
+            *err = std::string("unknown option: ") + arg;
+            return false;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.size() != 3) {
+        *err = "expected M K N";
+        return false;
+    }
+    int* dims[3] = {&args->m, &args->k, &args->n};
+    static const char* names[3] = {"M", "K", "N"};
+    for (int i = 0; i < 3; ++i) {
+        if (!parseInteger(positional[i], 1, kMaxDim, dims[i])) {
+            *err = std::string("invalid ") + names[i] + ": " + positional[i];
+            return false;
+        }
+    }
+    args->kernel = findGemmConfig(kernel.c_str());
+    if (!args->kernel) {
+        *err = "unknown kernel: " + kernel;
+        return false;
+    }
+    // GPU chunks are row slices of A and C in place; WMMA kernels need padded copies
+    if (args->kernel->wmma()) {
+        *err = "the split GEMM needs an FP32 kernel: " + kernel;
+        return false;
+    }
+    if (args->devices == HETERO_CPU_ONLY && args->cpu_threads == 0) {
+        *err = "--devices=cpu needs --cpu-threads of at least 1";
+        return false;
+    }
+    if (args->devices == HETERO_BOTH && args->cpu_threads == 0) args->devices = HETERO_GPU_ONLY;
+    return true;
+}
+
+double HeteroPass::balancedSplit() const {
+    if (gpu_rows == 0 || cpu_rows == 0 || gpu_s <= 0.0 || cpu_s <= 0.0) return split;
+    double gpu_rate = gpu_rows / gpu_s, cpu_rate = cpu_rows / cpu_s;
+    return gpu_rate / (gpu_rate + cpu_rate);
+}
+
+HeteroGemm::HeteroGemm(const HeteroArgs& args, BenchBackend* backend)
+    : args_(args), backend_(backend), d_a_(nullptr), d_b_(nullptr), d_c_(nullptr) {}
+
+HeteroGemm::~HeteroGemm() {
+    if (!backend_) return;
+    float* bufs[3] = {d_a_, d_b_, d_c_};
+    for (float* p : bufs)
+        if (p) backend_->release(p);
+}
+
+bool HeteroGemm::prepare(std::string* err) {
+    const int m = args_.m, k = args_.k, n = args_.n;
+    a_.resize(static_cast<size_t>(m) * k);
+    b_.resize(static_cast<size_t>(k) * n);
+    c_.resize(static_cast<size_t>(m) * n);
+    // same inputs as gemm_benchmark with the same seed
+    fillMatrix(a_, args_.seed);
+    fillMatrix(b_, args_.seed + 1);
+    if (!backend_) return true;
+    void *pa = nullptr, *pb = nullptr, *pc = nullptr;
+    bool ok = backend_->allocate(a_.size() * sizeof(float), &pa, err) &&
+              backend_->allocate(b_.size() * sizeof(float), &pb, err) &&
+              backend_->allocate(c_.size() * sizeof(float), &pc, err);
+    d_a_ = static_cast<float*>(pa);
+    d_b_ = static_cast<float*>(pb);
+    d_c_ = static_cast<float*>(pc);
+    return ok && backend_->upload(d_a_, a_.data(), a_.size() * sizeof(float), err) &&
+           backend_->upload(d_b_, b_.data(), b_.size() * sizeof(float), err);
+}
+
+void HeteroGemm::cpuWorker(HeteroPass* pass, std::mutex* mu, double t0) {
+    int rows = 0, steals = 0;
+    int first = 0, count = 0;
+    for (;;) {
+        bool stolen = false;
+        if (!cpu_queue_.take(1, &first, &count)) {
+            if (!gpu_queue_.steal(1, &first, &count)) break;
+            stolen = true;
+        }
+        int r0 = first * args_.chunk_rows;
+        int r1 = std::min(args_.m, (first + count) * args_.chunk_rows);
+        cpuGemmRows(a_.data(), b_.data(), c_.data(), args_.k, args_.n, r0, r1);
+        rows += r1 - r0;
+        steals += stolen ? count : 0;
+    }
+    std::lock_guard<std::mutex> lock(*mu);
+    pass->cpu_rows += rows;
+    pass->cpu_steals += steals;
+    if (rows > 0) pass->cpu_s = std::max(pass->cpu_s, now() - t0);
+}
+
+bool HeteroGemm::gpuWorker(HeteroPass* pass, double t0, std::string* err) {
+    const int k = args_.k, n = args_.n;
+    int first = 0, count = 0;
+    for (;;) {
+        bool stolen = false;
+        if (!gpu_queue_.take(args_.gpu_batch, &first, &count)) {
+            if (!cpu_queue_.steal(args_.gpu_batch, &first, &count)) break;
+            stolen = true;
+        }
+        int r0 = first * args_.chunk_rows;
+        int r1 = std::min(args_.m, (first + count) * args_.chunk_rows);
+        size_t c_off = static_cast<size_t>(r0) * n;
+        // one launch over the rows of the batch, then those rows of C back to the host
+        if (!backend_->launchGemm(*args_.kernel, d_a_ + static_cast<size_t>(r0) * k, d_b_, d_c_ + c_off,
+                                  r1 - r0, k, n, err) ||
+            !backend_->synchronize(err) ||
+            !backend_->download(&c_[c_off], d_c_ + c_off, static_cast<size_t>(r1 - r0) * n * sizeof(float), err))
+            return false;  // the CPU threads still drain both queues before run() returns
+        pass->gpu_rows += r1 - r0;
+        pass->gpu_steals += stolen ? count : 0;
+        pass->gpu_s = now() - t0;
+    }
+    return true;
+}
+
+bool HeteroGemm::run(double split, HeteroPass* pass, std::string* err) {
+    const int chunks = args_.chunks();
+    bool use_gpu = args_.devices != HETERO_CPU_ONLY && backend_;
+    bool use_cpu = args_.devices != HETERO_GPU_ONLY && args_.cpu_threads > 0;
+    if (!use_gpu) split = 0.0;
+    if (!use_cpu) split = 1.0;
+    int gpu_chunks = static_cast<int>(std::lround(split * chunks));
+    *pass = HeteroPass();
+    pass->split = split;
+    gpu_queue_.reset(0, gpu_chunks);
+    cpu_queue_.reset(gpu_chunks, chunks);
+    std::fill(c_.begin(), c_.end(), std::numeric_limits<float>::quiet_NaN());
+
+    std::mutex mu;
+    double t0 = now();
+    std::vector<std::thread> threads;
+    if (use_cpu)
+        for (int i = 0; i < args_.cpu_threads; ++i) threads.emplace_back(&HeteroGemm::cpuWorker, this, pass, &mu, t0);
+    bool ok = !use_gpu || gpuWorker(pass, t0, err);
+    for (std::thread& t : threads) t.join();
+    pass->time_s = now() - t0;
+    return ok;
+}
+
+std::string heteroSummaryLine(const HeteroArgs& args, const std::vector<HeteroPass>& passes,
+                              const GemmCheck* check) {
+    double time_s = 0.0, gpu_s = 0.0, cpu_s = 0.0;
+    long long gpu_rows = 0, cpu_rows = 0, steals = 0;
+    for (const HeteroPass& p : passes) {
+        time_s += p.time_s;
+        gpu_s += p.gpu_s;
+        cpu_s += p.cpu_s;
+        gpu_rows += p.gpu_rows;
+        cpu_rows += p.cpu_rows;
+        steals += p.gpu_steals + p.cpu_steals;
+    }
+    const double row_flops = 2.0 * args.k * static_cast<double>(args.n);
+    double gflops = gemmCounters(args.m, args.k, args.n, static_cast<long long>(passes.size()), time_s).gflops;
+    double gpu_gflops = gpu_s > 0.0 ? row_flops * gpu_rows / gpu_s / 1e9 : 0.0;
+    double cpu_gflops = cpu_s > 0.0 ? row_flops * cpu_rows / cpu_s / 1e9 : 0.0;
+    double total_rows = static_cast<double>(gpu_rows + cpu_rows);
+    double gpu_share = total_rows > 0.0 ? gpu_rows / total_rows : 0.0;
+    int cpu_threads = args.devices == HETERO_GPU_ONLY ? 0 : args.cpu_threads;
+    char buf[768];
+    int len = snprintf(buf, sizeof(buf),
+                       "kernel_name=hetero_gemm,problem_size=%dx%dx%d,iterations=%zu,time_s=%.9f,gflops=%.3f,"
+                       "gpu_kernel=%s,cpu_threads=%d,chunk_rows=%d,split_first=%.3f,split_last=%.3f,"
+                       "gpu_share=%.3f,cpu_share=%.3f,gpu_gflops=%.3f,cpu_gflops=%.3f,steals=%lld",
+                       args.m, args.k, args.n, passes.size(), time_s, gflops,
+                       args.devices == HETERO_CPU_ONLY ? "none" : args.kernel->name, cpu_threads, args.chunk_rows,
+                       passes.empty() ? 0.0 : passes.front().split, passes.empty() ? 0.0 : passes.back().split,
+                       gpu_share, total_rows > 0.0 ? 1.0 - gpu_share : 0.0, gpu_gflops, cpu_gflops, steals);
+    if (check && len > 0 && static_cast<size_t>(len) < sizeof(buf))
+        snprintf(buf + len, sizeof(buf) - len, ",verify=%s,max_err=%.3e", check->ok ? "pass" : "fail",
+                 check->max_err);
+    return buf;
+}
+
+int heteroMain(int argc, char** argv, BackendFactory makeBackend) {
+    HeteroArgs args;
+    std::string err;
+    if (!parseHeteroArgs(argc, argv, &args, &err)) {
+        fprintf(stderr, "%s: %s\n", argv[0], err.c_str());
+        fprintf(stderr, "Usage: %s M K N [--passes=N] [--chunk-rows=N] [--cpu-threads=N] [--gpu-batch=N]\n"
+                        "       [--split=F|auto] [--devices=both|cpu|gpu] [--kernel=NAME] [--seed=N]\n"
+                        "       [--verify] [--show-passes]\n", argv[0]);
+        return BENCH_EXIT_USAGE;
+    }
+
+    std::unique_ptr<BenchBackend> backend;
+    if (args.devices != HETERO_CPU_ONLY) {
+        backend = makeBackend(&err);
+        std::string why;
+        if (!backend) {
+            fprintf(stderr, "%s: %s\n", argv[0], err.c_str());
+            return BENCH_EXIT_BACKEND;
+        }
+        if (!backend->supportsGemm(*args.kernel, &why)) {
+            fprintf(stderr, "%s: %s: %s\n", argv[0], args.kernel->name, why.c_str());
+            return BENCH_EXIT_BACKEND;
+        }
+    }
+    HeteroGemm gemm(args, backend.get());
+    if (!gemm.prepare(&err)) {
+        fprintf(stderr, "%s: %s\n", argv[0], err.c_str());
+        return BENCH_EXIT_BACKEND;
+    }
+
+    // pass 0 warms both devices up and, when adapting, gives the first measured split
+    double split = args.adaptive() ? 0.5 : args.split;
+    std::vector<HeteroPass> passes;
+    for (int p = 0; p <= args.passes; ++p) {
+        HeteroPass pass;
+        if (!gemm.run(split, &pass, &err)) {
+            fprintf(stderr, "%s: %s\n", argv[0], err.c_str());
+            return BENCH_EXIT_BACKEND;
+        }
+        if (args.show_passes)
+            printf("pass=%d,split=%.3f,time_s=%.9f,gpu_rows=%d,cpu_rows=%d,gpu_s=%.9f,cpu_s=%.9f,"
+                   "gpu_steals=%d,cpu_steals=%d\n",
+                   p, pass.split, pass.time_s, pass.gpu_rows, pass.cpu_rows, pass.gpu_s, pass.cpu_s,
+                   pass.gpu_steals, pass.cpu_steals);
+        if (p > 0) passes.push_back(pass);
+        if (args.adaptive()) split = pass.balancedSplit();
+    }
+
+    int status = BENCH_EXIT_OK;
+    GemmCheck check;
+    if (args.verify) {
+        check = checkGemm(GEMM_FP32, gemm.a(), gemm.b(), gemm.c(), args.m, args.k, args.n);
+        if (!check.ok) status = BENCH_EXIT_VERIFY;
+    }
+    printf("%s\n", heteroSummaryLine(args, passes, args.verify ? &check : nullptr).c_str());
+    return status;
+}
+
+} // namespace gpu_monitor
@@ -0,0 +1,130 @@
+// hetero_gemm.h
+// GEMM split between the CPU and the GPU at the same time, so a run loads both halves
+// of the node and their DVFS settings interact. C is cut into chunks of rows; each
+// device owns a contiguous range of chunks in a RowQueue, takes work from the front
+// of its own range and, once that is empty, steals from the back of the other's, so
+// neither sits idle while work remains. The GPU side is one thread driving a
+// BenchBackend (whole batches of chunks per launch, result rows copied back); the CPU
+// side is a pool of threads computing one chunk at a time.
+//
+// The initial split comes from --split or, by default, adapts: after every pass the
+// GPU's share for the next pass is its measured throughput over the sum of both, so
+// the queues start close to balanced and stealing only corrects the remainder.
+// Any BenchBackend can stand in for the GPU; hetero_gemm_host uses the CPU backend,
+// so the scheduler can be tested without a GPU.
+
+#ifndef HETERO_GEMM_H
+#define HETERO_GEMM_H
+
+#include "bench_backend.h"
+#include "bench_util.h"
+#include "gemm_harness.h"
+#include "gemm_tiles.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace gpu_monitor {
+
+// Chunks [first, first + count) owned by one device. The owner takes from the front
+// and thieves from the back, so the two ends only meet on the last chunks.
+class RowQueue {
+public:
+    RowQueue() : lo_(0), hi_(0) {}
+
+    void reset(int lo, int hi);
+    // Up to max chunks from the front (owner); false when empty.
+    bool take(int max, int* first, int* count);
+    // Up to max chunks, and at most half of those left (rounded up), from the back
+    // (thief); false when empty.
+    bool steal(int max, int* first, int* count);
+
+private:
+    std::mutex mu_;
+    int lo_, hi_;
+};
+
+enum HeteroDevices { HETERO_BOTH, HETERO_CPU_ONLY, HETERO_GPU_ONLY };
+
+struct HeteroArgs {
+    int m = 0, k = 0, n = 0;
+    int passes = 5;                  // --passes=N timed passes (after one warmup pass)
+    int chunk_rows = 64;             // --chunk-rows=N rows of C per chunk
+    int cpu_threads = 0;             // --cpu-threads=N; default hardware threads - 1
+    int gpu_batch = 8;               // --gpu-batch=N chunks per GPU launch
+    double split = -1.0;             // --split=F GPU share of the initial queues; < 0 adapts
+    HeteroDevices devices = HETERO_BOTH;  // --devices=both|cpu|gpu
+    const TileConfig* kernel = nullptr;   // --kernel=NAME (FP32 kernels); default naive
+    unsigned seed = 1;
+    bool verify = false;
+    bool show_passes = false;        // --show-passes: one line per pass before the summary
+
+    int chunks() const { return (m + chunk_rows - 1) / chunk_rows; }
+    bool adaptive() const { return split < 0.0; }
+};
+
+// Parse "M K N [--passes=N] [--chunk-rows=N] [--cpu-threads=N] [--gpu-batch=N]
+// [--split=F|auto] [--devices=both|cpu|gpu] [--kernel=NAME] [--seed=N] [--verify]
+// [--show-passes]" (options may appear anywhere). Returns false with a message.
+bool parseHeteroArgs(int argc, char** argv, HeteroArgs* args, std::string* err);
+
+// What one pass did on each device.
+struct HeteroPass {
+    double split = 0.0;       // GPU share of the chunks queued at the start
+    double time_s = 0.0;      // wall time of the pass
+    int gpu_rows = 0, cpu_rows = 0;
+    double gpu_s = 0.0;       // time from the start of the pass to each device's last chunk
+    double cpu_s = 0.0;
+    int gpu_steals = 0;       // chunks each device took from the other's queue
+    int cpu_steals = 0;
+
+    // Split that would have finished both devices together at the rates measured;
+    // split unchanged if either device did no work.
+    double balancedSplit() const;
+};
+
+// Split C rows between the CPU and the GPU. a (m x k) and b (k x n) live on the host;
+// the session keeps copies on the backend for the GPU side.
+class HeteroGemm {
+public:
+    // backend may be null for --devices=cpu.
+    HeteroGemm(const HeteroArgs& args, BenchBackend* backend);
+    ~HeteroGemm();
+    HeteroGemm(const HeteroGemm&) = delete;
+    HeteroGemm& operator=(const HeteroGemm&) = delete;
+
+    // Generate the inputs and upload them.
+    bool prepare(std::string* err);
+    // One pass over all rows with the GPU's initial share split; C is poisoned first,
+    // so rows no device wrote fail verification.
+    bool run(double split, HeteroPass* pass, std::string* err);
+
+    const std::vector<float>& a() const { return a_; }
+    const std::vector<float>& b() const { return b_; }
+    const std::vector<float>& c() const { return c_; }
+
+private:
+    void cpuWorker(HeteroPass* pass, std::mutex* mu, double t0);
+    bool gpuWorker(HeteroPass* pass, double t0, std::string* err);
+
+    HeteroArgs args_;
+    BenchBackend* backend_;
+    std::vector<float> a_, b_, c_;
+    float *d_a_, *d_b_, *d_c_;
+    RowQueue gpu_queue_, cpu_queue_;
+};
+
+// Summary line:
+// kernel_name=hetero_gemm,problem_size=MxKxN,iterations=PASSES,time_s=..,gflops=..,
+// gpu_kernel=..,cpu_threads=..,chunk_rows=..,split_first=..,split_last=..,gpu_share=..,
+// cpu_share=..,gpu_gflops=..,cpu_gflops=..,steals=..[,verify=pass|fail,max_err=..]
+// (shares are of the rows computed over the timed passes)
+std::string heteroSummaryLine(const HeteroArgs& args, const std::vector<HeteroPass>& passes,
+                              const GemmCheck* check);
+
+int heteroMain(int argc, char** argv, BackendFactory makeBackend);
+
+} // namespace gpu_monitor
+
+#endif // HETERO_GEMM_H
@@ -0,0 +1,8 @@
+// hetero_gemm_host.cpp - hetero_gemm_host: the CPU+GPU split GEMM with the CPU backend
+// (bench_backend_host.cpp) standing in for the GPU, for testing the work-stealing
+// scheduler and the adaptive split without a GPU.
+#include "hetero_gemm.h"
+
+int main(int argc, char** argv) {
+    return gpu_monitor::heteroMain(argc, argv, gpu_monitor::makeHostBackend);
+}
@@ -0,0 +1,12 @@
+// hetero_gemm_main.cu - GEMM split between CPU threads and the CUDA backend of the harness
+// through work-stealing queues, with the split adapting to measured throughput.
+// Scheduler, CPU path and summary line are in hetero_gemm.cpp.
+//
+// Usage: ./hetero_gemm M K N [--passes=N] [--chunk-rows=N] [--cpu-threads=N] [--gpu-batch=N]
+//                      [--split=F|auto] [--devices=both|cpu|gpu] [--kernel=NAME] [--seed=N]
+//                      [--verify] [--show-passes]
+#include "hetero_gemm.h"
+
+int main(int argc, char** argv) {
+    return gpu_monitor::heteroMain(argc, argv, gpu_monitor::makeCudaBackend);
+}
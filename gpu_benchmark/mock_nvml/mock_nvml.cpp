@@ -0,0 +1,838 @@
+// mock_nvml.cpp
+// Scripted NVML implementation used to run gpu_monitor_nvml on machines without an
+// NVIDIA GPU. Readings come from a scenario file named by MOCK_NVML_SCRIPT; without
+// it a single device with constant readings is exposed.
+//
+// Scenario format (one directive per line, '#' starts a comment):
+//   devices <n>                              number of devices (default 1)
+//   device <idx> name=.. uuid=.. pci=..      static device attributes (defaults:
+//                                            "Mock GPU <idx>", GPU-MOCK-<idx>,
+//                                            00000000:<idx+1>:00.0)
+//   at <t_ms> <idx|*> key=value ...          keyframe: values hold until the next one
+//   fail <call> <code> [device=<idx>] [skip=<n>] [count=<n>]
+//                                            make <call> return <code> (name or number)
+//                                            after <skip> calls, for <count> calls
+//   delay <call> <us>                        add latency to every <call>
+//   clocks <idx|*> <mem>:<gr>[,<gr>...]      supported application clock pairs (one
+//                                            line per memory clock, highest first)
+//   proc <t_ms> <idx|*> <pid|@file> key=value ...
+//                                            compute process on the device from t_ms:
+//                                            sm, mem (utilization %), used_mib,
+//                                            running (0 ends it); @file reads the pid
+//                                            from a file when queried (absent = none)
+//
+// Time is measured from nvmlInit(). Keyframe keys: power_mw, gr_mhz, sm_mhz, mem_mhz,
+// video_mhz, util_gpu, util_mem, temp_c, throttle, energy_base_mj. throttle is a
+// reason bitmask (decimal or 0x..) or '|'-separated names: none, gpu_idle,
+// applications_clocks, sw_power_cap, hw_slowdown, sync_boost, sw_thermal, hw_thermal,
+// hw_power_brake, display_clocks; it reads as 0 when unset. Call names: init, count, handle, info, power, energy,
+// clock, util, temp, throttle, supported (supported-clock queries), appclock,
+// setclocks, resetclocks, procs (running processes), procutil (process utilization).
+//
+// Application and locked clocks set through NVML override the scripted gr/sm/mem
+// clock readings until they are reset. If MOCK_NVML_LOG names a file, every clock
+// change is appended to it ("set_app <idx> <mem> <gr>", "reset_app <idx>",
+// "set_locked_gr <idx> <min> <max>", "reset_locked_gr <idx>", "set_locked_mem ...",
+// "reset_locked_mem <idx>") so tests can check that defaults were restored.
+//
+// The total-energy counter is the exact integral of the power_mw step function plus
+// energy_base_mj, so it sees spikes that fall between two monitor samples. Use
+// "fail energy NOT_SUPPORTED" to emulate pre-Volta devices.
+
+#include "nvml.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <strings.h>
+#include <vector>
+
+struct nvmlDevice_st {
+    unsigned int index;
+};
+
+namespace {
+
+struct Keyframe {
+    double t_ms;
+    int device;  // -1 = all devices
+    std::map<std::string, double> values;
+};
+
+struct MockDevice {
+    nvmlDevice_st handle;
+    std::map<std::string, std::string> attrs;
+    std::vector<Keyframe> frames;  // sorted, each holding the merged state at t_ms
+
+    // Supported graphics clocks per memory clock, and clocks set through NVML (0 = none)
+    std::map<unsigned int, std::vector<unsigned int>> supported;
+    unsigned int app_mem = 0, app_gr = 0;
+    unsigned int lock_gr_min = 0, lock_gr_max = 0;
+    unsigned int lock_mem_min = 0, lock_mem_max = 0;
+};
+
+// Per-process keyframe; values hold until the next line for the same device and pid.
+struct ProcFrame {
+    double t_ms;
+    int device;       // -1 = all devices
+    std::string pid;  // number or @file
+    std::map<std::string, double> values;
+};
+
+struct FailRule {
+    std::string call;
+    nvmlReturn_t code;
+    int device;  // -1 = any device
+    unsigned long skip;
+    unsigned long count;  // 0 = unlimited
+    unsigned long seen;
+};
+
+struct MockState {
+    std::mutex mu;
+    bool loaded = false;
+    bool initialized = false;
+    int64_t t0_ns = 0;
+    std::vector<MockDevice> devices;
+    std::vector<FailRule> fails;
+    std::vector<ProcFrame> procs;  // sorted by t_ms
+    std::map<std::string, long> delays_us;
+};
+
+MockState& state() {
+    static MockState s;
+    return s;
+}
+
+int64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+const struct {
+    const char* name;
+    nvmlReturn_t code;
+} kErrorNames[] = {
+    {"SUCCESS", NVML_SUCCESS},
+    {"UNINITIALIZED", NVML_ERROR_UNINITIALIZED},
+    {"INVALID_ARGUMENT", NVML_ERROR_INVALID_ARGUMENT},
+    {"NOT_SUPPORTED", NVML_ERROR_NOT_SUPPORTED},
+    {"NO_PERMISSION", NVML_ERROR_NO_PERMISSION},
+    {"ALREADY_INITIALIZED", NVML_ERROR_ALREADY_INITIALIZED},
+    {"NOT_FOUND", NVML_ERROR_NOT_FOUND},
+    {"INSUFFICIENT_SIZE", NVML_ERROR_INSUFFICIENT_SIZE},
+    {"INSUFFICIENT_POWER", NVML_ERROR_INSUFFICIENT_POWER},
+    {"DRIVER_NOT_LOADED", NVML_ERROR_DRIVER_NOT_LOADED},
+    {"TIMEOUT", NVML_ERROR_TIMEOUT},
+    {"IRQ_ISSUE", NVML_ERROR_IRQ_ISSUE},
+    {"LIBRARY_NOT_FOUND", NVML_ERROR_LIBRARY_NOT_FOUND},
+    {"FUNCTION_NOT_FOUND", NVML_ERROR_FUNCTION_NOT_FOUND},
+    {"CORRUPTED_INFOROM", NVML_ERROR_CORRUPTED_INFOROM},
+    {"GPU_IS_LOST", NVML_ERROR_GPU_IS_LOST},
+    {"RESET_REQUIRED", NVML_ERROR_RESET_REQUIRED},
+    {"OPERATING_SYSTEM", NVML_ERROR_OPERATING_SYSTEM},
+    {"LIB_RM_VERSION_MISMATCH", NVML_ERROR_LIB_RM_VERSION_MISMATCH},
+    {"IN_USE", NVML_ERROR_IN_USE},
+    {"MEMORY", NVML_ERROR_MEMORY},
+    {"NO_DATA", NVML_ERROR_NO_DATA},
+    {"UNKNOWN", NVML_ERROR_UNKNOWN},
+};
+
+const struct {
+    const char* name;
+    unsigned long long mask;
+} kThrottleNames[] = {
+    {"none", nvmlClocksThrottleReasonNone},
+    {"gpu_idle", nvmlClocksThrottleReasonGpuIdle},
+    {"applications_clocks", nvmlClocksThrottleReasonApplicationsClocksSetting},
+    {"sw_power_cap", nvmlClocksThrottleReasonSwPowerCap},
+    {"hw_slowdown", nvmlClocksThrottleReasonHwSlowdown},
+    {"sync_boost", nvmlClocksThrottleReasonSyncBoost},
+    {"sw_thermal", nvmlClocksThrottleReasonSwThermalSlowdown},
+    {"hw_thermal", nvmlClocksThrottleReasonHwThermalSlowdown},
+    {"hw_power_brake", nvmlClocksThrottleReasonHwPowerBrakeSlowdown},
+    {"display_clocks", nvmlClocksThrottleReasonDisplayClockSetting},
+};
+
+// Parses a throttle value: a number, or reason names joined with '|'.
+bool parseThrottle(const std::string& s, double* out) {
+    char* end = nullptr;
+    unsigned long long v = std::strtoull(s.c_str(), &end, 0);
+    if (!s.empty() && end && *end == '\0') {
+        *out = (double)v;
+        return true;
+    }
+    unsigned long long mask = 0;
+    std::stringstream ss(s);
+    std::string name;
+    while (std::getline(ss, name, '|')) {
+        bool found = false;
+        for (const auto& t : kThrottleNames) {
+            if (name == t.name) {
+                mask |= t.mask;
+                found = true;
+            }
+        }
+        if (!found) return false;
+    }
+    *out = (double)mask;
+    return true;
+}
+
+bool parseErrorCode(const std::string& s, nvmlReturn_t* out) {
+    for (const auto& e : kErrorNames) {
+        if (s == e.name || s == std::string("NVML_ERROR_") + e.name || s == std::string("NVML_") + e.name) {
+            *out = e.code;
+            return true;
+        }
+    }
+    char* end = nullptr;
+    long v = std::strtol(s.c_str(), &end, 10);
+    if (end && *end == '\0' && !s.empty()) {
+        *out = (nvmlReturn_t)v;
+        return true;
+    }
+    return false;
+}
+
+void defaultScenario(MockState& st) {
+    st.devices.assign(1, MockDevice());
+    Keyframe kf;
+    kf.t_ms = 0.0;
+    kf.device = 0;
+    kf.values = {{"power_mw", 100000}, {"gr_mhz", 1000}, {"sm_mhz", 1000}, {"mem_mhz", 2000},
+                 {"video_mhz", 900}, {"util_gpu", 50}, {"util_mem", 20}, {"temp_c", 50}};
+    st.devices[0].frames.push_back(kf);
+}
+
+// Parses the scenario into st. Returns false (with a message on stderr) on errors.
+bool loadScenario(MockState& st, const char* path) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "mock_nvml: cannot open scenario " << path << "\n";
+        return false;
+    }
+
+    std::vector<Keyframe> frames;
+    std::map<unsigned int, std::map<std::string, std::string>> attrs;
+    std::vector<std::pair<int, std::pair<unsigned int, std::vector<unsigned int>>>> clock_lines;
+    unsigned int ndev = 1;
+    std::string line;
+    int lineno = 0;
+    while (std::getline(in, line)) {
+        ++lineno;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+        std::istringstream ls(line);
+        std::string kw;
+        if (!(ls >> kw)) continue;
+
+        std::vector<std::string> toks;
+        std::string tok;
+        while (ls >> tok) toks.push_back(tok);
+
+        bool ok = true;
+        if (kw == "devices" && toks.size() == 1) {
+            ndev = (unsigned int)std::strtoul(toks[0].c_str(), nullptr, 10);
+        } else if (kw == "device" && !toks.empty()) {
+            unsigned int idx = (unsigned int)std::strtoul(toks[0].c_str(), nullptr, 10);
+            for (size_t i = 1; i < toks.size() && ok; ++i) {
+                size_t eq = toks[i].find('=');
+                ok = (eq != std::string::npos);
+                if (ok) attrs[idx][toks[i].substr(0, eq)] = toks[i].substr(eq + 1);
+            }
+        } else if (kw == "at" && toks.size() >= 2) {
+            Keyframe kf;
+            kf.t_ms = std::strtod(toks[0].c_str(), nullptr);
+            kf.device = (toks[1] == "*") ? -1 : std::atoi(toks[1].c_str());
+            for (size_t i = 2; i < toks.size() && ok; ++i) {
+                size_t eq = toks[i].find('=');
+                ok = (eq != std::string::npos);
+                if (!ok) break;
+                std::string key = toks[i].substr(0, eq);
+                if (key == "throttle") ok = parseThrottle(toks[i].substr(eq + 1), &kf.values[key]);
+                else kf.values[key] = std::strtod(toks[i].c_str() + eq + 1, nullptr);
+            }
+            frames.push_back(kf);
+        } else if (kw == "fail" && toks.size() >= 2) {
+            FailRule r;
+            r.call = toks[0];
+            r.device = -1;
+            r.skip = 0;
+            r.count = 0;
+            r.seen = 0;
+            ok = parseErrorCode(toks[1], &r.code);
+            for (size_t i = 2; i < toks.size() && ok; ++i) {
+                if (toks[i].compare(0, 7, "device=") == 0) r.device = std::atoi(toks[i].c_str() + 7);
+                else if (toks[i].compare(0, 5, "skip=") == 0) r.skip = std::strtoul(toks[i].c_str() + 5, nullptr, 10);
+                else if (toks[i].compare(0, 6, "count=") == 0) r.count = std::strtoul(toks[i].c_str() + 6, nullptr, 10);
+                else ok = false;
+            }
+            st.fails.push_back(r);
+        } else if (kw == "clocks" && toks.size() == 2) {
+            int dev = (toks[0] == "*") ? -1 : std::atoi(toks[0].c_str());
+            size_t colon = toks[1].find(':');
+            ok = (colon != std::string::npos);
+            if (ok) {
+                unsigned int mem = (unsigned int)std::strtoul(toks[1].c_str(), nullptr, 10);
+                std::vector<unsigned int> grs;
+                std::stringstream gs(toks[1].substr(colon + 1));
+                std::string g;
+                while (std::getline(gs, g, ',')) grs.push_back((unsigned int)std::strtoul(g.c_str(), nullptr, 10));
+                clock_lines.push_back(std::make_pair(dev, std::make_pair(mem, grs)));
+            }
+        } else if (kw == "proc" && toks.size() >= 3) {
+            ProcFrame pf;
+            pf.t_ms = std::strtod(toks[0].c_str(), nullptr);
+            pf.device = (toks[1] == "*") ? -1 : std::atoi(toks[1].c_str());
+            pf.pid = toks[2];
+            for (size_t i = 3; i < toks.size() && ok; ++i) {
+                size_t eq = toks[i].find('=');
+                ok = (eq != std::string::npos);
+                if (ok) pf.values[toks[i].substr(0, eq)] = std::strtod(toks[i].c_str() + eq + 1, nullptr);
+            }
+            st.procs.push_back(pf);
+        } else if (kw == "delay" && toks.size() == 2) {
+            st.delays_us[toks[0]] = std::atol(toks[1].c_str());
+        } else {
+            ok = false;
+        }
+
+        if (!ok) {
+            std::cerr << "mock_nvml: " << path << ":" << lineno << ": cannot parse '" << line << "'\n";
+            return false;
+        }
+    }
+
+    st.devices.assign(ndev, MockDevice());
+    for (auto& a : attrs) {
+        if (a.first < ndev) st.devices[a.first].attrs = a.second;
+    }
+    for (const auto& c : clock_lines) {
+        for (unsigned int d = 0; d < ndev; ++d) {
+            if (c.first == -1 || c.first == (int)d) st.devices[d].supported[c.second.first] = c.second.second;
+        }
+    }
+
+    std::stable_sort(st.procs.begin(), st.procs.end(),
+                     [](const ProcFrame& a, const ProcFrame& b) { return a.t_ms < b.t_ms; });
+    std::stable_sort(frames.begin(), frames.end(),
+                     [](const Keyframe& a, const Keyframe& b) { return a.t_ms < b.t_ms; });
+    for (unsigned int d = 0; d < ndev; ++d) {
+        std::map<std::string, double> merged;
+        std::vector<Keyframe>& out = st.devices[d].frames;
+        for (const auto& kf : frames) {
+            if (kf.device != -1 && kf.device != (int)d) continue;
+            for (const auto& kv : kf.values) merged[kv.first] = kv.second;
+            if (!out.empty() && out.back().t_ms == kf.t_ms) {
+                out.back().values = merged;
+            } else {
+                Keyframe m;
+                m.t_ms = kf.t_ms;
+                m.device = (int)d;
+                m.values = merged;
+                out.push_back(m);
+            }
+        }
+    }
+    return true;
+}
+
+// Applies configured latency and error injection for one call. Must be called with
+// the state lock held; the latency sleep happens while holding it, which also
+// serialises concurrent callers the way a busy driver would.
+nvmlReturn_t intercept(MockState& st, const char* call, int device) {
+    auto d = st.delays_us.find(call);
+    if (d != st.delays_us.end() && d->second > 0) {
+        struct timespec ts;
+        ts.tv_sec = d->second / 1000000;
+        ts.tv_nsec = (d->second % 1000000) * 1000;
+        while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {
+        }
+    }
+    for (auto& r : st.fails) {
+        if (r.call != call) continue;
+        if (r.device != -1 && r.device != device) continue;
+        unsigned long n = r.seen++;
+        if (n >= r.skip && (r.count == 0 || n < r.skip + r.count)) return r.code;
+    }
+    return NVML_SUCCESS;
+}
+
+// Resolves a device handle to its index, or -1 when invalid.
+int deviceIndex(const MockState& st, nvmlDevice_t device) {
+    if (!device) return -1;
+    unsigned int idx = device->index;
+    if (idx >= st.devices.size() || &st.devices[idx].handle != device) return -1;
+    return (int)idx;
+}
+
+// Scripted value of key for device idx at the current time since nvmlInit().
+bool currentValue(const MockState& st, int idx, const char* key, double* out) {
+    const std::vector<Keyframe>& frames = st.devices[idx].frames;
+    double t_ms = (nowNs() - st.t0_ns) / 1e6;
+    auto it = std::upper_bound(frames.begin(), frames.end(), t_ms,
+                               [](double t, const Keyframe& kf) { return t < kf.t_ms; });
+    if (it == frames.begin()) return false;
+    --it;
+    auto v = it->values.find(key);
+    if (v == it->values.end()) return false;
+    *out = v->second;
+    return true;
+}
+
+// Exact integral of the power_mw step trace from nvmlInit() to now, in millijoules.
+bool energySinceInit(const MockState& st, int idx, double* out_mj) {
+    const std::vector<Keyframe>& frames = st.devices[idx].frames;
+    double t_ms = (nowNs() - st.t0_ns) / 1e6;
+    double mj = 0.0;
+    bool have_power = false;
+    for (size_t i = 0; i < frames.size() && frames[i].t_ms < t_ms; ++i) {
+        auto p = frames[i].values.find("power_mw");
+        if (p == frames[i].values.end()) continue;
+        double t_end = (i + 1 < frames.size() && frames[i + 1].t_ms < t_ms) ? frames[i + 1].t_ms : t_ms;
+        double t_begin = frames[i].t_ms > 0.0 ? frames[i].t_ms : 0.0;
+        if (t_end > t_begin) mj += p->second * (t_end - t_begin) / 1000.0;  // mW * ms -> mJ
+        have_power = true;
+    }
+    if (!have_power) return false;
+    double base = 0.0;
+    if (currentValue(st, idx, "energy_base_mj", &base)) mj += base;
+    *out_mj = mj;
+    return true;
+}
+
+struct MockProcess {
+    unsigned int pid;
+    double sm, mem, used_mib;
+};
+
+// Processes running on device idx now, with @file pids resolved.
+std::vector<MockProcess> currentProcesses(const MockState& st, int idx) {
+    double t_ms = (nowNs() - st.t0_ns) / 1e6;
+    std::map<std::string, std::map<std::string, double>> merged;
+    for (const ProcFrame& pf : st.procs) {
+        if (pf.t_ms > t_ms) break;
+        if (pf.device != -1 && pf.device != idx) continue;
+        for (const auto& kv : pf.values) merged[pf.pid][kv.first] = kv.second;
+    }
+    std::vector<MockProcess> out;
+    for (auto& m : merged) {
+        std::map<std::string, double>& v = m.second;
+        if (v.count("running") && v["running"] == 0.0) continue;
+        unsigned long pid = 0;
+        if (m.first[0] == '@') {
+            std::ifstream f(m.first.c_str() + 1);
+            if (!(f >> pid)) continue;
+        } else {
+            pid = std::strtoul(m.first.c_str(), nullptr, 10);
+        }
+        if (pid == 0) continue;
+        out.push_back(MockProcess{(unsigned int)pid, v["sm"], v["mem"], v["used_mib"]});
+    }
+    return out;
+}
+
+// Common prologue for per-device getters: lock, validate, intercept.
+#define MOCK_DEVICE_CALL(call_name, device, ptr)                 \
+    MockState& st = state();                                     \
+    std::lock_guard<std::mutex> lock(st.mu);                     \
+    if (!st.initialized) return NVML_ERROR_UNINITIALIZED;        \
+    int idx = deviceIndex(st, device);                           \
+    if (idx < 0 || !(ptr)) return NVML_ERROR_INVALID_ARGUMENT;   \
+    nvmlReturn_t injected = intercept(st, call_name, idx);       \
+    if (injected != NVML_SUCCESS) return injected
+
+nvmlReturn_t readUInt(const MockState& st, int idx, const char* key, unsigned int* out) {
+    double v = 0.0;
+    if (!currentValue(st, idx, key, &v)) return NVML_ERROR_NOT_SUPPORTED;
+    *out = (unsigned int)(v + 0.5);
+    return NVML_SUCCESS;
+}
+
+// Clock reading for key after applying NVML-set application/locked clocks.
+nvmlReturn_t readClock(const MockState& st, int idx, const char* key, unsigned int* out) {
+    const MockDevice& d = st.devices[idx];
+    bool mem = std::strcmp(key, "mem_mhz") == 0;
+    bool core = std::strcmp(key, "gr_mhz") == 0 || std::strcmp(key, "sm_mhz") == 0;
+    unsigned int v = 0;
+    nvmlReturn_t r = readUInt(st, idx, key, &v);
+    if (core && d.app_gr) v = d.app_gr, r = NVML_SUCCESS;
+    if (mem && d.app_mem) v = d.app_mem, r = NVML_SUCCESS;
+    if (core && d.lock_gr_max) v = std::min(std::max(v, d.lock_gr_min), d.lock_gr_max), r = NVML_SUCCESS;
+    if (mem && d.lock_mem_max) v = std::min(std::max(v, d.lock_mem_min), d.lock_mem_max), r = NVML_SUCCESS;
+    if (r == NVML_SUCCESS) *out = v;
+    return r;
+}
+
+bool isSupportedPair(const MockDevice& d, unsigned int mem, unsigned int gr) {
+    auto m = d.supported.find(mem);
+    return m != d.supported.end() && std::find(m->second.begin(), m->second.end(), gr) != m->second.end();
+}
+
+// Appends one line to MOCK_NVML_LOG, if set.
+void logClockEvent(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+void logClockEvent(const char* fmt, ...) {
+    const char* path = std::getenv("MOCK_NVML_LOG");
+    if (!path || !*path) return;
+    FILE* f = std::fopen(path, "a");
+    if (!f) return;
+    va_list ap;
+    va_start(ap, fmt);
+    std::vfprintf(f, fmt, ap);
+    va_end(ap);
+    std::fputc('\n', f);
+    std::fclose(f);
+}
+
+// Copies values into the caller's array following NVML's size protocol.
+nvmlReturn_t copyClockList(const std::vector<unsigned int>& values, unsigned int* count, unsigned int* out) {
+    unsigned int capacity = *count;
+    *count = (unsigned int)values.size();
+    if (capacity < values.size()) return NVML_ERROR_INSUFFICIENT_SIZE;
+    std::copy(values.begin(), values.end(), out);
+    return NVML_SUCCESS;
+}
+
+} // namespace
+
+extern "C" {
+
+nvmlReturn_t nvmlInit(void) {
+    MockState& st = state();
+    std::lock_guard<std::mutex> lock(st.mu);
+    // The scenario is loaded once per process so fail-rule counters survive
+    // nvmlShutdown()/nvmlInit() cycles.
+    if (!st.loaded) {
+        const char* path = std::getenv("MOCK_NVML_SCRIPT");
+        if (path && *path) {
+            if (!loadScenario(st, path)) return NVML_ERROR_UNKNOWN;
+        } else {
+            defaultScenario(st);
+        }
+        for (size_t i = 0; i < st.devices.size(); ++i) {
+            MockDevice& d = st.devices[i];
+            char buf[64];
+            d.handle.index = (unsigned int)i;
+            std::snprintf(buf, sizeof(buf), "Mock GPU %zu", i);
+            d.attrs.insert(std::make_pair(std::string("name"), std::string(buf)));
+            std::snprintf(buf, sizeof(buf), "GPU-MOCK-%04zu", i);
+            d.attrs.insert(std::make_pair(std::string("uuid"), std::string(buf)));
+            std::snprintf(buf, sizeof(buf), "00000000:%02zX:00.0", i + 1);
+            d.attrs.insert(std::make_pair(std::string("pci"), std::string(buf)));
+        }
+        st.loaded = true;
+    }
+    nvmlReturn_t injected = intercept(st, "init", -1);
+    if (injected != NVML_SUCCESS) return injected;
+
+    if (!st.initialized) st.t0_ns = nowNs();
+    st.initialized = true;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlShutdown(void) {
+    MockState& st = state();
+    std::lock_guard<std::mutex> lock(st.mu);
+    if (!st.initialized) return NVML_ERROR_UNINITIALIZED;
+    st.initialized = false;
+    return NVML_SUCCESS;
+}
+
+const char* nvmlErrorString(nvmlReturn_t result) {
+    switch (result) {
+    case NVML_SUCCESS: return "Success";
+    case NVML_ERROR_UNINITIALIZED: return "Uninitialized";
+    case NVML_ERROR_INVALID_ARGUMENT: return "Invalid Argument";
+    case NVML_ERROR_NOT_SUPPORTED: return "Not Supported";
+    case NVML_ERROR_NO_PERMISSION: return "Insufficient Permissions";
+    case NVML_ERROR_NOT_FOUND: return "Not Found";
+    case NVML_ERROR_DRIVER_NOT_LOADED: return "Driver Not Loaded";
+    case NVML_ERROR_TIMEOUT: return "Timeout";
+    case NVML_ERROR_GPU_IS_LOST: return "GPU is lost";
+    default: break;
+    }
+    for (const auto& e : kErrorNames) {
+        if (e.code == result) return e.name;
+    }
+    return "Unknown Error";
+}
+
+nvmlReturn_t nvmlDeviceGetCount(unsigned int* deviceCount) {
+    MockState& st = state();
+    std::lock_guard<std::mutex> lock(st.mu);
+    if (!st.initialized) return NVML_ERROR_UNINITIALIZED;
+    if (!deviceCount) return NVML_ERROR_INVALID_ARGUMENT;
+    nvmlReturn_t injected = intercept(st, "count", -1);
+    if (injected != NVML_SUCCESS) return injected;
+    *deviceCount = (unsigned int)st.devices.size();
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetHandleByIndex(unsigned int index, nvmlDevice_t* device) {
+    MockState& st = state();
+    std::lock_guard<std::mutex> lock(st.mu);
+    if (!st.initialized) return NVML_ERROR_UNINITIALIZED;
+    if (!device || index >= st.devices.size()) return NVML_ERROR_INVALID_ARGUMENT;
+    nvmlReturn_t injected = intercept(st, "handle", (int)index);
+    if (injected != NVML_SUCCESS) return injected;
+    *device = &st.devices[index].handle;
+    return NVML_SUCCESS;
+}
+
+// Looks up a device by a static attribute (uuid, pci); PCI ids compare case-insensitively.
+static nvmlReturn_t handleByAttr(const char* attr, const char* value, nvmlDevice_t* device) {
+    MockState& st = state();
+    std::lock_guard<std::mutex> lock(st.mu);
+    if (!st.initialized) return NVML_ERROR_UNINITIALIZED;
+    if (!value || !device) return NVML_ERROR_INVALID_ARGUMENT;
+    for (size_t i = 0; i < st.devices.size(); ++i) {
+        auto a = st.devices[i].attrs.find(attr);
+        if (a == st.devices[i].attrs.end() || strcasecmp(a->second.c_str(), value) != 0) continue;
+        nvmlReturn_t injected = intercept(st, "handle", (int)i);
+        if (injected != NVML_SUCCESS) return injected;
+        *device = &st.devices[i].handle;
+        return NVML_SUCCESS;
+    }
+    return NVML_ERROR_NOT_FOUND;
+}
+
+nvmlReturn_t nvmlDeviceGetHandleByUUID(const char* uuid, nvmlDevice_t* device) {
+    return handleByAttr("uuid", uuid, device);
+}
+
+nvmlReturn_t nvmlDeviceGetHandleByPciBusId(const char* pciBusId, nvmlDevice_t* device) {
+    return handleByAttr("pci", pciBusId, device);
+}
+
+nvmlReturn_t nvmlDeviceGetIndex(nvmlDevice_t device, unsigned int* index) {
+    MOCK_DEVICE_CALL("info", device, index);
+    *index = (unsigned int)idx;
+    return NVML_SUCCESS;
+}
+
+static nvmlReturn_t copyAttr(const MockState& st, int idx, const char* attr, char* buf, unsigned int length) {
+    const std::string& v = st.devices[idx].attrs.at(attr);
+    if (v.size() + 1 > length) return NVML_ERROR_INSUFFICIENT_SIZE;
+    std::memcpy(buf, v.c_str(), v.size() + 1);
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetName(nvmlDevice_t device, char* name, unsigned int length) {
+    MOCK_DEVICE_CALL("info", device, name);
+    return copyAttr(st, idx, "name", name, length);
+}
+
+nvmlReturn_t nvmlDeviceGetUUID(nvmlDevice_t device, char* uuid, unsigned int length) {
+    MOCK_DEVICE_CALL("info", device, uuid);
+    return copyAttr(st, idx, "uuid", uuid, length);
+}
+
+nvmlReturn_t nvmlDeviceGetPciInfo(nvmlDevice_t device, nvmlPciInfo_t* pci) {
+    MOCK_DEVICE_CALL("info", device, pci);
+    std::memset(pci, 0, sizeof(*pci));
+    const std::string& id = st.devices[idx].attrs.at("pci");
+    std::snprintf(pci->busId, sizeof(pci->busId), "%s", id.c_str());
+    std::snprintf(pci->busIdLegacy, sizeof(pci->busIdLegacy), "%s", id.c_str());
+    std::sscanf(id.c_str(), "%x:%x:%x", &pci->domain, &pci->bus, &pci->device);
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetPowerUsage(nvmlDevice_t device, unsigned int* power) {
+    MOCK_DEVICE_CALL("power", device, power);
+    return readUInt(st, idx, "power_mw", power);
+}
+
+nvmlReturn_t nvmlDeviceGetTotalEnergyConsumption(nvmlDevice_t device, unsigned long long* energy) {
+    MOCK_DEVICE_CALL("energy", device, energy);
+    double mj = 0.0;
+    if (!energySinceInit(st, idx, &mj)) return NVML_ERROR_NOT_SUPPORTED;
+    *energy = (unsigned long long)mj;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetClockInfo(nvmlDevice_t device, nvmlClockType_t type, unsigned int* clock) {
+    MOCK_DEVICE_CALL("clock", device, clock);
+    switch (type) {
+    case NVML_CLOCK_GRAPHICS: return readClock(st, idx, "gr_mhz", clock);
+    case NVML_CLOCK_SM: return readClock(st, idx, "sm_mhz", clock);
+    case NVML_CLOCK_MEM: return readClock(st, idx, "mem_mhz", clock);
+    case NVML_CLOCK_VIDEO: return readUInt(st, idx, "video_mhz", clock);
+    }
+    return NVML_ERROR_INVALID_ARGUMENT;
+}
+
+nvmlReturn_t nvmlDeviceGetUtilizationRates(nvmlDevice_t device, nvmlUtilization_t* utilization) {
+    MOCK_DEVICE_CALL("util", device, utilization);
+    nvmlReturn_t r = readUInt(st, idx, "util_gpu", &utilization->gpu);
+    if (r != NVML_SUCCESS) return r;
+    if (readUInt(st, idx, "util_mem", &utilization->memory) != NVML_SUCCESS) utilization->memory = 0;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetTemperature(nvmlDevice_t device, nvmlTemperatureSensors_t sensorType,
+                                      unsigned int* temp) {
+    MOCK_DEVICE_CALL("temp", device, temp);
+    if (sensorType != NVML_TEMPERATURE_GPU) return NVML_ERROR_INVALID_ARGUMENT;
+    return readUInt(st, idx, "temp_c", temp);
+}
+
+nvmlReturn_t nvmlDeviceGetCurrentClocksThrottleReasons(nvmlDevice_t device,
+                                                       unsigned long long* clocksThrottleReasons) {
+    MOCK_DEVICE_CALL("throttle", device, clocksThrottleReasons);
+    double v = 0.0;
+    *clocksThrottleReasons = currentValue(st, idx, "throttle", &v) ? (unsigned long long)v : 0ULL;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetSupportedMemoryClocks(nvmlDevice_t device, unsigned int* count,
+                                                unsigned int* clocksMHz) {
+    MOCK_DEVICE_CALL("supported", device, count);
+    const MockDevice& d = st.devices[idx];
+    if (d.supported.empty()) return NVML_ERROR_NOT_SUPPORTED;
+    std::vector<unsigned int> mems;
+    for (auto it = d.supported.rbegin(); it != d.supported.rend(); ++it) mems.push_back(it->first);
+    if (*count && !clocksMHz) return NVML_ERROR_INVALID_ARGUMENT;
+    return copyClockList(mems, count, clocksMHz);
+}
+
+nvmlReturn_t nvmlDeviceGetSupportedGraphicsClocks(nvmlDevice_t device, unsigned int memoryClockMHz,
+                                                  unsigned int* count, unsigned int* clocksMHz) {
+    MOCK_DEVICE_CALL("supported", device, count);
+    const MockDevice& d = st.devices[idx];
+    if (d.supported.empty()) return NVML_ERROR_NOT_SUPPORTED;
+    auto m = d.supported.find(memoryClockMHz);
+    if (m == d.supported.end()) return NVML_ERROR_NOT_FOUND;
+    if (*count && !clocksMHz) return NVML_ERROR_INVALID_ARGUMENT;
+    return copyClockList(m->second, count, clocksMHz);
+}
+
+nvmlReturn_t nvmlDeviceGetApplicationsClock(nvmlDevice_t device, nvmlClockType_t clockType,
+                                            unsigned int* clockMHz) {
+    MOCK_DEVICE_CALL("appclock", device, clockMHz);
+    const MockDevice& d = st.devices[idx];
+    if (d.supported.empty()) return NVML_ERROR_NOT_SUPPORTED;
+    // Default application clocks: the highest supported pair
+    unsigned int mem = d.app_mem ? d.app_mem : d.supported.rbegin()->first;
+    unsigned int gr = d.app_gr;
+    if (!gr) {
+        const std::vector<unsigned int>& grs = d.supported.rbegin()->second;
+        gr = grs.empty() ? 0 : *std::max_element(grs.begin(), grs.end());
+    }
+    switch (clockType) {
+    case NVML_CLOCK_GRAPHICS:
+    case NVML_CLOCK_SM: *clockMHz = gr; return NVML_SUCCESS;
+    case NVML_CLOCK_MEM: *clockMHz = mem; return NVML_SUCCESS;
+    default: return NVML_ERROR_INVALID_ARGUMENT;
+    }
+}
+
+nvmlReturn_t nvmlDeviceSetApplicationsClocks(nvmlDevice_t device, unsigned int memClockMHz,
+                                             unsigned int graphicsClockMHz) {
+    MOCK_DEVICE_CALL("setclocks", device, device);
+    MockDevice& d = st.devices[idx];
+    if (d.supported.empty()) return NVML_ERROR_NOT_SUPPORTED;
+    if (!isSupportedPair(d, memClockMHz, graphicsClockMHz)) return NVML_ERROR_INVALID_ARGUMENT;
+    d.app_mem = memClockMHz;
+    d.app_gr = graphicsClockMHz;
+    logClockEvent("set_app %d %u %u", idx, memClockMHz, graphicsClockMHz);
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceResetApplicationsClocks(nvmlDevice_t device) {
+    MOCK_DEVICE_CALL("resetclocks", device, device);
+    MockDevice& d = st.devices[idx];
+    d.app_mem = d.app_gr = 0;
+    logClockEvent("reset_app %d", idx);
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceSetGpuLockedClocks(nvmlDevice_t device, unsigned int minGpuClockMHz,
+                                          unsigned int maxGpuClockMHz) {
+    MOCK_DEVICE_CALL("setclocks", device, device);
+    MockDevice& d = st.devices[idx];
+    if (minGpuClockMHz > maxGpuClockMHz || maxGpuClockMHz == 0) return NVML_ERROR_INVALID_ARGUMENT;
+    d.lock_gr_min = minGpuClockMHz;
+    d.lock_gr_max = maxGpuClockMHz;
+    logClockEvent("set_locked_gr %d %u %u", idx, minGpuClockMHz, maxGpuClockMHz);
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceResetGpuLockedClocks(nvmlDevice_t device) {
+    MOCK_DEVICE_CALL("resetclocks", device, device);
+    MockDevice& d = st.devices[idx];
+    d.lock_gr_min = d.lock_gr_max = 0;
+    logClockEvent("reset_locked_gr %d", idx);
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceSetMemoryLockedClocks(nvmlDevice_t device, unsigned int minMemClockMHz,
+                                             unsigned int maxMemClockMHz) {
+    MOCK_DEVICE_CALL("setclocks", device, device);
+    MockDevice& d = st.devices[idx];
+    if (minMemClockMHz > maxMemClockMHz || maxMemClockMHz == 0) return NVML_ERROR_INVALID_ARGUMENT;
+    d.lock_mem_min = minMemClockMHz;
+    d.lock_mem_max = maxMemClockMHz;
+    logClockEvent("set_locked_mem %d %u %u", idx, minMemClockMHz, maxMemClockMHz);
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceResetMemoryLockedClocks(nvmlDevice_t device) {
+    MOCK_DEVICE_CALL("resetclocks", device, device);
+    MockDevice& d = st.devices[idx];
+    d.lock_mem_min = d.lock_mem_max = 0;
+    logClockEvent("reset_locked_mem %d", idx);
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetComputeRunningProcesses(nvmlDevice_t device, unsigned int* infoCount,
+                                                  nvmlProcessInfo_t* infos) {
+    MOCK_DEVICE_CALL("procs", device, infoCount);
+    std::vector<MockProcess> procs = currentProcesses(st, idx);
+    unsigned int capacity = infos ? *infoCount : 0;
+    *infoCount = (unsigned int)procs.size();
+    if (capacity < procs.size()) return NVML_ERROR_INSUFFICIENT_SIZE;
+    for (size_t i = 0; i < procs.size(); ++i) {
+        infos[i].pid = procs[i].pid;
+        infos[i].usedGpuMemory = (unsigned long long)(procs[i].used_mib * 1024 * 1024);
+        infos[i].gpuInstanceId = infos[i].computeInstanceId = 0xFFFFFFFF;
+    }
+    return NVML_SUCCESS;
+}
+
+// Every process gets one sample stamped with the current wall-clock time; nothing
+// newer than lastSeenTimeStamp means NOT_FOUND, as with the real driver.
+nvmlReturn_t nvmlDeviceGetProcessUtilization(nvmlDevice_t device, nvmlProcessUtilizationSample_t* utilization,
+                                             unsigned int* processSamplesCount,
+                                             unsigned long long lastSeenTimeStamp) {
+    MOCK_DEVICE_CALL("procutil", device, processSamplesCount);
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    unsigned long long now_us = (unsigned long long)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+    std::vector<MockProcess> procs = currentProcesses(st, idx);
+    if (procs.empty() || now_us <= lastSeenTimeStamp) return NVML_ERROR_NOT_FOUND;
+    unsigned int capacity = utilization ? *processSamplesCount : 0;
+    *processSamplesCount = (unsigned int)procs.size();
+    if (capacity < procs.size()) return NVML_ERROR_INSUFFICIENT_SIZE;
+    for (size_t i = 0; i < procs.size(); ++i) {
+        utilization[i].pid = procs[i].pid;
+        utilization[i].timeStamp = now_us;
+        utilization[i].smUtil = (unsigned int)procs[i].sm;
+        utilization[i].memUtil = (unsigned int)procs[i].mem;
+        utilization[i].encUtil = utilization[i].decUtil = 0;
+    }
+    return NVML_SUCCESS;
+}
+
+} // extern "C"
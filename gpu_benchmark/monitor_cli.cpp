@@ -0,0 +1,68 @@
+// monitor_cli.cpp
+#include "monitor_cli.h"
+
+#include <sys/wait.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+
+namespace gpu_monitor {
+
+int parseOptions(int argc, char** argv, const std::vector<std::string>& flags, const OptionHandler& handler) {
+    int i = 1;
+    for (; i < argc && std::strncmp(argv[i], "--", 2) == 0; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--") return i + 1;
+        std::string key = arg, val;
+        size_t eq = arg.find('=');
+        bool flag = std::find(flags.begin(), flags.end(), arg.substr(0, eq)) != flags.end();
+        if (flag) {
+            if (eq != std::string::npos) {
+                std::cerr << arg.substr(0, eq) << " takes no value\n";
+                return -1;
+            }
+        } else if (eq != std::string::npos) {
+            key = arg.substr(0, eq);
+            val = arg.substr(eq + 1);
+        } else if (i + 1 < argc) {
+            val = argv[++i];
+        } else {
+            std::cerr << "Missing value for " << arg << "\n";
+            return -1;
+        }
+
+        OptionResult r = handler(key, val);
+        if (r == OptionResult::UNKNOWN) std::cerr << "Unknown option: " << key << "\n";
+        if (r != OptionResult::OK) return -1;
+    }
+    return i;
+}
+
+bool writeReportFile(const std::string& path, const std::function<void(std::ostream&)>& write) {
+    std::string tmp_path = path + ".tmp";
+    std::ofstream ofs(tmp_path.c_str(), std::ios::out | std::ios::trunc);
+    if (!ofs) return false;
+    write(ofs);
+    ofs.close();
+    if (!ofs) return false;
+    return std::rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+std::string isoTimestamp() {
+    std::time_t now_t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    char buf[64];
+    std::strftime(buf, sizeof(buf), "%FT%T%z", std::localtime(&now_t));
+    return buf;
+}
+
+int childExitCode(int status) {
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return 0;
+}
+
+} // namespace gpu_monitor
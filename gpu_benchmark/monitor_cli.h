@@ -0,0 +1,39 @@
+// monitor_cli.h
+// Command-line and report plumbing shared by gpu_monitor_nvml and node_monitor: the
+// leading --option loop, the key=value report written through a temporary file, its
+// timestamp, and the child's wait status as the monitor's exit code.
+
+#ifndef MONITOR_CLI_H
+#define MONITOR_CLI_H
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace gpu_monitor {
+
+enum class OptionResult { OK, INVALID, UNKNOWN };
+
+// Called once per option with its key ("--devices") and value; INVALID after printing
+// why, UNKNOWN for a key the monitor does not take.
+typedef std::function<OptionResult(const std::string& key, const std::string& val)> OptionHandler;
+
+// Parses the leading --options of argv, given as --key=value or --key value, or as a
+// bare --key for those in flags (handled with an empty value); "--" ends them. Returns
+// the index of the first positional argument, or -1 after printing the error.
+int parseOptions(int argc, char** argv, const std::vector<std::string>& flags, const OptionHandler& handler);
+
+// Writes path through path.tmp and rename(), so readers (and a crash mid-write) never
+// see a truncated report. Returns false if it cannot be written.
+bool writeReportFile(const std::string& path, const std::function<void(std::ostream&)>& write);
+
+// Local time as ISO 8601 (2024-05-01T12:00:00+0200), for the report's timestamp line.
+std::string isoTimestamp();
+
+// Child wait status as the monitor's exit code (128+signal for signals).
+int childExitCode(int status);
+
+} // namespace gpu_monitor
+
+#endif // MONITOR_CLI_H
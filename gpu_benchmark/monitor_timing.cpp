@@ -0,0 +1,94 @@
+// monitor_timing.cpp - deadline timer and trapezoidal integration for gpu_monitor_nvml
+#include "monitor_timing.h"
+
+#include <poll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+namespace gpu_monitor {
+
+static const int64_t NS_PER_S = 1000000000LL;
+
+int64_t monotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * NS_PER_S + ts.tv_nsec;
+}
+
+double monotonicSeconds() {
+    return monotonicNs() / 1e9;
+}
+
+DeadlineTimer::DeadlineTimer(int64_t period_ns)
+    : fd_(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)), create_errno_(fd_ < 0 ? errno : 0),
+      period_ns_(period_ns > 0 ? period_ns : 1), next_ns_(0), missed_(0) {}
+
+DeadlineTimer::~DeadlineTimer() {
+    if (fd_ >= 0) close(fd_);
+}
+
+static struct timespec toTimespec(int64_t ns) {
+    struct timespec ts;
+    ts.tv_sec = ns / NS_PER_S;
+    ts.tv_nsec = ns % NS_PER_S;
+    return ts;
+}
+
+bool DeadlineTimer::start(std::string* err) {
+    if (fd_ < 0) {
+        *err = std::string("timerfd_create: ") + std::strerror(create_errno_);
+        return false;
+    }
+    next_ns_ = monotonicNs() + period_ns_;
+    missed_ = 0;
+    struct itimerspec its;
+    its.it_value = toTimespec(next_ns_);
+    its.it_interval = toTimespec(period_ns_);
+    if (timerfd_settime(fd_, TFD_TIMER_ABSTIME, &its, nullptr) != 0) {
+        *err = std::string("timerfd_settime: ") + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+void DeadlineTimer::waitNext() {
+    struct pollfd pfd = {fd_, POLLIN, 0};
+    while (poll(&pfd, 1, -1) < 0 && errno == EINTR) {
+        // absolute deadline: simply retry after a signal
+    }
+    acknowledge();
+}
+
+void DeadlineTimer::acknowledge() {
+    uint64_t expirations = 0;
+    if (read(fd_, &expirations, sizeof(expirations)) != (ssize_t)sizeof(expirations)) return;
+    // Every expiration beyond the first is a deadline the caller overran
+    missed_ += expirations - 1;
+    next_ns_ += (int64_t)expirations * period_ns_;
+}
+
+TrapezoidIntegrator::TrapezoidIntegrator()
+    : count_(0), first_t_(0.0), last_t_(0.0), last_v_(0.0), integral_(0.0) {}
+
+void TrapezoidIntegrator::add(double t_s, double value) {
+    if (count_ == 0) {
+        first_t_ = t_s;
+    } else {
+        double dt = t_s - last_t_;
+        if (dt > 0.0) integral_ += 0.5 * (value + last_v_) * dt;
+    }
+    last_t_ = t_s;
+    last_v_ = value;
+    ++count_;
+}
+
+double TrapezoidIntegrator::mean() const {
+    double s = span();
+    if (s > 0.0) return integral_ / s;
+    return count_ > 0 ? last_v_ : 0.0;
+}
+
+} // namespace gpu_monitor
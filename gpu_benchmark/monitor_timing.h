@@ -0,0 +1,78 @@
+// monitor_timing.h
+// Timing helpers for gpu_monitor_nvml: an absolute-deadline periodic timer and a
+// trapezoidal integrator over real sample timestamps. No NVML dependency, so the
+// sampling schedule can be exercised without a GPU.
+
+#ifndef MONITOR_TIMING_H
+#define MONITOR_TIMING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace gpu_monitor {
+
+// Current CLOCK_MONOTONIC time in nanoseconds / seconds.
+int64_t monotonicNs();
+double monotonicSeconds();
+
+// Periodic timer driven by absolute deadlines (a CLOCK_MONOTONIC timerfd armed with
+// TFD_TIMER_ABSTIME), so query latency does not accumulate into the period. When the
+// caller overruns one or more deadlines the extra expirations are counted as missed
+// and the timer fires once, instead of firing a catch-up burst. fd() can be put in a
+// poll set alongside other events (see ChildSupervisor).
+class DeadlineTimer {
+public:
+    explicit DeadlineTimer(int64_t period_ns);
+    ~DeadlineTimer();
+    DeadlineTimer(const DeadlineTimer&) = delete;
+    DeadlineTimer& operator=(const DeadlineTimer&) = delete;
+
+    // Anchor the schedule: first deadline is now + period. Returns false with the
+    // reason in *err if the timerfd could not be created or armed; without it poll()
+    // would skip the fd and no deadline would ever fire.
+    bool start(std::string* err);
+
+    // Block until the next deadline.
+    void waitNext();
+
+    // Readable once a deadline has passed; call acknowledge() after poll reports it.
+    int fd() const { return fd_; }
+    void acknowledge();
+
+    int64_t periodNs() const { return period_ns_; }
+    int64_t nextDeadlineNs() const { return next_ns_; }
+    uint64_t missed() const { return missed_; }
+
+private:
+    int fd_;
+    int create_errno_;  // errno of a failed timerfd_create, else 0
+    int64_t period_ns_;
+    int64_t next_ns_;
+    uint64_t missed_;
+};
+
+// Integrates a piecewise-linear signal sampled at arbitrary timestamps.
+class TrapezoidIntegrator {
+public:
+    TrapezoidIntegrator();
+
+    void add(double t_s, double value);
+
+    double integral() const { return integral_; }
+    double span() const { return count_ > 1 ? last_t_ - first_t_ : 0.0; }
+    // Time-weighted mean; falls back to the single value when span is zero.
+    double mean() const;
+    size_t count() const { return count_; }
+
+private:
+    size_t count_;
+    double first_t_;
+    double last_t_;
+    double last_v_;
+    double integral_;
+};
+
+} // namespace gpu_monitor
+
+#endif // MONITOR_TIMING_H
@@ -0,0 +1,272 @@
+// node_monitor.cpp
+// Whole-node energy monitor: launches a child process (the benchmark) and samples the
+// CPU RAPL domains and the GPUs in one loop on a shared CLOCK_MONOTONIC timeline, then
+// reports total node energy, the per-component breakdown, and the combined
+// energy-delay products EDP (E*t) and ED2P (E*t^2) of the run. Each half is an
+// EnergySource that is only used when present: RAPL when the powercap interface is
+// readable, NVML when the binary was built with it and a device is found. On a
+// machine with neither the run is still timed and the report says sources=none.
+// The command is supervised as in gpu_monitor_nvml (ChildSupervisor): immediate exit
+// detection, signal forwarding and the child's resource usage in the report.
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "child_supervisor.h"
+#include "energy_source.h"
+#include "monitor_cli.h"
+#include "monitor_timing.h"
+#include "rapl_source.h"
+#include "streaming_stats.h"
+#ifdef NODE_MONITOR_HAVE_NVML
+#include "nvml_source.h"
+#endif
+
+using gpu_monitor::ChildSupervisor;
+using gpu_monitor::ComponentKind;
+using gpu_monitor::DeadlineTimer;
+using gpu_monitor::EnergyComponent;
+using gpu_monitor::EnergySource;
+using gpu_monitor::MetricStats;
+using gpu_monitor::OptionResult;
+
+// auto: use the source when available; on: fail if it is not; off: never use it.
+enum class SourceMode { AUTO, ON, OFF };
+
+struct NodeOptions {
+    SourceMode cpu = SourceMode::AUTO;
+    SourceMode gpu = SourceMode::AUTO;
+    std::string rapl_root = "/sys/class/powercap";
+    std::string devices = "all";
+};
+
+static void usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " [options] <sample_ms> <output_file> <command> [args...]\n"
+              << "Options:\n"
+              << "  --cpu=MODE       auto (default), rapl (required) or none\n"
+              << "  --gpu=MODE       auto (default), nvml (required) or none\n"
+              << "  --rapl-root=DIR  powercap directory (default /sys/class/powercap)\n"
+              << "  --devices=LIST   comma-separated NVML indices, UUIDs or PCI bus ids (default: all)\n";
+}
+
+static bool parseSourceMode(const std::string& val, const char* on_name, SourceMode* out) {
+    if (val == "auto") {
+        *out = SourceMode::AUTO;
+    } else if (val == on_name) {
+        *out = SourceMode::ON;
+    } else if (val == "none") {
+        *out = SourceMode::OFF;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Parses leading --options; returns the index of the first positional argument or -1.
+static int parseOptions(int argc, char** argv, NodeOptions* opts) {
+    return gpu_monitor::parseOptions(argc, argv, {}, [opts](const std::string& key, const std::string& val) {
+        if (key == "--cpu") {
+            if (!parseSourceMode(val, "rapl", &opts->cpu)) {
+                std::cerr << "--cpu must be auto, rapl or none\n";
+                return OptionResult::INVALID;
+            }
+        } else if (key == "--gpu") {
+            if (!parseSourceMode(val, "nvml", &opts->gpu)) {
+                std::cerr << "--gpu must be auto, nvml or none\n";
+                return OptionResult::INVALID;
+            }
+        } else if (key == "--rapl-root") {
+            opts->rapl_root = val;
+        } else if (key == "--devices") {
+            opts->devices = val;
+        } else {
+            return OptionResult::UNKNOWN;
+        }
+        return OptionResult::OK;
+    });
+}
+
+// Opens the sources selected by opts. Returns false if a required one is missing.
+static bool openSources(const NodeOptions& opts, std::vector<std::unique_ptr<EnergySource>>* out) {
+    std::string err;
+    if (opts.cpu != SourceMode::OFF) {
+        std::unique_ptr<EnergySource> rapl = gpu_monitor::RaplSource::open(opts.rapl_root, &err);
+        if (rapl) {
+            out->push_back(std::move(rapl));
+        } else if (opts.cpu == SourceMode::ON) {
+            std::cerr << "RAPL unavailable: " << err << "\n";
+            return false;
+        }
+    }
+    if (opts.gpu != SourceMode::OFF) {
+#ifdef NODE_MONITOR_HAVE_NVML
+        std::unique_ptr<EnergySource> nvml = gpu_monitor::NvmlSource::open(opts.devices, &err);
+        if (nvml) {
+            out->push_back(std::move(nvml));
+        } else if (opts.gpu == SourceMode::ON) {
+            std::cerr << "NVML unavailable: " << err << "\n";
+            return false;
+        }
+#else
+        if (opts.gpu == SourceMode::ON) {
+            std::cerr << "NVML unavailable: built without NVML support\n";
+            return false;
+        }
+#endif
+    }
+    return true;
+}
+
+// Everything the key=value report is built from.
+struct NodeReport {
+    int sample_ms;
+    const std::vector<std::unique_ptr<EnergySource>>* sources;
+    const MetricStats* node_power_w;
+    const ChildSupervisor* child;
+    uint64_t samples;
+    uint64_t missed_deadlines;
+    double duration_s;
+};
+
+static const char* kindName(ComponentKind k) {
+    return k == ComponentKind::GPU ? "gpu" : "cpu";
+}
+
+static double sharePct(double part, double total) {
+    return total > 0.0 ? part / total * 100.0 : 0.0;
+}
+
+// Writes the report as key=value lines.
+static void writeReport(std::ostream& ofs, const NodeReport& in) {
+    // Node total counts each joule once: see EnergyComponent::in_total
+    double energy_kind_j[2] = {0.0, 0.0};
+    size_t ncomp = 0;
+    std::string names;
+    for (const auto& src : *in.sources) {
+        names += (names.empty() ? "" : ",") + std::string(src->name());
+        const std::vector<EnergyComponent>& comps = src->components();
+        for (size_t i = 0; i < comps.size(); ++i) {
+            if (comps[i].in_total) energy_kind_j[comps[i].kind == ComponentKind::GPU] += src->energyJ(i);
+        }
+        ncomp += comps.size();
+    }
+    double energy_j = energy_kind_j[0] + energy_kind_j[1];
+    double t = in.duration_s;
+
+    ofs << "timestamp=" << gpu_monitor::isoTimestamp() << "\n";
+    ofs << "status=complete\n";
+    ofs << "sources=" << (names.empty() ? "none" : names) << "\n";
+    ofs << std::fixed << std::setprecision(3);
+    ofs << "samples=" << in.samples << "\n";
+    ofs << "sample_period_ms=" << in.sample_ms << "\n";
+    ofs << "missed_deadlines=" << in.missed_deadlines << "\n";
+    ofs << "duration_s=" << t << "\n";
+    ofs << "energy_total_j=" << energy_j << "\n";
+    ofs << "energy_cpu_j=" << energy_kind_j[0] << "\n";
+    ofs << "energy_gpu_j=" << energy_kind_j[1] << "\n";
+    ofs << "energy_cpu_pct=" << sharePct(energy_kind_j[0], energy_j) << "\n";
+    ofs << "energy_gpu_pct=" << sharePct(energy_kind_j[1], energy_j) << "\n";
+    ofs << "power_avg_w=" << (t > 0.0 ? energy_j / t : 0.0) << "\n";
+    ofs << "power_w.min=" << in.node_power_w->stats().min() << "\n";
+    ofs << "power_w.max=" << in.node_power_w->stats().max() << "\n";
+    ofs << "power_w.p50=" << in.node_power_w->p50() << "\n";
+    ofs << "power_w.p95=" << in.node_power_w->p95() << "\n";
+    ofs << "power_w.p99=" << in.node_power_w->p99() << "\n";
+    // Energy-delay products of the whole node (J*s, J*s^2)
+    ofs << std::scientific << std::setprecision(6);
+    ofs << "edp=" << energy_j * t << "\n";
+    ofs << "ed2p=" << energy_j * t * t << "\n";
+    ofs << std::fixed << std::setprecision(3);
+
+    gpu_monitor::writeChildUsage(ofs, in.child->usage());
+    if (in.child->signalReceived())
+        ofs << "forwarded_signal=" << in.child->signalReceived() << "\n";
+
+    // Per-component breakdown: component.<name>.<metric>=value
+    ofs << "components=" << ncomp << "\n";
+    for (const auto& src : *in.sources) {
+        const std::vector<EnergyComponent>& comps = src->components();
+        for (size_t i = 0; i < comps.size(); ++i) {
+            std::string p = "component." + comps[i].name + ".";
+            double e = src->energyJ(i);
+            ofs << p << "kind=" << kindName(comps[i].kind) << "\n";
+            ofs << p << "source=" << src->name() << "\n";
+            ofs << p << "in_total=" << (comps[i].in_total ? 1 : 0) << "\n";
+            ofs << p << "energy_j=" << e << "\n";
+            ofs << p << "energy_method=" << src->method(i) << "\n";
+            ofs << p << "energy_pct=" << (comps[i].in_total ? sharePct(e, energy_j) : 0.0) << "\n";
+            ofs << p << "power_avg_w=" << (t > 0.0 ? e / t : 0.0) << "\n";
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    NodeOptions opts;
+    int first = parseOptions(argc, argv, &opts);
+    if (first < 0 || argc - first < 3) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    int sample_ms = std::atoi(argv[first]);
+    std::string out_file = argv[first + 1];
+    if (sample_ms <= 0) {
+        std::cerr << "sample_ms must be a positive integer\n";
+        return 2;
+    }
+    char** cmd = &argv[first + 2];
+
+    // Sources come up before the command starts so their baselines precede it
+    std::vector<std::unique_ptr<EnergySource>> sources;
+    if (!openSources(opts, &sources)) return 4;
+
+    double t_start = gpu_monitor::monotonicSeconds();
+    for (auto& src : sources) src->sample(t_start, false);
+
+    ChildSupervisor sup;
+    if (sup.start(cmd) == -1) return 3;
+
+    // Node power of each interval: sum over the components counted in the total
+    MetricStats node_power_w;
+    uint64_t samples = 1;
+    DeadlineTimer timer((int64_t)sample_ms * 1000000LL);
+    std::string timer_err;
+    if (!timer.start(&timer_err)) {
+        std::cerr << "Sampling timer failed: " << timer_err << "\n";
+        sup.wait(nullptr);
+        return 8;
+    }
+    while (true) {
+        bool child_done = sup.wait(&timer) == ChildSupervisor::EXITED;
+
+        double power_w = 0.0;
+        for (auto& src : sources) {
+            src->sample(t_start, child_done);
+            const std::vector<EnergyComponent>& comps = src->components();
+            for (size_t i = 0; i < comps.size(); ++i)
+                if (comps[i].in_total) power_w += src->powerW(i);
+        }
+        if (!sources.empty()) node_power_w.add(power_w);
+        ++samples;
+
+        if (child_done) break;
+    }
+
+    NodeReport report;
+    report.sample_ms = sample_ms;
+    report.sources = &sources;
+    report.node_power_w = &node_power_w;
+    report.child = &sup;
+    report.samples = samples;
+    report.missed_deadlines = timer.missed();
+    report.duration_s = gpu_monitor::monotonicSeconds() - t_start;
+    if (!gpu_monitor::writeReportFile(out_file, [&report](std::ostream& os) { writeReport(os, report); })) {
+        std::cerr << "Failed to open output file: " << out_file << "\n";
+        return 6;
+    }
+    return gpu_monitor::childExitCode(sup.status());
+}
@@ -0,0 +1,56 @@
+// nvml_source.cpp - NVML devices as node_monitor energy components
+#include "nvml_source.h"
+
+namespace gpu_monitor {
+
+NvmlSource::NvmlSource() : started_(false) {}
+
+NvmlSource::~NvmlSource() {
+    nvmlShutdown();
+}
+
+std::unique_ptr<NvmlSource> NvmlSource::open(const std::string& devices, std::string* err) {
+    nvmlReturn_t ret = nvmlInit();
+    if (ret != NVML_SUCCESS) {
+        *err = std::string("NVML init failed: ") + nvmlErrorString(ret);
+        return nullptr;
+    }
+    // From here on the destructor owns the NVML session
+    std::unique_ptr<NvmlSource> src(new NvmlSource());
+    ret = selectDevices(devices, &src->devs_, err);
+    if (ret != NVML_SUCCESS) {
+        *err = "NVML get device failed: " + *err;
+        return nullptr;
+    }
+    if (src->devs_.size() == 0) {
+        *err = "no NVML devices";
+        return nullptr;
+    }
+
+    size_t n = src->devs_.size();
+    for (size_t d = 0; d < n; ++d)
+        src->components_.push_back(EnergyComponent{"gpu" + std::to_string(src->devs_.index[d]), ComponentKind::GPU, true});
+    src->pass_.resize(n);
+    src->counters_.init(n);
+    src->energy_.resize(n);
+    src->power_w_.assign(n, 0.0);
+    return src;
+}
+
+void NvmlSource::sample(double t_origin, bool last) {
+    samplePass(devs_, t_origin, &pass_);
+    for (size_t d = 0; d < devs_.size(); ++d) {
+        if (!pass_.power_ok[d]) continue;  // the integrator bridges the failed read
+        energy_[d].add(pass_.dev_t_s[d], pass_.power_w[d]);
+        power_w_[d] = pass_.power_w[d];
+    }
+    // Hardware counters bracket the run: read on the first and last sample only
+    if (!started_ || last) counters_.read(devs_, !started_);
+    started_ = true;
+}
+
+double NvmlSource::energyJ(size_t i) const {
+    return counters_.valid(i) ? counters_.joules(i) : energy_[i].integral();
+}
+
+} // namespace gpu_monitor
@@ -0,0 +1,49 @@
+// nvml_source.h
+// GPU half of node_monitor: the selected NVML devices, one component per device
+// ("gpu<idx>"). Energy comes from the hardware total-energy counter where the device
+// has one and from trapezoidal integration of the sampled power otherwise, as in
+// gpu_monitor_nvml.
+
+#ifndef NVML_SOURCE_H
+#define NVML_SOURCE_H
+
+#include "energy_source.h"
+#include "gpu_devices.h"
+#include "monitor_timing.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gpu_monitor {
+
+class NvmlSource : public EnergySource {
+public:
+    ~NvmlSource();  // shuts NVML down
+
+    // Initializes NVML and selects devices (see selectDevices). Returns null and
+    // fills *err on failure, including when no device is found.
+    static std::unique_ptr<NvmlSource> open(const std::string& devices, std::string* err);
+
+    const char* name() const { return "nvml"; }
+    void sample(double t_origin, bool last);
+    double energyJ(size_t i) const;
+    double powerW(size_t i) const { return power_w_[i]; }
+    const char* method(size_t i) const { return counters_.valid(i) ? "hw_counter" : "trapezoid"; }
+
+    const DeviceSet& devices() const { return devs_; }
+
+private:
+    NvmlSource();
+
+    DeviceSet devs_;
+    PassSample pass_;
+    EnergyCounters counters_;
+    std::vector<TrapezoidIntegrator> energy_;  // valid power reads only
+    std::vector<double> power_w_;              // last valid power read
+    bool started_;
+};
+
+} // namespace gpu_monitor
+
+#endif // NVML_SOURCE_H
@@ -0,0 +1,229 @@
+// pipeline.cpp - Scheduler, arguments, reference check and front end of the copy/compute pipeline benchmark
+#include "pipeline.h"
+#include "pipeline_ops.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace gpu_monitor {
+
+namespace {
+
+const long long kMaxSizeMb = 1 << 16;  // 64 GiB
+const int kMaxDepth = 32;
+
+struct Slots {
+    PipelineDevice& dev;
+    std::vector<void*> ptrs;
+    explicit Slots(PipelineDevice& d) : dev(d) {}
+    ~Slots() {
+        for (void* p : ptrs) dev.freeDevice(p);
+    }
+};
+
+// Queue one pass: chunk i goes through slot and stream i % streams, so stream order
+// keeps a slot from being reused before its previous chunk has been copied out.
+bool queuePass(PipelineDevice& dev, const PipelineArgs& args, int streams, const Slots& slots,
+               const float* in, float* out, std::string* err) {
+    const char* src = reinterpret_cast<const char*>(in);
+    char* dst = reinterpret_cast<char*>(out);
+    for (size_t i = 0; i < args.chunks(); ++i) {
+        int s = static_cast<int>(i % streams);
+        size_t off = i * args.chunk_bytes;
+        size_t bytes = std::min(args.chunk_bytes, args.total_bytes - off);
+        float* slot = static_cast<float*>(slots.ptrs[s]);
+        if (!dev.copyIn(s, slot, src + off, bytes, args.pinned, err) ||
+            !dev.compute(s, slot, bytes / sizeof(float), args.intensity, err) ||
+            !dev.copyOut(s, dst + off, slot, bytes, args.pinned, err))
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool parsePipelineArgs(int argc, char** argv, PipelineArgs* args, std::string* err) {
+    std::vector<const char*> positional;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        int v = 0;
+        bool matched = false;
+        if (!takeIntegerOption(arg, "--chunk-kb", 1, 1 << 20, &v, &matched, err)) return false;
+        if (matched) {
+            args->chunk_bytes = static_cast<size_t>(v) << 10;
+            continue;
+        }
+        if (!takeIntegerOption(arg, "--depth", 1, kMaxDepth, &v, &matched, err)) return false;
+        if (matched) {
+            args->depth = v;
+            continue;
+        }
+        if (!takeIntegerOption(arg, "--intensity", 1, 1 << 16, &v, &matched, err)) return false;
+        if (matched) {
+            args->intensity = v;
+            continue;
+        }
+        if (!takeIntegerOption(arg, "--passes", 1, 1 << 20, &v, &matched, err)) return false;
+        if (matched) {
+            args->passes = v;
+            continue;
+        }
+        if (strncmp(arg, "--host=", 7) == 0) {
+            if (strcmp(arg + 7, "pinned") == 0) {
+                args->pinned = true;
+            } else if (strcmp(arg + 7, "pageable") == 0) {
+                args->pinned = false;
+            } else {
+                *err = std::string("invalid --host (pinned or pageable): ") + (arg + 7);
+                return false;
+            }
+        } else if (strcmp(arg, "--verify") == 0) {
+            args->verify = true;
+        } else if (strncmp(arg, "--", 2) == 0) {
+            *err = std::string("unknown option: ") + arg;
+            return false;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.size() != 1) {
+        *err = "expected SIZE_MB";
+        return false;
+    }
+    long long mb = 0;
+    if (!parseInteger(positional[0], 1LL, kMaxSizeMb, &mb)) {
+        *err = std::string("invalid SIZE_MB: ") + positional[0];
+        return false;
+    }
+    args->total_bytes = static_cast<size_t>(mb) << 20;
+    return true;
+}
+
+double PipelineTiming::overlap(int passes) const {
+    double pass = passes > 0 ? time_s / passes : 0.0;
+    double serial = serialPass();
+    double slowest = std::max(h2d_s, std::max(kernel_s, d2h_s));
+    if (pass <= 0.0 || serial <= slowest) return 0.0;
+    return std::min(1.0, std::max(0.0, (serial - pass) / (serial - slowest)));
+}
+
+bool runPipeline(PipelineDevice& dev, const PipelineArgs& args, const float* in, float* out,
+                 PipelineTiming* timing, std::string* err) {
+    // one slot and stream per chunk in flight; no more than there are chunks
+    int streams = args.streams();
+    if (!dev.setup(streams, err)) return false;
+    Slots slots(dev);
+    for (int s = 0; s < streams; ++s) {
+        void* p = nullptr;
+        if (!dev.allocDevice(args.chunk_bytes, &p, err)) return false;
+        slots.ptrs.push_back(p);
+    }
+
+    // Stages alone: every chunk through one stage on stream 0 before the next stage.
+    // Only the times matter; the results are overwritten by the pipelined passes.
+    const char* src = reinterpret_cast<const char*>(in);
+    char* dst = reinterpret_cast<char*>(out);
+    float* slot = static_cast<float*>(slots.ptrs[0]);
+    double* stage_s[3] = {&timing->h2d_s, &timing->kernel_s, &timing->d2h_s};
+    for (int stage = 0; stage < 3; ++stage) {
+        if (!dev.begin(err)) return false;
+        for (size_t i = 0; i < args.chunks(); ++i) {
+            size_t off = i * args.chunk_bytes;
+            size_t bytes = std::min(args.chunk_bytes, args.total_bytes - off);
+            bool ok = stage == 0   ? dev.copyIn(0, slot, src + off, bytes, args.pinned, err)
+                      : stage == 1 ? dev.compute(0, slot, bytes / sizeof(float), args.intensity, err)
+                                   : dev.copyOut(0, dst + off, slot, bytes, args.pinned, err);
+            if (!ok) return false;
+        }
+        if (!dev.end(stage_s[stage], err)) return false;
+    }
+
+    // one untimed pass (first-touch of the host pages, clocks ramping up), then the run
+    double warm = 0.0;
+    if (!dev.begin(err) || !queuePass(dev, args, streams, slots, in, out, err) || !dev.end(&warm, err))
+        return false;
+    if (!dev.begin(err)) return false;
+    for (int p = 0; p < args.passes; ++p)
+        if (!queuePass(dev, args, streams, slots, in, out, err)) return false;
+    return dev.end(&timing->time_s, err);
+}
+
+PipelineCheck checkPipeline(const PipelineArgs& args, const float* in, const float* out) {
+    PipelineCheck check;
+    // same fmaf chain on both sides: only a broken schedule makes them differ
+    check.tolerance = FLT_EPSILON;
+    size_t count = args.total_bytes / sizeof(float);
+    for (size_t i = 0; i < count; ++i) {
+        double ref = pipelineOp(in[i], args.intensity);
+        double err = std::fabs(out[i] - ref) / std::max(1.0, std::fabs(ref));
+        trackMaxError(err, &check.max_err);
+    }
+    check.ok = check.max_err <= check.tolerance;
+    return check;
+}
+
+std::string pipelineSummaryLine(const PipelineArgs& args, const PipelineTiming& t,
+                                const PipelineCheck* check) {
+    double gbps = t.time_s > 0.0 ? static_cast<double>(args.total_bytes) * args.passes / t.time_s / 1e9 : 0.0;
+    char buf[512];
+    int len = snprintf(buf, sizeof(buf),
+                       "kernel_name=pipeline,problem_size=%zu,chunk_bytes=%zu,depth=%d,streams=%d,host=%s,"
+                       "iterations=%d,time_s=%.9f,h2d_s=%.9f,kernel_s=%.9f,d2h_s=%.9f,overlap=%.3f,"
+                       "throughput_gbps=%.3f",
+                       args.total_bytes, args.chunk_bytes, args.depth, args.streams(), args.pinned ? "pinned" : "pageable",
+                       args.passes, t.time_s, t.h2d_s, t.kernel_s, t.d2h_s, t.overlap(args.passes), gbps);
+    if (check && len > 0 && static_cast<size_t>(len) < sizeof(buf))
+        snprintf(buf + len, sizeof(buf) - len, ",verify=%s,max_err=%.3e",
+                 check->ok ? "pass" : "fail", check->max_err);
+    return buf;
+}
+
+int pipelineMain(int argc, char** argv, PipelineDeviceFactory makeDevice) {
+    PipelineArgs args;
+    std::string err;
+    if (!parsePipelineArgs(argc, argv, &args, &err)) {
+        fprintf(stderr, "%s: %s\n", argv[0], err.c_str());
+        fprintf(stderr, "Usage: %s SIZE_MB [--chunk-kb=N] [--depth=N] [--host=pinned|pageable]\n"
+                        "       [--intensity=N] [--passes=N] [--verify]\n", argv[0]);
+        return BENCH_EXIT_USAGE;
+    }
+
+    std::unique_ptr<PipelineDevice> dev = makeDevice(&err);
+    if (!dev) {
+        fprintf(stderr, "%s: %s\n", argv[0], err.c_str());
+        return BENCH_EXIT_BACKEND;
+    }
+    void *in = nullptr, *out = nullptr;
+    if (!dev->allocHost(args.total_bytes, args.pinned, &in, &err) ||
+        !dev->allocHost(args.total_bytes, args.pinned, &out, &err)) {
+        fprintf(stderr, "%s: %s\n", argv[0], err.c_str());
+        if (in) dev->freeHost(in, args.pinned);
+        return BENCH_EXIT_BACKEND;
+    }
+    float* fin = static_cast<float*>(in);
+    size_t count = args.total_bytes / sizeof(float);
+    for (size_t i = 0; i < count; ++i) fin[i] = static_cast<float>(i % 1024) / 1024.0f;
+
+    int status = BENCH_EXIT_OK;
+    PipelineTiming timing;
+    if (!runPipeline(*dev, args, fin, static_cast<float*>(out), &timing, &err)) {
+        fprintf(stderr, "%s: %s\n", argv[0], err.c_str());
+        status = BENCH_EXIT_BACKEND;
+    } else {
+        PipelineCheck check;
+        if (args.verify) {
+            check = checkPipeline(args, fin, static_cast<const float*>(out));
+            if (!check.ok) status = BENCH_EXIT_VERIFY;
+        }
+        printf("%s\n", pipelineSummaryLine(args, timing, args.verify ? &check : nullptr).c_str());
+    }
+    dev->freeHost(in, args.pinned);
+    dev->freeHost(out, args.pinned);
+    return status;
+}
+
+} // namespace gpu_monitor
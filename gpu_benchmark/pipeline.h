@@ -0,0 +1,115 @@
+// pipeline.h
+// Overlapped copy/compute pipeline benchmark. The input is streamed through the
+// device in chunks: each chunk is copied host-to-device, transformed by a kernel and
+// copied back, with up to `depth` chunks in flight on as many streams, so the copies
+// of one chunk overlap the kernel of another when the hardware allows it. Pinned
+// versus pageable host buffers and the chunk size decide how much does.
+//
+// The scheduler only talks to a PipelineDevice: the CUDA one (pipeline_cuda.cu) or a
+// simulated device (pipeline_sim.cpp) that models copy engines, compute and stream
+// ordering on a virtual clock while doing the data movement on the host, so the
+// schedule, overlap accounting and correctness can be tested without a GPU.
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "bench_util.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gpu_monitor {
+
+class PipelineDevice {
+public:
+    virtual ~PipelineDevice() {}
+
+    virtual const char* name() const = 0;  // "cuda", "sim"
+
+    // Create the streams (indices 0 .. streams-1) used by the queueing calls.
+    virtual bool setup(int streams, std::string* err) = 0;
+
+    virtual bool allocHost(size_t bytes, bool pinned, void** ptr, std::string* err) = 0;
+    virtual void freeHost(void* ptr, bool pinned) = 0;
+    virtual bool allocDevice(size_t bytes, void** ptr, std::string* err) = 0;
+    virtual void freeDevice(void* ptr) = 0;
+
+    // Queue work on a stream. pinned says how the host side of a copy was allocated;
+    // a pageable copy may block the caller until it completes.
+    virtual bool copyIn(int stream, void* dst, const void* src, size_t bytes, bool pinned,
+                        std::string* err) = 0;
+    virtual bool compute(int stream, float* data, size_t count, int intensity, std::string* err) = 0;
+    virtual bool copyOut(int stream, void* dst, const void* src, size_t bytes, bool pinned,
+                         std::string* err) = 0;
+
+    // Timestamp before the work queued next, and after all work queued so far (waits
+    // for it); *seconds is the time between the two.
+    virtual bool begin(std::string* err) = 0;
+    virtual bool end(double* seconds, std::string* err) = 0;
+};
+
+typedef std::unique_ptr<PipelineDevice> (*PipelineDeviceFactory)(std::string* err);
+
+// Simulated device (pipeline_sim.cpp): never fails.
+std::unique_ptr<PipelineDevice> makeSimPipelineDevice(std::string* err);
+// CUDA device (pipeline_cuda.cu); nullptr with a message if there is none.
+std::unique_ptr<PipelineDevice> makeCudaPipelineDevice(std::string* err);
+
+struct PipelineArgs {
+    size_t total_bytes = 0;           // streamed per pass (multiple of 4)
+    size_t chunk_bytes = 4u << 20;    // --chunk-kb=N (multiple of 4 KiB), default 4 MiB
+    int depth = 3;                    // --depth=N: streams / chunks in flight
+    bool pinned = true;               // --host=pinned|pageable
+    int intensity = 32;               // --intensity=N: FMAs per element in the kernel
+    int passes = 10;                  // --passes=N over the data in the timed run
+    bool verify = false;
+
+    size_t chunks() const { return (total_bytes + chunk_bytes - 1) / chunk_bytes; }
+    // Streams the scheduler actually runs: no more than there are chunks
+    int streams() const { return chunks() < static_cast<size_t>(depth) ? static_cast<int>(chunks()) : depth; }
+};
+
+// Parse "SIZE_MB [--chunk-kb=N] [--depth=N] [--host=pinned|pageable] [--intensity=N]
+// [--passes=N] [--verify]" (options may appear anywhere). Returns false with a message.
+bool parsePipelineArgs(int argc, char** argv, PipelineArgs* args, std::string* err);
+
+struct PipelineTiming {
+    double time_s = 0.0;   // all passes, pipelined
+    // One pass with each stage run alone on one stream (no overlap possible)
+    double h2d_s = 0.0;
+    double kernel_s = 0.0;
+    double d2h_s = 0.0;
+
+    double serialPass() const { return h2d_s + kernel_s + d2h_s; }
+    // Share of the achievable overlap obtained: 0 when a pass takes as long as its
+    // stages back to back, 1 when it takes as long as its slowest stage.
+    double overlap(int passes) const;
+};
+
+// Measure the stages alone, then stream args.passes passes of in through the device
+// into out with args.depth chunks in flight. in and out are host buffers of
+// args.total_bytes allocated by the device with args.pinned.
+bool runPipeline(PipelineDevice& dev, const PipelineArgs& args, const float* in, float* out,
+                 PipelineTiming* timing, std::string* err);
+
+struct PipelineCheck {
+    double max_err = 0.0;  // max |out - ref| / max(1, |ref|)
+    double tolerance = 0.0;
+    bool ok = true;
+};
+
+PipelineCheck checkPipeline(const PipelineArgs& args, const float* in, const float* out);
+
+// kernel_name=pipeline,problem_size=BYTES,chunk_bytes=..,depth=..,streams=..,
+// host=pinned|pageable,iterations=PASSES,time_s=..,h2d_s=..,kernel_s=..,d2h_s=..,overlap=..,throughput_gbps=..
+// [,verify=pass|fail,max_err=..]   (stage times are per pass; throughput counts input bytes)
+std::string pipelineSummaryLine(const PipelineArgs& args, const PipelineTiming& t,
+                                const PipelineCheck* check);
+
+int pipelineMain(int argc, char** argv, PipelineDeviceFactory makeDevice);
+
+} // namespace gpu_monitor
+
+#endif // PIPELINE_H
@@ -0,0 +1,10 @@
+// pipeline_benchmark.cu - Copy/compute pipeline benchmark on the CUDA device.
+// Scheduler, arguments and summary line are in pipeline.cpp, the device in pipeline_cuda.cu.
+//
+// Usage: ./pipeline_benchmark SIZE_MB [--chunk-kb=N] [--depth=N] [--host=pinned|pageable]
+//                             [--intensity=N] [--passes=N] [--verify]
+#include "pipeline.h"
+
+int main(int argc, char** argv) {
+    return gpu_monitor::pipelineMain(argc, argv, gpu_monitor::makeCudaPipelineDevice);
+}
@@ -0,0 +1,115 @@
+// pipeline_cuda.cu - CUDA device of the copy/compute pipeline benchmark
+//
+// Streams are ordinary blocking streams and the timing events go to the legacy
+// default stream, which orders itself with all of them: the start event precedes
+// everything queued after it and the stop event follows everything queued before.
+// Copies are always cudaMemcpyAsync; on pageable memory the driver stages them
+// through its own pinned buffer and returns only when the host side is consumed,
+// which is the behaviour the benchmark compares against pinned buffers.
+#include "bench_util.h"
+#include "pipeline.h"
+#include "pipeline_ops.h"
+
+#include <cuda_runtime.h>
+
+#include <cstdlib>
+#include <vector>
+
+namespace gpu_monitor {
+
+namespace {
+
+__global__ void pipeline_kernel(float* data, size_t count, int intensity) {
+    size_t stride = static_cast<size_t>(blockDim.x) * gridDim.x;
+    for (size_t i = static_cast<size_t>(blockIdx.x) * blockDim.x + threadIdx.x; i < count; i += stride)
+        data[i] = pipelineOp(data[i], intensity);
+}
+
+class CudaPipelineDevice : public PipelineDevice {
+public:
+    explicit CudaPipelineDevice(const cudaDeviceProp& prop) : num_sm_(prop.multiProcessorCount) {
+        cudaEventCreate(&start_);
+        cudaEventCreate(&stop_);
+    }
+    ~CudaPipelineDevice() override {
+        for (cudaStream_t s : streams_) cudaStreamDestroy(s);
+        cudaEventDestroy(start_);
+        cudaEventDestroy(stop_);
+    }
+
+    const char* name() const override { return "cuda"; }
+
+    bool setup(int streams, std::string* err) override {
+        for (int i = 0; i < streams; ++i) {
+            cudaStream_t s;
+            if (!cudaCheck(cudaStreamCreate(&s), "cudaStreamCreate", err)) return false;
+            streams_.push_back(s);
+        }
+        return true;
+    }
+
+    bool allocHost(size_t bytes, bool pinned, void** ptr, std::string* err) override {
+        if (pinned) return cudaCheck(cudaMallocHost(ptr, bytes), "cudaMallocHost", err);
+        *ptr = malloc(bytes ? bytes : 1);
+        if (!*ptr) *err = "out of memory";
+        return *ptr != nullptr;
+    }
+    void freeHost(void* ptr, bool pinned) override {
+        if (pinned)
+            cudaFreeHost(ptr);
+        else
+            free(ptr);
+    }
+    bool allocDevice(size_t bytes, void** ptr, std::string* err) override {
+        return cudaCheck(cudaMalloc(ptr, bytes), "cudaMalloc", err);
+    }
+    void freeDevice(void* ptr) override { cudaFree(ptr); }
+
+    bool copyIn(int stream, void* dst, const void* src, size_t bytes, bool, std::string* err) override {
+        return cudaCheck(cudaMemcpyAsync(dst, src, bytes, cudaMemcpyHostToDevice, streams_[stream]),
+                         "cudaMemcpyAsync", err);
+    }
+    bool compute(int stream, float* data, size_t count, int intensity, std::string* err) override {
+        // a few blocks per SM; the grid-stride loop covers the rest of the chunk
+        pipeline_kernel<<<num_sm_ * 8, 256, 0, streams_[stream]>>>(data, count, intensity);
+        return cudaCheck(cudaGetLastError(), "launch", err);
+    }
+    bool copyOut(int stream, void* dst, const void* src, size_t bytes, bool, std::string* err) override {
+        return cudaCheck(cudaMemcpyAsync(dst, src, bytes, cudaMemcpyDeviceToHost, streams_[stream]),
+                         "cudaMemcpyAsync", err);
+    }
+
+    bool begin(std::string* err) override { return cudaCheck(cudaEventRecord(start_, 0), "cudaEventRecord", err); }
+    bool end(double* seconds, std::string* err) override {
+        if (!cudaCheck(cudaEventRecord(stop_, 0), "cudaEventRecord", err) ||
+            !cudaCheck(cudaEventSynchronize(stop_), "cudaEventSynchronize", err))
+            return false;
+        float ms = 0.0f;
+        cudaEventElapsedTime(&ms, start_, stop_);
+        *seconds = ms / 1000.0;
+        return true;
+    }
+
+private:
+    int num_sm_;
+    std::vector<cudaStream_t> streams_;
+    cudaEvent_t start_, stop_;
+};
+
+} // namespace
+
+std::unique_ptr<PipelineDevice> makeCudaPipelineDevice(std::string* err) {
+    int count = 0, device = 0;
+    cudaDeviceProp prop;
+    if (!cudaCheck(cudaGetDeviceCount(&count), "cudaGetDeviceCount", err)) return nullptr;
+    if (count == 0) {
+        *err = "no CUDA device";
+        return nullptr;
+    }
+    if (!cudaCheck(cudaGetDevice(&device), "cudaGetDevice", err) ||
+        !cudaCheck(cudaGetDeviceProperties(&prop, device), "cudaGetDeviceProperties", err))
+        return nullptr;
+    return std::unique_ptr<PipelineDevice>(new CudaPipelineDevice(prop));
+}
+
+} // namespace gpu_monitor
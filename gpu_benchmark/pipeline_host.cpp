@@ -0,0 +1,8 @@
+// pipeline_host.cpp - pipeline_host: the copy/compute pipeline benchmark on the simulated
+// device (pipeline_sim.cpp), for testing the scheduler without a GPU. Its times are
+// those of the device model, not measurements.
+#include "pipeline.h"
+
+int main(int argc, char** argv) {
+    return gpu_monitor::pipelineMain(argc, argv, gpu_monitor::makeSimPipelineDevice);
+}
@@ -0,0 +1,27 @@
+// pipeline_ops.h
+// Per-element transform of the pipeline kernel, shared by the CUDA kernel, the
+// simulated device and the --verify reference. An explicit fmaf chain rounds the same
+// way on both sides, so results compare exactly.
+
+#ifndef PIPELINE_OPS_H
+#define PIPELINE_OPS_H
+
+#include <cmath>
+
+#ifdef __CUDACC__
+#define PIPELINE_HD __host__ __device__ __forceinline__
+#else
+#define PIPELINE_HD inline
+#endif
+
+namespace gpu_monitor {
+
+// intensity fused multiply-adds; contracts towards 1, so values stay in [0, 1].
+PIPELINE_HD float pipelineOp(float x, int intensity) {
+    for (int r = 0; r < intensity; ++r) x = fmaf(x, 0.999f, 0.001f);
+    return x;
+}
+
+} // namespace gpu_monitor
+
+#endif // PIPELINE_OPS_H
@@ -0,0 +1,99 @@
+// pipeline_sim.cpp - Simulated device for the copy/compute pipeline benchmark
+//
+// Work is executed immediately on the host (so --verify checks the schedule's data
+// movement) and timed on a virtual clock modelled on a Tesla M2075 over PCIe 2.0:
+// two copy engines (host-to-device and device-to-host run concurrently with each
+// other and with kernels), one compute engine, every engine serving its work in issue
+// order, every stream in order. Each queueing call costs the host a few microseconds;
+// a pageable copy additionally blocks the host until it completes, as the staged copy
+// of the CUDA driver does, which is what keeps pageable transfers from overlapping.
+#include "pipeline.h"
+#include "pipeline_ops.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace gpu_monitor {
+
+namespace {
+
+const double kIssueSeconds = 5e-6;     // host cost of one queueing call
+const double kPinnedBytesPerS = 6e9;
+const double kPageableBytesPerS = 3e9;
+const double kFmaPerS = 100e9;         // sustained FMAs per second of the kernel
+
+enum Engine { ENGINE_H2D, ENGINE_COMPUTE, ENGINE_D2H, ENGINE_COUNT };
+
+class SimDevice : public PipelineDevice {
+public:
+    SimDevice() : host_(0.0), origin_(0.0) { std::fill(engine_, engine_ + ENGINE_COUNT, 0.0); }
+
+    const char* name() const override { return "sim"; }
+
+    bool setup(int streams, std::string*) override {
+        stream_.assign(streams, 0.0);
+        return true;
+    }
+
+    bool allocHost(size_t bytes, bool, void** ptr, std::string* err) override {
+        *ptr = malloc(bytes ? bytes : 1);
+        if (!*ptr) *err = "out of memory";
+        return *ptr != nullptr;
+    }
+    void freeHost(void* ptr, bool) override { free(ptr); }
+    bool allocDevice(size_t bytes, void** ptr, std::string* err) override { return allocHost(bytes, false, ptr, err); }
+    void freeDevice(void* ptr) override { free(ptr); }
+
+    bool copyIn(int stream, void* dst, const void* src, size_t bytes, bool pinned, std::string*) override {
+        memcpy(dst, src, bytes);
+        queue(stream, ENGINE_H2D, bytes / (pinned ? kPinnedBytesPerS : kPageableBytesPerS), !pinned);
+        return true;
+    }
+    bool compute(int stream, float* data, size_t count, int intensity, std::string*) override {
+        for (size_t i = 0; i < count; ++i) data[i] = pipelineOp(data[i], intensity);
+        queue(stream, ENGINE_COMPUTE, static_cast<double>(count) * intensity / kFmaPerS, false);
+        return true;
+    }
+    bool copyOut(int stream, void* dst, const void* src, size_t bytes, bool pinned, std::string*) override {
+        memcpy(dst, src, bytes);
+        queue(stream, ENGINE_D2H, bytes / (pinned ? kPinnedBytesPerS : kPageableBytesPerS), !pinned);
+        return true;
+    }
+
+    bool begin(std::string*) override {
+        origin_ = host_;
+        return true;
+    }
+    bool end(double* seconds, std::string*) override {
+        // the host waits for every stream to drain
+        for (double t : stream_) host_ = std::max(host_, t);
+        *seconds = host_ - origin_;
+        return true;
+    }
+
+private:
+    // The op starts once issued, its stream is free and its engine has finished the
+    // work issued before it.
+    void queue(int stream, Engine engine, double seconds, bool blocks_host) {
+        host_ += kIssueSeconds;
+        double start = std::max(host_, std::max(stream_[stream], engine_[engine]));
+        double finish = start + seconds;
+        stream_[stream] = finish;
+        engine_[engine] = finish;
+        if (blocks_host) host_ = finish;
+    }
+
+    double host_, origin_;
+    double engine_[ENGINE_COUNT];
+    std::vector<double> stream_;
+};
+
+} // namespace
+
+std::unique_ptr<PipelineDevice> makeSimPipelineDevice(std::string*) {
+    return std::unique_ptr<PipelineDevice>(new SimDevice());
+}
+
+} // namespace gpu_monitor
@@ -0,0 +1,160 @@
+// process_attribution.cpp - per-process GPU utilization and energy attribution
+#include "process_attribution.h"
+
+#include <sys/time.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace gpu_monitor {
+
+// Parent and start time (clock ticks since boot) of pid from /proc/<pid>/stat;
+// false if the process is gone.
+static bool readStat(unsigned int pid, unsigned int* ppid, unsigned long long* start_time) {
+    std::ifstream f(("/proc/" + std::to_string(pid) + "/stat").c_str());
+    std::string stat;
+    std::getline(f, stat);
+    // "pid (comm) state ppid ... starttime ...": comm may contain spaces and parentheses
+    size_t paren = stat.rfind(')');
+    if (paren == std::string::npos) return false;
+    char state = 0;
+    return std::sscanf(stat.c_str() + paren + 1, " %c %u %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u %*d %*d %*d %*d %*d %*d %llu",
+                       &state, ppid, start_time) == 3;
+}
+
+bool ProcessTree::contains(unsigned int pid) {
+    if (root_ <= 0) return false;
+    // Processes met on the way up, with their start times
+    std::vector<std::pair<unsigned int, unsigned long long>> chain;
+    bool in_tree = false;
+    for (unsigned int p = pid; p > 1;) {
+        if (p == (unsigned int)root_) {
+            in_tree = true;
+            break;
+        }
+        unsigned int ppid = 0;
+        unsigned long long start = 0;
+        auto c = cache_.find(p);
+        if (!readStat(p, &ppid, &start)) {
+            // Exited since it was resolved: the pid has not been reused yet
+            if (c != cache_.end()) in_tree = c->second.in_tree;
+            break;
+        }
+        // A cached verdict only holds for the same process instance: the pid may have
+        // been reused since
+        if (c != cache_.end() && c->second.start_time == start) {
+            in_tree = c->second.in_tree;
+            break;
+        }
+        chain.push_back(std::make_pair(p, start));
+        if (chain.size() > 4096) break;  // guards against a /proc race forming a loop
+        p = ppid;
+    }
+    for (const auto& e : chain) cache_[e.first] = Verdict{e.second, in_tree};
+    return in_tree;
+}
+
+static unsigned long long wallClockUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    return (unsigned long long)tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+void ProcessAttribution::init(size_t ndev, pid_t root) {
+    tree_ = ProcessTree(root);
+    supported_.assign(ndev, 0);
+    share_.assign(ndev, 0.0);
+    util_share_.assign(ndev, 0);
+    // Utilization samples taken before the run are not the command's
+    last_seen_us_.assign(ndev, wallClockUs());
+    power_.assign(ndev, TrapezoidIntegrator());
+    attributed_.assign(ndev, TrapezoidIntegrator());
+    tree_sm_util_.assign(ndev, RunningStats());
+    tree_mem_mib_max_.assign(ndev, 0.0);
+    tree_procs_max_.assign(ndev, 0);
+    other_procs_max_.assign(ndev, 0);
+}
+
+void ProcessAttribution::sample(const DeviceSet& devs, const PassSample& pass) {
+    for (size_t d = 0; d < devs.size(); ++d) {
+        nvmlDevice_t dev = devs.handles[d];
+
+        // Running compute processes: size query, then the list (with headroom for
+        // processes starting in between)
+        unsigned int count = 0;
+        nvmlReturn_t ret = nvmlDeviceGetComputeRunningProcesses(dev, &count, nullptr);
+        if (ret == NVML_ERROR_INSUFFICIENT_SIZE || (ret == NVML_SUCCESS && count > 0)) {
+            infos_.resize(count + 4);
+            count = (unsigned int)infos_.size();
+            ret = nvmlDeviceGetComputeRunningProcesses(dev, &count, infos_.data());
+        }
+        unsigned int tree_procs = 0, other_procs = 0;
+        bool listed = (ret == NVML_SUCCESS);
+        if (listed) {
+            supported_[d] = 1;
+            double tree_mib = 0.0;
+            for (unsigned int i = 0; i < count; ++i) {
+                if (tree_.contains(infos_[i].pid)) {
+                    ++tree_procs;
+                    // all ones = not available (e.g. Windows WDDM)
+                    if (infos_[i].usedGpuMemory != ~0ULL) tree_mib += infos_[i].usedGpuMemory / (1024.0 * 1024.0);
+                } else {
+                    ++other_procs;
+                }
+            }
+            if (tree_mib > tree_mem_mib_max_[d]) tree_mem_mib_max_[d] = tree_mib;
+            if (tree_procs > tree_procs_max_[d]) tree_procs_max_[d] = tree_procs;
+            if (other_procs > other_procs_max_[d]) other_procs_max_[d] = other_procs;
+        }
+
+        // SM utilization per process since the previous pass
+        double tree_sm = 0.0, all_sm = 0.0;
+        bool have_util = false, no_new_samples = false;
+#ifdef GPU_MONITOR_HAVE_PROCESS_UTILIZATION
+        unsigned int nsamples = 0;
+        ret = nvmlDeviceGetProcessUtilization(dev, nullptr, &nsamples, last_seen_us_[d]);
+        if (ret == NVML_ERROR_INSUFFICIENT_SIZE || (ret == NVML_SUCCESS && nsamples > 0)) {
+            util_.resize(nsamples + 4);
+            nsamples = (unsigned int)util_.size();
+            ret = nvmlDeviceGetProcessUtilization(dev, util_.data(), &nsamples, last_seen_us_[d]);
+            if (ret == NVML_SUCCESS) {
+                for (unsigned int i = 0; i < nsamples; ++i) {
+                    const nvmlProcessUtilizationSample_t& u = util_[i];
+                    all_sm += u.smUtil;
+                    if (tree_.contains(u.pid)) tree_sm += u.smUtil;
+                    if (u.timeStamp > last_seen_us_[d]) last_seen_us_[d] = u.timeStamp;
+                }
+                have_util = nsamples > 0;
+                if (have_util) tree_sm_util_[d].add(tree_sm);
+            }
+        }
+        no_new_samples = (ret == NVML_ERROR_NOT_FOUND);
+#endif
+
+        unsigned int procs = tree_procs + other_procs;
+        if (listed && procs == 0) {
+            share_[d] = 0.0;  // nothing runs on the device
+        } else if (have_util && all_sm > 0.0) {
+            share_[d] = tree_sm / all_sm;
+            util_share_[d] = 1;
+        } else if (no_new_samples && util_share_[d]) {
+            // the driver has nothing newer: the last utilization share holds
+        } else if (procs > 0) {
+            share_[d] = (double)tree_procs / procs;
+            util_share_[d] = 0;
+        }
+
+        if (!pass.power_ok[d]) continue;
+        double t = pass.dev_t_s[d];
+        power_[d].add(t, pass.power_w[d]);
+        attributed_[d].add(t, pass.power_w[d] * share_[d]);
+    }
+}
+
+double ProcessAttribution::attributedJ(size_t d, double device_j) const {
+    double sampled = power_[d].integral();
+    return sampled > 0.0 ? device_j * attributed_[d].integral() / sampled : 0.0;
+}
+
+} // namespace gpu_monitor
@@ -0,0 +1,81 @@
+// process_attribution.h
+// Attribution of shared-GPU energy to the monitored command. On every pass the
+// compute processes running on each device and their SM utilization
+// (nvmlDeviceGetProcessUtilization) are split into the command's process tree and
+// everything else; the device power of the pass is multiplied by the tree's share of
+// the SM utilization and integrated alongside the device-wide power. When the device
+// is busy but reports no utilization for its processes (or cannot report it at
+// all) the share falls back to the tree's share of the running processes.
+
+#ifndef PROCESS_ATTRIBUTION_H
+#define PROCESS_ATTRIBUTION_H
+
+#include "gpu_devices.h"
+#include "monitor_timing.h"
+#include "streaming_stats.h"
+
+#include <nvml.h>
+#include <sys/types.h>
+#include <map>
+#include <vector>
+
+namespace gpu_monitor {
+
+// The monitored command and its descendants, resolved through /proc/<pid>/stat.
+class ProcessTree {
+public:
+    explicit ProcessTree(pid_t root = 0) : root_(root) {}
+
+    // True if pid is the root or one of its descendants. Verdicts are cached per
+    // process instance, keyed by pid and start time, so a reused pid is resolved again.
+    bool contains(unsigned int pid);
+
+private:
+    struct Verdict {
+        unsigned long long start_time;  // /proc/<pid>/stat field 22
+        bool in_tree;
+    };
+
+    pid_t root_;
+    std::map<unsigned int, Verdict> cache_;
+};
+
+class ProcessAttribution {
+public:
+    void init(size_t ndev, pid_t root);
+
+    // Queries processes and utilization of every device and integrates the
+    // attributed share of the pass's power readings.
+    void sample(const DeviceSet& devs, const PassSample& pass);
+
+    bool supported(size_t d) const { return supported_[d] != 0; }
+    // Energy of device d attributed to the process tree, given the device-wide energy
+    // (which may come from the hardware counter rather than the sampled power).
+    double attributedJ(size_t d, double device_j) const;
+
+    unsigned int treeProcsMax(size_t d) const { return tree_procs_max_[d]; }
+    unsigned int otherProcsMax(size_t d) const { return other_procs_max_[d]; }
+    double treeMemMiBMax(size_t d) const { return tree_mem_mib_max_[d]; }
+    const RunningStats& treeSmUtil(size_t d) const { return tree_sm_util_[d]; }
+
+private:
+    ProcessTree tree_;
+    std::vector<char> supported_;           // process list could be read at least once
+    std::vector<double> share_;             // tree share of the latest pass, 0..1
+    std::vector<char> util_share_;          // share_ came from utilization samples
+    std::vector<unsigned long long> last_seen_us_;
+    std::vector<TrapezoidIntegrator> power_;       // device power
+    std::vector<TrapezoidIntegrator> attributed_;  // device power * share
+    std::vector<RunningStats> tree_sm_util_;
+    std::vector<double> tree_mem_mib_max_;
+    std::vector<unsigned int> tree_procs_max_;
+    std::vector<unsigned int> other_procs_max_;
+
+    // Query buffers reused from pass to pass
+    std::vector<nvmlProcessInfo_t> infos_;
+    std::vector<nvmlProcessUtilizationSample_t> util_;
+};
+
+} // namespace gpu_monitor
+
+#endif // PROCESS_ATTRIBUTION_H
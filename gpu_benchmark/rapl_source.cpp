@@ -0,0 +1,45 @@
+// rapl_source.cpp - RAPL domains from the powercap sysfs interface
+#include "rapl_source.h"
+#include "monitor_timing.h"
+
+namespace gpu_monitor {
+
+RaplSource::RaplSource() {}
+
+std::unique_ptr<RaplSource> RaplSource::open(const std::string& root, std::string* err) {
+    std::unique_ptr<RaplSource> src(new RaplSource());
+    if (!src->domains_.open(root, err)) return nullptr;
+    size_t n = src->domains_.size();
+    for (size_t i = 0; i < n; ++i) {
+        EnergyComponent c;
+        c.name = src->domains_.name(i);
+        c.kind = ComponentKind::CPU;
+        c.in_total = src->domains_.inTotal(i);
+        src->components_.push_back(c);
+    }
+    src->has_prev_.assign(n, 0);
+    src->prev_t_.assign(n, 0.0);
+    src->energy_uj_.assign(n, 0.0);
+    src->power_w_.assign(n, 0.0);
+    return src;
+}
+
+void RaplSource::sample(double t_origin, bool last) {
+    (void)last;
+    double t_s = monotonicSeconds() - t_origin;
+    for (size_t i = 0; i < domains_.size(); ++i) {
+        uint64_t delta = 0;
+        // A failed read keeps the previous value; the next good one covers the gap
+        if (!domains_.readDelta(i, &delta)) continue;
+        // The first good read is the baseline: energy counts from the first sample
+        if (has_prev_[i]) {
+            double dt = t_s - prev_t_[i];
+            energy_uj_[i] += (double)delta;
+            power_w_[i] = dt > 0.0 ? delta / 1e6 / dt : 0.0;
+        }
+        prev_t_[i] = t_s;
+        has_prev_[i] = 1;
+    }
+}
+
+} // namespace gpu_monitor
@@ -0,0 +1,46 @@
+// rapl_source.h
+// CPU half of node_monitor: every RAPL domain exposed through the Linux powercap
+// interface (/sys/class/powercap/intel-rapl:N and intel-rapl:N:M), read from
+// energy_uj on each sample. Enumeration, naming, the node-total rules and counter
+// wraparound come from the dvfsmon library's RaplDomains
+// (benchmark_monitor_C/rapl_domains.h), built into node_monitor from there. No NVML
+// dependency.
+
+#ifndef RAPL_SOURCE_H
+#define RAPL_SOURCE_H
+
+#include "energy_source.h"
+#include "rapl_domains.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace gpu_monitor {
+
+class RaplSource : public EnergySource {
+public:
+    // Enumerates the domains under root (normally /sys/class/powercap). Returns null
+    // and fills *err when there is no readable domain.
+    static std::unique_ptr<RaplSource> open(const std::string& root, std::string* err);
+
+    const char* name() const { return "rapl"; }
+    void sample(double t_origin, bool last);
+    double energyJ(size_t i) const { return energy_uj_[i] / 1e6; }
+    double powerW(size_t i) const { return power_w_[i]; }
+    const char* method(size_t) const { return "counter"; }
+
+private:
+    RaplSource();
+
+    system_monitor::RaplDomains domains_;
+    std::vector<char> has_prev_;       // the domain has been sampled: deltas count
+    std::vector<double> energy_uj_;
+    std::vector<double> power_w_;
+    std::vector<double> prev_t_;
+};
+
+} // namespace gpu_monitor
+
+#endif // RAPL_SOURCE_H
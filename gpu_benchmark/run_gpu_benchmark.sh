@@ -1,11 +1,12 @@
 #!/usr/bin/env bash
-# run_gpu_benchmark.sh - Compila y ejecuta gemm_benchmark, muestrea nvidia-smi y genera results_gpu.csv
+# run_gpu_benchmark.sh - Compila y ejecuta gemm_benchmark y stream_benchmark, muestrea nvidia-smi y genera results_gpu.csv
 
 set -euo pipefail
 
 ROOT_DIR="$(cd "$(dirname "$0")" && pwd)"
 BUILD_DIR="$ROOT_DIR/build"
 BIN="$BUILD_DIR/gemm_benchmark"
+STREAM_BIN="$BUILD_DIR/stream_benchmark"
 OUTPUT_CSV="$ROOT_DIR/results_gpu.csv"
 
 # Create a temporary working directory for transient files so we don't leave artifacts
@@ -19,7 +20,32 @@ SAMPLE_FILE=""
 # Default sizes reduced to small/medium so test runs complete quickly; edit to increase stress.
 SIZES=("128 128 128" "256 256 256" "512 512 512")
 ITERATIONS=100
+# GEMM kernel variants (see ./build/gemm_benchmark_host --list-kernels), each in its own
+# monitored run: naive, tiled_<BM>x<BN>x<BK>_<TM>x<TN> or the tensor-core wmma_fp16,
+# wmma_bf16 and wmma_tf32, e.g. GEMM_KERNEL="tiled_64x64x16_4x4 wmma_fp16 wmma_tf32".
+GEMM_KERNEL="${GEMM_KERNEL:-naive}"
+# Launches per CUDA event pair in gemm_benchmark_google: "auto" (enough to keep the GPU
+# busy for GEMM_BATCH_MIN_TIME seconds) or a fixed count; 1 syncs after every launch.
+GEMM_BATCH="${GEMM_BATCH:-auto}"
+GEMM_BATCH_MIN_TIME="${GEMM_BATCH_MIN_TIME:-0.01}"
+# Launch modes to measure, each in its own monitored run so time and energy are per
+# mode: "stream" (one launch per kernel), "graph" (batches replayed as a CUDA graph,
+# needs CUDA 10) or both, e.g. GEMM_LAUNCH="stream graph".
+GEMM_LAUNCH="${GEMM_LAUNCH:-stream}"
+# STREAM sweep (stream_benchmark): every op x block size x grid size is its own monitored
+# run, so clocks, power and achieved bandwidth are per configuration. Grid sizes are
+# blocks per SM or "full" (one element per thread). STREAM_OPS="" skips the suite.
+STREAM_OPS="${STREAM_OPS:-copy triad}"
+STREAM_BLOCKS="${STREAM_BLOCKS:-128 256 512 1024}"
+STREAM_GRIDS="${STREAM_GRIDS:-4 full}"
+STREAM_N="${STREAM_N:-33554432}"   # doubles per array (256 MiB)
+STREAM_ITERATIONS="${STREAM_ITERATIONS:-100}"
 SAMPLE_MS=100
+# GPUs sampled by gpu_monitor_nvml (NVML indices, UUIDs or PCI bus ids, or "all").
+# The benchmark itself runs on one GPU, so only that one is monitored by default.
+GPU_DEVICES="${GPU_DEVICES:-0}"
+# Optional per-sample traces: when set, one CSV per size is written to this directory
+GPU_TRACE_DIR="${GPU_TRACE_DIR:-}"
 
 # Determine nvcc path robustly: respect NVCC env var, PATH, and common install locations
 if [ -n "${NVCC-}" ] && [ -x "${NVCC}" ]; then
@@ -61,24 +87,40 @@ else
     # Compile gemm_benchmark.cu directly
     if [ -f "$ROOT_DIR/gemm_benchmark.cu" ]; then
         echo "Compiling gemm_benchmark.cu..."
-        "$NVCC" -O3 -o "$BIN" "$ROOT_DIR/gemm_benchmark.cu"
+        "$NVCC" -O3 -std=c++14 -o "$BIN" "$ROOT_DIR/gemm_benchmark.cu" "$ROOT_DIR/bench_backend_cuda.cu" \
+            "$ROOT_DIR/gemm_harness.cpp" "$ROOT_DIR/device_buffer_pool.cpp" "$ROOT_DIR/bench_backend_host.cpp"
         echo "Built: $BIN"
     else
         echo "Error: gemm_benchmark.cu not found in $ROOT_DIR"
         exit 1
     fi
+    echo "Compiling stream_benchmark.cu..."
+    "$NVCC" -O3 -std=c++14 -o "$STREAM_BIN" "$ROOT_DIR/stream_benchmark.cu" "$ROOT_DIR/bench_backend_cuda.cu" \
+        "$ROOT_DIR/stream_harness.cpp" "$ROOT_DIR/device_buffer_pool.cpp" "$ROOT_DIR/bench_backend_host.cpp" && \
+        echo "Built: $STREAM_BIN" || echo "Warning: could not compile stream_benchmark (STREAM suite skipped)"
     
     # Try to compile gpu_monitor_nvml if NVML headers are available
     MONITOR_SRC="$ROOT_DIR/gpu_monitor_nvml.cpp"
+    MONITOR_SRCS="$MONITOR_SRC $ROOT_DIR/child_supervisor.cpp $ROOT_DIR/gpu_aggregates.cpp $ROOT_DIR/gpu_clocks.cpp $ROOT_DIR/gpu_devices.cpp $ROOT_DIR/monitor_cli.cpp $ROOT_DIR/monitor_timing.cpp $ROOT_DIR/process_attribution.cpp $ROOT_DIR/streaming_stats.cpp $ROOT_DIR/throttle_reasons.cpp $ROOT_DIR/trace_writer.cpp"
     MONITOR_BIN="$BUILD_DIR/gpu_monitor_nvml"
     if [ -f "$MONITOR_SRC" ]; then
         echo "Attempting to compile gpu_monitor_nvml..."
         # Try common NVML paths
         NVML_INC=""
         NVML_LIB=""
+        NVML_DEFS=""
         for inc_path in /usr/local/cuda/include /usr/local/cuda-*/include /opt/ohpc/pub/devtools/cuda/*/include; do
             if [ -f "$inc_path/nvml.h" ]; then
                 NVML_INC="-I$inc_path"
+                # Same optional-API detection as CMakeLists.txt
+                for probe in nvmlDeviceGetTotalEnergyConsumption=TOTAL_ENERGY \
+                             nvmlDeviceGetCurrentClocksThrottleReasons=THROTTLE_REASONS \
+                             nvmlDeviceSetApplicationsClocks=APP_CLOCKS \
+                             nvmlDeviceSetGpuLockedClocks=LOCKED_CLOCKS \
+                             nvmlDeviceSetMemoryLockedClocks=MEM_LOCKED_CLOCKS \
+                             nvmlDeviceGetProcessUtilization=PROCESS_UTILIZATION; do
+                    grep -q "${probe%%=*}" "$inc_path/nvml.h" && NVML_DEFS="$NVML_DEFS -DGPU_MONITOR_HAVE_${probe#*=}"
+                done
                 break
             fi
         done
@@ -90,7 +132,7 @@ else
         done
         
         if [ -n "$NVML_INC" ] && [ -n "$NVML_LIB" ]; then
-            g++ -O2 $NVML_INC -o "$MONITOR_BIN" "$MONITOR_SRC" $NVML_LIB 2>/dev/null && \
+            g++ -O2 -std=c++14 -pthread $NVML_INC $NVML_DEFS -o "$MONITOR_BIN" $MONITOR_SRCS $NVML_LIB 2>/dev/null && \
                 echo "Built: $MONITOR_BIN" || \
                 echo "Warning: Could not compile gpu_monitor_nvml (will use nvidia-smi fallback)"
         else
@@ -101,7 +143,7 @@ fi
 
 # Header CSV (GPU-focused; NO CPU columns)
 cat > "$OUTPUT_CSV" <<EOF
-timestamp,kernel_name,problem_size,iterations,gpu_core_clock_MHz,gpu_mem_clock_MHz,gpu_utilization_pct,occupancy,throughput_gflops,bandwidth_gbps,power_avg_w,energy_j,edp,gflops_per_watt,gpu_temp_c,ed2p
+timestamp,kernel_name,problem_size,iterations,gpu_core_clock_MHz,gpu_mem_clock_MHz,gpu_utilization_pct,occupancy,throughput_gflops,bandwidth_gbps,power_avg_w,energy_j,edp,gflops_per_watt,gpu_temp_c,ed2p,throttle_contaminated,throttle_reasons,launch_mode,block_size,grid_size,active_blocks_per_sm,mem_bandwidth_gbs
 EOF
 
 # Helper: parse NVML monitor output file (key=value lines)
@@ -115,6 +157,8 @@ parse_nvml_output() {
     SAMPLE_STATS[count]=0
     SAMPLE_STATS[duration_s]=0
     SAMPLE_STATS[energy_j]=0
+    SAMPLE_STATS[throttle_contaminated]=""
+    SAMPLE_STATS[throttle_reasons]=""
 
     if [ ! -s "$SAMPLE_FILE" ]; then
         return
@@ -130,6 +174,8 @@ parse_nvml_output() {
             samples) SAMPLE_STATS[count]="$val";;
             duration_s) SAMPLE_STATS[duration_s]="$val";;
             energy_j) SAMPLE_STATS[energy_j]="$val";;
+            throttle_contaminated) SAMPLE_STATS[throttle_contaminated]="$val";;
+            throttle_reasons) SAMPLE_STATS[throttle_reasons]="$val";;
         esac
     done < "$SAMPLE_FILE"
 }
@@ -137,11 +183,19 @@ parse_nvml_output() {
 # Helper: read CPU freq (MHz) - best effort
 # (No CPU helpers — CSV is GPU-only)
 
-# Main loop over sizes
+# Main loop over sizes, launch modes and kernels
+RUNS=()
 for s in "${SIZES[@]}"; do
-    read -r M K N <<< "$s"
+    for mode in $GEMM_LAUNCH; do
+        for kernel in $GEMM_KERNEL; do
+            RUNS+=("$s $mode $kernel")
+        done
+    done
+done
+for r in "${RUNS[@]}"; do
+    read -r M K N LAUNCH KERNEL <<< "$r"
     timestamp=$(date -Iseconds)
-    echo "Running GEMM size ${M}x${K}x${N} (iterations=${ITERATIONS})"
+    echo "Running GEMM size ${M}x${K}x${N} (kernel=${KERNEL}, launch=${LAUNCH}, iterations=${ITERATIONS})"
 
     # Use NVML monitor which will launch the benchmark and sample while it runs
     MONITOR_BIN="$BUILD_DIR/gpu_monitor_nvml"
@@ -154,14 +208,27 @@ for s in "${SIZES[@]}"; do
     GBOUT=$(mktemp "$TMPDIR/gbout.XXXX.json")
 
     GBIN="$BUILD_DIR/gemm_benchmark_google"
+    # gemm_benchmark_google registers the naive kernel as BM_GEMM and the others as BM_GEMM_<kernel>
+    if [ "$KERNEL" = "naive" ]; then
+        GB_FILTER="^BM_GEMM/${M}/${K}/${N}"
+    else
+        GB_FILTER="^BM_GEMM_${KERNEL}/${M}/${K}/${N}"
+    fi
+
+    MONITOR_OPTS=(--devices="$GPU_DEVICES")
+    if [ -n "$GPU_TRACE_DIR" ]; then
+        mkdir -p "$GPU_TRACE_DIR"
+        MONITOR_OPTS+=(--trace="$GPU_TRACE_DIR/trace_${KERNEL}_${M}x${K}x${N}.csv")
+    fi
 
     if [ -x "$GBIN" ]; then
         echo "Running Google Benchmark under NVML monitor: $GBIN"
         # monitor will write $SAMPLE_FILE; capture GB JSON to GBOUT
-        "$MONITOR_BIN" "$SAMPLE_MS" "$SAMPLE_FILE" "$GBIN" --benchmark_repetitions=3 --benchmark_format=json > "$GBOUT" 2>&1 || true
+        "$MONITOR_BIN" "${MONITOR_OPTS[@]}" "$SAMPLE_MS" "$SAMPLE_FILE" "$GBIN" --benchmark_repetitions=3 --benchmark_format=json "--benchmark_filter=$GB_FILTER" \
+            "--gemm_batch=$GEMM_BATCH" "--gemm_batch_min_time=$GEMM_BATCH_MIN_TIME" "--gemm_launch=$LAUNCH" > "$GBOUT" 2>&1 || true
     else
         echo "Running simple binary under NVML monitor: $BIN"
-        "$MONITOR_BIN" "$SAMPLE_MS" "$SAMPLE_FILE" "$BIN" "$M" "$K" "$N" "$ITERATIONS" > /dev/null 2>&1 || true
+        "$MONITOR_BIN" "${MONITOR_OPTS[@]}" "$SAMPLE_MS" "$SAMPLE_FILE" "$BIN" "$M" "$K" "$N" "$ITERATIONS" --kernel="$KERNEL" --launch="$LAUNCH" > /dev/null 2>&1 || true
     fi
 
     # Parse NVML monitor output (from SAMPLE_FILE)
@@ -169,7 +236,7 @@ for s in "${SIZES[@]}"; do
 
     # Parse gemm output or Google Benchmark JSON (if present)
     # Set sane defaults so 'set -u' doesn't fail on missing values
-    kernel_name="gemm_naive"
+    kernel_name="gemm_${KERNEL}"
     problem_size="${M}x${K}x${N}"
     time_s=0
     gflops=0
@@ -233,9 +300,12 @@ PY
     gpu_core_clock=${SAMPLE_STATS[core_clock_avg]:-0}
     gpu_mem_clock=${SAMPLE_STATS[mem_clock_avg]:-0}
     gpu_temp=${SAMPLE_STATS[temp_avg]:-0}
+    # Empty when the GPU cannot report throttle reasons
+    throttle_contaminated=${SAMPLE_STATS[throttle_contaminated]}
+    throttle_reasons=${SAMPLE_STATS[throttle_reasons]}
 
     # Append to CSV (GPU-only columns)
-    echo "$timestamp,$kernel_name,$problem_size,$ITERATIONS,$gpu_core_clock,$gpu_mem_clock,$gpu_util,$occupancy,$gflops,$bandwidth_gbps,$power_avg_w,$energy_j,$edp,$gflops_per_watt,$gpu_temp,$ed2p" >> "$OUTPUT_CSV"
+    echo "$timestamp,$kernel_name,$problem_size,$ITERATIONS,$gpu_core_clock,$gpu_mem_clock,$gpu_util,$occupancy,$gflops,$bandwidth_gbps,$power_avg_w,$energy_j,$edp,$gflops_per_watt,$gpu_temp,$ed2p,$throttle_contaminated,$throttle_reasons,$LAUNCH,,,," >> "$OUTPUT_CSV"
 
     # Clean per-run temp files
     rm -f "$SAMPLE_FILE" "$GBOUT" || true
@@ -244,4 +314,54 @@ PY
     echo ""
 done
 
+# STREAM sweep: memory-bound rows for separating memory-clock from SM-clock effects
+if [ -n "$STREAM_OPS" ] && [ ! -x "$STREAM_BIN" ]; then
+    echo "stream_benchmark not found; skipping the STREAM sweep"
+    STREAM_OPS=""
+fi
+for OP in $STREAM_OPS; do
+    for BLOCK in $STREAM_BLOCKS; do
+        for GRID in $STREAM_GRIDS; do
+            timestamp=$(date -Iseconds)
+            echo "Running STREAM ${OP} (n=${STREAM_N}, block=${BLOCK}, grid=${GRID}, iterations=${STREAM_ITERATIONS})"
+            SAMPLE_FILE=$(mktemp "$TMPDIR/sample.XXXX")
+            SOUT=$(mktemp "$TMPDIR/stream.XXXX")
+            MONITOR_OPTS=(--devices="$GPU_DEVICES")
+            if [ -n "$GPU_TRACE_DIR" ]; then
+                mkdir -p "$GPU_TRACE_DIR"
+                MONITOR_OPTS+=(--trace="$GPU_TRACE_DIR/trace_stream_${OP}_${BLOCK}_${GRID}.csv")
+            fi
+            "$BUILD_DIR/gpu_monitor_nvml" "${MONITOR_OPTS[@]}" "$SAMPLE_MS" "$SAMPLE_FILE" "$STREAM_BIN" "$STREAM_N" "$STREAM_ITERATIONS" \
+                --op="$OP" --block="$BLOCK" --grid="$GRID" > "$SOUT" 2>&1 || true
+            parse_nvml_output
+
+            # summary line of stream_benchmark (key=value pairs)
+            declare -A SV=()
+            line=$(grep '^kernel_name=stream_' "$SOUT" | head -n 1 || true)
+            if [ -n "$line" ]; then
+                IFS=',' read -ra fields <<< "$line"
+                for f in "${fields[@]}"; do SV[${f%%=*}]="${f#*=}"; done
+            fi
+            kernel_name="${SV[kernel_name]:-stream_${OP}}"
+            time_s="${SV[time_s]:-0}"
+            mem_bandwidth_gbs="${SV[bandwidth_gbs]:-0}"
+            occupancy="${SV[occupancy]:-0}"
+            active_blocks="${SV[active_blocks_per_sm]:-0}"
+            grid_blocks="${SV[grid]:-0}"
+            # same units as the GEMM rows
+            bandwidth_gbps=$(awk -v g="$mem_bandwidth_gbs" 'BEGIN{printf("%.3f", g * 8.0)}')
+
+            power_avg_w=${SAMPLE_STATS[power_avg]:-0}
+            energy_j=$(awk -v p=$power_avg_w -v t=$time_s 'BEGIN{printf("%.6f", p * t)}')
+            edp=$(awk -v e=$energy_j -v t=$time_s 'BEGIN{printf("%.6e", e * t)}')
+            ed2p=$(awk -v e=$energy_j -v t=$time_s 'BEGIN{printf("%.6e", e * t * t)}')
+            echo "$timestamp,$kernel_name,$STREAM_N,$STREAM_ITERATIONS,${SAMPLE_STATS[core_clock_avg]:-0},${SAMPLE_STATS[mem_clock_avg]:-0},${SAMPLE_STATS[util_avg]:-0},$occupancy,0,$bandwidth_gbps,$power_avg_w,$energy_j,$edp,0,${SAMPLE_STATS[temp_avg]:-0},$ed2p,${SAMPLE_STATS[throttle_contaminated]},${SAMPLE_STATS[throttle_reasons]},stream,$BLOCK,$grid_blocks,$active_blocks,$mem_bandwidth_gbs" >> "$OUTPUT_CSV"
+
+            rm -f "$SAMPLE_FILE" "$SOUT" || true
+            echo "Result appended to $OUTPUT_CSV"
+            echo ""
+        done
+    done
+done
+
 echo "All done. CSV: $OUTPUT_CSV"
@@ -0,0 +1,93 @@
+#!/usr/bin/env bash
+# run_hetero_benchmark.sh - Barre hilos de CPU y reparto inicial del GEMM heterogéneo CPU+GPU
+# bajo node_monitor (energía CPU + GPU) y genera results_hetero.csv. Se asume el proyecto ya
+# compilado en build/ (ver run_gpu_benchmark.sh).
+#
+# Con HETERO_BIN=build/hetero_gemm_host el backend CPU hace de GPU (sin GPU).
+
+set -euo pipefail
+
+ROOT_DIR="$(cd "$(dirname "$0")" && pwd)"
+BUILD_DIR="${BUILD_DIR:-$ROOT_DIR/build}"
+BIN="${HETERO_BIN:-$BUILD_DIR/hetero_gemm}"
+MONITOR_BIN="${NODE_MONITOR_BIN:-$BUILD_DIR/node_monitor}"
+OUTPUT_CSV="${OUTPUT_CSV:-$ROOT_DIR/results_hetero.csv}"
+
+# Problema MxKxN, pasadas cronometradas, filas por chunk y kernel del lado GPU
+SIZE="${SIZE:-4096 4096 4096}"
+PASSES="${PASSES:-10}"
+CHUNK_ROWS="${CHUNK_ROWS:-64}"
+KERNEL="${KERNEL:-tiled_128x128x8_8x8}"
+# Valores barridos (listas separadas por espacios): SPLITS admite auto o una fracción para
+# la GPU; DEVICES both, cpu o gpu (cpu y gpu ignoran SPLITS y CPU_THREADS no aplica a gpu)
+CPU_THREADS="${CPU_THREADS:-$(( $(nproc) > 1 ? $(nproc) - 1 : 1 ))}"
+SPLITS="${SPLITS:-auto}"
+DEVICES="${DEVICES:-both cpu gpu}"
+SAMPLE_MS="${SAMPLE_MS:-50}"
+
+for b in "$BIN" "$MONITOR_BIN"; do
+    if [ ! -x "$b" ]; then
+        echo "$b not found; build the project first (cmake -S . -B build && cmake --build build)"
+        exit 1
+    fi
+done
+
+TMPDIR=$(mktemp -d)
+trap 'rm -rf "${TMPDIR}"' EXIT
+
+echo "timestamp,problem_size,devices,gpu_kernel,cpu_threads,chunk_rows,split,passes,time_s,gflops,split_first,split_last,gpu_share,cpu_share,gpu_gflops,cpu_gflops,steals,duration_s,energy_cpu_j,energy_gpu_j,energy_total_j,gflops_per_watt" > "$OUTPUT_CSV"
+
+# Value of key in a file of key=value lines (one per line, or comma-separated on one line)
+value_of() {
+    tr ',' '\n' < "$2" | awk -F= -v k="$1" '$1 == k { print $2; exit }'
+}
+
+# shellcheck disable=SC2086
+set -- $SIZE
+M=$1; K=$2; N=$3
+
+run_one() {  # devices threads split
+    local devices=$1 threads=$2 split=$3
+    local timestamp OUT REPORT cols k duration_s energy_cpu_j energy_gpu_j energy_total_j gflops_per_watt
+    timestamp=$(date -Iseconds)
+    echo "Running hetero_gemm ${M}x${K}x${N} (devices=$devices, cpu_threads=$threads, split=$split)"
+    OUT="$TMPDIR/out.txt"
+    REPORT="$TMPDIR/report.txt"
+    if ! "$MONITOR_BIN" "$SAMPLE_MS" "$REPORT" "$BIN" "$M" "$K" "$N" --devices="$devices" \
+            --cpu-threads="$threads" --split="$split" --chunk-rows="$CHUNK_ROWS" --kernel="$KERNEL" \
+            --passes="$PASSES" > "$OUT"; then
+        echo "  failed; skipping"
+        return
+    fi
+    cols=""
+    for k in problem_size; do cols="$cols,$(value_of "$k" "$OUT")"; done
+    cols="$cols,$devices"
+    for k in gpu_kernel cpu_threads chunk_rows; do cols="$cols,$(value_of "$k" "$OUT")"; done
+    cols="$cols,$split"
+    for k in iterations time_s gflops split_first split_last gpu_share cpu_share gpu_gflops cpu_gflops steals; do
+        cols="$cols,$(value_of "$k" "$OUT")"
+    done
+    duration_s=$(value_of duration_s "$REPORT")
+    energy_cpu_j=$(value_of energy_cpu_j "$REPORT")
+    energy_gpu_j=$(value_of energy_gpu_j "$REPORT")
+    energy_total_j=$(value_of energy_total_j "$REPORT")
+    # node-wide (CPU + GPU) efficiency of the timed passes over the energy of the whole process
+    gflops_per_watt=$(awk -v g="$(value_of gflops "$OUT")" -v t="$(value_of time_s "$OUT")" \
+        -v e="${energy_total_j:-0}" 'BEGIN{ printf("%.6f", e > 0 ? g * t / e : 0) }')
+    echo "$timestamp$cols,$duration_s,$energy_cpu_j,$energy_gpu_j,$energy_total_j,$gflops_per_watt" >> "$OUTPUT_CSV"
+}
+
+for devices in $DEVICES; do
+    case "$devices" in
+        both)
+            for threads in $CPU_THREADS; do
+                for split in $SPLITS; do run_one both "$threads" "$split"; done
+            done ;;
+        cpu)
+            for threads in $CPU_THREADS; do run_one cpu "$threads" auto; done ;;
+        *)
+            run_one "$devices" 0 auto ;;
+    esac
+done
+
+echo "All done. CSV: $OUTPUT_CSV"
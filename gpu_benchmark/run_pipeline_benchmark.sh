@@ -0,0 +1,71 @@
+#!/usr/bin/env bash
+# run_pipeline_benchmark.sh - Barre profundidad, tamaño de chunk y memoria host (pinned/pageable)
+# del benchmark de pipeline copia/cómputo bajo node_monitor (energía CPU + GPU) y genera
+# results_pipeline.csv. Se asume el proyecto ya compilado en build/ (ver run_gpu_benchmark.sh).
+#
+# Con PIPELINE_BIN=build/pipeline_host corre sobre el dispositivo simulado (sin GPU).
+
+set -euo pipefail
+
+ROOT_DIR="$(cd "$(dirname "$0")" && pwd)"
+BUILD_DIR="${BUILD_DIR:-$ROOT_DIR/build}"
+BIN="${PIPELINE_BIN:-$BUILD_DIR/pipeline_benchmark}"
+MONITOR_BIN="${NODE_MONITOR_BIN:-$BUILD_DIR/node_monitor}"
+OUTPUT_CSV="${OUTPUT_CSV:-$ROOT_DIR/results_pipeline.csv}"
+
+# Datos por pasada (MB), pasadas cronometradas y FMAs por elemento del kernel
+SIZE_MB="${SIZE_MB:-256}"
+PASSES="${PASSES:-20}"
+INTENSITY="${INTENSITY:-32}"
+# Valores barridos (listas separadas por espacios)
+DEPTHS="${DEPTHS:-1 2 3 4}"
+CHUNKS_KB="${CHUNKS_KB:-1024 4096 16384}"
+HOSTS="${HOSTS:-pinned pageable}"
+SAMPLE_MS="${SAMPLE_MS:-50}"
+
+for b in "$BIN" "$MONITOR_BIN"; do
+    if [ ! -x "$b" ]; then
+        echo "$b not found; build the project first (cmake -S . -B build && cmake --build build)"
+        exit 1
+    fi
+done
+
+TMPDIR=$(mktemp -d)
+trap 'rm -rf "${TMPDIR}"' EXIT
+
+echo "timestamp,size_bytes,chunk_bytes,depth,streams,host,passes,time_s,h2d_s,kernel_s,d2h_s,overlap,throughput_gbps,duration_s,energy_cpu_j,energy_gpu_j,energy_total_j,joules_per_gb" > "$OUTPUT_CSV"
+
+# Value of key in a file of key=value lines (one per line, or comma-separated on one line)
+value_of() {
+    tr ',' '\n' < "$2" | awk -F= -v k="$1" '$1 == k { print $2; exit }'
+}
+
+for host in $HOSTS; do
+    for chunk in $CHUNKS_KB; do
+        for depth in $DEPTHS; do
+            timestamp=$(date -Iseconds)
+            echo "Running pipeline ${SIZE_MB} MB (host=$host, chunk=${chunk} KiB, depth=$depth)"
+            OUT="$TMPDIR/out.txt"
+            REPORT="$TMPDIR/report.txt"
+            if ! "$MONITOR_BIN" "$SAMPLE_MS" "$REPORT" "$BIN" "$SIZE_MB" --host="$host" --chunk-kb="$chunk" \
+                    --depth="$depth" --intensity="$INTENSITY" --passes="$PASSES" > "$OUT"; then
+                echo "  failed; skipping"
+                continue
+            fi
+            cols=""
+            for k in problem_size chunk_bytes depth streams host iterations time_s h2d_s kernel_s d2h_s overlap throughput_gbps; do
+                cols="$cols,$(value_of "$k" "$OUT")"
+            done
+            duration_s=$(value_of duration_s "$REPORT")
+            energy_cpu_j=$(value_of energy_cpu_j "$REPORT")
+            energy_gpu_j=$(value_of energy_gpu_j "$REPORT")
+            energy_total_j=$(value_of energy_total_j "$REPORT")
+            # energy of the whole process (stage reference and warmup pass included) per GB streamed
+            joules_per_gb=$(awk -v e="${energy_total_j:-0}" -v s="$SIZE_MB" -v p="$PASSES" \
+                'BEGIN{ printf("%.6f", e / (s * 1048576.0 * p / 1e9)) }')
+            echo "$timestamp$cols,$duration_s,$energy_cpu_j,$energy_gpu_j,$energy_total_j,$joules_per_gb" >> "$OUTPUT_CSV"
+        done
+    done
+done
+
+echo "All done. CSV: $OUTPUT_CSV"
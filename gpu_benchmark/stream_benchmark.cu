@@ -0,0 +1,11 @@
+// stream_benchmark.cu - STREAM bandwidth benchmark (copy, scale, add, triad) on the CUDA
+// backend of the harness, swept over block and grid sizes. Kernels are in
+// stream_kernels.cuh; sweep, timing and the summary line in stream_harness.cpp.
+//
+// Usage: ./stream_benchmark N iterations [--op=NAME[,NAME...]|all] [--block=N[,N...]]
+//                           [--grid=BLOCKS_PER_SM|full[,...]] [--verify]
+#include "stream_harness.h"
+
+int main(int argc, char** argv) {
+    return gpu_monitor::streamMain(argc, argv, gpu_monitor::makeCudaBackend);
+}
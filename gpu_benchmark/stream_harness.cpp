@@ -0,0 +1,268 @@
+// stream_harness.cpp - STREAM session, reference check and command-line front end of the benchmark harness
+#include "stream_harness.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+namespace gpu_monitor {
+
+namespace {
+
+const double kScalar = 3.0;
+const size_t kMaxElements = size_t(1) << 31;
+const int kMaxIterations = 1000000;
+
+// Arrays each op writes (index into a, b, c)
+const int kDest[STREAM_OP_COUNT] = {2, 1, 2, 0};
+
+std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> items;
+    size_t start = 0;
+    for (;;) {
+        size_t comma = list.find(',', start);
+        items.push_back(list.substr(start, comma - start));
+        if (comma == std::string::npos) return items;
+        start = comma + 1;
+    }
+}
+
+bool parseOps(const std::string& list, std::vector<StreamOp>* out, std::string* err) {
+    out->clear();
+    if (list == "all") {
+        for (int op = 0; op < STREAM_OP_COUNT; ++op) out->push_back(static_cast<StreamOp>(op));
+        return true;
+    }
+    for (const std::string& name : splitList(list)) {
+        int op = 0;
+        while (op < STREAM_OP_COUNT && name != streamOpName(static_cast<StreamOp>(op))) ++op;
+        if (op == STREAM_OP_COUNT) {
+            *err = "unknown op (copy, scale, add, triad or all): " + name;
+            return false;
+        }
+        out->push_back(static_cast<StreamOp>(op));
+    }
+    return true;
+}
+
+bool parseBlocks(const std::string& list, std::vector<int>* out, std::string* err) {
+    out->clear();
+    for (const std::string& item : splitList(list)) {
+        long long v = 0;
+        if (!parseInteger(item.c_str(), 1LL, 1024LL, &v) || v % 32 != 0) {
+            *err = "invalid block size (multiple of 32 up to 1024): " + item;
+            return false;
+        }
+        out->push_back(static_cast<int>(v));
+    }
+    return true;
+}
+
+bool parseGrids(const std::string& list, std::vector<int>* out, std::string* err) {
+    out->clear();
+    for (const std::string& item : splitList(list)) {
+        long long v = 0;
+        if (item == "full") {
+            out->push_back(kStreamGridFull);
+        } else if (parseInteger(item.c_str(), 1LL, 1LL << 16, &v)) {
+            out->push_back(static_cast<int>(v));
+        } else {
+            *err = "invalid grid (blocks per SM or full): " + item;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Initial contents: small integers, so every op's result is exact in double.
+double initial(int array, size_t i) {
+    switch (array) {
+    case 0: return 1.0 + static_cast<double>(i % 7);
+    case 1: return 2.0 + static_cast<double>(i % 5);
+    default: return 0.5 + static_cast<double>(i % 3);
+    }
+}
+
+} // namespace
+
+const char* streamOpName(StreamOp op) {
+    static const char* names[STREAM_OP_COUNT] = {"copy", "scale", "add", "triad"};
+    return op >= 0 && op < STREAM_OP_COUNT ? names[op] : "unknown";
+}
+
+int streamOpArrays(StreamOp op) { return op == STREAM_COPY || op == STREAM_SCALE ? 2 : 3; }
+
+bool parseStreamArgs(int argc, char** argv, StreamArgs* args, std::string* err) {
+    std::vector<const char*> positional;
+    std::string ops = "all", blocks = "256", grids = "full";
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (strncmp(arg, "--op=", 5) == 0) {
+            ops = arg + 5;
+        } else if (strncmp(arg, "--block=", 8) == 0) {
+            blocks = arg + 8;
+        } else if (strncmp(arg, "--grid=", 7) == 0) {
+            grids = arg + 7;
+        } else if (strcmp(arg, "--verify") == 0) {
+            args->verify = true;
+        } else if (strncmp(arg, "--", 2) == 0) {
+            *err = std::string("unknown option: ") + arg;
+            return false;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+    if (positional.size() != 2) {
+        *err = "expected N iterations";
+        return false;
+    }
+    long long n = 0, iterations = 0;
+    if (!parseInteger(positional[0], 1LL, static_cast<long long>(kMaxElements), &n)) {
+        *err = std::string("invalid N: ") + positional[0];
+        return false;
+    }
+    if (!parseInteger(positional[1], 1LL, static_cast<long long>(kMaxIterations), &iterations)) {
+        *err = std::string("invalid iterations: ") + positional[1];
+        return false;
+    }
+    args->n = static_cast<size_t>(n);
+    args->iterations = static_cast<int>(iterations);
+    return parseOps(ops, &args->ops, err) && parseBlocks(blocks, &args->blocks, err) &&
+           parseGrids(grids, &args->grids, err);
+}
+
+int streamGridBlocks(int grid, int block, size_t n, const DeviceInfo& device) {
+    long long blocks = grid == kStreamGridFull ? static_cast<long long>((n + block - 1) / block)
+                                               : static_cast<long long>(grid) * std::max(1, device.num_sm);
+    return static_cast<int>(std::max(1LL, std::min<long long>(blocks, device.max_grid_x)));
+}
+
+double streamBandwidth(StreamOp op, size_t n, long long iterations, double seconds) {
+    if (seconds <= 0.0) return 0.0;
+    return static_cast<double>(streamOpArrays(op)) * sizeof(double) * n * iterations / seconds;
+}
+
+StreamSession::StreamSession(BenchBackend& backend) : backend_(backend), pool_(backend), n_(0) {
+    std::fill(d_, d_ + 3, nullptr);
+}
+
+bool StreamSession::prepare(size_t n, std::string* err) {
+    for (int i = 0; i < 3; ++i) {
+        d_[i] = static_cast<double*>(pool_.get(i, n * sizeof(double), err));
+        if (!d_[i]) return false;
+        init_[i].resize(n);
+        for (size_t j = 0; j < n; ++j) init_[i][j] = initial(i, j);
+    }
+    n_ = n;
+    return true;
+}
+
+bool StreamSession::reset(StreamOp op, std::string* err) {
+    std::vector<double> poison(n_, std::numeric_limits<double>::quiet_NaN());
+    for (int i = 0; i < 3; ++i) {
+        const std::vector<double>& src = i == kDest[op] ? poison : init_[i];
+        if (!backend_.upload(d_[i], src.data(), n_ * sizeof(double), err)) return false;
+    }
+    return true;
+}
+
+bool StreamSession::time(StreamOp op, int block, int grid, int iterations, double* seconds,
+                         std::string* err) {
+    BenchBackend* backend = &backend_;
+    double *a = d_[0], *b = d_[1], *c = d_[2];
+    size_t n = n_;
+    std::function<bool()> launch = [=]() { return backend->launchStream(op, block, grid, a, b, c, kScalar, n, err); };
+    double warm = 0.0;
+    return backend_.timeBatch(launch, 1, &warm, err) && backend_.timeBatch(launch, iterations, seconds, err);
+}
+
+bool StreamSession::check(StreamOp op, StreamCheck* check, std::string* err) {
+    std::vector<double> out(n_), ref[3] = {init_[0], init_[1], init_[2]};
+    if (!backend_.download(out.data(), d_[kDest[op]], n_ * sizeof(double), err)) return false;
+    for (size_t i = 0; i < n_; ++i) streamElement(op, ref[0].data(), ref[1].data(), ref[2].data(), kScalar, i);
+    const std::vector<double>& expect = ref[kDest[op]];
+    // exact on small integers unless the device contracts q * c + b differently
+    check->tolerance = DBL_EPSILON;
+    check->max_err = 0.0;
+    for (size_t i = 0; i < n_; ++i) {
+        double e = std::fabs(out[i] - expect[i]) / std::max(1.0, std::fabs(expect[i]));
+        trackMaxError(e, &check->max_err);
+    }
+    check->ok = check->max_err <= check->tolerance;
+    return true;
+}
+
+std::string streamSummaryLine(StreamOp op, int block, const StreamArgs& args, const StreamTiming& t,
+                              int num_sm, const StreamCheck* check) {
+    double gbs = streamBandwidth(op, args.n, args.iterations, t.time_s) / 1e9;
+    char buf[512];
+    int len = snprintf(buf, sizeof(buf),
+                       "kernel_name=stream_%s,problem_size=%zu,iterations=%d,time_s=%.9f,bandwidth_gbs=%.3f,"
+                       "occupancy=%.3f,active_blocks_per_sm=%d,block=%d,grid=%d,numSM=%d",
+                       streamOpName(op), args.n, args.iterations, t.time_s, gbs, t.occupancy, t.active_blocks,
+                       block, t.grid_blocks, num_sm);
+    if (check && len > 0 && static_cast<size_t>(len) < sizeof(buf))
+        snprintf(buf + len, sizeof(buf) - len, ",verify=%s,max_err=%.3e", check->ok ? "pass" : "fail",
+                 check->max_err);
+    return buf;
+}
+
+int streamMain(int argc, char** argv, BackendFactory makeBackend) {
+    StreamArgs args;
+    std::string err;
+    if (!parseStreamArgs(argc, argv, &args, &err)) {
+        fprintf(stderr, "%s: %s\n", argv[0], err.c_str());
+        fprintf(stderr, "Usage: %s N iterations [--op=NAME[,NAME...]|all] [--block=N[,N...]]\n"
+                        "       [--grid=BLOCKS_PER_SM|full[,...]] [--verify]\n", argv[0]);
+        return BENCH_EXIT_USAGE;
+    }
+
+    std::unique_ptr<BenchBackend> backend = makeBackend(&err);
+    if (!backend) {
+        fprintf(stderr, "%s: %s\n", argv[0], err.c_str());
+        return BENCH_EXIT_BACKEND;
+    }
+    StreamSession session(*backend);
+    if (!session.prepare(args.n, &err)) {
+        fprintf(stderr, "%s: %s\n", argv[0], err.c_str());
+        return BENCH_EXIT_BACKEND;
+    }
+
+    const DeviceInfo& dev = backend->device();
+    int status = BENCH_EXIT_OK;
+    for (StreamOp op : args.ops) {
+        for (int block : args.blocks) {
+            StreamTiming timing;
+            timing.active_blocks = backend->streamActiveBlocks(op, block);
+            if (dev.max_threads_per_sm > 0)
+                timing.occupancy = std::min(1.0, static_cast<double>(timing.active_blocks) * block /
+                                                     dev.max_threads_per_sm);
+            for (int grid : args.grids) {
+                timing.grid_blocks = streamGridBlocks(grid, block, args.n, dev);
+                if (!session.reset(op, &err) ||
+                    !session.time(op, block, timing.grid_blocks, args.iterations, &timing.time_s, &err)) {
+                    fprintf(stderr, "%s: stream_%s: %s\n", argv[0], streamOpName(op), err.c_str());
+                    return BENCH_EXIT_BACKEND;
+                }
+                StreamCheck check;
+                if (args.verify) {
+                    if (!session.check(op, &check, &err)) {
+                        fprintf(stderr, "%s: stream_%s: %s\n", argv[0], streamOpName(op), err.c_str());
+                        return BENCH_EXIT_BACKEND;
+                    }
+                    if (!check.ok) status = BENCH_EXIT_VERIFY;
+                }
+                printf("%s\n", streamSummaryLine(op, block, args, timing, dev.num_sm,
+                                                 args.verify ? &check : nullptr).c_str());
+                fflush(stdout);
+            }
+        }
+    }
+    return status;
+}
+
+} // namespace gpu_monitor
@@ -0,0 +1,97 @@
+// stream_harness.h
+// STREAM suite on the benchmark harness: copy, scale, add and triad (stream_ops.h)
+// over three device arrays of doubles, swept over block sizes and grid sizes. Each
+// configuration reports the bandwidth it achieved next to the theoretical occupancy
+// of its kernel (cudaOccupancyMaxActiveBlocksPerMultiprocessor through the backend),
+// so memory-bound behaviour can be set against the memory clock while GEMM covers
+// the SM clock. Like gemm_harness.h nothing here depends on CUDA: stream_benchmark.cu
+// runs it on the GPU, stream_host.cpp on the CPU emulation used by the tests.
+
+#ifndef STREAM_HARNESS_H
+#define STREAM_HARNESS_H
+
+#include "bench_backend.h"
+#include "bench_util.h"
+#include "device_buffer_pool.h"
+#include "stream_ops.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace gpu_monitor {
+
+// Grid size of a sweep point: blocks per SM, or kStreamGridFull for one element per
+// thread (as many blocks as the arrays need, up to the device's grid limit).
+const int kStreamGridFull = 0;
+
+struct StreamArgs {
+    size_t n = 0;                  // elements per array
+    int iterations = 0;            // launches timed per configuration
+    std::vector<StreamOp> ops;     // --op=NAME[,NAME...]|all; default all
+    std::vector<int> blocks;       // --block=N[,N...]: threads per block, default 256
+    std::vector<int> grids;        // --grid=G[,G...]: blocks per SM or "full", default full
+    bool verify = false;
+};
+
+// Parse "N iterations [--op=...] [--block=...] [--grid=...] [--verify]" (options may
+// appear anywhere). Block sizes must be multiples of 32 up to 1024. Returns false
+// with a message in *err.
+bool parseStreamArgs(int argc, char** argv, StreamArgs* args, std::string* err);
+
+// Blocks launched for grid (blocks per SM or kStreamGridFull) on device.
+int streamGridBlocks(int grid, int block, size_t n, const DeviceInfo& device);
+
+struct StreamTiming {
+    double time_s = 0.0;       // all iterations, warmup excluded
+    int active_blocks = 0;     // resident blocks per SM the kernel allows; 0 if unknown
+    double occupancy = 0.0;    // active_blocks * block / max threads per SM
+    int grid_blocks = 0;
+};
+
+// Bytes moved per second by iterations launches of op over n elements in seconds.
+double streamBandwidth(StreamOp op, size_t n, long long iterations, double seconds);
+
+struct StreamCheck {
+    double max_err = 0.0;  // max |out - ref| / |ref| over the written array
+    double tolerance = 0.0;
+    bool ok = true;
+};
+
+// The arrays a, b and c resident on a backend (pooled device buffers) with known
+// initial contents, so every configuration can be checked.
+class StreamSession {
+public:
+    explicit StreamSession(BenchBackend& backend);
+
+    // Allocate n-element arrays and compute their initial contents.
+    bool prepare(size_t n, std::string* err);
+    // Upload the initial arrays, with NaN in the one op writes, so elements a launch
+    // configuration fails to cover fail verification.
+    bool reset(StreamOp op, std::string* err);
+    // One warmup launch of grid blocks of block threads, then iterations launches
+    // between one timestamp pair; *seconds is the total.
+    bool time(StreamOp op, int block, int grid, int iterations, double* seconds, std::string* err);
+    // Download the array op writes and compare it with op applied on the host.
+    bool check(StreamOp op, StreamCheck* check, std::string* err);
+
+private:
+    BenchBackend& backend_;
+    DeviceBufferPool pool_;
+    size_t n_;
+    std::vector<double> init_[3];
+    double* d_[3];
+};
+
+// Summary line parsed by run_gpu_benchmark.sh:
+// kernel_name=stream_<op>,problem_size=N,iterations=..,time_s=..,bandwidth_gbs=..,
+// occupancy=..,active_blocks_per_sm=..,block=..,grid=..,numSM=..[,verify=pass|fail,max_err=..]
+std::string streamSummaryLine(StreamOp op, int block, const StreamArgs& args, const StreamTiming& t,
+                              int num_sm, const StreamCheck* check);
+
+// Command-line front end: one line per op, block size and grid size, in that order.
+int streamMain(int argc, char** argv, BackendFactory makeBackend);
+
+} // namespace gpu_monitor
+
+#endif // STREAM_HARNESS_H
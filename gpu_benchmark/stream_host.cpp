@@ -0,0 +1,7 @@
+// stream_host.cpp - stream_benchmark_host: the STREAM front end on the CPU backend
+// (bench_backend_host.cpp), for testing the sweep and the checks without a GPU.
+#include "stream_harness.h"
+
+int main(int argc, char** argv) {
+    return gpu_monitor::streamMain(argc, argv, gpu_monitor::makeHostBackend);
+}
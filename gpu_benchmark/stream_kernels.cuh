@@ -0,0 +1,48 @@
+// stream_kernels.cuh
+// CUDA kernels of the STREAM suite (stream_ops.h). One grid-stride loop per op, so any
+// block and grid size covers the arrays: a grid of one element per thread makes each
+// thread do one element, a grid of a few blocks per SM makes each loop many times.
+// The op is a template parameter, so every kernel is a straight load/store loop.
+
+#ifndef STREAM_KERNELS_CUH
+#define STREAM_KERNELS_CUH
+
+#include "stream_ops.h"
+
+#include <cuda_runtime.h>
+
+namespace gpu_monitor {
+
+template <StreamOp OP>
+__global__ void stream_kernel(double* __restrict__ a, double* __restrict__ b, double* __restrict__ c,
+                              double q, size_t n) {
+    size_t stride = static_cast<size_t>(blockDim.x) * gridDim.x;
+    for (size_t i = static_cast<size_t>(blockIdx.x) * blockDim.x + threadIdx.x; i < n; i += stride)
+        streamElement(OP, a, b, c, q, i);
+}
+
+// Kernel entry point of op, for cudaOccupancyMaxActiveBlocksPerMultiprocessor.
+inline const void* streamKernel(StreamOp op) {
+    switch (op) {
+    case STREAM_COPY: return reinterpret_cast<const void*>(stream_kernel<STREAM_COPY>);
+    case STREAM_SCALE: return reinterpret_cast<const void*>(stream_kernel<STREAM_SCALE>);
+    case STREAM_ADD: return reinterpret_cast<const void*>(stream_kernel<STREAM_ADD>);
+    default: return reinterpret_cast<const void*>(stream_kernel<STREAM_TRIAD>);
+    }
+}
+
+// Launch op once on stream; returns the launch error, if any.
+inline cudaError_t launchStream(StreamOp op, int block, int grid, double* a, double* b, double* c,
+                                double q, size_t n, cudaStream_t stream = 0) {
+    switch (op) {
+    case STREAM_COPY: stream_kernel<STREAM_COPY><<<grid, block, 0, stream>>>(a, b, c, q, n); break;
+    case STREAM_SCALE: stream_kernel<STREAM_SCALE><<<grid, block, 0, stream>>>(a, b, c, q, n); break;
+    case STREAM_ADD: stream_kernel<STREAM_ADD><<<grid, block, 0, stream>>>(a, b, c, q, n); break;
+    default: stream_kernel<STREAM_TRIAD><<<grid, block, 0, stream>>>(a, b, c, q, n); break;
+    }
+    return cudaGetLastError();
+}
+
+} // namespace gpu_monitor
+
+#endif // STREAM_KERNELS_CUH
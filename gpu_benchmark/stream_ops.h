@@ -0,0 +1,45 @@
+// stream_ops.h
+// The four STREAM kernels (McCalpin) on double arrays a, b, c and scalar q, shared by
+// the CUDA kernels (stream_kernels.cuh), the host backend's emulation and the
+// --verify reference:
+//
+//   copy   c = a          2 arrays moved per element
+//   scale  b = q * c      2
+//   add    c = a + b      3
+//   triad  a = b + q * c  3
+//
+// Each op reads only arrays it does not write, so repeating it leaves the same result
+// and a timed batch of any length can be checked against one application.
+
+#ifndef STREAM_OPS_H
+#define STREAM_OPS_H
+
+#include <cstddef>
+
+#ifdef __CUDACC__
+#define STREAM_HD __host__ __device__ __forceinline__
+#else
+#define STREAM_HD inline
+#endif
+
+namespace gpu_monitor {
+
+enum StreamOp { STREAM_COPY, STREAM_SCALE, STREAM_ADD, STREAM_TRIAD, STREAM_OP_COUNT };
+
+// "copy", "scale", "add", "triad"
+const char* streamOpName(StreamOp op);
+// Arrays read or written per element (bytes moved = arrays * sizeof(double) * n).
+int streamOpArrays(StreamOp op);
+
+STREAM_HD void streamElement(StreamOp op, double* a, double* b, double* c, double q, size_t i) {
+    switch (op) {
+    case STREAM_COPY: c[i] = a[i]; break;
+    case STREAM_SCALE: b[i] = q * c[i]; break;
+    case STREAM_ADD: c[i] = a[i] + b[i]; break;
+    default: a[i] = b[i] + q * c[i]; break;
+    }
+}
+
+} // namespace gpu_monitor
+
+#endif // STREAM_OPS_H
@@ -0,0 +1,100 @@
+// streaming_stats.cpp - Welford running statistics and log-bucket quantile sketch
+#include "streaming_stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace gpu_monitor {
+
+RunningStats::RunningStats() : count_(0), mean_(0.0), m2_(0.0), min_(0.0), max_(0.0) {}
+
+void RunningStats::add(double x) {
+    if (count_ == 0) {
+        min_ = max_ = x;
+    } else {
+        if (x < min_) min_ = x;
+        if (x > max_) max_ = x;
+    }
+    ++count_;
+    double delta = x - mean_;
+    mean_ += delta / count_;
+    m2_ += delta * (x - mean_);
+}
+
+double RunningStats::variance() const {
+    return count_ > 1 ? m2_ / count_ : 0.0;
+}
+
+double RunningStats::stddev() const {
+    return std::sqrt(variance());
+}
+
+QuantileSketch::QuantileSketch(double relative_accuracy, double min_value)
+    : gamma_((1.0 + relative_accuracy) / (1.0 - relative_accuracy)),
+      log_gamma_(std::log(gamma_)),
+      min_value_(min_value),
+      count_(0),
+      zero_count_(0),
+      offset_(0),
+      min_(0.0),
+      max_(0.0) {}
+
+int QuantileSketch::bucketIndex(double x) const {
+    return (int)std::ceil(std::log(x) / log_gamma_);
+}
+
+void QuantileSketch::add(double x) {
+    if (count_ == 0) {
+        min_ = max_ = x;
+    } else {
+        if (x < min_) min_ = x;
+        if (x > max_) max_ = x;
+    }
+    ++count_;
+
+    if (x < min_value_) {
+        ++zero_count_;
+        return;
+    }
+    int idx = bucketIndex(x);
+    if (counts_.empty()) {
+        offset_ = idx;
+        counts_.assign(1, 0);
+    } else if (idx < offset_) {
+        counts_.insert(counts_.begin(), (size_t)(offset_ - idx), 0);
+        offset_ = idx;
+    } else if (idx >= offset_ + (int)counts_.size()) {
+        counts_.resize((size_t)(idx - offset_ + 1), 0);
+    }
+    ++counts_[(size_t)(idx - offset_)];
+}
+
+double QuantileSketch::quantile(double q) const {
+    if (count_ == 0) return 0.0;
+    if (q <= 0.0) return min_;
+    if (q >= 1.0) return max_;
+
+    // Nearest-rank: smallest value with at least ceil(q*n) observations <= it
+    uint64_t rank = (uint64_t)std::ceil(q * count_);
+    if (rank == 0) rank = 1;
+    uint64_t seen = zero_count_;
+    if (seen >= rank) return min_;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        seen += counts_[i];
+        if (seen >= rank) {
+            // Bucket midpoint in the relative sense, clamped to the observed range
+            double v = 2.0 * std::pow(gamma_, (double)(offset_ + (int)i)) / (gamma_ + 1.0);
+            return std::min(std::max(v, min_), max_);
+        }
+    }
+    return max_;
+}
+
+MetricStats::MetricStats() {}
+
+void MetricStats::add(double x) {
+    stats_.add(x);
+    sketch_.add(x);
+}
+
+} // namespace gpu_monitor
@@ -0,0 +1,84 @@
+// streaming_stats.h
+// Constant-memory statistics for long monitoring runs: running mean/variance/min/max
+// (Welford) and a relative-error quantile sketch (log-spaced buckets, as in DDSketch).
+
+#ifndef STREAMING_STATS_H
+#define STREAMING_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gpu_monitor {
+
+// Running count, mean, variance, min and max of a stream.
+class RunningStats {
+public:
+    RunningStats();
+
+    void add(double x);
+
+    uint64_t count() const { return count_; }
+    double mean() const { return mean_; }
+    double variance() const;  // population variance
+    double stddev() const;
+    double min() const { return count_ ? min_ : 0.0; }
+    double max() const { return count_ ? max_ : 0.0; }
+
+private:
+    uint64_t count_;
+    double mean_;
+    double m2_;
+    double min_;
+    double max_;
+};
+
+// Quantile sketch with bounded relative error: positive values fall into buckets
+// [gamma^(i-1), gamma^i) with gamma = (1+a)/(1-a), so any quantile is returned within
+// a fraction a of the true value. Values below min_value share a zero bucket. The
+// bucket array only spans the observed value range, so memory is bounded by
+// log(max/min_value)/log(gamma) counters regardless of the number of samples, and
+// discrete traces (clock steps, integer utilization) do not smear between levels.
+class QuantileSketch {
+public:
+    explicit QuantileSketch(double relative_accuracy = 0.005, double min_value = 1e-3);
+
+    void add(double x);
+    double quantile(double q) const;  // q in [0,1]
+    uint64_t count() const { return count_; }
+    size_t buckets() const { return counts_.size(); }
+
+private:
+    int bucketIndex(double x) const;
+
+    double gamma_;
+    double log_gamma_;
+    double min_value_;
+    uint64_t count_;
+    uint64_t zero_count_;
+    int offset_;                   // bucket index of counts_[0]
+    std::vector<uint64_t> counts_;
+    double min_;
+    double max_;
+};
+
+// RunningStats plus a quantile sketch for one metric.
+class MetricStats {
+public:
+    MetricStats();
+
+    void add(double x);
+
+    const RunningStats& stats() const { return stats_; }
+    double p50() const { return sketch_.quantile(0.50); }
+    double p95() const { return sketch_.quantile(0.95); }
+    double p99() const { return sketch_.quantile(0.99); }
+
+private:
+    RunningStats stats_;
+    QuantileSketch sketch_;
+};
+
+} // namespace gpu_monitor
+
+#endif // STREAMING_STATS_H
@@ -0,0 +1,59 @@
+// throttle_reasons.cpp - clock throttle reason names and time accounting
+#include "throttle_reasons.h"
+
+namespace gpu_monitor {
+
+const ThrottleReasonInfo kThrottleReasons[kNumThrottleReasons] = {
+    {0x0000000000000001ULL, "gpu_idle", false},
+    {0x0000000000000002ULL, "applications_clocks", false},
+    {0x0000000000000004ULL, "sw_power_cap", true},
+    {0x0000000000000008ULL, "hw_slowdown", true},
+    {0x0000000000000010ULL, "sync_boost", true},
+    {0x0000000000000020ULL, "sw_thermal", true},
+    {0x0000000000000040ULL, "hw_thermal", true},
+    {0x0000000000000080ULL, "hw_power_brake", true},
+    {0x0000000000000100ULL, "display_clocks", false},
+};
+
+unsigned long long contaminatingThrottleMask() {
+    unsigned long long m = 0;
+    for (const ThrottleReasonInfo& r : kThrottleReasons) {
+        if (r.contaminating) m |= r.mask;
+    }
+    return m;
+}
+
+std::string throttleReasonNames(unsigned long long mask) {
+    std::string out;
+    for (const ThrottleReasonInfo& r : kThrottleReasons) {
+        if (!(mask & r.mask)) continue;
+        if (!out.empty()) out += "|";
+        out += r.name;
+    }
+    return out.empty() ? "none" : out;
+}
+
+void ThrottleTime::add(double t_s, unsigned long long mask) {
+    if (has_prev_ && t_s > prev_t_) {
+        double dt = t_s - prev_t_;
+        observed_s += dt;
+        for (size_t i = 0; i < kNumThrottleReasons; ++i) {
+            if (prev_mask_ & kThrottleReasons[i].mask) reason_s[i] += dt;
+        }
+        if (prev_mask_ & contaminatingThrottleMask()) contaminated_s += dt;
+    }
+
+    // A failed reading ends the current interval; time until the next valid reading
+    // is not attributed to any reason.
+    if (mask == kThrottleReasonsUnavailable) {
+        has_prev_ = false;
+        return;
+    }
+    supported = true;
+    seen_mask |= mask;
+    has_prev_ = true;
+    prev_t_ = t_s;
+    prev_mask_ = mask;
+}
+
+} // namespace gpu_monitor
@@ -0,0 +1,55 @@
+// throttle_reasons.h
+// Clock throttle reasons reported by nvmlDeviceGetCurrentClocksThrottleReasons and the
+// time a run spent under each of them. Reasons that lower clocks behind the
+// experiment's back (power cap, thermal, power brake, sync boost) mark the run as
+// contaminated; idle and application/display clock settings are intentional or benign.
+
+#ifndef THROTTLE_REASONS_H
+#define THROTTLE_REASONS_H
+
+#include <cstddef>
+#include <string>
+
+namespace gpu_monitor {
+
+// Bit values match nvmlClocksThrottleReason* in nvml.h (spelled out because older
+// headers lack the newer reasons).
+struct ThrottleReasonInfo {
+    unsigned long long mask;
+    const char* name;
+    bool contaminating;
+};
+
+const size_t kNumThrottleReasons = 9;
+extern const ThrottleReasonInfo kThrottleReasons[kNumThrottleReasons];
+
+// Stored in PassSample::throttle when the device could not report its reasons.
+const unsigned long long kThrottleReasonsUnavailable = ~0ULL;
+
+// Union of the contaminating reason bits.
+unsigned long long contaminatingThrottleMask();
+
+// "sw_power_cap|hw_thermal" for a mask, "none" for 0. Unknown bits are ignored.
+std::string throttleReasonNames(unsigned long long mask);
+
+// Time spent under each reason. Readings are held until the next one, so the interval
+// between two samples is charged to the reasons seen at its start.
+struct ThrottleTime {
+    bool supported = false;            // at least one valid reading
+    double reason_s[kNumThrottleReasons] = {};
+    double contaminated_s = 0.0;       // under any contaminating reason
+    double observed_s = 0.0;           // time covered by valid readings
+    unsigned long long seen_mask = 0;  // every reason observed at least once
+
+    void add(double t_s, unsigned long long mask);
+    double contaminatedPct() const { return observed_s > 0.0 ? contaminated_s / observed_s * 100.0 : 0.0; }
+
+private:
+    bool has_prev_ = false;
+    double prev_t_ = 0.0;
+    unsigned long long prev_mask_ = 0;
+};
+
+} // namespace gpu_monitor
+
+#endif // THROTTLE_REASONS_H
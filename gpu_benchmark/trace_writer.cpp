@@ -0,0 +1,184 @@
+// trace_writer.cpp - background writer for per-sample GPU traces
+#include "trace_writer.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace gpu_monitor {
+
+// The writer thread wakes when this many records are queued, or after kFlushInterval
+// otherwise, so the trace on disk lags the run by a bounded amount.
+static const size_t kWakeRecords = 1024;
+static const std::chrono::milliseconds kFlushInterval(200);
+
+// Binary traces are little-endian whatever the host byte order
+static unsigned char* putLE32(unsigned char* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = (unsigned char)(v >> (8 * i));
+    return p + 4;
+}
+
+static unsigned char* putLE64(unsigned char* p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) p[i] = (unsigned char)(v >> (8 * i));
+    return p + 8;
+}
+
+// Encodes r as the 40-byte on-disk record (field order of TraceRecord)
+static void encodeRecord(const TraceRecord& r, unsigned char* p) {
+    uint64_t t_bits;
+    uint32_t power_bits;
+    std::memcpy(&t_bits, &r.t_s, sizeof(t_bits));
+    std::memcpy(&power_bits, &r.power_w, sizeof(power_bits));
+    p = putLE64(p, t_bits);
+    p = putLE64(p, r.throttle);
+    p = putLE32(p, power_bits);
+    p = putLE32(p, r.gpu);
+    p = putLE32(p, r.sm_mhz);
+    p = putLE32(p, r.mem_mhz);
+    p = putLE32(p, r.util_pct);
+    putLE32(p, r.temp_c);
+}
+
+TraceWriter::TraceWriter()
+    : file_(nullptr), format_(CSV), max_pending_(0), stop_(false), failed_(false), written_(0), dropped_(0) {}
+
+TraceWriter::~TraceWriter() {
+    close();
+}
+
+bool TraceWriter::open(const std::string& path, Format format, size_t max_pending) {
+    if (file_) return false;
+    // "e": close-on-exec, the monitored command must not inherit the trace file
+    file_ = std::fopen(path.c_str(), format == BINARY ? "wbe" : "we");
+    if (!file_) return false;
+    // Large stdio buffer: the writer thread issues few, big write(2) calls
+    std::setvbuf(file_, nullptr, _IOFBF, 1 << 20);
+
+    format_ = format;
+    max_pending_ = max_pending;
+    pending_.reserve(kWakeRecords * 2);
+    stop_ = false;
+    failed_ = false;
+    written_ = dropped_ = 0;
+
+    bool ok;
+    if (format_ == BINARY) {
+        unsigned char header[16];
+        std::memcpy(header, "GPUTRACE", 8);
+        putLE32(putLE32(header + 8, 1), sizeof(TraceRecord));  // version, record size
+        ok = std::fwrite(header, sizeof(header), 1, file_) == 1;
+    } else {
+        ok = std::fputs("t_s,gpu,power_w,sm_mhz,mem_mhz,util_pct,temp_c,throttle_reasons\n", file_) >= 0;
+    }
+    if (!ok) {
+        std::fclose(file_);
+        file_ = nullptr;
+        return false;
+    }
+
+    thread_ = std::thread(&TraceWriter::run, this);
+    return true;
+}
+
+void TraceWriter::push(const DeviceSet& devs, const PassSample& s) {
+    if (!file_) return;
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        for (size_t d = 0; d < s.size(); ++d) {
+            if (pending_.size() >= max_pending_) {
+                ++dropped_;
+                continue;
+            }
+            TraceRecord r;
+            r.t_s = s.dev_t_s[d];
+            r.throttle = s.throttle[d];
+            r.power_w = s.power_ok[d] ? (float)s.power_w[d] : NAN;
+            r.gpu = devs.index[d];
+            r.sm_mhz = s.sm_mhz[d];
+            r.mem_mhz = s.mem_mhz[d];
+            r.util_pct = s.util_pct[d];
+            r.temp_c = s.temp_c[d];
+            pending_.push_back(r);
+        }
+        wake = pending_.size() >= kWakeRecords;
+    }
+    if (wake) cv_.notify_one();
+}
+
+bool TraceWriter::writeBatch(const std::vector<TraceRecord>& batch) {
+    if (batch.empty()) return true;
+    if (format_ == BINARY) {
+        encoded_.resize(batch.size() * sizeof(TraceRecord));
+        for (size_t i = 0; i < batch.size(); ++i) encodeRecord(batch[i], &encoded_[i * sizeof(TraceRecord)]);
+        return std::fwrite(encoded_.data(), 1, encoded_.size(), file_) == encoded_.size();
+    }
+    for (const TraceRecord& r : batch) {
+        char reasons[24] = "";
+        if (r.throttle != kThrottleReasonsUnavailable)
+            std::snprintf(reasons, sizeof(reasons), "0x%llx", (unsigned long long)r.throttle);
+        if (std::fprintf(file_, "%.6f,%u,%.3f,%u,%u,%u,%u,%s\n", r.t_s, r.gpu, r.power_w, r.sm_mhz,
+                         r.mem_mhz, r.util_pct, r.temp_c, reasons) < 0)
+            return false;
+    }
+    return true;
+}
+
+void TraceWriter::run() {
+    std::vector<TraceRecord> batch;
+    batch.reserve(kWakeRecords * 2);
+    std::unique_lock<std::mutex> lock(mu_);
+    while (true) {
+        cv_.wait_for(lock, kFlushInterval, [this] { return stop_ || pending_.size() >= kWakeRecords; });
+        // Swap buffers so the sampler keeps appending while this batch is written
+        batch.swap(pending_);
+        bool stopping = stop_;
+        lock.unlock();
+
+        bool ok = writeBatch(batch) && std::fflush(file_) == 0;
+
+        lock.lock();
+        if (ok) written_ += batch.size();
+        else failed_ = true;
+        batch.clear();
+        if (stopping && pending_.empty()) break;
+    }
+}
+
+bool TraceWriter::close() {
+    if (!file_) return true;
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+
+    bool ok = !failed_;
+    if (std::fclose(file_) != 0) ok = false;
+    file_ = nullptr;
+    return ok;
+}
+
+uint64_t TraceWriter::written() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return written_;
+}
+
+uint64_t TraceWriter::dropped() const {
+    std::lock_guard<std::mutex> lock(mu_);
+    return dropped_;
+}
+
+bool parseTraceFormat(const std::string& s, TraceWriter::Format* out) {
+    if (s == "csv") {
+        *out = TraceWriter::CSV;
+    } else if (s == "bin" || s == "binary") {
+        *out = TraceWriter::BINARY;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+} // namespace gpu_monitor
@@ -0,0 +1,90 @@
+// trace_writer.h
+// Per-sample time-series output for gpu_monitor_nvml. The sampling loop appends one
+// record per device and pass to an in-memory queue; a background thread formats the
+// queued records and writes them to disk, so a slow or stalled filesystem never
+// delays the next sample.
+//
+// Formats:
+//   csv     header "t_s,gpu,power_w,sm_mhz,mem_mhz,util_pct,temp_c,throttle_reasons",
+//           one line per record, throttle reasons as a hex bitmask (empty when the
+//           device could not report them); power_w is nan when the read failed
+//   binary  16-byte header: magic "GPUTRACE", uint32 version (1), uint32 record size
+//           (40), followed by packed TraceRecord structs; every field is written
+//           little-endian explicitly, so traces read the same on any host
+
+#ifndef TRACE_WRITER_H
+#define TRACE_WRITER_H
+
+#include "gpu_devices.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace gpu_monitor {
+
+// One device reading; the binary format stores these fields in this order, packed.
+struct TraceRecord {
+    double t_s;              // seconds since monitor start
+    uint64_t throttle;       // nvmlClocksThrottleReason* bitmask, all ones if unavailable
+    float power_w;
+    uint32_t gpu;            // NVML index
+    uint32_t sm_mhz;
+    uint32_t mem_mhz;
+    uint32_t util_pct;
+    uint32_t temp_c;
+};
+static_assert(sizeof(TraceRecord) == 40, "TraceRecord must stay packed (binary trace format)");
+
+class TraceWriter {
+public:
+    enum Format { CSV, BINARY };
+
+    TraceWriter();
+    ~TraceWriter();
+
+    // Opens path and starts the writer thread. At most max_pending records wait in
+    // memory; beyond that new records are dropped and counted rather than blocking
+    // the sampler.
+    bool open(const std::string& path, Format format, size_t max_pending = 1 << 16);
+    bool isOpen() const { return file_ != nullptr; }
+
+    // Queues one record per device of the pass. Never performs I/O.
+    void push(const DeviceSet& devs, const PassSample& s);
+
+    // Drains the queue, stops the thread and closes the file. Returns false if any
+    // write failed.
+    bool close();
+
+    uint64_t written() const;
+    uint64_t dropped() const;
+
+private:
+    void run();
+    bool writeBatch(const std::vector<TraceRecord>& batch);
+
+    FILE* file_;
+    Format format_;
+    size_t max_pending_;
+    std::thread thread_;
+    std::vector<unsigned char> encoded_;  // binary batch being written (writer thread only)
+
+    mutable std::mutex mu_;
+    std::condition_variable cv_;
+    std::vector<TraceRecord> pending_;  // filled by the sampler, swapped out by run()
+    bool stop_;
+    bool failed_;
+    uint64_t written_;
+    uint64_t dropped_;
+};
+
+// Parses "csv" / "bin" / "binary"; returns false for anything else.
+bool parseTraceFormat(const std::string& s, TraceWriter::Format* out);
+
+} // namespace gpu_monitor
+
+#endif // TRACE_WRITER_H
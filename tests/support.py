@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""
+Helpers shared by the test scripts that drive a built binary: the key=value line and
+report parsers, the subprocess runner, the skip decorator for an unset or missing
+binary, a fake powercap tree for the RAPL readers (rapl_domains.cpp), a TestCase base
+for the benchmark front ends (gemm, stencil, pipeline, stream, hetero_gemm), which
+share their usage and exit-code conventions (bench_util.h), and one for the monitors
+(gpu_monitor_nvml, node_monitor) running against the mock NVML library.
+
+The scripts run from this directory, so a plain "import support" finds it.
+"""
+
+import os
+import shutil
+import subprocess
+import tempfile
+import unittest
+
+
+def parse_line(line):
+    """Parse one comma-separated key=value line into an ordered list of pairs"""
+    return [tuple(field.split('=', 1)) for field in line.strip().split(',')]
+
+
+def parse_fields(line):
+    """Parse one comma-separated key=value line into a dict"""
+    return dict(parse_line(line))
+
+
+def read_report(path):
+    """Parse a monitor report file, one key=value per line, into a dict. Values may hold
+    commas (sources=rapl,nvml), so the lines are not split like parse_line does"""
+    result = {}
+    with open(path) as f:
+        for line in f:
+            key, sep, val = line.strip().partition('=')
+            if sep:
+                result[key] = val
+    return result
+
+
+def executable(path):
+    return bool(path) and os.access(path, os.X_OK)
+
+
+def skip_unless_executable(path, variable, what):
+    """Skip a test or TestCase unless the environment variable points at a built binary"""
+    return unittest.skipUnless(executable(path), '%s not set to an executable %s' % (variable, what))
+
+
+def run(cmd, env=None, timeout=120):
+    """Run cmd (arguments converted with str) and capture its output as text"""
+    return subprocess.run([str(c) for c in cmd], stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                          universal_newlines=True, env=env, timeout=timeout)
+
+
+class BenchmarkTestCase(unittest.TestCase):
+    """A benchmark front end: subclasses set binary to the path under test"""
+
+    binary = ''
+
+    def run_benchmark(self, *args):
+        return run([self.binary] + list(args))
+
+    def assert_usage(self, *args):
+        """Invalid arguments: exit code 1 (BENCH_EXIT_USAGE), usage on stderr, nothing on stdout"""
+        proc = self.run_benchmark(*args)
+        self.assertEqual(proc.returncode, 1, proc.stdout)
+        self.assertIn('Usage', proc.stderr)
+        self.assertEqual(proc.stdout, '')
+        return proc
+
+
+class FakePowercap(object):
+    """A powercap tree under root, created with the first zone. energy_uj is written at a
+    fixed width: the readers keep it open and re-read it with pread"""
+
+    WIDTH = 12
+
+    def __init__(self, root):
+        self.root = root
+
+    def add_zone(self, zone, name, energy_uj, max_uj=2 ** 32):
+        """Create zone (e.g. 'intel-rapl:0:1') with its counter files; returns the energy_uj path"""
+        path = os.path.join(self.root, zone)
+        os.makedirs(path)
+        for f, v in (('name', name), ('energy_uj', str(energy_uj).zfill(self.WIDTH)),
+                     ('max_energy_range_uj', str(max_uj))):
+            with open(os.path.join(path, f), 'w') as fh:
+                fh.write(v + '\n')
+        return os.path.join(path, 'energy_uj')
+
+    def set_energy(self, energy_file, energy_uj):
+        fd = os.open(energy_file, os.O_WRONLY)
+        try:
+            os.pwrite(fd, str(energy_uj).zfill(self.WIDTH).encode(), 0)
+        finally:
+            os.close(fd)
+
+    def shell_set_energy(self, *pairs):
+        """Shell snippet that writes each (energy_uj path, value) pair, for a monitored child"""
+        return '; '.join("echo %s > '%s'" % (str(val).zfill(self.WIDTH), path) for path, val in pairs)
+
+
+class MonitorTestCase(unittest.TestCase):
+    """A monitor against the mock NVML library: subclasses set binary, and scenario for the
+    MOCK_NVML_SCRIPT used when run_monitor is given none (see mock_nvml.cpp)"""
+
+    binary = ''
+    scenario = None
+
+    def setUp(self):
+        self.tmpdir = tempfile.mkdtemp(prefix='monitor_test_')
+        self.out_file = os.path.join(self.tmpdir, 'out.txt')
+
+    def tearDown(self):
+        shutil.rmtree(self.tmpdir, ignore_errors=True)
+
+    def write_scenario(self, text):
+        path = os.path.join(self.tmpdir, 'scenario.txt')
+        with open(path, 'w') as f:
+            f.write(text)
+        return path
+
+    def monitor_options(self):
+        """Options passed before the caller's own"""
+        return []
+
+    def run_monitor(self, command, sample_ms=10, scenario=None, options=None, env=None):
+        """Run the monitor on command; returns (returncode, parsed report or None)"""
+        run_env = dict(os.environ)
+        if scenario is None:
+            scenario = self.scenario
+        if scenario is not None:
+            run_env['MOCK_NVML_SCRIPT'] = self.write_scenario(scenario)
+        if env:
+            run_env.update(env)
+        opts = self.monitor_options() + (options or [])
+        proc = run([self.binary] + opts + [sample_ms, self.out_file] + command, env=run_env, timeout=60)
+        self.stderr = proc.stderr
+        out = read_report(self.out_file) if os.path.exists(self.out_file) else None
+        return proc.returncode, out
@@ -0,0 +1,284 @@
+#!/usr/bin/env python3
+"""
+Tests for the dvfsmon monitoring library through its C API examples: sessions with
+dvfsmon_probe (nested regions, RAPL energy from a fake powercap tree including counter
+wrap, missing sources), region markers with dvfsmon_markers (per-thread aggregation,
+nesting limit, energy from the sampler, summary at exit, overhead), and
+find_package(dvfsmon) from a consumer project.
+
+Point DVFSMON_PROBE_BIN at dvfsmon_probe, DVFSMON_MARKERS_BIN at dvfsmon_markers and
+dvfsmon_DIR at the build directory holding dvfsmonConfig.cmake, or run through ctest:
+    cmake -S benchmark_monitor_C -B build && cmake --build build && ctest --test-dir build
+"""
+
+import os
+import shutil
+import subprocess
+import tempfile
+import threading
+import time
+import unittest
+
+from support import FakePowercap, parse_line, run, skip_unless_executable
+
+PROBE_BIN = os.environ.get('DVFSMON_PROBE_BIN', '')
+MARKERS_BIN = os.environ.get('DVFSMON_MARKERS_BIN', '')
+PACKAGE_DIR = os.environ.get('dvfsmon_DIR', '')
+PROBE_SRC = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'benchmark_monitor_C',
+                         'dvfsmon_probe.c')
+
+HEADER_KEYS = ['version', 'energy', 'counters', 'frequency', 'temperature', 'freq_mhz', 'temperature_c']
+REGION_KEYS = ['region', 'depth', 'time_s', 'energy_j', 'power_avg_w', 'instructions', 'cycles', 'ipc',
+               'cache_misses', 'branch_misses']
+SUMMARY_KEYS = ['region', 'calls', 'time_s', 'energy_j', 'power_avg_w', 'instructions', 'cycles', 'ipc',
+                'cache_misses', 'branch_misses']
+MAX_DEPTH = 64
+
+class FakePowercapMixin(object):
+    """A temporary directory with a fake powercap tree (support.py), pointed at by
+    DVFSMON_POWERCAP_ROOT; the tree exists once a zone is added"""
+
+    def setUp(self):
+        self.tmpdir = tempfile.mkdtemp()
+        self.powercap = FakePowercap(os.path.join(self.tmpdir, 'powercap'))
+        self.env = dict(os.environ)
+        self.env['DVFSMON_POWERCAP_ROOT'] = self.powercap.root
+
+    def tearDown(self):
+        shutil.rmtree(self.tmpdir)
+
+
+@skip_unless_executable(PROBE_BIN, 'DVFSMON_PROBE_BIN', 'dvfsmon_probe')
+class ProbeTestCase(FakePowercapMixin, unittest.TestCase):
+
+    def run_probe(self, *args):
+        return run([PROBE_BIN] + list(args), env=self.env, timeout=60)
+
+    def output(self, *args):
+        """Header and the region lines (inner first) of a successful run"""
+        proc = self.run_probe(*args)
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        lines = [dict(parse_line(line)) for line in proc.stdout.splitlines()]
+        self.assertEqual(len(lines), 3, proc.stdout)
+        return lines[0], lines[1], lines[2]
+
+
+class TestRegions(ProbeTestCase):
+
+    def test_keys(self):
+        proc = self.run_probe(10)
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        lines = proc.stdout.splitlines()
+        self.assertEqual([k for k, _ in parse_line(lines[0])], HEADER_KEYS)
+        for line in lines[1:]:
+            self.assertEqual([k for k, _ in parse_line(line)], REGION_KEYS)
+        self.assertRegex(dict(parse_line(lines[0]))['version'], r'^\d+\.\d+\.\d+$')
+
+    def test_nesting(self):
+        _, inner, outer = self.output(200)
+        self.assertEqual((inner['region'], inner['depth']), ('inner', '1'))
+        self.assertEqual((outer['region'], outer['depth']), ('outer', '0'))
+        self.assertGreaterEqual(float(outer['time_s']), 0.2)
+        self.assertGreaterEqual(float(inner['time_s']), 0.1)
+        self.assertLess(float(inner['time_s']), float(outer['time_s']))
+
+    def test_counters_when_available(self):
+        header, inner, outer = self.output(100)
+        if header['counters'] == '0':
+            for r in (inner, outer):
+                self.assertEqual(int(r['instructions']), 0)
+            self.skipTest('perf_event not available here')
+        self.assertGreater(int(inner['instructions']), 0)
+        self.assertLess(int(inner['cycles']), int(outer['cycles']))
+        self.assertGreater(float(outer['ipc']), 0.0)
+
+    def test_usage(self):
+        proc = self.run_probe(1, 2)
+        self.assertEqual(proc.returncode, 1)
+        self.assertIn('Usage', proc.stderr)
+
+
+class TestEnergy(ProbeTestCase):
+
+    def test_no_rapl(self):
+        header, inner, outer = self.output(10)
+        self.assertEqual(header['energy'], '0')
+        self.assertEqual(float(outer['energy_j']), 0.0)
+
+    def test_domains_counted(self):
+        # packages and their DRAM count; core is inside the package and psys contains it
+        files = [self.powercap.add_zone('intel-rapl:0', 'package-0', 1000),
+                 self.powercap.add_zone('intel-rapl:0:0', 'core', 1000),
+                 self.powercap.add_zone('intel-rapl:0:1', 'dram', 1000),
+                 self.powercap.add_zone('intel-rapl:1', 'psys', 1000)]
+        done = threading.Event()
+
+        def bump():
+            time.sleep(0.4)
+            for f in files:
+                self.powercap.set_energy(f, 1000 + 250000)
+            done.set()
+
+        t = threading.Thread(target=bump)
+        t.start()
+        try:
+            header, inner, outer = self.output(1000)
+        finally:
+            t.join()
+        self.assertTrue(done.is_set())
+        self.assertEqual(header['energy'], '1')
+        # package-0 + dram, 0.25 J each, during the outer region
+        self.assertAlmostEqual(float(outer['energy_j']), 0.5, places=6)
+        self.assertAlmostEqual(float(outer['power_avg_w']), 0.5 / float(outer['time_s']), places=2)
+
+    def test_counter_wrap(self):
+        f = self.powercap.add_zone('intel-rapl:0', 'package-0', 999000, max_uj=1000000)
+
+        def wrap():
+            time.sleep(0.4)
+            self.powercap.set_energy(f, 4000)
+
+        t = threading.Thread(target=wrap)
+        t.start()
+        try:
+            _, _, outer = self.output(1000)
+        finally:
+            t.join()
+        # 1000 uJ up to the wrap and 4000 after it
+        self.assertAlmostEqual(float(outer['energy_j']), 0.005, places=6)
+
+    def test_unreadable_zone_skipped(self):
+        self.powercap.add_zone('intel-rapl:0', 'package-0', 1000)
+        os.remove(os.path.join(self.tmpdir, 'powercap', 'intel-rapl:0', 'energy_uj'))
+        header, _, _ = self.output(10)
+        self.assertEqual(header['energy'], '0')
+
+
+@skip_unless_executable(MARKERS_BIN, 'DVFSMON_MARKERS_BIN', 'dvfsmon_markers')
+class TestMarkers(FakePowercapMixin, unittest.TestCase):
+
+    def run_markers(self, *args, **env):
+        run_env = dict(self.env)
+        run_env.update(env)
+        return run([MARKERS_BIN] + list(args), env=run_env)
+
+    def summary(self, *args):
+        """Program line and summary rows (by region name) written to DVFSMON_REGIONS_OUT"""
+        out = os.path.join(self.tmpdir, 'regions.txt')
+        proc = self.run_markers(*args, DVFSMON_REGIONS_OUT=out)
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        with open(out) as fh:
+            lines = fh.read().splitlines()
+        for line in lines:
+            self.assertEqual([k for k, _ in parse_line(line)], SUMMARY_KEYS)
+        rows = [dict(parse_line(line)) for line in lines]
+        return dict(parse_line(proc.stdout)), rows
+
+    def test_aggregated_across_threads(self):
+        _, rows = self.summary(3, 50, '--overhead=1000')
+        by_name = dict((r['region'], r) for r in rows)
+        self.assertEqual(sorted(by_name), ['empty', 'inner', 'outer'])
+        self.assertEqual(int(by_name['outer']['calls']), 150)
+        self.assertEqual(int(by_name['inner']['calls']), 150)
+        self.assertEqual(int(by_name['empty']['calls']), 1000)
+        # inclusive times, rows from the longest
+        self.assertLess(float(by_name['inner']['time_s']), float(by_name['outer']['time_s']))
+        self.assertGreaterEqual(float(by_name['outer']['time_s']), 150 * 20e-6)
+        times = [float(r['time_s']) for r in rows]
+        self.assertEqual(times, sorted(times, reverse=True))
+
+    def test_nesting_limit(self):
+        # regions beyond the maximum depth are skipped, and their ends still balance
+        _, rows = self.summary(0, 0, '--deep=%d' % (MAX_DEPTH + 6), '--overhead=10')
+        by_name = dict((r['region'], r) for r in rows)
+        self.assertEqual(int(by_name['deep']['calls']), MAX_DEPTH)
+        self.assertEqual(int(by_name['empty']['calls']), 10)
+
+    def test_summary_destinations(self):
+        proc = self.run_markers(1, 2, '--overhead=5')
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        names = [dict(parse_line(line))['region'] for line in proc.stderr.splitlines()]
+        self.assertEqual(sorted(names), ['empty', 'inner', 'outer'])
+        proc = self.run_markers(1, 2, DVFSMON_REGIONS_OUT='none')
+        self.assertEqual(proc.returncode, 0)
+        self.assertEqual(proc.stderr, '')
+
+    def test_energy_from_sampler(self):
+        # a package drawing a steady 50 W, published every 2 ms
+        f = self.powercap.add_zone('intel-rapl:0', 'package-0', 0, max_uj=2 ** 40)
+        stop = threading.Event()
+
+        def draw():
+            t0 = time.monotonic()
+            while not stop.is_set():
+                self.powercap.set_energy(f, int((time.monotonic() - t0) * 50e6))
+                time.sleep(0.002)
+
+        self.env['DVFSMON_SAMPLE_MS'] = '5'
+        t = threading.Thread(target=draw)
+        t.start()
+        try:
+            _, rows = self.summary(1, 1, '--work-us=1000000', '--overhead=10')
+        finally:
+            stop.set()
+            t.join()
+        by_name = dict((r['region'], r) for r in rows)
+        for name, seconds in (('outer', 1.0), ('inner', 0.5)):
+            self.assertAlmostEqual(float(by_name[name]['power_avg_w']), 50.0, delta=5.0)
+            self.assertAlmostEqual(float(by_name[name]['energy_j']), 50.0 * seconds, delta=5.0 * seconds)
+
+    def test_no_energy_without_rapl(self):
+        _, rows = self.summary(1, 3, '--overhead=10')
+        for r in rows:
+            self.assertEqual(float(r['energy_j']), 0.0)
+
+    def test_overhead_under_a_microsecond(self):
+        info, rows = self.summary(0, 0, '--overhead=200000')
+        counters = any(int(r['instructions']) > 0 for r in rows)
+        rdpmc = '/sys/bus/event_source/devices/cpu/rdpmc'
+        if counters and os.path.exists(rdpmc) and open(rdpmc).read().strip() == '0':
+            self.skipTest('counters read through syscalls (rdpmc disabled)')
+        self.assertLess(float(info['marker_ns']), 1000.0)
+
+    def test_usage(self):
+        for args in ((1,), (1, 2, 3), (1, 2, '--fast')):
+            proc = self.run_markers(*args)
+            self.assertEqual(proc.returncode, 1)
+            self.assertIn('Usage', proc.stderr)
+
+
+@unittest.skipUnless(PACKAGE_DIR and os.path.isfile(os.path.join(PACKAGE_DIR, 'dvfsmonConfig.cmake'))
+                     and shutil.which('cmake'), 'dvfsmon_DIR not set to a dvfsmon build directory')
+class TestPackage(unittest.TestCase):
+    """A C project finding the library with find_package(dvfsmon)"""
+
+    def build_consumer(self, target):
+        tmpdir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, tmpdir)
+        src = os.path.join(tmpdir, 'src')
+        os.mkdir(src)
+        with open(os.path.join(src, 'CMakeLists.txt'), 'w') as fh:
+            fh.write('cmake_minimum_required(VERSION 3.10)\n'
+                     'project(consumer C)\n'
+                     'find_package(dvfsmon 1.0 REQUIRED)\n'
+                     'add_executable(consumer %s)\n'
+                     'target_link_libraries(consumer dvfsmon::%s)\n' % (PROBE_SRC, target))
+        build = os.path.join(tmpdir, 'build')
+        for cmd in (['cmake', '-S', src, '-B', build, '-Ddvfsmon_DIR=' + PACKAGE_DIR],
+                    ['cmake', '--build', build]):
+            proc = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                                  universal_newlines=True, timeout=300)
+            self.assertEqual(proc.returncode, 0, proc.stdout)
+        proc = run([os.path.join(build, 'consumer'), 5], timeout=60)
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        self.assertEqual(len(proc.stdout.splitlines()), 3)
+
+    def test_shared(self):
+        self.build_consumer('dvfsmon')
+
+    def test_static(self):
+        self.build_consumer('dvfsmon_static')
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,339 @@
+#!/usr/bin/env python3
+"""
+Tests for the /metrics exporter of the monitor daemon (dvfsmond --listen): Prometheus
+families from a fake sysfs and powercap tree, refresh every period, throttling state,
+keep-alive and pipelined requests, error responses, many concurrent clients and the
+Unix socket lifecycle.
+
+Point DVFSMOND_BIN at dvfsmond, or run through ctest:
+    cmake -S benchmark_monitor_C -B build && cmake --build build && ctest --test-dir build
+"""
+
+import os
+import re
+import shutil
+import signal
+import socket
+import subprocess
+import tempfile
+import threading
+import time
+import unittest
+
+from support import executable, parse_fields, run
+
+DAEMON_BIN = os.environ.get('DVFSMOND_BIN', '')
+NCPUS = os.sysconf('SC_NPROCESSORS_CONF')
+
+SAMPLE_RE = re.compile(r'^([a-z_]+)(\{[^}]*\})? (\S+)$')
+
+
+def parse_metrics(body):
+    """{(name, labels): value} and {name: type} of a Prometheus text body"""
+    samples, types = {}, {}
+    for line in body.splitlines():
+        if line.startswith('# TYPE '):
+            _, _, name, kind = line.split(' ')
+            types[name] = kind
+        elif line and not line.startswith('#'):
+            m = SAMPLE_RE.match(line)
+            assert m, 'bad sample line %r' % line
+            samples[(m.group(1), m.group(2) or '')] = float(m.group(3))
+    return samples, types
+
+
+def write(path, value):
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, 'w') as fh:
+        fh.write('%s\n' % value)
+
+
+class Connection:
+    """Raw HTTP/1.1 client: sends bytes and reads whole responses"""
+
+    def __init__(self, endpoint):
+        kind, _, addr = endpoint.partition(':')
+        if kind == 'unix':
+            self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            self.sock.connect(addr)
+        else:
+            host, _, port = addr.rpartition(':')
+            self.sock = socket.create_connection((host, int(port)))
+        self.sock.settimeout(30)
+        self.buf = b''
+
+    def close(self):
+        self.sock.close()
+
+    def send(self, data):
+        self.sock.sendall(data)
+
+    def response(self):
+        """(status, headers, body) of the next response, or None at end of stream"""
+        while b'\r\n\r\n' not in self.buf:
+            chunk = self.sock.recv(65536)
+            if not chunk:
+                return None
+            self.buf += chunk
+        head, self.buf = self.buf.split(b'\r\n\r\n', 1)
+        lines = head.decode().split('\r\n')
+        headers = dict((k.lower(), v.strip()) for k, v in (l.split(':', 1) for l in lines[1:]))
+        length = int(headers['content-length'])
+        while len(self.buf) < length:
+            chunk = self.sock.recv(65536)
+            if not chunk:
+                break
+            self.buf += chunk
+        body, self.buf = self.buf[:length], self.buf[length:]
+        return int(lines[0].split(' ')[1]), headers, body.decode()
+
+    def get(self, path='/metrics', extra=''):
+        self.send(('GET %s HTTP/1.1\r\nHost: localhost\r\n%s\r\n' % (path, extra)).encode())
+        return self.response()
+
+
+@unittest.skipUnless(executable(DAEMON_BIN), 'DVFSMOND_BIN not set to the built daemon')
+class ExporterTestCase(unittest.TestCase):
+
+    def setUp(self):
+        self.tmpdir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.tmpdir)
+        self.sysfs = os.path.join(self.tmpdir, 'sys')
+        for cpu in range(NCPUS):
+            base = os.path.join(self.sysfs, 'devices', 'system', 'cpu', 'cpu%d' % cpu)
+            write(os.path.join(base, 'cpufreq', 'scaling_cur_freq'), 1200000 + 100000 * cpu)
+            write(os.path.join(base, 'thermal_throttle', 'core_throttle_count'), 3)
+            write(os.path.join(base, 'thermal_throttle', 'package_throttle_count'), 7)
+        for zone, kind, temp in ((0, 'x86_pkg_temp', 51000), (1, 'acpitz', 27800)):
+            base = os.path.join(self.sysfs, 'class', 'thermal', 'thermal_zone%d' % zone)
+            write(os.path.join(base, 'type'), kind)
+            write(os.path.join(base, 'temp'), temp)
+        rapl = os.path.join(self.tmpdir, 'powercap', 'intel-rapl:0')
+        write(os.path.join(rapl, 'name'), 'package-0')
+        write(os.path.join(rapl, 'energy_uj'), 12500000)
+        write(os.path.join(rapl, 'max_energy_range_uj'), 2 ** 50)
+        self.env = dict(os.environ)
+        self.env['DVFSMON_SYSFS_ROOT'] = self.sysfs
+        self.env['DVFSMON_POWERCAP_ROOT'] = os.path.dirname(rapl)
+        self.name = 'dvfsmon_exporter_%d_%s' % (os.getpid(), self._testMethodName)
+        self.sock_path = os.path.join(self.tmpdir, 'metrics.sock')
+
+    def start_daemon(self, *args):
+        """Running daemon and its start-up line, once it is serving"""
+        proc = subprocess.Popen([DAEMON_BIN, '--name=' + self.name] + [str(a) for a in args],
+                                stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True,
+                                env=self.env)
+        self.addCleanup(self.stop_daemon, proc)
+        line = proc.stdout.readline()
+        self.assertTrue(line, proc.stderr.read() if proc.poll() is not None else 'no start-up line')
+        return proc, parse_fields(line)
+
+    def stop_daemon(self, proc):
+        if proc.poll() is None:
+            proc.send_signal(signal.SIGTERM)
+        proc.communicate(timeout=30)
+
+    def connect(self, endpoint):
+        conn = Connection(endpoint)
+        self.addCleanup(conn.close)
+        return conn
+
+    def tcp_daemon(self, *args):
+        proc, started = self.start_daemon('--listen=tcp:0', *args)
+        self.assertRegex(started['listen'], r'^tcp:127\.0\.0\.1:[0-9]+$')
+        return proc, started['listen']
+
+    def scrape(self, endpoint):
+        conn = self.connect(endpoint)
+        status, headers, body = conn.get()
+        self.assertEqual(status, 200)
+        return parse_metrics(body)
+
+
+class TestMetrics(ExporterTestCase):
+
+    def test_families(self):
+        _, endpoint = self.tcp_daemon('--period-ms=20')
+        conn = self.connect(endpoint)
+        status, headers, body = conn.get()
+        self.assertEqual(status, 200)
+        self.assertEqual(headers['content-type'], 'text/plain; version=0.0.4; charset=utf-8')
+        samples, types = parse_metrics(body)
+        for name, kind in (('dvfsmon_energy_joules_total', 'counter'), ('dvfsmon_power_watts', 'gauge'),
+                           ('dvfsmon_cpu_frequency_hertz', 'gauge'), ('dvfsmon_thermal_zone_celsius', 'gauge'),
+                           ('dvfsmon_cpu_throttle_events_total', 'counter'), ('dvfsmon_cpu_throttled', 'gauge'),
+                           ('dvfsmon_samples_total', 'counter'), ('dvfsmon_sample_period_seconds', 'gauge')):
+            self.assertEqual(types.get(name), kind, name)
+            self.assertIn('# HELP %s ' % name, body)
+        self.assertAlmostEqual(samples[('dvfsmon_energy_joules_total', '')], 0.0, delta=1e-6)
+        self.assertEqual(samples[('dvfsmon_power_watts', '')], 0.0)
+        self.assertEqual(samples[('dvfsmon_sample_period_seconds', '')], 0.02)
+        for cpu in range(NCPUS):
+            self.assertEqual(samples[('dvfsmon_cpu_frequency_hertz', '{cpu="%d"}' % cpu)], 1.2e9 + 1e8 * cpu)
+            self.assertEqual(samples[('dvfsmon_cpu_throttle_events_total', '{cpu="%d",scope="core"}' % cpu)], 3)
+            self.assertEqual(samples[('dvfsmon_cpu_throttle_events_total', '{cpu="%d",scope="package"}' % cpu)], 7)
+            self.assertEqual(samples[('dvfsmon_cpu_throttled', '{cpu="%d"}' % cpu)], 0)
+        self.assertEqual(samples[('dvfsmon_thermal_zone_celsius', '{zone="0",type="x86_pkg_temp"}')], 51.0)
+        self.assertEqual(samples[('dvfsmon_thermal_zone_celsius', '{zone="1",type="acpitz"}')], 27.8)
+        # the node temperature comes from the same tree (thermal_zone0), not the real /sys
+        self.assertEqual(samples[('dvfsmon_temperature_celsius', '')], 51.0)
+
+    def test_missing_sources_omitted(self):
+        shutil.rmtree(self.sysfs)
+        self.env['DVFSMON_POWERCAP_ROOT'] = os.path.join(self.tmpdir, 'missing')
+        _, endpoint = self.tcp_daemon()
+        samples, types = self.scrape(endpoint)
+        for name in ('dvfsmon_energy_joules_total', 'dvfsmon_power_watts', 'dvfsmon_cpu_frequency_hertz',
+                     'dvfsmon_temperature_celsius', 'dvfsmon_thermal_zone_celsius', 'dvfsmon_cpu_throttled'):
+            self.assertNotIn(name, types)
+        self.assertGreaterEqual(samples[('dvfsmon_samples_total', '')], 1)
+
+    def test_refreshed_each_period(self):
+        _, endpoint = self.tcp_daemon('--period-ms=20')
+        conn = self.connect(endpoint)
+        first = parse_metrics(conn.get()[2])[0]
+        write(os.path.join(self.tmpdir, 'powercap', 'intel-rapl:0', 'energy_uj'), 20500000)
+        write(os.path.join(self.sysfs, 'devices', 'system', 'cpu', 'cpu0', 'thermal_throttle',
+                           'core_throttle_count'), 5)
+        write(os.path.join(self.sysfs, 'class', 'thermal', 'thermal_zone0', 'temp'), 88500)
+        for _ in range(500):
+            samples = parse_metrics(conn.get()[2])[0]
+            if samples[('dvfsmon_cpu_throttled', '{cpu="0"}')] == 1:
+                break
+            time.sleep(0.002)
+        else:
+            self.fail('throttling never reported')
+        self.assertGreater(samples[('dvfsmon_samples_total', '')], first[('dvfsmon_samples_total', '')])
+        self.assertAlmostEqual(samples[('dvfsmon_energy_joules_total', '')], 8.0, delta=1e-6)
+        self.assertEqual(samples[('dvfsmon_cpu_throttle_events_total', '{cpu="0",scope="core"}')], 5)
+        self.assertEqual(samples[('dvfsmon_thermal_zone_celsius', '{zone="0",type="x86_pkg_temp"}')], 88.5)
+        self.assertEqual(samples[('dvfsmon_temperature_celsius', '')], 88.5)
+        # only the period where the count rose is throttled
+        time.sleep(0.1)
+        samples = parse_metrics(conn.get()[2])[0]
+        self.assertEqual(samples[('dvfsmon_cpu_throttled', '{cpu="0"}')], 0)
+        self.assertEqual(samples[('dvfsmon_cpu_throttle_events_total', '{cpu="0",scope="core"}')], 5)
+
+
+class TestProtocol(ExporterTestCase):
+
+    def test_keep_alive(self):
+        _, endpoint = self.tcp_daemon()
+        conn = self.connect(endpoint)
+        for _ in range(200):
+            status, headers, body = conn.get('/metrics?name[]=dvfsmon_power_watts')
+            self.assertEqual(status, 200)
+            self.assertIn('dvfsmon_samples_total', body)
+        self.assertEqual(conn.get(extra='Connection: close\r\n')[0], 200)
+        self.assertIsNone(conn.response())
+
+    def test_http10_closes(self):
+        _, endpoint = self.tcp_daemon()
+        conn = self.connect(endpoint)
+        conn.send(b'GET /metrics HTTP/1.0\r\n\r\n')
+        self.assertEqual(conn.response()[0], 200)
+        self.assertIsNone(conn.response())
+        conn = self.connect(endpoint)
+        conn.send(b'GET /metrics HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n')
+        self.assertEqual(conn.response()[0], 200)
+        self.assertEqual(conn.get()[0], 200)
+
+    def test_pipelined(self):
+        _, endpoint = self.tcp_daemon()
+        conn = self.connect(endpoint)
+        conn.send(b''.join(b'GET /metrics HTTP/1.1\r\nHost: x\r\n\r\n' for _ in range(20)))
+        for _ in range(20):
+            self.assertEqual(conn.response()[0], 200)
+        self.assertEqual(conn.get()[0], 200)
+
+    def test_half_closed_client(self):
+        # nc -N: the requests are answered even though the client already sent EOF
+        _, endpoint = self.tcp_daemon()
+        conn = self.connect(endpoint)
+        conn.send(b''.join(b'GET /metrics HTTP/1.1\r\nHost: x\r\n\r\n' for _ in range(3)) + b'GET /met')
+        conn.sock.shutdown(socket.SHUT_WR)
+        for _ in range(3):
+            self.assertEqual(conn.response()[0], 200)
+        self.assertIsNone(conn.response())
+
+    def test_errors(self):
+        _, endpoint = self.tcp_daemon()
+        for request, status in ((b'GET / HTTP/1.1\r\n\r\n', 404),
+                                (b'GET /metricsx HTTP/1.1\r\n\r\n', 404),
+                                (b'POST /metrics HTTP/1.1\r\nContent-Length: 0\r\n\r\n', 405),
+                                (b'garbage\r\n\r\n', 400),
+                                (b'GET /metrics HTTP/1.1\r\nX-Pad: ' + b'a' * 8192, 431)):
+            conn = self.connect(endpoint)
+            try:
+                conn.send(request)
+            except OSError:
+                pass  # closed by the daemon before the whole request was sent
+            response = conn.response()
+            self.assertEqual(response[0], status, request[:40])
+            if status == 405:
+                self.assertEqual(response[1]['allow'], 'GET')
+            self.assertIsNone(conn.response())
+        self.assertEqual(self.connect(endpoint).get()[0], 200)
+
+    def test_concurrent_clients(self):
+        _, endpoint = self.tcp_daemon('--period-ms=5')
+        errors = []
+
+        def client():
+            try:
+                conn = Connection(endpoint)
+                for _ in range(50):
+                    status, _, body = conn.get()
+                    if status != 200 or not body.endswith('\n'):
+                        errors.append(status)
+                conn.close()
+            except Exception as e:  # noqa: BLE001 - reported below
+                errors.append(repr(e))
+
+        threads = [threading.Thread(target=client) for _ in range(50)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        self.assertEqual(errors, [])
+
+
+class TestEndpoints(ExporterTestCase):
+
+    def test_unix_and_tcp(self):
+        _, started = self.start_daemon('--listen=unix:' + self.sock_path, '--listen=tcp:localhost:0')
+        unix, tcp = started['listen'].split(';')
+        self.assertEqual(unix, 'unix:' + self.sock_path)
+        self.assertTrue(tcp.startswith('tcp:127.0.0.1:'))
+        for endpoint in (unix, tcp):
+            samples, _ = self.scrape(endpoint)
+            self.assertIn(('dvfsmon_samples_total', ''), samples)
+
+    def test_unix_socket_lifecycle(self):
+        proc, _ = self.start_daemon('--listen=unix:' + self.sock_path)
+        self.stop_daemon(proc)
+        self.assertEqual(proc.returncode, 0)
+        self.assertFalse(os.path.exists(self.sock_path))
+        # a socket left by a killed daemon is replaced, one in use is not
+        proc, _ = self.start_daemon('--listen=unix:' + self.sock_path)
+        proc.kill()
+        proc.wait()
+        self.assertTrue(os.path.exists(self.sock_path))
+        self.start_daemon('--listen=unix:' + self.sock_path)
+        self.scrape('unix:' + self.sock_path)
+        self.name += '_busy'
+        busy = run([DAEMON_BIN, '--name=' + self.name, '--listen=unix:' + self.sock_path], env=self.env,
+                   timeout=30)
+        self.assertEqual(busy.returncode, 1)
+        self.assertIn('in use', busy.stderr)
+
+    def test_bad_listen(self):
+        for spec in ('tcp:', 'tcp:99999', 'tcp:nohost.invalid:0', 'udp:9100', 'unix:', 'unix:/nonexistent/dir/s'):
+            proc = run([DAEMON_BIN, '--name=' + self.name, '--listen=' + spec], env=self.env, timeout=30)
+            self.assertEqual(proc.returncode, 1, spec)
+            self.assertIn('dvfsmond: ', proc.stderr)
+            self.assertFalse(os.path.exists('/dev/shm/' + self.name), spec)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,254 @@
+#!/usr/bin/env python3
+"""
+Tests for the LD_PRELOAD profiler, libdvfsmon_preload.so: the per-process report
+(destinations, %p/%r expansion, energy from a fake powercap tree, forked children),
+the application's own markers merged into it, and the MPI (PMPI) and OpenMP (OMPT)
+hooks on small programs compiled here when mpicc / libomp are installed.
+
+Point DVFSMON_PRELOAD_LIB at libdvfsmon_preload.so and DVFSMON_MARKERS_BIN at
+dvfsmon_markers, or run through ctest:
+    cmake -S benchmark_monitor_C -B build && cmake --build build && ctest --test-dir build
+"""
+
+import ctypes.util
+import glob
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import unittest
+
+from support import parse_line, run, skip_unless_executable
+
+PRELOAD_LIB = os.environ.get('DVFSMON_PRELOAD_LIB', '')
+MARKERS_BIN = os.environ.get('DVFSMON_MARKERS_BIN', '')
+
+PROCESS_KEYS = ['pid', 'rank', 'command', 'time_s', 'energy_j', 'power_avg_w', 'cpu_time_s', 'instructions',
+                'cycles', 'ipc', 'cache_misses', 'branch_misses', 'max_rss_kb']
+SUMMARY_KEYS = ['region', 'calls', 'time_s', 'energy_j', 'power_avg_w', 'instructions', 'cycles', 'ipc',
+                'cache_misses', 'branch_misses']
+
+MPI_SRC = r'''
+#include <mpi.h>
+#include <stdio.h>
+int main(int argc, char** argv) {
+    int i, rank, value = 0;
+    double x = 1.5, sum = 0.0, total = 0.0;
+    MPI_Request req[2];
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    for (i = 0; i < 10; ++i) {
+        MPI_Allreduce(&x, &sum, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        MPI_Reduce(&x, &total, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+    if (rank == 0) value = 42;
+    MPI_Bcast(&value, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Irecv(&i, 1, MPI_INT, rank, 7, MPI_COMM_WORLD, &req[0]);
+    MPI_Isend(&value, 1, MPI_INT, rank, 7, MPI_COMM_WORLD, &req[1]);
+    MPI_Wait(&req[1], MPI_STATUS_IGNORE);
+    MPI_Wait(&req[0], MPI_STATUS_IGNORE);
+    printf("sum=%g,total=%g,value=%d,received=%d\n", sum, total, value, i);
+    MPI_Finalize();
+    return 0;
+}
+'''
+
+OMP_SRC = r'''
+#include <stdio.h>
+int main(void) {
+    int i, n = 0;
+    for (i = 0; i < 5; ++i) {
+#pragma omp parallel reduction(+:n)
+        n += 1;
+    }
+    printf("n=%d\n", n);
+    return 0;
+}
+'''
+
+
+def parse_report(text):
+    """Process line and region rows (by name) of a report"""
+    lines = text.splitlines()
+    return dict(parse_line(lines[0])), dict((r['region'], r) for r in (dict(parse_line(l)) for l in lines[1:]))
+
+
+@unittest.skipUnless(PRELOAD_LIB and os.path.isfile(PRELOAD_LIB),
+                     'DVFSMON_PRELOAD_LIB not set to libdvfsmon_preload.so')
+class PreloadTestCase(unittest.TestCase):
+
+    def setUp(self):
+        self.tmpdir = tempfile.mkdtemp()
+        self.env = dict(os.environ)
+        self.env['DVFSMON_POWERCAP_ROOT'] = os.path.join(self.tmpdir, 'missing')
+        for var in ('DVFSMON_PRELOAD_OUT', 'DVFSMON_PRELOAD_REGIONS', 'DVFSMON_REGIONS_OUT',
+                    'OMPI_COMM_WORLD_RANK', 'PMI_RANK', 'PMIX_RANK', 'SLURM_PROCID'):
+            self.env.pop(var, None)
+
+    def tearDown(self):
+        shutil.rmtree(self.tmpdir)
+
+    def run_preloaded(self, cmd, **env):
+        run_env = dict(self.env)
+        run_env.update(env)
+        run_env['LD_PRELOAD'] = PRELOAD_LIB
+        return run(cmd, env=run_env)
+
+    def report(self, cmd, **env):
+        """Output and report of a successful run, reported to a file"""
+        out = os.path.join(self.tmpdir, 'report.txt')
+        proc = self.run_preloaded(cmd, DVFSMON_PRELOAD_OUT=out, **env)
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        with open(out) as fh:
+            text = fh.read()
+        lines = text.splitlines()
+        self.assertEqual([k for k, _ in parse_line(lines[0])], PROCESS_KEYS)
+        for line in lines[1:]:
+            self.assertEqual([k for k, _ in parse_line(line)], SUMMARY_KEYS)
+        return proc, parse_report(text)
+
+    def compile(self, compiler, source, cflags=(), ldflags=()):
+        src = os.path.join(self.tmpdir, 'prog.c')
+        with open(src, 'w') as fh:
+            fh.write(source)
+        obj = os.path.join(self.tmpdir, 'prog.o')
+        exe = os.path.join(self.tmpdir, 'prog')
+        for cmd in ([compiler] + list(cflags) + ['-c', src, '-o', obj], [compiler, obj, '-o', exe] + list(ldflags)):
+            proc = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True,
+                                  timeout=300)
+            self.assertEqual(proc.returncode, 0, proc.stdout)
+        return exe
+
+
+class TestReport(PreloadTestCase):
+
+    def test_whole_process(self):
+        _, (process, regions) = self.report(['sleep', '0.3'])
+        self.assertEqual(process['command'], 'sleep')
+        self.assertEqual(process['rank'], '0')
+        self.assertGreaterEqual(float(process['time_s']), 0.3)
+        self.assertLess(float(process['cpu_time_s']), float(process['time_s']))
+        self.assertGreater(int(process['max_rss_kb']), 0)
+        self.assertEqual(float(process['energy_j']), 0.0)
+        self.assertEqual(regions, {})
+
+    def test_stderr_by_default(self):
+        # sleep closes stderr from its own atexit; the report still gets through
+        proc = self.run_preloaded(['sleep', '0'])
+        self.assertEqual(proc.returncode, 0)
+        lines = proc.stderr.splitlines()
+        self.assertEqual(len(lines), 1, proc.stderr)
+        self.assertEqual([k for k, _ in parse_line(lines[0])], PROCESS_KEYS)
+
+    def test_disabled(self):
+        proc = self.run_preloaded(['sleep', '0'], DVFSMON_PRELOAD_OUT='none')
+        self.assertEqual((proc.returncode, proc.stderr), (0, ''))
+
+    def test_path_expansion(self):
+        pattern = os.path.join(self.tmpdir, 'run.%r.%p.txt')
+        proc = self.run_preloaded(['sleep', '0'], DVFSMON_PRELOAD_OUT=pattern, OMPI_COMM_WORLD_RANK='7')
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        files = glob.glob(os.path.join(self.tmpdir, 'run.7.*.txt'))
+        self.assertEqual(len(files), 1)
+        with open(files[0]) as fh:
+            process, _ = parse_report(fh.read())
+        self.assertEqual(process['rank'], '7')
+        self.assertEqual(os.path.basename(files[0]), 'run.7.%s.txt' % process['pid'])
+
+    def test_forked_child_not_reported(self):
+        script = 'import os, sys\npid = os.fork()\nif pid == 0: sys.exit(0)\nos.waitpid(pid, 0)\n'
+        proc = self.run_preloaded([sys.executable, '-c', script])
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        self.assertEqual(len(proc.stderr.splitlines()), 1, proc.stderr)
+
+    def test_energy(self):
+        # a package drawing a steady 40 W for the whole run
+        zone = os.path.join(self.tmpdir, 'powercap', 'intel-rapl:0')
+        os.makedirs(zone)
+        for f, v in (('name', 'package-0'), ('energy_uj', '0'.zfill(16)), ('max_energy_range_uj', str(2 ** 50))):
+            with open(os.path.join(zone, f), 'w') as fh:
+                fh.write(v + '\n')
+        energy = os.path.join(zone, 'energy_uj')
+        stop = threading.Event()
+
+        def draw():
+            t0 = time.monotonic()
+            fd = os.open(energy, os.O_WRONLY)
+            while not stop.is_set():
+                os.pwrite(fd, str(int((time.monotonic() - t0) * 40e6)).zfill(16).encode(), 0)
+                time.sleep(0.002)
+            os.close(fd)
+
+        t = threading.Thread(target=draw)
+        t.start()
+        try:
+            _, (process, _) = self.report(['sleep', '1'], DVFSMON_POWERCAP_ROOT=os.path.dirname(zone),
+                                          DVFSMON_SAMPLE_MS='5')
+        finally:
+            stop.set()
+            t.join()
+        self.assertAlmostEqual(float(process['power_avg_w']), 40.0, delta=4.0)
+        self.assertAlmostEqual(float(process['energy_j']), 40.0 * float(process['time_s']), delta=4.0)
+
+    def test_unknown_hook(self):
+        proc = self.run_preloaded(['sleep', '0'], DVFSMON_PRELOAD_REGIONS='mpi,,MPI_Bogus',
+                                  DVFSMON_PRELOAD_OUT='none')
+        self.assertEqual(proc.returncode, 0)
+        self.assertEqual(proc.stderr.strip(),
+                         "dvfsmon_preload: unknown hook 'MPI_Bogus' in DVFSMON_PRELOAD_REGIONS")
+
+    @skip_unless_executable(MARKERS_BIN, 'DVFSMON_MARKERS_BIN', 'dvfsmon_markers')
+    def test_application_markers_merged(self):
+        # the application's dvfsmon markers land in the one report, not in a second summary
+        proc, (process, regions) = self.report([MARKERS_BIN, 2, 25, '--overhead=10'])
+        self.assertEqual(process['command'], 'dvfsmon_markers')
+        self.assertEqual(sorted(regions), ['empty', 'inner', 'outer'])
+        self.assertEqual(int(regions['outer']['calls']), 50)
+        self.assertEqual(proc.stderr, '')
+
+
+class TestHooks(PreloadTestCase):
+
+    @unittest.skipUnless(shutil.which('mpicc'), 'mpicc not found')
+    def test_mpi(self):
+        exe = self.compile('mpicc', MPI_SRC)
+        plain = subprocess.run([exe], stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                               universal_newlines=True, timeout=120)
+        if plain.returncode != 0:
+            self.skipTest('MPI singleton cannot start here: ' + plain.stdout)
+        # the launcher daemon of a singleton run is preloaded too: one report per pid
+        pattern = os.path.join(self.tmpdir, 'mpi.%p.txt')
+        proc = self.run_preloaded([exe], DVFSMON_PRELOAD_OUT=pattern,
+                                  DVFSMON_PRELOAD_REGIONS='MPI_Allreduce,MPI_Reduce,MPI_Barrier,MPI_Bcast,MPI_Wait')
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        # arguments went through untouched
+        self.assertEqual(proc.stdout, plain.stdout)
+        self.assertEqual(proc.stdout.strip(), 'sum=1.5,total=1.5,value=42,received=42')
+        reports = []
+        for path in glob.glob(os.path.join(self.tmpdir, 'mpi.*.txt')):
+            with open(path) as fh:
+                reports.append(parse_report(fh.read()))
+        regions = [r for p, r in reports if p['command'] == 'prog'][0]
+        self.assertEqual(dict((n, int(r['calls'])) for n, r in regions.items()),
+                         {'MPI_Allreduce': 10, 'MPI_Reduce': 10, 'MPI_Barrier': 10, 'MPI_Bcast': 1, 'MPI_Wait': 2})
+
+    @unittest.skipUnless(shutil.which('cc') and ctypes.util.find_library('omp'), 'cc or libomp not found')
+    def test_openmp(self):
+        # GOMP entry points as GCC emits them, served by LLVM's libomp, which has OMPT
+        exe = self.compile('cc', OMP_SRC, cflags=['-fopenmp'], ldflags=['-l:libomp.so.5'])
+        _, (_, regions) = self.report([exe], DVFSMON_PRELOAD_REGIONS='omp', OMP_NUM_THREADS='3')
+        self.assertEqual(int(regions['omp_parallel']['calls']), 5)
+        # the last implicit task of each worker ends at the next parallel region
+        self.assertGreaterEqual(int(regions['omp_implicit_task']['calls']), 5)
+        self.assertLessEqual(float(regions['omp_implicit_task']['time_s']), 3 * float(regions['omp_parallel']['time_s']))
+
+        _, (_, regions) = self.report([exe], OMP_NUM_THREADS='3')
+        self.assertEqual(regions, {})
+
+
+if __name__ == '__main__':
+    unittest.main()
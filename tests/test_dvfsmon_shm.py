@@ -0,0 +1,231 @@
+#!/usr/bin/env python3
+"""
+Tests for the monitor daemon, dvfsmond, and the shared-memory client API (dvfsmon_shm_*)
+through dvfsmon_shm_probe: segment header and samples, reading in order, overwritten and
+future samples, consistency with concurrent readers, energy from a fake powercap tree,
+one writer per segment, stale segments and cleanup.
+
+Point DVFSMOND_BIN at dvfsmond and DVFSMON_SHM_PROBE_BIN at dvfsmon_shm_probe, or run
+through ctest:
+    cmake -S benchmark_monitor_C -B build && cmake --build build && ctest --test-dir build
+"""
+
+import fcntl
+import os
+import shutil
+import signal
+import struct
+import subprocess
+import tempfile
+import threading
+import time
+import unittest
+
+from support import executable, parse_fields, run
+
+DAEMON_BIN = os.environ.get('DVFSMOND_BIN', '')
+PROBE_BIN = os.environ.get('DVFSMON_SHM_PROBE_BIN', '')
+
+INFO_KEYS = ['period_ms', 'capacity', 'writer_pid', 'head']
+SAMPLE_KEYS = ['seq_no', 't_ns', 'energy_j', 'power_w', 'temperature_c', 'capabilities', 'ncpus', 'freq_mhz']
+CAP_ENERGY = 0x1
+SHM_MAGIC = 0x44564653  # "DVFS"
+
+
+@unittest.skipUnless(executable(DAEMON_BIN) and executable(PROBE_BIN),
+                     'DVFSMOND_BIN / DVFSMON_SHM_PROBE_BIN not set to the built binaries')
+class ShmTestCase(unittest.TestCase):
+
+    def setUp(self):
+        self.tmpdir = tempfile.mkdtemp()
+        self.addCleanup(shutil.rmtree, self.tmpdir)
+        self.env = dict(os.environ)
+        self.env['DVFSMON_POWERCAP_ROOT'] = os.path.join(self.tmpdir, 'missing')
+        self.name = 'dvfsmon_test_%d_%s' % (os.getpid(), self._testMethodName)
+
+    def start_daemon(self, *args):
+        """Running daemon and its start-up line, once the segment is ready"""
+        proc = subprocess.Popen([DAEMON_BIN, '--name=' + self.name] + [str(a) for a in args],
+                                stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True,
+                                env=self.env)
+        self.addCleanup(self.stop_daemon, proc)
+        line = proc.stdout.readline()
+        self.assertTrue(line, proc.stderr.read() if proc.poll() is not None else 'no start-up line')
+        return proc, parse_fields(line)
+
+    def stop_daemon(self, proc):
+        if proc.poll() is None:
+            proc.send_signal(signal.SIGTERM)
+        proc.communicate(timeout=30)
+
+    def run_probe(self, *args):
+        return run([PROBE_BIN, self.name] + list(args))
+
+    def probe(self, *args):
+        """Header and sample lines of a successful probe run"""
+        proc = self.run_probe(*args)
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        lines = proc.stdout.splitlines()
+        return parse_fields(lines[0]), [parse_fields(line) for line in lines[1:]]
+
+    def wait_for_head(self, head):
+        for _ in range(500):
+            info, _ = self.probe('--check=1')
+            if int(info['head']) >= head:
+                return
+            time.sleep(0.01)
+        self.fail('daemon did not publish %d samples' % head)
+
+
+class TestSamples(ShmTestCase):
+
+    def test_header_and_latest(self):
+        proc, started = self.start_daemon('--period-ms=20', '--slots=8')
+        self.assertEqual(started['name'], '/' + self.name)
+        self.assertEqual(int(started['pid']), proc.pid)
+        self.wait_for_head(1)
+        info, samples = self.probe()
+        self.assertEqual(list(info), INFO_KEYS)
+        self.assertEqual((info['period_ms'], info['capacity'], info['writer_pid']), ('20', '8', str(proc.pid)))
+        self.assertEqual(len(samples), 1)
+        self.assertEqual(list(samples[0]), SAMPLE_KEYS)
+        self.assertGreaterEqual(int(samples[0]['seq_no']), int(info['head']))
+        self.assertEqual(samples[0]['ncpus'], started['ncpus'])
+        self.assertEqual(len(samples[0]['freq_mhz'].split(';')), int(started['ncpus']))
+        self.assertEqual(int(samples[0]['capabilities']) & CAP_ENERGY, 0)
+
+    def test_follow_in_order(self):
+        self.start_daemon('--period-ms=20')
+        _, samples = self.probe('--follow=6')
+        seqs = [int(s['seq_no']) for s in samples]
+        self.assertEqual(seqs, list(range(seqs[0], seqs[0] + 6)))
+        gaps = [(int(b['t_ns']) - int(a['t_ns'])) / 1e6 for a, b in zip(samples, samples[1:])]
+        self.assertAlmostEqual(sum(gaps) / len(gaps), 20.0, delta=10.0)
+
+    def test_overwritten_and_future(self):
+        self.start_daemon('--period-ms=5', '--slots=4')
+        self.wait_for_head(10)
+        proc = self.run_probe('--seq=1')
+        self.assertEqual(proc.returncode, 2)
+        self.assertIn('overwritten', proc.stderr)
+        proc = self.run_probe('--seq=1000000')
+        self.assertEqual(proc.returncode, 2)
+        self.assertIn('not published yet', proc.stderr)
+
+    def test_consistent_with_concurrent_readers(self):
+        # a fast writer over a small ring, several readers copying the latest sample
+        self.start_daemon('--period-ms=1', '--slots=2')
+        self.wait_for_head(1)
+        procs = [subprocess.Popen([PROBE_BIN, self.name, '--check=200000'], stdout=subprocess.PIPE,
+                                  universal_newlines=True) for _ in range(4)]
+        for p in procs:
+            out, _ = p.communicate(timeout=120)
+            self.assertEqual(p.returncode, 0)
+            result = parse_fields(out.splitlines()[1])
+            self.assertEqual(result['inconsistent'], '0')
+            self.assertGreater(int(result['distinct']), 1)
+
+    def test_energy_and_power(self):
+        # a package drawing a steady 30 W
+        zone = os.path.join(self.tmpdir, 'powercap', 'intel-rapl:0')
+        os.makedirs(zone)
+        for f, v in (('name', 'package-0'), ('energy_uj', '0'.zfill(16)), ('max_energy_range_uj', str(2 ** 50))):
+            with open(os.path.join(zone, f), 'w') as fh:
+                fh.write(v + '\n')
+        self.env['DVFSMON_POWERCAP_ROOT'] = os.path.dirname(zone)
+        stop = threading.Event()
+
+        def draw():
+            t0 = time.monotonic()
+            fd = os.open(os.path.join(zone, 'energy_uj'), os.O_WRONLY)
+            while not stop.is_set():
+                os.pwrite(fd, str(int((time.monotonic() - t0) * 30e6)).zfill(16).encode(), 0)
+                time.sleep(0.002)
+            os.close(fd)
+
+        t = threading.Thread(target=draw)
+        t.start()
+        try:
+            self.start_daemon('--period-ms=50')
+            _, samples = self.probe('--follow=5')
+        finally:
+            stop.set()
+            t.join()
+        for s in samples:
+            self.assertTrue(int(s['capabilities']) & CAP_ENERGY)
+            self.assertAlmostEqual(float(s['power_w']), 30.0, delta=6.0)
+        energy = [float(s['energy_j']) for s in samples]
+        self.assertEqual(energy, sorted(energy))
+        elapsed = (int(samples[-1]['t_ns']) - int(samples[0]['t_ns'])) / 1e9
+        self.assertAlmostEqual(energy[-1] - energy[0], 30.0 * elapsed, delta=0.1 * 30.0 * elapsed + 0.2)
+
+
+class TestLifecycle(ShmTestCase):
+
+    def test_one_writer(self):
+        proc, _ = self.start_daemon()
+        second = run([DAEMON_BIN, '--name=' + self.name], timeout=30)
+        self.assertEqual(second.returncode, 1)
+        self.assertIn('already published by pid %d' % proc.pid, second.stderr)
+
+    def test_removed_on_exit(self):
+        proc, _ = self.start_daemon()
+        self.stop_daemon(proc)
+        self.assertEqual(proc.returncode, 0)
+        self.assertFalse(os.path.exists('/dev/shm/' + self.name))
+        self.assertFalse(os.path.exists('/dev/shm/' + self.name + '.lock'))
+        probe = self.run_probe()
+        self.assertEqual(probe.returncode, 2)
+        self.assertIn('not available', probe.stderr)
+
+    def test_stale_segment_replaced(self):
+        proc, _ = self.start_daemon()
+        proc.kill()
+        proc.wait()
+        self.addCleanup(lambda: os.path.exists('/dev/shm/' + self.name) and os.unlink('/dev/shm/' + self.name))
+        new, _ = self.start_daemon('--period-ms=10')
+        self.wait_for_head(1)
+        info, _ = self.probe()
+        self.assertEqual(info['writer_pid'], str(new.pid))
+
+    def test_waits_for_writer_being_created(self):
+        # Another writer holds the creation lock and has not published its header yet:
+        # the segment must not be taken for a dead writer's and replaced
+        path = '/dev/shm/' + self.name
+        self.addCleanup(lambda: os.path.exists(path) and os.unlink(path))
+        self.addCleanup(lambda: os.path.exists(path + '.lock') and os.unlink(path + '.lock'))
+        lock = open(path + '.lock', 'w')
+        self.addCleanup(lock.close)
+        fcntl.flock(lock, fcntl.LOCK_EX)
+        with open(path, 'wb'):
+            pass
+        inode = os.stat(path).st_ino
+        proc = subprocess.Popen([DAEMON_BIN, '--name=' + self.name], stdout=subprocess.PIPE,
+                                stderr=subprocess.PIPE, universal_newlines=True, env=self.env)
+        self.addCleanup(self.stop_daemon, proc)
+        time.sleep(0.3)
+        self.assertIsNone(proc.poll())
+        self.assertEqual(os.stat(path).st_ino, inode)
+        self.assertEqual(os.path.getsize(path), 0)
+        # The other writer publishes (ShmHeader: magic, version, slot_size, capacity,
+        # period_ms, writer_pid, head) and releases the lock
+        with open(path, 'r+b') as fh:
+            fh.write(struct.pack('<IIIIIiQ', SHM_MAGIC, 1, 0, 1, 100, os.getpid(), 0).ljust(64, b'\0'))
+        fcntl.flock(lock, fcntl.LOCK_UN)
+        _, err = proc.communicate(timeout=30)
+        self.assertEqual(proc.returncode, 1)
+        self.assertIn('already published by pid %d' % os.getpid(), err)
+
+    def test_usage(self):
+        for args in (['--period-ms=0'], ['--slots=x'], ['--bogus'], ['extra']):
+            proc = run([DAEMON_BIN] + args, timeout=30)
+            self.assertEqual(proc.returncode, 1)
+            self.assertIn('Usage', proc.stderr)
+        for args in (['--follow=0'], ['a', 'b'], ['--bogus']):
+            proc = run([PROBE_BIN] + args, timeout=30)
+            self.assertEqual(proc.returncode, 1)
+            self.assertIn('Usage', proc.stderr)
+
+
+if __name__ == '__main__':
+    unittest.main()
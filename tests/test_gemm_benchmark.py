@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+"""
+Tests for the gemm_benchmark driver (argument handling, kernel selection, --verify
+and the summary line) running against its CPU backend, gemm_benchmark_host.
+
+Point GEMM_BENCHMARK_BIN at gemm_benchmark_host (or at the CUDA gemm_benchmark on a
+GPU machine), or run through ctest:
+    cmake -S gpu_benchmark -B build && cmake --build build && ctest --test-dir build
+"""
+
+import os
+import unittest
+
+from support import BenchmarkTestCase, parse_line, skip_unless_executable
+
+GEMM_BIN = os.environ.get('GEMM_BENCHMARK_BIN', '')
+
+SUMMARY_KEYS = ['kernel_name', 'problem_size', 'iterations', 'time_s', 'gflops',
+                'occupancy', 'block', 'numSM', 'launch']
+
+
+@skip_unless_executable(GEMM_BIN, 'GEMM_BENCHMARK_BIN', 'gemm_benchmark_host')
+class GemmBenchmarkTestCase(BenchmarkTestCase):
+
+    binary = GEMM_BIN
+
+    def kernels(self):
+        proc = self.run_benchmark('--list-kernels')
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        return proc.stdout.split()
+
+
+class TestKernelSelection(GemmBenchmarkTestCase):
+
+    def test_list_kernels(self):
+        kernels = self.kernels()
+        self.assertEqual(kernels[0], 'naive')
+        tiled = [k for k in kernels if k.startswith('tiled_')]
+        self.assertGreaterEqual(len(tiled), 3)
+
+    def test_default_is_naive(self):
+        proc = self.run_benchmark(32, 32, 32, 1)
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        fields = parse_line(proc.stdout)
+        self.assertEqual([k for k, _ in fields], SUMMARY_KEYS)
+        values = dict(fields)
+        self.assertEqual(values['kernel_name'], 'gemm_naive')
+        self.assertEqual(values['problem_size'], '32x32x32')
+        self.assertEqual(values['iterations'], '1')
+        self.assertEqual(values['block'], '16x16')
+
+    def test_tiled_block_shape(self):
+        proc = self.run_benchmark(64, 64, 64, 1, '--kernel=tiled_128x64x16_8x4')
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        values = dict(parse_line(proc.stdout))
+        self.assertEqual(values['kernel_name'], 'gemm_tiled_128x64x16_8x4')
+        # x spans BN/TN columns, y spans BM/TM rows
+        self.assertEqual(values['block'], '16x16')
+
+    def test_all_kernels_one_line_each(self):
+        proc = self.run_benchmark(40, 24, 36, 1, '--kernel=all')
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        names = [dict(parse_line(l))['kernel_name'] for l in proc.stdout.splitlines()]
+        self.assertEqual(names, ['gemm_' + k for k in self.kernels()])
+
+    def test_kernel_list(self):
+        proc = self.run_benchmark(16, 16, 16, 1, '--kernel=tiled_64x64x16_4x4,naive')
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        names = [dict(parse_line(l))['kernel_name'] for l in proc.stdout.splitlines()]
+        self.assertEqual(names, ['gemm_tiled_64x64x16_4x4', 'gemm_naive'])
+
+
+class TestVerification(GemmBenchmarkTestCase):
+
+    def check_verify(self, m, k, n):
+        proc = self.run_benchmark(m, k, n, 1, '--kernel=all', '--verify')
+        self.assertEqual(proc.returncode, 0, proc.stdout + proc.stderr)
+        lines = proc.stdout.splitlines()
+        self.assertEqual(len(lines), len(self.kernels()))
+        for line in lines:
+            values = dict(parse_line(line))
+            self.assertEqual(values['verify'], 'pass', line)
+            self.assertLess(float(values['max_err']), k * 1.2e-7, line)
+
+    def test_tile_multiples(self):
+        self.check_verify(128, 64, 128)
+
+    def test_ragged_edges(self):
+        # nothing divides a tile and K is not a multiple of 4 (scalar load path)
+        self.check_verify(67, 45, 93)
+
+    def test_smaller_than_one_tile(self):
+        self.check_verify(3, 5, 7)
+
+    def test_sampled_rows(self):
+        # more rows than the verifier checks exhaustively
+        self.check_verify(130, 17, 20)
+
+    def test_no_verify_fields_by_default(self):
+        proc = self.run_benchmark(8, 8, 8, 1)
+        self.assertNotIn('verify=', proc.stdout)
+
+    def test_seed_changes_inputs(self):
+        proc = self.run_benchmark(8, 8, 8, 1, '--seed=7', '--verify')
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        self.assertIn('verify=pass', proc.stdout)
+
+
+class TestTensorCoreKernels(GemmBenchmarkTestCase):
+
+    WMMA = ['wmma_fp16', 'wmma_bf16', 'wmma_tf32']
+
+    def test_listed(self):
+        kernels = self.kernels()
+        for name in self.WMMA:
+            self.assertIn(name, kernels)
+
+    def test_ragged_verify(self):
+        # operands are padded to whole 64x64 tiles; C is written back unpadded
+        proc = self.run_benchmark(33, 17, 65, 2, '--kernel=' + ','.join(self.WMMA), '--verify')
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        lines = proc.stdout.splitlines()
+        self.assertEqual([dict(parse_line(l))['kernel_name'] for l in lines], ['gemm_' + k for k in self.WMMA])
+        for line in lines:
+            values = dict(parse_line(line))
+            self.assertEqual(values['block'], '32x4')
+            self.assertEqual(values['verify'], 'pass')
+
+    def test_graph_launch(self):
+        proc = self.run_benchmark(70, 45, 33, 3, '--kernel=wmma_bf16', '--launch=graph', '--verify')
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        values = dict(parse_line(proc.stdout))
+        self.assertEqual(values['launch'], 'graph')
+        self.assertEqual(values['verify'], 'pass')
+
+
+class TestLaunchMode(GemmBenchmarkTestCase):
+
+    def test_default_is_stream(self):
+        proc = self.run_benchmark(16, 16, 16, 1)
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        self.assertEqual(dict(parse_line(proc.stdout))['launch'], 'stream')
+
+    def test_graph_all_kernels_verify(self):
+        # every kernel replayed from a captured batch still computes the right C
+        proc = self.run_benchmark(33, 17, 65, 3, '--kernel=all', '--launch=graph', '--verify')
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        lines = proc.stdout.splitlines()
+        self.assertEqual(len(lines), len(self.kernels()))
+        for line in lines:
+            values = dict(parse_line(line))
+            self.assertEqual(values['launch'], 'graph')
+            self.assertEqual(values['iterations'], '3')
+            self.assertEqual(values['verify'], 'pass')
+
+
+class TestArguments(GemmBenchmarkTestCase):
+
+    def test_missing_arguments(self):
+        self.assert_usage(64, 64, 64)
+
+    def test_too_many_arguments(self):
+        self.assert_usage(64, 64, 64, 1, 2)
+
+    def test_non_numeric(self):
+        proc = self.assert_usage(64, 'x', 64, 1)
+        self.assertIn('invalid K', proc.stderr)
+
+    def test_zero_size(self):
+        self.assert_usage(0, 64, 64, 1)
+
+    def test_unknown_kernel(self):
+        proc = self.assert_usage(64, 64, 64, 1, '--kernel=tiled_1x1x1_1x1')
+        self.assertIn('unknown kernel', proc.stderr)
+
+    def test_unknown_option(self):
+        self.assert_usage(64, 64, 64, 1, '--fast')
+
+    def test_bad_seed(self):
+        self.assert_usage(64, 64, 64, 1, '--seed=-3')
+
+    def test_bad_launch_mode(self):
+        proc = self.assert_usage(64, 64, 64, 1, '--launch=async')
+        self.assertIn('launch mode', proc.stderr)
+
+    def test_options_anywhere(self):
+        proc = self.run_benchmark('--kernel=tiled_64x64x16_4x4', 16, 16, '--verify', 16, 2)
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        values = dict(parse_line(proc.stdout))
+        self.assertEqual(values['problem_size'], '16x16x16')
+        self.assertEqual(values['iterations'], '2')
+        self.assertEqual(values['verify'], 'pass')
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""
+Tests for the Google Benchmark front end of the GEMM harness (benchmark names,
+counters, filtering and argument errors) running against its CPU backend,
+gemm_benchmark_google_host.
+
+Point GEMM_BENCHMARK_GOOGLE_BIN at gemm_benchmark_google_host (or at the CUDA
+gemm_benchmark_google on a GPU machine), or run through ctest:
+    cmake -S gpu_benchmark -B build && cmake --build build && ctest --test-dir build
+"""
+
+import json
+import os
+import unittest
+
+from support import run, skip_unless_executable
+
+GOOGLE_BIN = os.environ.get('GEMM_BENCHMARK_GOOGLE_BIN', '')
+
+COUNTERS = ['gflops', 'occupancy', 'bytes', 'gbps', 'batch']
+
+
+@skip_unless_executable(GOOGLE_BIN, 'GEMM_BENCHMARK_GOOGLE_BIN', 'gemm_benchmark_google_host')
+class TestGemmGoogle(unittest.TestCase):
+
+    def run_google(self, *args):
+        return run([GOOGLE_BIN] + list(args), timeout=300)
+
+    def run_json(self, benchmark_filter, *args):
+        proc = self.run_google('--benchmark_filter=' + benchmark_filter,
+                               '--benchmark_format=json', '--benchmark_min_time=0.01', *args)
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        return json.loads(proc.stdout)['benchmarks']
+
+    def test_list_names(self):
+        proc = self.run_google('--benchmark_list_tests=true')
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        names = proc.stdout.split()
+        self.assertIn('BM_GEMM/128/128/128/manual_time', names)
+        tiled = {n.split('/')[0] for n in names if n.startswith('BM_GEMM_tiled_')}
+        self.assertGreaterEqual(len(tiled), 3)
+        # the host backend emulates every tensor-core precision
+        wmma = {n.split('/')[0] for n in names if n.startswith('BM_GEMM_wmma_')}
+        self.assertEqual(wmma, {'BM_GEMM_wmma_fp16', 'BM_GEMM_wmma_bf16', 'BM_GEMM_wmma_tf32'})
+        # three sizes per kernel
+        self.assertEqual(len(names), 3 * (len(tiled) + len(wmma) + 1))
+
+    def test_naive_counters(self):
+        benchmarks = self.run_json('^BM_GEMM/128/')
+        self.assertEqual(len(benchmarks), 1)
+        run = benchmarks[0]
+        self.assertNotIn('error_occurred', run)
+        self.assertEqual(run['run_name'].split('/')[:4], ['BM_GEMM', '128', '128', '128'])
+        for counter in COUNTERS:
+            self.assertIn(counter, run)
+        self.assertGreater(run['gflops'], 0.0)
+        # A, B and C once: 3 * 128 * 128 floats
+        self.assertEqual(run['bytes'], 3 * 128 * 128 * 4)
+        self.assertGreater(run['gbps'], 0.0)
+
+    def test_tiled_filter(self):
+        benchmarks = self.run_json('^BM_GEMM_tiled_64x64x16_4x4/128/')
+        self.assertEqual(len(benchmarks), 1)
+        self.assertTrue(benchmarks[0]['run_name'].startswith('BM_GEMM_tiled_64x64x16_4x4/128/128/128'))
+        self.assertNotIn('error_occurred', benchmarks[0])
+
+    def test_sizes_share_session(self):
+        # two sizes in one process: the second reuses the pooled buffers
+        benchmarks = self.run_json('^BM_GEMM/(128|256)/')
+        self.assertEqual([b['run_name'].split('/')[1] for b in benchmarks], ['128', '256'])
+        for run in benchmarks:
+            self.assertNotIn('error_occurred', run)
+
+    def test_fixed_batch(self):
+        run = self.run_json('^BM_GEMM/128/', '--gemm_batch=3')[0]
+        self.assertEqual(run['batch'], 3)
+        # iterations are launches, taken a whole batch at a time
+        self.assertEqual(run['iterations'] % 3, 0)
+
+    def test_adaptive_batch(self):
+        # no 128^3 launch takes 0.1 s, so auto must queue several per event pair
+        run = self.run_json('^BM_GEMM/128/', '--gemm_batch=auto', '--gemm_batch_min_time=0.1')[0]
+        self.assertNotIn('error_occurred', run)
+        self.assertGreater(run['batch'], 1)
+        self.assertEqual(run['iterations'] % run['batch'], 0)
+
+    def test_launch_mode_label(self):
+        run = self.run_json('^BM_GEMM/128/')[0]
+        self.assertEqual(run['label'], 'launch=stream')
+        run = self.run_json('^BM_GEMM_tiled_64x64x16_4x4/128/', '--gemm_launch=graph',
+                            '--gemm_batch=2')[0]
+        self.assertNotIn('error_occurred', run)
+        self.assertEqual(run['label'], 'launch=graph')
+        self.assertEqual(run['batch'], 2)
+
+    def test_invalid_launch_mode(self):
+        proc = self.run_google('--gemm_launch=async')
+        self.assertEqual(proc.returncode, 1)
+        self.assertIn('gemm_launch', proc.stderr)
+
+    def test_invalid_batch(self):
+        for arg in ('--gemm_batch=0', '--gemm_batch=x', '--gemm_batch_min_time=0',
+                    '--gemm_batch_min_time=-1'):
+            proc = self.run_google(arg)
+            self.assertEqual(proc.returncode, 1, arg)
+            self.assertIn('gemm_batch', proc.stderr)
+
+    def test_unrecognized_argument(self):
+        proc = self.run_google('--no-such-flag')
+        self.assertEqual(proc.returncode, 1)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,698 @@
+#!/usr/bin/env python3
+"""
+End-to-end tests for gpu_monitor_nvml running against the mock NVML library.
+
+The binary under test is gpu_monitor_nvml_mock (built from gpu_benchmark/ with
+GPU_MONITOR_BUILD_MOCK=ON). Point GPU_MONITOR_NVML_BIN at it, or run through ctest:
+    cmake -S gpu_benchmark -B build && cmake --build build && ctest --test-dir build
+"""
+
+import csv
+import os
+import signal
+import struct
+import subprocess
+import time
+import unittest
+
+from support import MonitorTestCase, read_report, run, skip_unless_executable
+
+MONITOR_BIN = os.environ.get('GPU_MONITOR_NVML_BIN', '')
+
+
+@skip_unless_executable(MONITOR_BIN, 'GPU_MONITOR_NVML_BIN', 'gpu_monitor_nvml_mock')
+class GpuMonitorTestCase(MonitorTestCase):
+    """Base class: temp directory, scenario writer and monitor runner (support.py)"""
+
+    binary = MONITOR_BIN
+
+
+class TestBasicSampling(GpuMonitorTestCase):
+    """Constant traces: averages, energy and exit status"""
+
+    SCENARIO = ('at 0 0 power_mw=100000 gr_mhz=1150 mem_mhz=1566 '
+                'util_gpu=80 util_mem=30 temp_c=61\n')
+
+    def test_constant_trace_averages(self):
+        """Averages match a constant scripted trace"""
+        rc, out = self.run_monitor(['sleep', '0.3'], scenario=self.SCENARIO)
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertAlmostEqual(float(out['power_avg_w']), 100.0, places=2)
+        self.assertAlmostEqual(float(out['gpu_core_clock_MHz']), 1150.0, places=2)
+        self.assertAlmostEqual(float(out['gpu_mem_clock_MHz']), 1566.0, places=2)
+        self.assertAlmostEqual(float(out['gpu_utilization_pct']), 80.0, places=2)
+        self.assertAlmostEqual(float(out['gpu_temp_c']), 61.0, places=2)
+        self.assertGreaterEqual(int(out['samples']), 20)
+
+    def test_energy_matches_duration(self):
+        """Energy of a constant 100 W trace is 100 W times the sampled span"""
+        rc, out = self.run_monitor(['sleep', '0.5'], sample_ms=20, scenario=self.SCENARIO)
+        self.assertEqual(rc, 0, self.stderr)
+        energy = float(out['energy_j'])
+        duration = float(out['duration_s'])
+        self.assertGreater(energy, 0.0)
+        self.assertAlmostEqual(energy, 100.0 * duration, delta=100.0 * 0.03)
+
+    def test_default_scenario(self):
+        """Without MOCK_NVML_SCRIPT the mock serves one constant 100 W device"""
+        env = {'MOCK_NVML_SCRIPT': ''}
+        rc, out = self.run_monitor(['true'], env=env)
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertAlmostEqual(float(out['power_avg_w']), 100.0, places=2)
+
+    def test_child_exit_status_propagated(self):
+        """The monitor returns the child's exit code"""
+        rc, out = self.run_monitor(['sh', '-c', 'exit 3'], scenario=self.SCENARIO)
+        self.assertEqual(rc, 3)
+        self.assertIsNotNone(out)
+
+    def test_invalid_sample_period(self):
+        """A non-positive sample period is rejected before launching the child"""
+        marker = os.path.join(self.tmpdir, 'ran')
+        rc, _ = self.run_monitor(['touch', marker], sample_ms=0)
+        self.assertEqual(rc, 2)
+        self.assertFalse(os.path.exists(marker))
+
+
+class TestDeadlineScheduling(GpuMonitorTestCase):
+    """Fixed-rate sampling on absolute deadlines"""
+
+    def test_query_latency_does_not_stretch_period(self):
+        """5 queries x 1 ms latency inside a 20 ms period keep the mean interval at 20 ms"""
+        scenario = ('at 0 0 power_mw=80000 gr_mhz=1000 mem_mhz=2000 util_gpu=10 temp_c=40\n'
+                    'delay power 1000\ndelay clock 1000\ndelay util 1000\ndelay temp 1000\n')
+        rc, out = self.run_monitor(['sleep', '0.6'], sample_ms=20, scenario=scenario)
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertAlmostEqual(float(out['sample_interval_mean_ms']), 20.0, delta=2.0)
+        self.assertEqual(int(out['missed_deadlines']), 0)
+
+    def test_overrun_counts_missed_deadlines(self):
+        """Queries slower than the period are reported as missed deadlines"""
+        scenario = 'at 0 0 power_mw=80000\ndelay power 25000\n'
+        rc, out = self.run_monitor(['sleep', '0.3'], sample_ms=10, scenario=scenario)
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertGreater(int(out['missed_deadlines']), 0)
+        # skipped deadlines are not replayed as a burst: intervals stay >= the period
+        self.assertGreaterEqual(float(out['sample_interval_mean_ms']), 20.0)
+
+    def test_step_trace_energy(self):
+        """Energy integrates a 50 W -> 150 W step at its true timestamp"""
+        scenario = 'at 0 0 power_mw=50000\nat 300 0 power_mw=150000\n'
+        rc, out = self.run_monitor(['sleep', '0.6'], sample_ms=5, scenario=scenario)
+        self.assertEqual(rc, 0, self.stderr)
+        duration = float(out['duration_s'])
+        expected = 50.0 * 0.3 + 150.0 * (duration - 0.3)
+        self.assertAlmostEqual(float(out['energy_j']), expected, delta=3.0)
+
+
+class TestEnergyCounter(GpuMonitorTestCase):
+    """Hardware total-energy counter vs. integrated power"""
+
+    def test_counter_preferred(self):
+        """When the counter is supported it is the reported energy"""
+        rc, out = self.run_monitor(['sleep', '0.3'], scenario='at 0 0 power_mw=100000\n')
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['energy_method'], 'hw_counter')
+        self.assertEqual(out['energy_j'], out['energy_counter_j'])
+        self.assertAlmostEqual(float(out['energy_counter_j']),
+                               float(out['energy_integrated_j']), delta=0.5)
+        self.assertIn('energy_discrepancy_pct', out)
+
+    def test_counter_sees_spike_between_samples(self):
+        """A 4 ms, 2 kW spike between two 50 ms samples only shows up in the counter"""
+        scenario = ('at 0 0 power_mw=100000\n'
+                    'at 125 0 power_mw=2000000\n'
+                    'at 129 0 power_mw=100000\n')
+        rc, out = self.run_monitor(['sleep', '0.4'], sample_ms=50, scenario=scenario)
+        self.assertEqual(rc, 0, self.stderr)
+        missed_j = float(out['energy_counter_j']) - float(out['energy_integrated_j'])
+        self.assertAlmostEqual(missed_j, 1900.0 * 0.004, delta=1.5)
+        self.assertLess(float(out['energy_discrepancy_pct']), -5.0)
+
+    def test_fallback_without_counter(self):
+        """Pre-Volta devices fall back to trapezoidal integration"""
+        scenario = 'at 0 0 power_mw=100000\nfail energy NOT_SUPPORTED\n'
+        rc, out = self.run_monitor(['sleep', '0.2'], scenario=scenario)
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['energy_method'], 'trapezoid')
+        self.assertEqual(out['energy_j'], out['energy_integrated_j'])
+        self.assertNotIn('energy_counter_j', out)
+        self.assertNotIn('energy_discrepancy_pct', out)
+
+    def test_counter_lost_mid_run(self):
+        """A counter that stops answering mid-run is not trusted"""
+        scenario = 'at 0 0 power_mw=100000\nfail energy GPU_IS_LOST skip=1\n'
+        rc, out = self.run_monitor(['sleep', '0.2'], scenario=scenario)
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['energy_method'], 'trapezoid')
+
+
+class TestMultiGpu(GpuMonitorTestCase):
+    """Several devices sampled per pass, selected by index, UUID or PCI bus id"""
+
+    SCENARIO = ('devices 3\n'
+                'device 1 uuid=GPU-1111 pci=0000:04:00.0 name=Tesla_M2075\n'
+                'at 0 * gr_mhz=575 mem_mhz=1566 temp_c=50\n'
+                'at 0 0 power_mw=50000 util_gpu=10\n'
+                'at 0 1 power_mw=100000 util_gpu=60\n'
+                'at 0 2 power_mw=150000 util_gpu=90 gr_mhz=700\n')
+
+    def test_all_devices_by_default(self):
+        """Every device is reported and power/energy are summed"""
+        rc, out = self.run_monitor(['sleep', '0.3'], scenario=self.SCENARIO)
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['devices'], '3')
+        self.assertAlmostEqual(float(out['power_avg_w']), 300.0, places=2)
+        self.assertAlmostEqual(float(out['gpu_utilization_pct']), 160.0 / 3, places=2)
+        self.assertAlmostEqual(float(out['gpu_core_clock_MHz']), (575 * 2 + 700) / 3.0, places=2)
+        per_dev = sum(float(out['gpu%d.energy_j' % i]) for i in range(3))
+        self.assertAlmostEqual(float(out['energy_j']), per_dev, places=2)
+        self.assertAlmostEqual(float(out['gpu2.power_avg_w']), 150.0, places=2)
+        self.assertEqual(out['gpu1.name'], 'Tesla_M2075')
+        self.assertEqual(out['gpu0.uuid'], 'GPU-MOCK-0000')
+
+    def test_select_by_index_uuid_and_pci(self):
+        """Mixed selectors resolve to the right devices and duplicates are dropped"""
+        options = ['--devices', '2,GPU-1111,0000:04:00.0']
+        rc, out = self.run_monitor(['true'], scenario=self.SCENARIO, options=options)
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['devices'], '2')
+        self.assertNotIn('gpu0.power_avg_w', out)
+        self.assertAlmostEqual(float(out['power_avg_w']), 250.0, places=2)
+        self.assertEqual(out['gpu1.pci_bus_id'], '0000:04:00.0')
+
+    def test_single_device_matches_legacy_keys(self):
+        """--devices=0 reports the aggregate keys for that device alone"""
+        rc, out = self.run_monitor(['true'], scenario=self.SCENARIO, options=['--devices=0'])
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertAlmostEqual(float(out['power_avg_w']), 50.0, places=2)
+        self.assertEqual(out['power_avg_w'], out['gpu0.power_avg_w'])
+
+    def test_mixed_energy_methods(self):
+        """Only some devices exposing the counter gives energy_method=mixed"""
+        scenario = self.SCENARIO + 'fail energy NOT_SUPPORTED device=1\n'
+        rc, out = self.run_monitor(['sleep', '0.1'], scenario=scenario)
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['energy_method'], 'mixed')
+        self.assertEqual(out['gpu1.energy_method'], 'trapezoid')
+        self.assertEqual(out['gpu0.energy_method'], 'hw_counter')
+        self.assertNotIn('energy_counter_j', out)
+
+    def test_failed_reads_left_out_of_averages(self):
+        """A device whose utilization or clock read fails does not pull the node mean to 0"""
+        scenario = self.SCENARIO + 'fail util NOT_SUPPORTED device=1\nfail clock NOT_SUPPORTED device=2\n'
+        rc, out = self.run_monitor(['sleep', '0.1'], scenario=scenario)
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertAlmostEqual(float(out['gpu_utilization_pct']), (10 + 90) / 2.0, places=2)
+        self.assertAlmostEqual(float(out['gpu_core_clock_MHz']), 575.0, places=2)
+        self.assertAlmostEqual(float(out['gpu_mem_clock_MHz']), 1566.0, places=2)
+        self.assertAlmostEqual(float(out['gpu_temp_c']), 50.0, places=2)
+        self.assertAlmostEqual(float(out['gpu0.gpu_utilization_pct']), 10.0, places=2)
+
+    def test_unknown_device(self):
+        """An unknown UUID fails with exit code 5"""
+        rc, _ = self.run_monitor(['true'], scenario=self.SCENARIO, options=['--devices=GPU-nope'])
+        self.assertEqual(rc, 5)
+        self.assertIn('GPU-nope', self.stderr)
+
+    def test_bad_selector(self):
+        """Unparseable selectors are rejected"""
+        rc, _ = self.run_monitor(['true'], scenario=self.SCENARIO, options=['--devices=foo'])
+        self.assertEqual(rc, 5)
+
+
+class TestStreamingAggregates(GpuMonitorTestCase):
+    """Streaming min/max/std/percentiles and periodic snapshots"""
+
+    def test_distribution_statistics(self):
+        """Stats of a 100 W / 200 W trace (80% / 20% of the time)"""
+        scenario = 'at 0 0 power_mw=100000 gr_mhz=1000\nat 400 0 power_mw=200000 gr_mhz=500\n'
+        rc, out = self.run_monitor(['sleep', '0.5'], sample_ms=5, scenario=scenario)
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertAlmostEqual(float(out['power_w.min']), 100.0, places=2)
+        self.assertAlmostEqual(float(out['power_w.max']), 200.0, places=2)
+        # Percentiles come from a sketch with 0.5% relative error
+        self.assertAlmostEqual(float(out['power_w.p50']), 100.0, delta=0.5)
+        self.assertAlmostEqual(float(out['power_w.p99']), 200.0, delta=1.0)
+        self.assertAlmostEqual(float(out['power_w.std']), 40.0, delta=8.0)
+        self.assertAlmostEqual(float(out['gpu0.core_clock_MHz.min']), 500.0, places=2)
+        self.assertAlmostEqual(float(out['gpu0.core_clock_MHz.p50']), 1000.0, delta=5.0)
+
+    def test_constant_trace_has_zero_spread(self):
+        """A constant trace has std 0 and all percentiles equal to the value"""
+        rc, out = self.run_monitor(['sleep', '0.1'], scenario='at 0 0 power_mw=75000 temp_c=45\n')
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertAlmostEqual(float(out['power_w.std']), 0.0, places=3)
+        for stat in ('p50', 'p95', 'p99'):
+            self.assertAlmostEqual(float(out['power_w.' + stat]), 75.0, places=3)
+            self.assertAlmostEqual(float(out['gpu0.temp_c.' + stat]), 45.0, places=3)
+
+    def test_periodic_snapshot(self):
+        """--snapshot-ms rewrites the report while the child is still running"""
+        env = dict(os.environ)
+        env['MOCK_NVML_SCRIPT'] = self.write_scenario('at 0 0 power_mw=100000\n')
+        args = [MONITOR_BIN, '--snapshot-ms=50', '10', self.out_file, 'sleep', '1.0']
+        proc = subprocess.Popen(args, env=env)
+        try:
+            deadline = time.time() + 0.6
+            snap = None
+            while time.time() < deadline:
+                time.sleep(0.05)
+                if os.path.exists(self.out_file):
+                    snap = read_report(self.out_file)
+            self.assertIsNotNone(snap, 'no snapshot written')
+            self.assertEqual(snap['status'], 'running')
+            self.assertGreater(int(snap['samples']), 10)
+            self.assertGreater(float(snap['energy_j']), 0.0)
+        finally:
+            proc.wait(timeout=30)
+        self.assertEqual(proc.returncode, 0)
+        final = read_report(self.out_file)
+        self.assertEqual(final['status'], 'complete')
+        self.assertGreater(int(final['samples']), int(snap['samples']))
+        self.assertFalse(os.path.exists(self.out_file + '.tmp'))
+
+    def test_no_snapshot_by_default(self):
+        """Without --snapshot-ms nothing is written before the child exits"""
+        env = dict(os.environ)
+        env['MOCK_NVML_SCRIPT'] = self.write_scenario('at 0 0 power_mw=100000\n')
+        proc = subprocess.Popen([MONITOR_BIN, '10', self.out_file, 'sleep', '0.4'], env=env)
+        time.sleep(0.2)
+        self.assertFalse(os.path.exists(self.out_file))
+        proc.wait(timeout=30)
+        self.assertEqual(read_report(self.out_file)['status'], 'complete')
+
+
+class TestSampleTrace(GpuMonitorTestCase):
+    """Per-sample time series written by the background trace writer"""
+
+    SCENARIO = ('devices 2\n'
+                'at 0 * power_mw=100000 sm_mhz=1400 mem_mhz=5000 util_gpu=90 temp_c=60\n'
+                'at 150 1 sm_mhz=900 throttle=0x4\n')
+
+    def read_binary_trace(self, path):
+        with open(path, 'rb') as f:
+            data = f.read()
+        magic, version, size = struct.unpack_from('<8sII', data, 0)
+        self.assertEqual((magic, version, size), (b'GPUTRACE', 1, 40))
+        fmt = '<dQfIIIII'
+        return [struct.unpack_from(fmt, data, off) for off in range(16, len(data), size)]
+
+    def test_csv_trace(self):
+        """CSV trace has one row per device and pass, including clock drops"""
+        trace = os.path.join(self.tmpdir, 'trace.csv')
+        rc, out = self.run_monitor(['sleep', '0.3'], scenario=self.SCENARIO,
+                                   options=['--trace=' + trace])
+        self.assertEqual(rc, 0, self.stderr)
+        with open(trace) as f:
+            rows = list(csv.DictReader(f))
+        self.assertEqual(len(rows), 2 * int(out['samples']))
+        self.assertEqual(int(out['trace_records']), len(rows))
+        self.assertEqual(out['trace_dropped'], '0')
+        self.assertEqual(out['trace_format'], 'csv')
+
+        gpu1 = [r for r in rows if r['gpu'] == '1']
+        self.assertEqual(gpu1[0]['sm_mhz'], '1400')
+        self.assertEqual(gpu1[0]['throttle_reasons'], '0x0')
+        self.assertEqual(gpu1[-1]['sm_mhz'], '900')
+        self.assertEqual(gpu1[-1]['throttle_reasons'], '0x4')
+        self.assertTrue(all(r['sm_mhz'] == '1400' for r in rows if r['gpu'] == '0'))
+        times = [float(r['t_s']) for r in gpu1]
+        self.assertEqual(times, sorted(times))
+        drop = next(float(r['t_s']) for r in gpu1 if r['sm_mhz'] == '900')
+        self.assertAlmostEqual(drop, 0.15, delta=0.03)
+
+    def test_binary_trace(self):
+        """Binary trace holds the same records in packed form"""
+        trace = os.path.join(self.tmpdir, 'trace.bin')
+        rc, out = self.run_monitor(['sleep', '0.3'], scenario=self.SCENARIO,
+                                   options=['--trace=' + trace, '--trace-format=bin'])
+        self.assertEqual(rc, 0, self.stderr)
+        records = self.read_binary_trace(trace)
+        self.assertEqual(len(records), int(out['trace_records']))
+        self.assertEqual(len(records), 2 * int(out['samples']))
+        t_s, throttle, power_w, gpu, sm, mem, util, temp = records[-1]
+        self.assertEqual((gpu, sm, mem, util, temp, throttle), (1, 900, 5000, 90, 60, 4))
+        self.assertAlmostEqual(power_w, 100.0, places=3)
+
+    def test_bad_trace_path(self):
+        """An unwritable trace path fails before the command is started"""
+        marker = os.path.join(self.tmpdir, 'ran')
+        rc, _ = self.run_monitor(['touch', marker], scenario=self.SCENARIO,
+                                 options=['--trace=' + os.path.join(self.tmpdir, 'no', 'trace.csv')])
+        self.assertEqual(rc, 6)
+        self.assertFalse(os.path.exists(marker))
+
+    def test_bad_trace_format(self):
+        """Unknown trace formats are rejected"""
+        rc, _ = self.run_monitor(['true'], options=['--trace=x', '--trace-format=xml'])
+        self.assertEqual(rc, 2)
+
+
+class TestThrottleReasons(GpuMonitorTestCase):
+    """Time under each clock throttle reason and run contamination"""
+
+    SCENARIO = ('at 0 0 power_mw=100000 sm_mhz=1400 throttle=none\n'
+                'at 200 0 sm_mhz=1100 throttle=sw_power_cap|sw_thermal\n'
+                'at 300 0 sm_mhz=1400 throttle=applications_clocks\n')
+
+    def test_time_per_reason(self):
+        """Each reason is charged the time it was reported for"""
+        rc, out = self.run_monitor(['sleep', '0.4'], sample_ms=5, scenario=self.SCENARIO)
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['throttle_supported'], '1')
+        self.assertEqual(out['throttle_reasons'], 'applications_clocks|sw_power_cap|sw_thermal')
+        self.assertAlmostEqual(float(out['throttle.sw_power_cap_s']), 0.1, delta=0.02)
+        self.assertAlmostEqual(float(out['throttle.sw_thermal_s']), 0.1, delta=0.02)
+        self.assertAlmostEqual(float(out['throttle.applications_clocks_s']), 0.1, delta=0.03)
+        self.assertEqual(float(out['throttle.hw_slowdown_s']), 0.0)
+        self.assertEqual(out['throttle_contaminated'], '1')
+        self.assertAlmostEqual(float(out['throttle_contaminated_s']), 0.1, delta=0.02)
+        self.assertAlmostEqual(float(out['throttle_contaminated_pct']), 25.0, delta=6.0)
+        self.assertEqual(out['gpu0.throttle_contaminated'], '1')
+
+    def test_intentional_clocks_not_contaminated(self):
+        """Application clock settings and idle do not contaminate a run"""
+        scenario = 'at 0 0 power_mw=100000 throttle=applications_clocks|gpu_idle\n'
+        rc, out = self.run_monitor(['sleep', '0.1'], scenario=scenario)
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['throttle_contaminated'], '0')
+        self.assertGreater(float(out['throttle.applications_clocks_s']), 0.0)
+
+    def test_tolerance(self):
+        """--throttle-tolerance-pct ignores short throttling episodes"""
+        rc, out = self.run_monitor(['sleep', '0.4'], sample_ms=5, scenario=self.SCENARIO,
+                                   options=['--throttle-tolerance-pct=50'])
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['throttle_contaminated'], '0')
+        self.assertGreater(float(out['throttle_contaminated_s']), 0.0)
+
+    def test_tolerance_boundary(self):
+        """Throttling must exceed the tolerance: exactly P% is not contaminated"""
+        scenario = 'at 0 0 power_mw=100000 throttle=sw_thermal\n'
+        for tolerance, contaminated in (('100', '0'), ('99.9', '1')):
+            rc, out = self.run_monitor(['sleep', '0.1'], scenario=scenario,
+                                       options=['--throttle-tolerance-pct=' + tolerance])
+            self.assertEqual(rc, 0, self.stderr)
+            self.assertEqual(float(out['throttle_contaminated_pct']), 100.0)
+            self.assertEqual(out['throttle_contaminated'], contaminated, tolerance)
+
+    def test_numeric_mask(self):
+        """Reasons can also be scripted as a raw bitmask"""
+        rc, out = self.run_monitor(['sleep', '0.1'], scenario='at 0 0 power_mw=1000 throttle=0x48\n')
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['throttle_reasons'], 'hw_slowdown|hw_thermal')
+
+    def test_per_device(self):
+        """Node-level reasons are the union over devices"""
+        scenario = ('devices 2\n'
+                    'at 0 * power_mw=100000\n'
+                    'at 0 1 throttle=hw_power_brake\n')
+        rc, out = self.run_monitor(['sleep', '0.1'], scenario=scenario)
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['gpu0.throttle_reasons'], 'none')
+        self.assertEqual(out['gpu0.throttle_contaminated'], '0')
+        self.assertEqual(out['gpu1.throttle_reasons'], 'hw_power_brake')
+        self.assertEqual(out['throttle_reasons'], 'hw_power_brake')
+        self.assertEqual(out['throttle_contaminated'], '1')
+
+    def test_unsupported(self):
+        """Devices that cannot report reasons are marked unsupported"""
+        trace = os.path.join(self.tmpdir, 'trace.csv')
+        scenario = 'at 0 0 power_mw=100000\nfail throttle NOT_SUPPORTED\n'
+        rc, out = self.run_monitor(['sleep', '0.1'], scenario=scenario, options=['--trace=' + trace])
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['throttle_supported'], '0')
+        self.assertNotIn('throttle_contaminated', out)
+        with open(trace) as f:
+            rows = list(csv.DictReader(f))
+        self.assertTrue(rows)
+        self.assertTrue(all(r['throttle_reasons'] == '' for r in rows))
+
+
+class TestClockSweep(GpuMonitorTestCase):
+    """Application/locked clock control and multi-pair sweeps"""
+
+    SCENARIO = ('devices 2\n'
+                'at 0 * power_mw=100000 gr_mhz=1000 sm_mhz=1000 mem_mhz=5000\n'
+                'clocks * 5001:1530,1200,900\n'
+                'clocks * 810:405\n')
+
+    def setUp(self):
+        super().setUp()
+        self.log = os.path.join(self.tmpdir, 'nvml.log')
+
+    def clock_log(self):
+        if not os.path.exists(self.log):
+            return []
+        with open(self.log) as f:
+            return [line.strip() for line in f]
+
+    def run_sweep(self, command, options, scenario=None):
+        return self.run_monitor(command, scenario=scenario or self.SCENARIO, options=options,
+                                env={'MOCK_NVML_LOG': self.log})
+
+    def test_list_clocks(self):
+        """--list-clocks prints every supported pair per device"""
+        env = dict(os.environ)
+        env['MOCK_NVML_SCRIPT'] = self.write_scenario(self.SCENARIO)
+        proc = run([MONITOR_BIN, '--devices=1', '--list-clocks'], env=env, timeout=30)
+        self.assertEqual(proc.returncode, 0)
+        self.assertEqual(proc.stdout.strip(),
+                         'gpu1.supported_clocks=5001:1530,5001:1200,5001:900,810:405')
+
+    def test_sweep_pairs(self):
+        """Each pair gets its own report with the clocks in effect, then defaults return"""
+        out = os.path.join(self.tmpdir, 'out_{mem}_{gr}.txt')
+        args = [MONITOR_BIN, '--clocks=5001:1200,810:405', '10', out, 'sleep', '0.1']
+        env = dict(os.environ, MOCK_NVML_SCRIPT=self.write_scenario(self.SCENARIO), MOCK_NVML_LOG=self.log)
+        proc = run(args, env=env, timeout=60)
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+
+        first = read_report(os.path.join(self.tmpdir, 'out_5001_1200.txt'))
+        second = read_report(os.path.join(self.tmpdir, 'out_810_405.txt'))
+        self.assertEqual((first['clock_mode'], first['sweep_index'], first['sweep_total']), ('app', '0', '2'))
+        self.assertEqual(float(first['gpu_core_clock_MHz']), 1200.0)
+        self.assertEqual(float(first['gpu1.gpu_mem_clock_MHz']), 5001.0)
+        self.assertEqual(second['clock_set_gr_MHz'], '405')
+        self.assertEqual(float(second['gpu_core_clock_MHz']), 405.0)
+        self.assertEqual(self.clock_log(), ['set_app 0 5001 1200', 'set_app 1 5001 1200',
+                                            'set_app 0 810 405', 'set_app 1 810 405',
+                                            'reset_app 0', 'reset_app 1'])
+
+    def test_all_pairs_default_suffix(self):
+        """--clocks=all runs every supported pair; paths get a _MEM_GR suffix"""
+        rc, _ = self.run_sweep(['true'], ['--devices=0', '--clocks=all'])
+        self.assertEqual(rc, 0, self.stderr)
+        for pair in ('5001_1530', '5001_1200', '5001_900', '810_405'):
+            self.assertTrue(os.path.exists(os.path.join(self.tmpdir, 'out_%s.txt' % pair)), pair)
+        self.assertEqual(self.clock_log()[-1], 'reset_app 0')
+
+    def test_single_pair_keeps_path(self):
+        """A single pair writes to the output path unchanged"""
+        rc, out = self.run_sweep(['true'], ['--clocks=5001:900'])
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['clock_set_gr_MHz'], '900')
+
+    def test_locked_clocks(self):
+        """Locked mode pins graphics and memory clocks and resets both"""
+        rc, out = self.run_sweep(['true'], ['--devices=0', '--clock-mode=locked', '--clocks=5001:1100'])
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['clock_mode'], 'locked')
+        self.assertEqual(float(out['gpu_core_clock_MHz']), 1100.0)
+        self.assertEqual(self.clock_log(), ['set_locked_gr 0 1100 1100', 'set_locked_mem 0 5001 5001',
+                                            'reset_locked_gr 0', 'reset_locked_mem 0'])
+
+    def test_unsupported_pair(self):
+        """Unsupported application clocks are rejected before the command runs"""
+        marker = os.path.join(self.tmpdir, 'ran')
+        rc, _ = self.run_sweep(['touch', marker], ['--clocks=5001:1000'])
+        self.assertEqual(rc, 7)
+        self.assertIn('not supported', self.stderr)
+        self.assertFalse(os.path.exists(marker))
+        self.assertEqual(self.clock_log(), [])
+
+    def test_permission_denied(self):
+        """A failed clock change stops the sweep and restores what was changed"""
+        scenario = self.SCENARIO + 'fail setclocks NO_PERMISSION device=1\n'
+        marker = os.path.join(self.tmpdir, 'ran')
+        rc, _ = self.run_sweep(['touch', marker], ['--clocks=5001:1200'], scenario=scenario)
+        self.assertEqual(rc, 7)
+        self.assertIn('Insufficient Permissions', self.stderr)
+        self.assertFalse(os.path.exists(marker))
+        self.assertEqual(self.clock_log(), ['set_app 0 5001 1200', 'reset_app 0', 'reset_app 1'])
+
+    def test_signal_restores_defaults(self):
+        """SIGTERM stops the sweep, is forwarded to the command and restores clocks"""
+        env = dict(os.environ, MOCK_NVML_SCRIPT=self.write_scenario(self.SCENARIO), MOCK_NVML_LOG=self.log)
+        args = [MONITOR_BIN, '--clocks=5001:1530,5001:900', '10', self.out_file, 'sleep', '30']
+        proc = subprocess.Popen(args, env=env)
+        time.sleep(0.3)
+        proc.send_signal(signal.SIGTERM)
+        rc = proc.wait(timeout=10)
+        self.assertEqual(rc, 128 + signal.SIGTERM)
+        self.assertEqual(self.clock_log(), ['set_app 0 5001 1530', 'set_app 1 5001 1530',
+                                            'reset_app 0', 'reset_app 1'])
+        report = read_report(os.path.join(self.tmpdir, 'out_5001_1530.txt'))
+        self.assertEqual(report['status'], 'complete')
+
+    def test_bad_clock_list(self):
+        """Malformed pairs and modes are usage errors"""
+        rc, _ = self.run_monitor(['true'], options=['--clocks=5001'])
+        self.assertEqual(rc, 2)
+        rc, _ = self.run_monitor(['true'], options=['--clocks=5001:900', '--clock-mode=fast'])
+        self.assertEqual(rc, 2)
+
+
+class TestChildSupervision(GpuMonitorTestCase):
+    """pidfd exit detection, signal forwarding and child resource usage"""
+
+    def test_exit_detected_before_next_sample(self):
+        """A child exiting mid-period ends the run without waiting for the deadline"""
+        start = time.monotonic()
+        rc, out = self.run_monitor(['sleep', '0.1'], sample_ms=5000)
+        elapsed = time.monotonic() - start
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertLess(elapsed, 2.0)
+        self.assertLess(float(out['duration_s']), 1.0)
+        self.assertEqual(out['samples'], '2')
+
+    def test_sigterm_forwarded(self):
+        """SIGTERM to the monitor reaches the command; the run is still reported"""
+        env = dict(os.environ, MOCK_NVML_SCRIPT=self.write_scenario('at 0 0 power_mw=100000\n'))
+        proc = subprocess.Popen([MONITOR_BIN, '10', self.out_file, 'sleep', '30'], env=env)
+        time.sleep(0.3)
+        proc.send_signal(signal.SIGTERM)
+        rc = proc.wait(timeout=10)
+        self.assertEqual(rc, 128 + signal.SIGTERM)
+        out = read_report(self.out_file)
+        self.assertEqual(out['status'], 'complete')
+        self.assertEqual(out['forwarded_signal'], str(int(signal.SIGTERM)))
+        self.assertLess(float(out['duration_s']), 5.0)
+
+    def test_sigint_handled_by_command(self):
+        """A command that traps the forwarded signal decides the exit code"""
+        env = dict(os.environ, MOCK_NVML_SCRIPT=self.write_scenario('at 0 0 power_mw=100000\n'))
+        script = "trap 'kill $!; exit 3' INT; sleep 30 & wait"
+        proc = subprocess.Popen([MONITOR_BIN, '10', self.out_file, 'sh', '-c', script], env=env)
+        time.sleep(0.3)
+        proc.send_signal(signal.SIGINT)
+        self.assertEqual(proc.wait(timeout=10), 3)
+
+    def test_child_rusage(self):
+        """CPU time, peak RSS and page faults of the command are reported"""
+        script = 'import time\nb = bytearray(64 << 20)\nt = time.process_time()\n' \
+                 'while time.process_time() - t < 0.2: pass\n'
+        rc, out = self.run_monitor(['python3', '-c', script])
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertGreater(float(out['child_user_cpu_s']) + float(out['child_sys_cpu_s']), 0.15)
+        self.assertGreater(int(out['child_max_rss_kb']), 64 * 1024)
+        self.assertGreater(int(out['child_minor_faults']), 0)
+        self.assertIn('child_major_faults', out)
+        self.assertNotIn('forwarded_signal', out)
+
+
+class TestProcessAttribution(GpuMonitorTestCase):
+    """--per-process: device energy split by the command's utilization share"""
+
+    def setUp(self):
+        super().setUp()
+        self.pidfile = os.path.join(self.tmpdir, 'pid')
+        # Stands in for another job on the GPU: not a descendant of the monitor
+        self.other_pid = os.getpid()
+
+    def scenario(self, ours, other=None):
+        text = 'at 0 0 power_mw=100000 util_gpu=80\nproc 0 0 @%s %s\n' % (self.pidfile, ours)
+        if other:
+            text += 'proc 0 0 %d %s\n' % (self.other_pid, other)
+        return text
+
+    def test_shared_device(self):
+        """Energy is apportioned by SM utilization share; device-wide energy is kept"""
+        cmd = ['sh', '-c', 'echo $$ > %s; sleep 0.4' % self.pidfile]
+        rc, out = self.run_monitor(cmd, scenario=self.scenario('sm=60 used_mib=512', 'sm=20 used_mib=1024'),
+                                   options=['--per-process'])
+        self.assertEqual(rc, 0, self.stderr)
+        device_j = float(out['gpu0.energy_j'])
+        self.assertAlmostEqual(float(out['gpu0.energy_attributed_j']), 0.75 * device_j, delta=0.05 * device_j)
+        self.assertAlmostEqual(float(out['gpu0.energy_attributed_pct']), 75.0, delta=5.0)
+        self.assertAlmostEqual(float(out['energy_attributed_j']), float(out['gpu0.energy_attributed_j']), places=3)
+        self.assertEqual(out['gpu0.proc_supported'], '1')
+        self.assertEqual(out['gpu0.proc_count_max'], '1')
+        self.assertEqual(out['gpu0.proc_other_count_max'], '1')
+        self.assertAlmostEqual(float(out['gpu0.proc_mem_used_mib_max']), 512.0, places=1)
+        self.assertAlmostEqual(float(out['gpu0.proc_sm_util_pct']), 60.0, delta=5.0)
+
+    def test_descendant_process(self):
+        """GPU work in a grandchild of the monitor counts for the command"""
+        cmd = ['sh', '-c', 'sleep 0.4 & echo $! > %s; wait' % self.pidfile]
+        rc, out = self.run_monitor(cmd, scenario=self.scenario('sm=90 used_mib=256'), options=['--per-process'])
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['gpu0.proc_count_max'], '1')
+        self.assertAlmostEqual(float(out['gpu0.energy_attributed_pct']), 100.0, delta=5.0)
+
+    def test_other_job_only(self):
+        """A command that does not use the GPU is attributed nothing"""
+        rc, out = self.run_monitor(['sleep', '0.2'], scenario=self.scenario('running=0', 'sm=90'),
+                                   options=['--per-process'])
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertGreater(float(out['gpu0.energy_j']), 0.0)
+        self.assertEqual(float(out['gpu0.energy_attributed_j']), 0.0)
+        self.assertEqual(out['gpu0.proc_count_max'], '0')
+        self.assertEqual(out['gpu0.proc_other_count_max'], '1')
+
+    def test_process_count_fallback(self):
+        """Without per-process utilization the share follows the process count"""
+        cmd = ['sh', '-c', 'echo $$ > %s; sleep 0.4' % self.pidfile]
+        scenario = self.scenario('sm=60', 'sm=20') + 'fail procutil NOT_SUPPORTED\n'
+        rc, out = self.run_monitor(cmd, scenario=scenario, options=['--per-process'])
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertAlmostEqual(float(out['gpu0.energy_attributed_pct']), 50.0, delta=5.0)
+
+    def test_off_by_default(self):
+        """No per-process queries or keys without --per-process"""
+        rc, out = self.run_monitor(['true'], scenario=self.scenario('sm=60'))
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertNotIn('energy_attributed_j', out)
+        self.assertNotIn('gpu0.proc_supported', out)
+
+
+class TestErrorInjection(GpuMonitorTestCase):
+    """Injected NVML error codes"""
+
+    def test_init_failure(self):
+        """nvmlInit failure returns 4 but still waits for the child"""
+        marker = os.path.join(self.tmpdir, 'ran')
+        rc, out = self.run_monitor(['touch', marker], scenario='fail init DRIVER_NOT_LOADED\n')
+        self.assertEqual(rc, 4)
+        self.assertIn('Driver Not Loaded', self.stderr)
+        self.assertTrue(os.path.exists(marker))
+        self.assertIsNone(out)
+
+    def test_handle_failure(self):
+        """Device handle failure returns 5"""
+        rc, _ = self.run_monitor(['true'], scenario='fail handle GPU_IS_LOST\n')
+        self.assertEqual(rc, 5)
+
+    def test_transient_power_errors(self):
+        """Failed power reads are counted and left out of power and energy"""
+        scenario = 'at 0 0 power_mw=100000\nfail power NOT_SUPPORTED skip=2 count=3\n'
+        rc, out = self.run_monitor(['sleep', '0.2'], scenario=scenario)
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['power_read_errors'], '3')
+        self.assertEqual(out['gpu0.power_read_errors'], '3')
+        self.assertAlmostEqual(float(out['power_avg_w']), 100.0, places=2)
+        for stat in ('min', 'p50', 'max'):
+            self.assertAlmostEqual(float(out['power_w.' + stat]), 100.0, delta=0.5)
+        # the gap left by the failed reads is bridged at 100 W
+        self.assertAlmostEqual(float(out['energy_integrated_j']), 100.0 * float(out['duration_s']), delta=1.5)
+
+    def test_bad_scenario(self):
+        """A malformed scenario makes nvmlInit fail"""
+        rc, _ = self.run_monitor(['true'], scenario='bogus directive\n')
+        self.assertEqual(rc, 4)
+        self.assertIn('cannot parse', self.stderr)
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""
+Tests for the CPU+GPU split GEMM (work-stealing queues, adaptive split, per-device
+shares, --verify and arguments) running with the CPU backend standing in for the
+GPU, hetero_gemm_host.
+
+Point HETERO_GEMM_BIN at hetero_gemm_host, or run through ctest:
+    cmake -S gpu_benchmark -B build && cmake --build build && ctest --test-dir build
+"""
+
+import os
+import unittest
+
+from support import BenchmarkTestCase, parse_line, skip_unless_executable
+
+HETERO_BIN = os.environ.get('HETERO_GEMM_BIN', '')
+
+SUMMARY_KEYS = ['kernel_name', 'problem_size', 'iterations', 'time_s', 'gflops', 'gpu_kernel',
+                'cpu_threads', 'chunk_rows', 'split_first', 'split_last', 'gpu_share', 'cpu_share',
+                'gpu_gflops', 'cpu_gflops', 'steals']
+
+
+@skip_unless_executable(HETERO_BIN, 'HETERO_GEMM_BIN', 'hetero_gemm_host')
+class HeteroTestCase(BenchmarkTestCase):
+
+    binary = HETERO_BIN
+
+    def output(self, *args):
+        """Per-pass lines and the summary of a successful run"""
+        proc = self.run_benchmark(*args)
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        lines = [dict(parse_line(line)) for line in proc.stdout.splitlines()]
+        return lines[:-1], lines[-1]
+
+
+class TestSchedule(HeteroTestCase):
+
+    def test_summary_keys(self):
+        proc = self.run_benchmark(64, 32, 48, '--passes=2', '--cpu-threads=2')
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        fields = parse_line(proc.stdout)
+        self.assertEqual([k for k, _ in fields], SUMMARY_KEYS)
+        values = dict(fields)
+        self.assertEqual(values['kernel_name'], 'hetero_gemm')
+        self.assertEqual(values['problem_size'], '64x32x48')
+        self.assertEqual(values['iterations'], '2')
+        self.assertEqual(values['gpu_kernel'], 'naive')
+        self.assertEqual(values['cpu_threads'], '2')
+        self.assertAlmostEqual(float(values['gpu_share']) + float(values['cpu_share']), 1.0, places=3)
+
+    def test_both_devices_verify(self):
+        # ragged chunks (7 rows), a tiled kernel on the "GPU" side
+        _, v = self.output(131, 45, 70, '--chunk-rows=7', '--cpu-threads=2', '--split=0.5',
+                           '--kernel=tiled_64x64x16_4x4', '--passes=3', '--verify')
+        self.assertEqual(v['verify'], 'pass')
+        self.assertEqual(v['gpu_kernel'], 'tiled_64x64x16_4x4')
+
+    def test_cpu_work_is_stolen_when_all_queued_on_gpu(self):
+        # how much the CPU threads get depends on the scheduler, but all of it is stolen
+        passes, v = self.output(256, 32, 32, '--chunk-rows=4', '--gpu-batch=2', '--cpu-threads=2',
+                                '--split=1', '--passes=2', '--show-passes', '--verify')
+        self.assertEqual(v['verify'], 'pass')
+        for p in passes:
+            self.assertEqual(int(p['gpu_steals']), 0)
+            self.assertEqual(int(p['cpu_steals']) * 4, int(p['cpu_rows']))
+        self.assertEqual(int(v['steals']), sum(int(p['cpu_steals']) for p in passes[1:]))
+
+    def test_gpu_work_is_stolen_when_all_queued_on_cpu(self):
+        passes, v = self.output(96, 16, 16, '--chunk-rows=8', '--cpu-threads=1', '--split=0',
+                                '--passes=2', '--show-passes', '--verify')
+        self.assertEqual(v['verify'], 'pass')
+        for p in passes:
+            self.assertEqual(int(p['cpu_steals']), 0)
+            self.assertLessEqual(int(p['gpu_rows']), int(p['gpu_steals']) * 8)
+
+    def test_gpu_only(self):
+        _, v = self.output(100, 20, 30, '--devices=gpu', '--verify')
+        self.assertEqual(v['cpu_threads'], '0')
+        self.assertEqual(float(v['gpu_share']), 1.0)
+        self.assertEqual(int(v['steals']), 0)
+        self.assertEqual(v['verify'], 'pass')
+
+    def test_cpu_only(self):
+        _, v = self.output(100, 20, 30, '--devices=cpu', '--cpu-threads=3', '--verify')
+        self.assertEqual(v['gpu_kernel'], 'none')
+        self.assertEqual(float(v['cpu_share']), 1.0)
+        self.assertEqual(float(v['gpu_gflops']), 0.0)
+        self.assertEqual(v['verify'], 'pass')
+
+    def test_fixed_split(self):
+        passes, v = self.output(128, 16, 16, '--split=0.25', '--chunk-rows=8', '--cpu-threads=2',
+                                '--passes=3', '--show-passes')
+        self.assertEqual(len(passes), 4)  # warmup pass 0, then the timed passes
+        for p in passes:
+            self.assertEqual(p['split'], '0.250')
+        self.assertEqual(v['split_first'], '0.250')
+        self.assertEqual(v['split_last'], '0.250')
+
+
+class TestAdaptiveSplit(HeteroTestCase):
+
+    def test_split_follows_measured_rates(self):
+        passes, v = self.output(240, 64, 64, '--chunk-rows=8', '--cpu-threads=2', '--passes=3',
+                                '--show-passes')
+        self.assertEqual([int(p['pass']) for p in passes], [0, 1, 2, 3])
+        self.assertEqual(passes[0]['split'], '0.500')
+        for prev, cur in zip(passes, passes[1:]):
+            gpu_rows, cpu_rows = int(prev['gpu_rows']), int(prev['cpu_rows'])
+            gpu_s, cpu_s = float(prev['gpu_s']), float(prev['cpu_s'])
+            if gpu_rows and cpu_rows and gpu_s > 0 and cpu_s > 0:
+                gpu_rate, cpu_rate = gpu_rows / gpu_s, cpu_rows / cpu_s
+                expected = gpu_rate / (gpu_rate + cpu_rate)
+            else:
+                expected = float(prev['split'])  # one device idle: nothing to rebalance on
+            self.assertAlmostEqual(float(cur['split']), expected, delta=0.002)
+            self.assertTrue(0.0 <= float(cur['split']) <= 1.0)
+        self.assertEqual(v['split_first'], passes[1]['split'])
+        self.assertEqual(v['split_last'], passes[-1]['split'])
+
+    def test_rows_cover_the_matrix(self):
+        passes, _ = self.output(200, 16, 16, '--chunk-rows=9', '--cpu-threads=3', '--passes=2',
+                                '--show-passes')
+        for p in passes:
+            self.assertEqual(int(p['gpu_rows']) + int(p['cpu_rows']), 200)
+
+
+class TestArguments(HeteroTestCase):
+
+    def test_missing_arguments(self):
+        self.assert_usage(64, 64)
+
+    def test_bad_split(self):
+        proc = self.assert_usage(64, 64, 64, '--split=1.5')
+        self.assertIn('--split', proc.stderr)
+
+    def test_bad_devices(self):
+        self.assert_usage(64, 64, 64, '--devices=fpga')
+
+    def test_wmma_kernel_rejected(self):
+        proc = self.assert_usage(64, 64, 64, '--kernel=wmma_fp16')
+        self.assertIn('FP32 kernel', proc.stderr)
+
+    def test_unknown_kernel(self):
+        self.assert_usage(64, 64, 64, '--kernel=fast')
+
+    def test_cpu_only_without_threads(self):
+        proc = self.assert_usage(64, 64, 64, '--devices=cpu', '--cpu-threads=0')
+        self.assertIn('--cpu-threads', proc.stderr)
+
+    def test_zero_chunk_rows(self):
+        self.assert_usage(64, 64, 64, '--chunk-rows=0')
+
+
+if __name__ == '__main__':
+    unittest.main()
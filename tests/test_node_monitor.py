@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+"""
+End-to-end tests for node_monitor (RAPL + NVML whole-node energy) running against a
+fake powercap tree and the mock NVML library.
+
+The binary under test is node_monitor_mock (built from gpu_benchmark/ with
+GPU_MONITOR_BUILD_MOCK=ON). Point NODE_MONITOR_BIN at it, or run through ctest:
+    cmake -S gpu_benchmark -B build && cmake --build build && ctest --test-dir build
+"""
+
+import os
+import unittest
+
+from support import FakePowercap, MonitorTestCase, skip_unless_executable
+
+MONITOR_BIN = os.environ.get('NODE_MONITOR_BIN', '')
+
+# 100 W for the whole run (see mock_nvml.cpp for the scenario format)
+GPU_SCENARIO = 'at 0 0 power_mw=100000 gr_mhz=1150 mem_mhz=1566\n'
+
+
+@skip_unless_executable(MONITOR_BIN, 'NODE_MONITOR_BIN', 'node_monitor_mock')
+class NodeMonitorTestCase(MonitorTestCase):
+    """Base class: the monitor runner of support.py plus an empty fake powercap tree"""
+
+    binary = MONITOR_BIN
+    scenario = GPU_SCENARIO
+
+    def setUp(self):
+        super().setUp()
+        self.powercap = FakePowercap(os.path.join(self.tmpdir, 'powercap'))
+        os.mkdir(self.powercap.root)
+
+    def monitor_options(self):
+        return ['--rapl-root=' + self.powercap.root]
+
+
+class TestNodeEnergy(NodeMonitorTestCase):
+    """CPU and GPU components on one timeline"""
+
+    def test_cpu_and_gpu_breakdown(self):
+        """Node total is the sum of the counted CPU domains and the GPU"""
+        pkg = self.powercap.add_zone('intel-rapl:0', 'package-0', 1000000)
+        dram = self.powercap.add_zone('intel-rapl:0:1', 'dram', 0)
+        script = 'sleep 0.1; %s; sleep 0.2' % self.powercap.shell_set_energy((pkg, 11000000), (dram, 2000000))
+        rc, out = self.run_monitor(['sh', '-c', script])
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['sources'], 'rapl,nvml')
+        self.assertEqual(out['components'], '3')
+        self.assertAlmostEqual(float(out['component.package-0.energy_j']), 10.0, places=3)
+        self.assertAlmostEqual(float(out['component.package-0.dram.energy_j']), 2.0, places=3)
+        self.assertEqual(out['component.gpu0.kind'], 'gpu')
+        duration = float(out['duration_s'])
+        gpu_j = float(out['component.gpu0.energy_j'])
+        self.assertAlmostEqual(gpu_j, 100.0 * duration, delta=100.0 * 0.03)
+        self.assertAlmostEqual(float(out['energy_cpu_j']), 12.0, places=3)
+        self.assertAlmostEqual(float(out['energy_gpu_j']), gpu_j, places=3)
+        total = float(out['energy_total_j'])
+        self.assertAlmostEqual(total, 12.0 + gpu_j, places=2)
+        self.assertAlmostEqual(float(out['energy_cpu_pct']) + float(out['energy_gpu_pct']),
+                               100.0, places=1)
+
+    def test_edp_and_ed2p(self):
+        """EDP = E*t and ED2P = E*t^2 of the whole node"""
+        pkg = self.powercap.add_zone('intel-rapl:0', 'package-0', 0)
+        script = 'sleep 0.1; ' + self.powercap.shell_set_energy((pkg, 5000000))
+        rc, out = self.run_monitor(['sh', '-c', script])
+        self.assertEqual(rc, 0, self.stderr)
+        e, t = float(out['energy_total_j']), float(out['duration_s'])
+        self.assertAlmostEqual(float(out['edp']), e * t, delta=e * t * 0.01)
+        self.assertAlmostEqual(float(out['ed2p']), e * t * t, delta=e * t * t * 0.01)
+        self.assertAlmostEqual(float(out['power_avg_w']), e / t, delta=e / t * 0.01)
+
+    def test_subdomains_not_double_counted(self):
+        """core/uncore are inside the package and psys spans everything: not in the total"""
+        pkg = self.powercap.add_zone('intel-rapl:0', 'package-0', 0)
+        core = self.powercap.add_zone('intel-rapl:0:0', 'core', 0)
+        psys = self.powercap.add_zone('intel-rapl:1', 'psys', 0)
+        script = 'sleep 0.05; ' + self.powercap.shell_set_energy((pkg, 4000000), (core, 3000000),
+                                                                 (psys, 9000000))
+        rc, out = self.run_monitor(['sh', '-c', script], options=['--gpu=none'])
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['component.package-0.core.in_total'], '0')
+        self.assertEqual(out['component.psys.in_total'], '0')
+        self.assertAlmostEqual(float(out['component.package-0.core.energy_j']), 3.0, places=3)
+        self.assertAlmostEqual(float(out['component.psys.energy_j']), 9.0, places=3)
+        self.assertAlmostEqual(float(out['energy_total_j']), 4.0, places=3)
+
+    def test_counter_wraparound(self):
+        """A counter passing max_energy_range_uj keeps accumulating"""
+        pkg = self.powercap.add_zone('intel-rapl:0', 'package-0', 9000000, max_uj=10000000)
+        script = 'sleep 0.1; ' + self.powercap.shell_set_energy((pkg, 2000000))
+        rc, out = self.run_monitor(['sh', '-c', script], options=['--gpu=none'])
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertAlmostEqual(float(out['component.package-0.energy_j']), 3.0, places=3)
+
+    def test_exit_code_propagated(self):
+        """Monitor returns the child's exit code"""
+        self.powercap.add_zone('intel-rapl:0', 'package-0', 0)
+        rc, out = self.run_monitor(['sh', '-c', 'exit 5'])
+        self.assertEqual(rc, 5)
+        self.assertEqual(out['status'], 'complete')
+        self.assertIn('child_user_cpu_s', out)
+        self.assertIn('child_max_rss_kb', out)
+
+
+class TestPluggableSources(NodeMonitorTestCase):
+    """Either half, or both, may be missing"""
+
+    def test_gpu_only(self):
+        """No RAPL domains: the GPU alone makes up the node"""
+        rc, out = self.run_monitor(['sleep', '0.1'])
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['sources'], 'nvml')
+        self.assertEqual(float(out['energy_cpu_j']), 0.0)
+        self.assertAlmostEqual(float(out['energy_gpu_pct']), 100.0, places=3)
+
+    def test_cpu_only(self):
+        """NVML failing to initialize is skipped in auto mode"""
+        pkg = self.powercap.add_zone('intel-rapl:0', 'package-0', 0)
+        script = 'sleep 0.05; ' + self.powercap.shell_set_energy((pkg, 1000000))
+        rc, out = self.run_monitor(['sh', '-c', script], scenario='fail init DRIVER_NOT_LOADED\n')
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['sources'], 'rapl')
+        self.assertAlmostEqual(float(out['energy_total_j']), 1.0, places=3)
+
+    def test_neither(self):
+        """With no source the run is still timed and reported"""
+        rc, out = self.run_monitor(['sleep', '0.1'], scenario='fail init DRIVER_NOT_LOADED\n')
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['sources'], 'none')
+        self.assertEqual(out['components'], '0')
+        self.assertEqual(float(out['energy_total_j']), 0.0)
+        self.assertGreaterEqual(float(out['duration_s']), 0.1)
+
+    def test_disabled_sources(self):
+        """--cpu=none / --gpu=none leave a source out even when present"""
+        self.powercap.add_zone('intel-rapl:0', 'package-0', 0)
+        rc, out = self.run_monitor(['true'], options=['--cpu=none', '--gpu=none'])
+        self.assertEqual(rc, 0, self.stderr)
+        self.assertEqual(out['sources'], 'none')
+
+    def test_required_source_missing(self):
+        """--cpu=rapl / --gpu=nvml fail with exit code 4 when unavailable"""
+        rc, _ = self.run_monitor(['true'], options=['--cpu=rapl'])
+        self.assertEqual(rc, 4)
+        self.assertIn('RAPL unavailable', self.stderr)
+        rc, _ = self.run_monitor(['true'], options=['--gpu=nvml'],
+                                 scenario='fail init DRIVER_NOT_LOADED\n')
+        self.assertEqual(rc, 4)
+        self.assertIn('NVML unavailable', self.stderr)
+
+    def test_bad_option(self):
+        """Invalid source mode is a usage error"""
+        rc, _ = self.run_monitor(['true'], options=['--cpu=perf'])
+        self.assertEqual(rc, 2)
+
+
+if __name__ == '__main__':
+    unittest.main()
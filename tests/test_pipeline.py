@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""
+Tests for the copy/compute pipeline benchmark (scheduler, overlap accounting,
+pinned vs pageable, --verify and arguments) running on its simulated device,
+pipeline_host. The device model is deterministic, so overlap figures can be
+asserted; see pipeline_sim.cpp for its engines and rates.
+
+Point PIPELINE_BIN at pipeline_host, or run through ctest:
+    cmake -S gpu_benchmark -B build && cmake --build build && ctest --test-dir build
+"""
+
+import os
+import unittest
+
+from support import BenchmarkTestCase, parse_line, skip_unless_executable
+
+PIPELINE_BIN = os.environ.get('PIPELINE_BIN', '')
+
+SUMMARY_KEYS = ['kernel_name', 'problem_size', 'chunk_bytes', 'depth', 'streams', 'host',
+                'iterations', 'time_s', 'h2d_s', 'kernel_s', 'd2h_s', 'overlap', 'throughput_gbps']
+
+
+@skip_unless_executable(PIPELINE_BIN, 'PIPELINE_BIN', 'pipeline_host')
+class PipelineTestCase(BenchmarkTestCase):
+
+    binary = PIPELINE_BIN
+
+    def summary(self, *args):
+        proc = self.run_benchmark(*args)
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        return dict(parse_line(proc.stdout))
+
+
+class TestSchedule(PipelineTestCase):
+
+    def test_summary_keys(self):
+        proc = self.run_benchmark(2, '--passes=2')
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        fields = parse_line(proc.stdout)
+        self.assertEqual([k for k, _ in fields], SUMMARY_KEYS)
+        values = dict(fields)
+        self.assertEqual(values['kernel_name'], 'pipeline')
+        self.assertEqual(values['problem_size'], str(2 << 20))
+        self.assertEqual(values['chunk_bytes'], str(4 << 20))
+        self.assertEqual(values['depth'], '3')
+        # 2 MB in one 4 MB chunk: a single stream whatever the depth
+        self.assertEqual(values['streams'], '1')
+        self.assertEqual(values['host'], 'pinned')
+        self.assertEqual(values['iterations'], '2')
+
+    def test_depth_one_is_serial(self):
+        v = self.summary(4, '--chunk-kb=512', '--depth=1', '--passes=2')
+        serial = float(v['h2d_s']) + float(v['kernel_s']) + float(v['d2h_s'])
+        # one chunk in flight: a pass is its stages back to back (plus issue costs)
+        self.assertAlmostEqual(float(v['time_s']) / 2, serial, delta=serial * 0.05)
+        self.assertLess(float(v['overlap']), 0.05)
+
+    def test_depth_overlaps_pinned(self):
+        serial = self.summary(4, '--chunk-kb=256', '--depth=1', '--passes=2')
+        piped = self.summary(4, '--chunk-kb=256', '--depth=3', '--passes=2')
+        self.assertGreater(float(piped['overlap']), 0.8)
+        self.assertGreater(float(piped['throughput_gbps']), 1.5 * float(serial['throughput_gbps']))
+        # the stage reference does not depend on depth
+        self.assertEqual(piped['h2d_s'], serial['h2d_s'])
+
+    def test_pageable_blocks_overlap(self):
+        pinned = self.summary(4, '--chunk-kb=256', '--depth=3', '--passes=2')
+        pageable = self.summary(4, '--chunk-kb=256', '--depth=3', '--passes=2', '--host=pageable')
+        self.assertEqual(pageable['host'], 'pageable')
+        self.assertLess(float(pageable['overlap']), 0.1)
+        self.assertGreater(float(pageable['h2d_s']), float(pinned['h2d_s']))
+        self.assertLess(float(pageable['throughput_gbps']), float(pinned['throughput_gbps']))
+
+    def test_one_chunk_cannot_overlap(self):
+        v = self.summary(1, '--chunk-kb=1024', '--depth=4', '--passes=1')
+        self.assertEqual(v['depth'], '4')
+        self.assertEqual(v['streams'], '1')
+        self.assertLess(float(v['overlap']), 0.05)
+
+    def test_intensity_scales_kernel(self):
+        light = self.summary(1, '--intensity=8', '--passes=1')
+        heavy = self.summary(1, '--intensity=64', '--passes=1')
+        # 8x the FMAs; the fixed issue cost keeps the ratio a little below 8
+        self.assertGreater(float(heavy['kernel_s']), 5 * float(light['kernel_s']))
+        self.assertEqual(heavy['h2d_s'], light['h2d_s'])
+
+
+class TestVerification(PipelineTestCase):
+
+    def test_verify_depths(self):
+        # uneven last chunk and more chunks than streams exercise slot reuse
+        for depth in (1, 2, 3, 5):
+            v = self.summary(3, '--chunk-kb=700', '--depth=%d' % depth, '--passes=2', '--verify')
+            self.assertEqual(v['verify'], 'pass', depth)
+            self.assertEqual(float(v['max_err']), 0.0)
+
+    def test_verify_pageable(self):
+        v = self.summary(2, '--chunk-kb=300', '--host=pageable', '--passes=1', '--verify')
+        self.assertEqual(v['verify'], 'pass')
+
+
+class TestArguments(PipelineTestCase):
+
+    def test_missing_size(self):
+        self.assert_usage('--depth=2')
+
+    def test_bad_size(self):
+        self.assert_usage('0')
+        self.assert_usage('1.5')
+
+    def test_bad_options(self):
+        for arg in ('--depth=0', '--depth=33', '--chunk-kb=x', '--intensity=-1', '--passes=0',
+                    '--host=managed', '--fast'):
+            self.assert_usage(1, arg)
+
+    def test_options_anywhere(self):
+        v = self.summary('--depth=2', 1, '--passes=1')
+        self.assertEqual(v['depth'], '2')
+        self.assertEqual(v['problem_size'], str(1 << 20))
+
+
+if __name__ == '__main__':
+    unittest.main()
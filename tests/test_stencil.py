@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""
+Tests for the 3D stencil benchmark driver (benchmarks/gpu) running against its CPU
+backend, stencil_host: argument handling, variant selection, --verify of the
+shared-memory and register-streaming decompositions, and the summary line.
+
+Point STENCIL_BIN at stencil_host (or at the CUDA stencil binary on a GPU machine), or
+run through ctest:
+    cmake -S gpu_benchmark -B build && cmake --build build && ctest --test-dir build
+"""
+
+import os
+import unittest
+
+from support import BenchmarkTestCase, parse_line, skip_unless_executable
+
+STENCIL_BIN = os.environ.get('STENCIL_BIN', '')
+
+# Same keys, in the same order, as gemm_benchmark
+SUMMARY_KEYS = ['kernel_name', 'problem_size', 'iterations', 'time_s', 'gflops',
+                'occupancy', 'block', 'numSM']
+VARIANTS = ['stencil7_smem', 'stencil7_regstream', 'stencil27_smem', 'stencil27_regstream']
+
+
+@skip_unless_executable(STENCIL_BIN, 'STENCIL_BIN', 'stencil_host')
+class StencilTestCase(BenchmarkTestCase):
+
+    binary = STENCIL_BIN
+
+    def run_lines(self, *args):
+        proc = self.run_benchmark(*args)
+        self.assertEqual(proc.returncode, 0, proc.stdout + proc.stderr)
+        return [dict(parse_line(l)) for l in proc.stdout.splitlines()]
+
+
+class TestSummaryLine(StencilTestCase):
+
+    def test_list_kernels(self):
+        proc = self.run_benchmark('--list-kernels')
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        self.assertEqual(proc.stdout.split(), VARIANTS)
+
+    def test_gemm_compatible_keys(self):
+        proc = self.run_benchmark('8x9x10', 3)
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        fields = parse_line(proc.stdout)
+        self.assertEqual([k for k, _ in fields], SUMMARY_KEYS)
+        values = dict(fields)
+        self.assertEqual(values['kernel_name'], 'stencil7_smem')
+        self.assertEqual(values['problem_size'], '8x9x10')
+        self.assertEqual(values['iterations'], '3')
+        self.assertEqual(values['block'], '32x4x4')
+
+    def test_point_count_is_cube(self):
+        # the frequency sweep passes a point count: 1000 -> 10x10x10
+        values = self.run_lines(1000)[0]
+        self.assertEqual(values['problem_size'], '10x10x10')
+        self.assertEqual(values['iterations'], '10')
+
+    def test_regstream_block(self):
+        values = self.run_lines('6x6x6', 1, '--kernel=stencil27_regstream')[0]
+        self.assertEqual(values['kernel_name'], 'stencil27_regstream')
+        self.assertEqual(values['block'], '32x8x1')
+
+    def test_all_variants(self):
+        names = [v['kernel_name'] for v in self.run_lines('5x5x5', 1, '--kernel=all')]
+        self.assertEqual(names, VARIANTS)
+
+
+class TestVerification(StencilTestCase):
+
+    def check_all(self, size, iterations):
+        lines = self.run_lines(size, iterations, '--kernel=all', '--verify')
+        self.assertEqual(len(lines), len(VARIANTS))
+        for values in lines:
+            self.assertEqual(values['verify'], 'pass', values)
+            self.assertLess(float(values['max_err']), iterations * 32 * 1.2e-7, values)
+
+    def test_single_interior_point(self):
+        self.check_all('3x3x3', 1)
+
+    def test_odd_sizes_even_iterations(self):
+        self.check_all('13x7x11', 4)
+
+    def test_odd_iterations(self):
+        # the result ends in the other ping-pong buffer
+        self.check_all('9x10x8', 3)
+
+    def test_larger_than_one_block(self):
+        self.check_all('40x12x9', 2)
+
+
+class TestArguments(StencilTestCase):
+
+    def test_missing_size(self):
+        self.assert_usage()
+
+    def test_too_many_arguments(self):
+        self.assert_usage('8x8x8', 2, 3)
+
+    def test_dimension_too_small(self):
+        proc = self.assert_usage('2x8x8')
+        self.assertIn('invalid size', proc.stderr)
+
+    def test_point_count_too_small(self):
+        self.assert_usage(8)
+
+    def test_malformed_size(self):
+        self.assert_usage('8x8')
+        self.assert_usage('8x8x8x')
+
+    def test_bad_iterations(self):
+        self.assert_usage('8x8x8', 0)
+
+    def test_unknown_kernel(self):
+        proc = self.assert_usage('8x8x8', '--kernel=stencil9_smem')
+        self.assertIn('unknown kernel', proc.stderr)
+
+    def test_unknown_option(self):
+        self.assert_usage('8x8x8', '--fast')
+
+
+if __name__ == '__main__':
+    unittest.main()
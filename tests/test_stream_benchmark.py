@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""
+Tests for the STREAM benchmark driver (op selection, the block/grid sweep, --verify
+and the summary line) running against its CPU backend, stream_benchmark_host.
+
+Point STREAM_BENCHMARK_BIN at stream_benchmark_host (or at the CUDA stream_benchmark
+on a GPU machine), or run through ctest:
+    cmake -S gpu_benchmark -B build && cmake --build build && ctest --test-dir build
+"""
+
+import os
+import unittest
+
+from support import BenchmarkTestCase, parse_line, skip_unless_executable
+
+STREAM_BIN = os.environ.get('STREAM_BENCHMARK_BIN', '')
+
+SUMMARY_KEYS = ['kernel_name', 'problem_size', 'iterations', 'time_s', 'bandwidth_gbs',
+                'occupancy', 'active_blocks_per_sm', 'block', 'grid', 'numSM']
+
+OPS = ['copy', 'scale', 'add', 'triad']
+
+
+@skip_unless_executable(STREAM_BIN, 'STREAM_BENCHMARK_BIN', 'stream_benchmark_host')
+class StreamBenchmarkTestCase(BenchmarkTestCase):
+
+    binary = STREAM_BIN
+
+    def lines(self, *args):
+        proc = self.run_benchmark(*args)
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        return [dict(parse_line(line)) for line in proc.stdout.splitlines()]
+
+
+class TestSweep(StreamBenchmarkTestCase):
+
+    def test_summary_keys(self):
+        proc = self.run_benchmark(1000, 2, '--op=triad')
+        self.assertEqual(proc.returncode, 0, proc.stderr)
+        fields = parse_line(proc.stdout)
+        self.assertEqual([k for k, _ in fields], SUMMARY_KEYS)
+        values = dict(fields)
+        self.assertEqual(values['kernel_name'], 'stream_triad')
+        self.assertEqual(values['problem_size'], '1000')
+        self.assertEqual(values['iterations'], '2')
+        # defaults: 256 threads per block, one element per thread
+        self.assertEqual(values['block'], '256')
+        self.assertEqual(values['grid'], '4')
+        self.assertGreater(float(values['bandwidth_gbs']), 0.0)
+
+    def test_all_ops_by_default(self):
+        names = [v['kernel_name'] for v in self.lines(100, 1)]
+        self.assertEqual(names, ['stream_' + op for op in OPS])
+
+    def test_sweep_order(self):
+        # op, then block size, then grid size
+        rows = self.lines(512, 1, '--op=copy,add', '--block=64,128', '--grid=2,full')
+        got = [(v['kernel_name'], v['block'], v['grid']) for v in rows]
+        # the host backend has no SMs, so 2 blocks per SM launches 2 blocks
+        expected = [('stream_copy', '64', '2'), ('stream_copy', '64', '8'),
+                    ('stream_copy', '128', '2'), ('stream_copy', '128', '4'),
+                    ('stream_add', '64', '2'), ('stream_add', '64', '8'),
+                    ('stream_add', '128', '2'), ('stream_add', '128', '4')]
+        self.assertEqual(got, expected)
+
+    def test_bandwidth_counts_arrays(self):
+        # copy moves two arrays per element, triad three
+        for v in self.lines(4096, 5, '--op=copy,triad'):
+            arrays = 2 if v['kernel_name'] == 'stream_copy' else 3
+            expected = arrays * 8 * 4096 * 5 / float(v['time_s']) / 1e9
+            self.assertAlmostEqual(float(v['bandwidth_gbs']), expected, delta=expected * 0.01 + 0.002)
+
+    def test_host_occupancy_unknown(self):
+        v = self.lines(64, 1, '--op=scale')[0]
+        self.assertEqual(v['active_blocks_per_sm'], '0')
+        self.assertEqual(float(v['occupancy']), 0.0)
+
+
+class TestVerification(StreamBenchmarkTestCase):
+
+    def test_every_configuration_passes(self):
+        # ragged sizes and grids far smaller than the arrays (grid-stride loop)
+        rows = self.lines(1001, 3, '--block=32,96,1024', '--grid=1,3,full', '--verify')
+        self.assertEqual(len(rows), len(OPS) * 3 * 3)
+        for v in rows:
+            self.assertEqual(v['verify'], 'pass', v)
+            self.assertEqual(float(v['max_err']), 0.0)
+
+    def test_no_verify_fields_by_default(self):
+        v = self.lines(100, 1, '--op=copy')[0]
+        self.assertNotIn('verify', v)
+
+
+class TestArguments(StreamBenchmarkTestCase):
+
+    def test_missing_arguments(self):
+        self.assert_usage(100)
+
+    def test_zero_size(self):
+        proc = self.assert_usage(0, 1)
+        self.assertIn('invalid N', proc.stderr)
+
+    def test_unknown_op(self):
+        proc = self.assert_usage(100, 1, '--op=copy,mul')
+        self.assertIn('unknown op', proc.stderr)
+
+    def test_block_not_warp_multiple(self):
+        proc = self.assert_usage(100, 1, '--block=100')
+        self.assertIn('block size', proc.stderr)
+
+    def test_block_too_large(self):
+        self.assert_usage(100, 1, '--block=2048')
+
+    def test_bad_grid(self):
+        proc = self.assert_usage(100, 1, '--grid=0')
+        self.assertIn('invalid grid', proc.stderr)
+
+    def test_unknown_option(self):
+        self.assert_usage(100, 1, '--fast')
+
+    def test_options_anywhere(self):
+        rows = self.lines('--op=add', 100, '--verify', 2)
+        self.assertEqual(len(rows), 1)
+        self.assertEqual(rows[0]['verify'], 'pass')
+
+
+if __name__ == '__main__':
+    unittest.main()